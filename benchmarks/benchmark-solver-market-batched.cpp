@@ -0,0 +1,141 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "solver-market-batched.hpp"
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-generators.hpp"
+
+/* Many small systems with one sparsity pattern (solver-market-batched.hpp):
+  - batched: every system in one team-per-system kernel launch
+  - looped:  one Jacobi preconditioned solve per system, each iteration a few kernel launches and
+             host synchronisations (dot products)
+for CG and BiCGStab over 2D Laplacians of 256 rows (16 x 16 grid), each system with its own
+diagonal shift and right-hand side. The throughput is in systems/s. */
+
+#ifndef SOLVER_MARKET_GIT_COMMIT
+#define SOLVER_MARKET_GIT_COMMIT "unknown"
+#endif
+
+constexpr double SolverMarketBenchmarkTolerance = 1e-8;
+constexpr int SolverMarketBenchmarkMaxIterations = 500;
+
+struct SolverMarketBenchmarkBatch {
+  SolverMarketCSRMatrix<double, int> pattern;
+  SolverMarketBatchedCSR<double, int> A;
+  DeviceBatchView<double> B, X;
+};
+
+// n_systems copies of the Laplacian, system s shifted by 0.01 s on the diagonal
+static bool SolverMarketBenchmarkMakeBatch(const int n_systems, SolverMarketBenchmarkBatch& batch) {
+  {
+    std::streambuf* saved = std::cout.rdbuf(nullptr);
+    const int status = SolverMarketGenerate("laplace2d:n=16", batch.pattern);
+    if (status == SolverMarketGeneratorSuccess) batch.pattern.send_to_device();
+    std::cout.rdbuf(saved);
+    if (status != SolverMarketGeneratorSuccess) return false;
+  }
+  const auto pattern = SolverMarketDeviceCSR<double, int>::wrap(batch.pattern);
+  const int n = pattern.n_rows;
+  DeviceBatchView<double> values(Kokkos::view_alloc(Kokkos::WithoutInitializing, "batched_values"), n_systems, pattern.nnz());
+  batch.B = DeviceBatchView<double>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "batched_B"), n_systems, n);
+  batch.X = DeviceBatchView<double>("batched_X", n_systems, n);
+  auto offsets = pattern.offsets;
+  auto columns = pattern.columns;
+  auto a_values = pattern.values;
+  auto B = batch.B;
+  Kokkos::parallel_for("SolverMarket::benchmark_batch", Kokkos::RangePolicy<Device>(0, n_systems), KOKKOS_LAMBDA(const int s) {
+    for (int i = 0; i < n; i++) {
+      for (int k = offsets(i); k < offsets(i + 1); k++) values(s, k) = a_values(k) + (columns(k) == i ? 0.01 * s : 0.0);
+      B(s, i) = 1.0 + 0.001 * ((i + s) % 97);
+    }
+  });
+  batch.A = SolverMarketBatchedCSR<double, int>::wrap(pattern, values);
+  return true;
+}
+
+static void SolverMarketBenchmarkCounters(benchmark::State& state, const int n_systems, const int iterations) {
+  state.SetItemsProcessed(int64_t(state.iterations()) * n_systems);
+  state.counters["systems/s"] = benchmark::Counter(double(n_systems), benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["max_iterations"] = double(iterations);
+}
+
+// Every system in one launch, range(0) systems
+static void BM_BatchedSolve(benchmark::State& state, SolverMarketBatchedMethod method) {
+  const int n_systems = int(state.range(0));
+  SolverMarketBenchmarkBatch batch;
+  if (!SolverMarketBenchmarkMakeBatch(n_systems, batch)) {
+    state.SkipWithError("generate failed");
+    return;
+  }
+  int iterations = 0;
+  for (auto _ : state) {
+    Kokkos::deep_copy(batch.X, 0.0);
+    const auto results = SolverMarketBatchedSolve(batch.A, batch.B, batch.X, method, SolverMarketBenchmarkTolerance,
+                                                  SolverMarketBenchmarkMaxIterations);
+    for (const auto& result : results) {
+      if (!result.converged) state.SkipWithError("a system did not converge");
+      iterations = std::max(iterations, result.iterations);
+    }
+  }
+  SolverMarketBenchmarkCounters(state, n_systems, iterations);
+}
+
+// One solve per system on the same batch
+static void BM_LoopedSolve(benchmark::State& state, SolverMarketBatchedMethod method) {
+  const int n_systems = int(state.range(0));
+  SolverMarketBenchmarkBatch batch;
+  if (!SolverMarketBenchmarkMakeBatch(n_systems, batch)) {
+    state.SkipWithError("generate failed");
+    return;
+  }
+  // The systems as separate CSRs and vectors, built outside the timed loop
+  const auto pattern = SolverMarketDeviceCSR<double, int>::wrap(batch.pattern);
+  std::vector<SolverMarketDeviceCSR<double, int>> systems(n_systems, pattern);
+  std::vector<SolverMarketJacobiPreconditioner<double>> preconditioners;
+  std::vector<DeviceView<double>> rhs(n_systems);
+  DeviceView<double> x("looped_x", pattern.n_rows);
+  for (int s = 0; s < n_systems; s++) {
+    systems[s].values = DeviceView<double>("looped_values", pattern.nnz());
+    Kokkos::deep_copy(systems[s].values, Kokkos::subview(batch.A.values, s, Kokkos::ALL));
+    rhs[s] = DeviceView<double>("looped_b", pattern.n_rows);
+    Kokkos::deep_copy(rhs[s], Kokkos::subview(batch.B, s, Kokkos::ALL));
+    preconditioners.emplace_back(systems[s]);
+  }
+  int iterations = 0;
+  for (auto _ : state) {
+    for (int s = 0; s < n_systems; s++) {
+      Kokkos::deep_copy(x, 0.0);
+      const auto result = (method == SolverMarketBatchedCG)
+          ? SolverMarketPCG(systems[s], rhs[s], x, preconditioners[s], SolverMarketBenchmarkTolerance, SolverMarketBenchmarkMaxIterations)
+          : SolverMarketBiCGStab(systems[s], rhs[s], x, preconditioners[s], SolverMarketBenchmarkTolerance, SolverMarketBenchmarkMaxIterations);
+      if (!result.converged) state.SkipWithError("a system did not converge");
+      iterations = std::max(iterations, result.iterations);
+    }
+    Kokkos::fence();
+  }
+  SolverMarketBenchmarkCounters(state, n_systems, iterations);
+}
+
+int main(int argc, char** argv) {
+  Kokkos::initialize(argc, argv); {
+    benchmark::Initialize(&argc, argv);
+    benchmark::AddCustomContext("solver_market_commit", SOLVER_MARKET_GIT_COMMIT);
+
+    const std::pair<const char*, SolverMarketBatchedMethod> methods[] = {{"cg", SolverMarketBatchedCG}, {"bicgstab", SolverMarketBatchedBiCGStab}};
+    for (const auto& [name, method] : methods) {
+      benchmark::RegisterBenchmark((std::string("BM_BatchedSolve/") + name).c_str(), BM_BatchedSolve, method)
+          ->Arg(64)->Arg(1024)->Arg(8192)->Unit(benchmark::kMillisecond)->UseRealTime();
+      // The loop pays per system: fewer systems keep it short, the rate compares
+      benchmark::RegisterBenchmark((std::string("BM_LoopedSolve/") + name).c_str(), BM_LoopedSolve, method)
+          ->Arg(64)->Arg(1024)->Unit(benchmark::kMillisecond)->UseRealTime();
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+  }
+  Kokkos::finalize();
+  return 0;
+}
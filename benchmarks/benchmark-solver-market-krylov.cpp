@@ -0,0 +1,113 @@
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "solver-market-amg.hpp"
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-generators.hpp"
+#include "solver-market-krylov-ca.hpp"
+
+/* CG variants of solver-market-krylov-ca.hpp against the classic one:
+  - cg:           SolverMarketPCG, three reductions per iteration
+  - pipelined_cg: one fused reduction per iteration, overlapped with M and the SpMV
+  - sstep_cg/<s>: one reduction per s iterations
+on generated Poisson problems, Jacobi or AMG preconditioned. Each solve reports its iterations and
+global reductions. The thread count is fixed at Kokkos initialization: to see how the variants
+scale, run the binary once per --kokkos-num-threads (recorded in the context). */
+
+#ifndef SOLVER_MARKET_GIT_COMMIT
+#define SOLVER_MARKET_GIT_COMMIT "unknown"
+#endif
+
+constexpr double SolverMarketBenchmarkTolerance = 1e-8;
+constexpr int SolverMarketBenchmarkMaxIterations = 2000;
+
+struct SolverMarketBenchmarkProblem {
+  SolverMarketCSRMatrix<double, int> matrix;
+  SolverMarketDeviceCSR<double, int> A;
+  DeviceView<double> b;
+};
+
+static std::shared_ptr<SolverMarketBenchmarkProblem> SolverMarketBenchmarkMakeProblem(const std::string& spec) {
+  auto problem = std::make_shared<SolverMarketBenchmarkProblem>();
+  std::streambuf* saved = std::cout.rdbuf(nullptr);
+  const int status = SolverMarketGenerate(spec, problem->matrix);
+  if (status == SolverMarketGeneratorSuccess) problem->matrix.send_to_device();
+  std::cout.rdbuf(saved);
+  if (status != SolverMarketGeneratorSuccess) return nullptr;
+  problem->A = SolverMarketDeviceCSR<double, int>::wrap(problem->matrix);
+  problem->b = DeviceView<double>("krylov_b", problem->A.n_rows);
+  Kokkos::deep_copy(problem->b, 1.0);
+  return problem;
+}
+
+template <typename _PRECONDITIONER_>
+static void SolverMarketBenchmarkSolve(benchmark::State& state, const SolverMarketBenchmarkProblem& problem, _PRECONDITIONER_& M,
+                                       const SolverMarketCGVariant variant, const int s) {
+  DeviceView<double> x("krylov_x", problem.A.n_rows);
+  SolverMarketKrylovResult result;
+  for (auto _ : state) {
+    Kokkos::deep_copy(x, 0.0);
+    result = SolverMarketSolveCG(variant, problem.A, problem.b, x, M, SolverMarketBenchmarkTolerance, SolverMarketBenchmarkMaxIterations, s);
+    Kokkos::fence();
+    if (!result.converged) state.SkipWithError("did not converge");
+  }
+  state.counters["iterations"] = double(result.iterations);
+  state.counters["reductions"] = double(result.reductions);
+}
+
+static void BM_JacobiCG(benchmark::State& state, std::shared_ptr<SolverMarketBenchmarkProblem> problem, SolverMarketCGVariant variant, int s) {
+  SolverMarketJacobiPreconditioner<double> jacobi(problem->A);
+  SolverMarketBenchmarkSolve(state, *problem, jacobi, variant, s);
+}
+
+static void BM_AMGCG(benchmark::State& state, std::shared_ptr<SolverMarketBenchmarkProblem> problem, SolverMarketCGVariant variant, int s) {
+  SolverMarketAMG<double> amg;
+  {
+    std::streambuf* saved = std::cout.rdbuf(nullptr);
+    const int status = amg.setup(problem->A);
+    std::cout.rdbuf(saved);
+    if (status != 0) {
+      state.SkipWithError("AMG setup failed");
+      return;
+    }
+  }
+  SolverMarketBenchmarkSolve(state, *problem, amg, variant, s);
+}
+
+int main(int argc, char** argv) {
+  Kokkos::initialize(argc, argv); {
+    benchmark::Initialize(&argc, argv);
+    benchmark::AddCustomContext("solver_market_commit", SOLVER_MARKET_GIT_COMMIT);
+    benchmark::AddCustomContext("kokkos_concurrency", std::to_string(Device().concurrency()));
+
+    const std::pair<std::string, SolverMarketCGVariant> variants[] = {
+        {"cg", SolverMarketCGClassic}, {"pipelined_cg", SolverMarketCGPipelined}};
+    for (const std::string spec : {"laplace3d:n=32", "laplace3d:n=96"}) {
+      auto problem = SolverMarketBenchmarkMakeProblem(spec);
+      if (!problem) {
+        std::cerr << "[Error][SolverMarket][Benchmark] Could not generate " << spec << std::endl;
+        continue;
+      }
+      for (const auto& [name, variant] : variants) {
+        benchmark::RegisterBenchmark(("BM_JacobiCG/" + name + "/" + spec).c_str(), BM_JacobiCG, problem, variant, 1)
+            ->Unit(benchmark::kMillisecond)->UseRealTime();
+        benchmark::RegisterBenchmark(("BM_AMGCG/" + name + "/" + spec).c_str(), BM_AMGCG, problem, variant, 1)
+            ->Unit(benchmark::kMillisecond)->UseRealTime();
+      }
+      for (int s : {2, 4, 8}) {
+        const std::string name = "sstep_cg/s=" + std::to_string(s) + "/" + spec;
+        benchmark::RegisterBenchmark(("BM_JacobiCG/" + name).c_str(), BM_JacobiCG, problem, SolverMarketCGSStep, s)
+            ->Unit(benchmark::kMillisecond)->UseRealTime();
+        benchmark::RegisterBenchmark(("BM_AMGCG/" + name).c_str(), BM_AMGCG, problem, SolverMarketCGSStep, s)
+            ->Unit(benchmark::kMillisecond)->UseRealTime();
+      }
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+  }
+  Kokkos::finalize();
+  return 0;
+}
@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <string>
+
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-generators.hpp"
+#include "solver-market-numa.hpp"
+
+/* Host memory bandwidth against the placement of the pages (solver-market-numa.hpp):
+  - serial:      one thread touches the buffers, every page on the node of that thread
+  - first-touch: parallel first touch with the static partition of the kernels
+  - interleave:  pages spread round robin over the nodes, then first touch
+for a STREAM triad and a host CSR SpMV of a 3D Laplacian. On a single-node machine the three
+give the same numbers; on two sockets, with OMP_PROC_BIND=spread OMP_PLACES=cores, serial
+placement runs at the bandwidth of one socket. */
+
+#ifndef SOLVER_MARKET_GIT_COMMIT
+#define SOLVER_MARKET_GIT_COMMIT "unknown"
+#endif
+
+enum SolverMarketBenchmarkPlacement { SolverMarketBenchmarkSerial, SolverMarketBenchmarkFirstTouch, SolverMarketBenchmarkInterleave };
+
+// A fresh host buffer of n entries placed as asked, then filled with `value` in parallel
+template <typename _TYPE_>
+static HostView<_TYPE_> SolverMarketBenchmarkPlaced(const size_t n, const SolverMarketBenchmarkPlacement placement, const _TYPE_ value) {
+  HostView<_TYPE_> view(Kokkos::view_alloc(Kokkos::WithoutInitializing, "numa_benchmark"), n);
+  if (placement == SolverMarketBenchmarkSerial) {
+    for (size_t i = 0; i < n; i++) view(i) = _TYPE_(0);
+  } else {
+    if (placement == SolverMarketBenchmarkInterleave) SolverMarketInterleavePages(view.data(), n * sizeof(_TYPE_));
+    SolverMarketFirstTouch(view, n);
+  }
+  Kokkos::parallel_for("SolverMarket::benchmark_fill", Kokkos::RangePolicy<Host, Kokkos::Schedule<Kokkos::Static>>(0, n),
+      [&](const size_t i) { view(i) = value; });
+  return view;
+}
+
+static void SolverMarketBenchmarkCounters(benchmark::State& state, const double bytes) {
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytes));
+  state.counters["GB/s"] = benchmark::Counter(bytes / 1e9, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["threads"] = double(Host().concurrency());
+  state.counters["nodes"] = double(SolverMarketNumaNodes().size());
+}
+
+// a = b + s c over 2^range(0) doubles
+static void BM_Triad(benchmark::State& state, SolverMarketBenchmarkPlacement placement) {
+  const size_t n = size_t(1) << state.range(0);
+  auto a = SolverMarketBenchmarkPlaced<double>(n, placement, 0.0);
+  auto b = SolverMarketBenchmarkPlaced<double>(n, placement, 1.0);
+  auto c = SolverMarketBenchmarkPlaced<double>(n, placement, 2.0);
+  for (auto _ : state) {
+    Kokkos::parallel_for("SolverMarket::benchmark_triad", Kokkos::RangePolicy<Host, Kokkos::Schedule<Kokkos::Static>>(0, n),
+        [&](const size_t i) { a(i) = b(i) + 3.0 * c(i); });
+    benchmark::DoNotOptimize(a.data());
+  }
+  SolverMarketBenchmarkCounters(state, 3.0 * n * sizeof(double));
+}
+
+// y = A x on the host, A a 7 point Laplacian on a range(0)^3 grid. The CSR is copied into
+// buffers placed as asked (x interleaved in the interleave mode, as SolverMarketVector does)
+static void BM_HostSpMV(benchmark::State& state, SolverMarketBenchmarkPlacement placement) {
+  SolverMarketCSRMatrix<double, int> A;
+  {
+    std::streambuf* saved = std::cout.rdbuf(nullptr);
+    const int status = SolverMarketGenerate("laplace3d:n=" + std::to_string(state.range(0)), A);
+    std::cout.rdbuf(saved);
+    if (status != SolverMarketGeneratorSuccess) {
+      state.SkipWithError("generate failed");
+      return;
+    }
+  }
+  const size_t n = A.get_n(), nnz = A.get_nnz();
+  const auto matrix_placement = (placement == SolverMarketBenchmarkInterleave) ? SolverMarketBenchmarkFirstTouch : placement;
+  auto offsets = SolverMarketBenchmarkPlaced<int>(n + 1, matrix_placement, 0);
+  auto x = SolverMarketBenchmarkPlaced<double>(n, placement, 1.0);
+  auto y = SolverMarketBenchmarkPlaced<double>(n, matrix_placement, 0.0);
+  const int* offsets_A = A.get_host_offsets_pointer();
+  Kokkos::parallel_for("SolverMarket::benchmark_copy", Kokkos::RangePolicy<Host, Kokkos::Schedule<Kokkos::Static>>(0, n + 1),
+      [&](const size_t i) { offsets(i) = offsets_A[i]; });
+
+  // Entries placed by rows (SolverMarketCSRMatrix::place_entries), or by one thread for serial
+  HostView<int> columns(Kokkos::view_alloc(Kokkos::WithoutInitializing, "numa_benchmark"), nnz);
+  HostView<double> values(Kokkos::view_alloc(Kokkos::WithoutInitializing, "numa_benchmark"), nnz);
+  if (matrix_placement == SolverMarketBenchmarkSerial) {
+    for (size_t k = 0; k < nnz; k++) {
+      columns(k) = 0;
+      values(k) = 0.0;
+    }
+  } else {
+    SolverMarketFirstTouchRows(columns, offsets, n);
+    SolverMarketFirstTouchRows(values, offsets, n);
+  }
+
+  // Rows are copied by the threads that own them in the SpMV, with their entries
+  const int* columns_A = A.get_host_columns_pointer();
+  const double* values_A = A.get_host_values_pointer();
+  Kokkos::parallel_for("SolverMarket::benchmark_copy", Kokkos::RangePolicy<Host, Kokkos::Schedule<Kokkos::Static>>(0, n),
+      [&](const size_t i) {
+        for (int k = offsets(i); k < offsets(i + 1); k++) {
+          columns(k) = columns_A[k];
+          values(k) = values_A[k];
+        }
+      });
+
+  for (auto _ : state) {
+    Kokkos::parallel_for("SolverMarket::benchmark_spmv", Kokkos::RangePolicy<Host, Kokkos::Schedule<Kokkos::Static>>(0, n),
+        [&](const size_t i) {
+          double sum = 0;
+          for (int k = offsets(i); k < offsets(i + 1); k++) sum += values(k) * x(columns(k));
+          y(i) = sum;
+        });
+    benchmark::DoNotOptimize(y.data());
+  }
+  // Compulsory traffic: the CSR once, x read once, y written once
+  SolverMarketBenchmarkCounters(state, double((n + 1) * sizeof(int) + nnz * (sizeof(int) + sizeof(double)) + 2 * n * sizeof(double)));
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(nnz));
+}
+
+int main(int argc, char** argv) {
+  Kokkos::initialize(argc, argv); {
+    benchmark::Initialize(&argc, argv);
+    benchmark::AddCustomContext("solver_market_commit", SOLVER_MARKET_GIT_COMMIT);
+    const auto binding = SolverMarketCheckThreadBinding();
+    benchmark::AddCustomContext("solver_market_numa_nodes", std::to_string(binding.nodes));
+    benchmark::AddCustomContext("solver_market_proc_bind", binding.bound ? "bound" : "not bound");
+
+    const std::pair<const char*, SolverMarketBenchmarkPlacement> placements[] = {
+        {"serial", SolverMarketBenchmarkSerial}, {"first-touch", SolverMarketBenchmarkFirstTouch}, {"interleave", SolverMarketBenchmarkInterleave}};
+    for (const auto& [name, placement] : placements) {
+      // 3 x 256 MB: well beyond the last level caches
+      benchmark::RegisterBenchmark((std::string("BM_Triad/") + name).c_str(), BM_Triad, placement)
+          ->Arg(25)->Unit(benchmark::kMillisecond)->UseRealTime();
+      // 2M rows, 14M nonzeros
+      benchmark::RegisterBenchmark((std::string("BM_HostSpMV/") + name).c_str(), BM_HostSpMV, placement)
+          ->Arg(128)->Unit(benchmark::kMillisecond)->UseRealTime();
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+  }
+  Kokkos::finalize();
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "solver-market-parse.hpp"
+
+/* Per-core throughput of the Matrix Market body parsers (bytes/s of entry lines):
+the historical getline + std::istringstream path against the parsing kernels, plus
+the parallel body driver on all host threads. */
+
+// Entry lines "i j value" as written by common tools, about 1M lines (~35 MB)
+static const std::string& SolverMarketBenchmarkBody() {
+  static std::string body;
+  if (body.empty()) {
+    std::mt19937_64 rng(12345);
+    std::uniform_int_distribution<int> index(1, 2000000);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    char line[96];
+    for (int l = 0; l < (1 << 20); l++) {
+      std::snprintf(line, sizeof(line), "%d %d %.16e\n", index(rng), index(rng), value(rng));
+      body += line;
+    }
+  }
+  return body;
+}
+
+static void BM_ParseIstringstream(benchmark::State& state) {
+  const std::string& body = SolverMarketBenchmarkBody();
+  for (auto _ : state) {
+    std::istringstream in(body);
+    std::string line;
+    double checksum = 0;
+    while (std::getline(in, line)) {
+      std::istringstream lineData(line);
+      long i, j;
+      double val;
+      lineData >> i >> j >> val;
+      checksum += val + i + j;
+    }
+    benchmark::DoNotOptimize(checksum);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(body.size()));
+}
+BENCHMARK(BM_ParseIstringstream)->Unit(benchmark::kMillisecond);
+
+static void BM_ParseKernel(benchmark::State& state) {
+  std::vector<char> buffer(SolverMarketBenchmarkBody().begin(), SolverMarketBenchmarkBody().end());
+  const size_t size = buffer.size();
+  buffer.resize(size + SolverMarketParsePadding, '\0');
+  for (auto _ : state) {
+    const char* p = buffer.data();
+    const char* end = p + size;
+    double checksum = 0;
+    while (p < end) {
+      const char* line_end = SolverMarketFindNewline(p, end);
+      long long i, j;
+      double val;
+      SolverMarketParseInteger(p, line_end, i);
+      SolverMarketParseInteger(p, line_end, j);
+      SolverMarketParseValue(p, line_end, val);
+      checksum += val + i + j;
+      p = line_end + 1;
+    }
+    benchmark::DoNotOptimize(checksum);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(size));
+}
+BENCHMARK(BM_ParseKernel)->Unit(benchmark::kMillisecond);
+
+static void BM_CountNewlines(benchmark::State& state) {
+  const std::string& body = SolverMarketBenchmarkBody();
+  for (auto _ : state) {
+    const size_t n = state.range(0) ? SolverMarketCountNewlines(body.data(), body.data() + body.size())
+                                    : SolverMarketCountNewlinesScalar(body.data(), body.data() + body.size());
+    benchmark::DoNotOptimize(n);
+  }
+  state.SetLabel(state.range(0) ? "simd" : "scalar");
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(body.size()));
+}
+BENCHMARK(BM_CountNewlines)->Arg(0)->Arg(1);
+
+// Full driver, all host threads
+static void BM_ParseBody(benchmark::State& state) {
+  const std::string& body = SolverMarketBenchmarkBody();
+  std::vector<long long> rows, cols;
+  std::vector<double> vals;
+  for (auto _ : state) {
+    std::istringstream in(body);
+    size_t stored;
+    SolverMarketParseBody(in,
+      [&](const size_t first, const size_t nlines) {
+        rows.resize(first + nlines); cols.resize(first + nlines); vals.resize(first + nlines);
+      },
+      [&](const char* p, const char* end, const size_t slot) -> int {
+        SolverMarketParseInteger(p, end, rows[slot]);
+        SolverMarketParseInteger(p, end, cols[slot]);
+        SolverMarketParseValue(p, end, vals[slot]);
+        return 0;
+      },
+      [&](const size_t, const size_t) {},
+      stored);
+    benchmark::DoNotOptimize(stored);
+  }
+  state.counters["threads"] = double(Host().concurrency());
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(body.size()));
+}
+BENCHMARK(BM_ParseBody)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+int main(int argc, char** argv) {
+  Kokkos::initialize(argc, argv); {
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+  }
+  Kokkos::finalize();
+  return 0;
+}
@@ -0,0 +1,287 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-generators.hpp"
+#include "solver-market-vector.hpp"
+#include "solver-market-sparse.hpp"
+#include "solver-market-sell.hpp"
+
+/* Each stage of the load pipeline on its own, so a regression can be pinned to one of them:
+  - read:   Matrix Market file to host CSR (bytes/s of file)
+  - build:  COO entries to host CSR, the part of the read after parsing (nnz/s)
+  - upload: send_to_device of the CSR (GB/s)
+  - spmv, dot: device kernels of the native solvers (nnz/s, GB/s)
+  - generate: in-memory matrices of solver-market-generators.hpp, no file at all (nnz/s)
+over scaled synthetic 2D Laplacians and every .mtx of the matrices directory (SOLVER_MARKET_MATRICES,
+default: matrices/ of the source tree). Archive with --benchmark_out=<file>.json, the commit is in
+the context of the report. */
+
+#ifndef SOLVER_MARKET_MATRICES_DIR
+#define SOLVER_MARKET_MATRICES_DIR "matrices"
+#endif
+#ifndef SOLVER_MARKET_GIT_COMMIT
+#define SOLVER_MARKET_GIT_COMMIT "unknown"
+#endif
+
+using BenchmarkMatrix = SolverMarketCSRMatrix<double, int>;
+using BenchmarkVector = SolverMarketVector<double, int>;
+using BenchmarkEntries = std::vector<std::tuple<int, int, double>>;
+
+// The reader logs every load: silenced inside the timed loops
+struct SolverMarketBenchmarkQuiet {
+  std::streambuf* saved = std::cout.rdbuf(nullptr);
+  ~SolverMarketBenchmarkQuiet() { std::cout.rdbuf(saved); }
+};
+
+struct SolverMarketBenchmarkInput {
+  std::string name;
+  std::string file;          /* Matrix Market file read by the read stage*/
+  int n = 0;
+  BenchmarkEntries entries;  /* COO of the same matrix for the build stage*/
+};
+
+// 5 point Laplacian on an nx x nx grid, written once to the temporary directory
+static SolverMarketBenchmarkInput SolverMarketBenchmarkLaplacian(const int nx) {
+  SolverMarketBenchmarkInput input;
+  input.name = "laplace2d_" + std::to_string(nx);
+  input.n = nx * nx;
+  input.entries.reserve(size_t(5) * input.n);
+  for (int y = 0; y < nx; y++) {
+    for (int x = 0; x < nx; x++) {
+      const int i = y * nx + x;
+      if (y > 0) input.entries.emplace_back(i, i - nx, -1.0);
+      if (x > 0) input.entries.emplace_back(i, i - 1, -1.0);
+      input.entries.emplace_back(i, i, 4.0);
+      if (x < nx - 1) input.entries.emplace_back(i, i + 1, -1.0);
+      if (y < nx - 1) input.entries.emplace_back(i, i + nx, -1.0);
+    }
+  }
+  input.file = (std::filesystem::temp_directory_path() / (input.name + ".mtx")).string();
+  std::ofstream out(input.file);
+  out << "%%MatrixMarket matrix coordinate real general\n" << input.n << " " << input.n << " " << input.entries.size() << "\n";
+  for (const auto& [i, j, value] : input.entries) out << i + 1 << " " << j + 1 << " " << value << "\n";
+  return input;
+}
+
+// A matrix of the matrices directory: read once, its COO taken back from the CSR
+static bool SolverMarketBenchmarkFromFile(const std::string& file, SolverMarketBenchmarkInput& input) {
+  BenchmarkMatrix A;
+  {
+    SolverMarketBenchmarkQuiet quiet;
+    if (A.read_matrix_market_file(file, SolverMarketCSRMatrixFull) != 0) return false;
+  }
+  input.name = std::filesystem::path(file).stem().string();
+  input.file = file;
+  input.n = A.get_n();
+  input.entries.clear();
+  input.entries.reserve(A.get_nnz());
+  const int* offsets = A.get_host_offsets_pointer();
+  const int* columns = A.get_host_columns_pointer();
+  const double* values = A.get_host_values_pointer();
+  for (int i = 0; i < input.n; i++)
+    for (int k = offsets[i]; k < offsets[i + 1]; k++) input.entries.emplace_back(i, columns[k], values[k]);
+  return true;
+}
+
+enum SolverMarketBenchmarkFileKind { SolverMarketBenchmarkSkip, SolverMarketBenchmarkVector, SolverMarketBenchmarkMatrix };
+
+// Coordinate files only: vectors (one column) are only read, matrices go through every stage
+static SolverMarketBenchmarkFileKind SolverMarketBenchmarkKind(const std::string& file) {
+  std::ifstream in(file);
+  std::string line;
+  if (!std::getline(in, line) || line.find("coordinate") == std::string::npos) return SolverMarketBenchmarkSkip;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '%') continue;
+    long rows = 0, cols = 0;
+    std::sscanf(line.c_str(), "%ld %ld", &rows, &cols);
+    return (cols == 1) ? SolverMarketBenchmarkVector : SolverMarketBenchmarkMatrix;
+  }
+  return SolverMarketBenchmarkSkip;
+}
+
+static size_t SolverMarketBenchmarkCSRBytes(size_t n, size_t nnz) {
+  return (n + 1) * sizeof(int) + nnz * (sizeof(int) + sizeof(double));
+}
+
+static void BM_Read(benchmark::State& state, std::shared_ptr<SolverMarketBenchmarkInput> input) {
+  const size_t bytes = std::filesystem::file_size(input->file);
+  for (auto _ : state) {
+    BenchmarkMatrix A;
+    SolverMarketBenchmarkQuiet quiet;
+    if (A.read_matrix_market_file(input->file, SolverMarketCSRMatrixFull) != 0) {
+      state.SkipWithError("read failed");
+      break;
+    }
+    benchmark::DoNotOptimize(A.get_host_values_pointer());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytes));
+  state.counters["MB/s"] = benchmark::Counter(double(bytes) / 1e6, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["nnz"] = double(input->entries.size());
+}
+
+static void BM_ReadVector(benchmark::State& state, std::string file) {
+  const size_t bytes = std::filesystem::file_size(file);
+  for (auto _ : state) {
+    BenchmarkVector v;
+    SolverMarketBenchmarkQuiet quiet;
+    if (v.read_matrix_market_file(file) != 0) {
+      state.SkipWithError("read failed");
+      break;
+    }
+    benchmark::DoNotOptimize(v.get_host_values_pointer());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytes));
+  state.counters["MB/s"] = benchmark::Counter(double(bytes) / 1e6, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void BM_BuildCSR(benchmark::State& state, std::shared_ptr<SolverMarketBenchmarkInput> input) {
+  BenchmarkMatrix A;
+  SolverMarketBenchmarkQuiet quiet;
+  for (auto _ : state) {
+    if (A.build_from_coo(input->n, input->entries) != 0) {
+      state.SkipWithError("build failed");
+      break;
+    }
+    benchmark::DoNotOptimize(A.get_host_values_pointer());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(input->entries.size()));
+  state.counters["threads"] = double(Host().concurrency());
+}
+
+static void BM_SendToDevice(benchmark::State& state, std::shared_ptr<SolverMarketBenchmarkInput> input) {
+  BenchmarkMatrix A;
+  SolverMarketBenchmarkQuiet quiet;
+  A.build_from_coo(input->n, input->entries);
+  const size_t bytes = SolverMarketBenchmarkCSRBytes(A.get_n(), A.get_nnz());
+  for (auto _ : state) {
+    A.send_to_device();
+    Kokkos::fence();
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytes));
+  state.counters["GB/s"] = benchmark::Counter(double(bytes) / 1e9, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void BM_SpMV(benchmark::State& state, std::shared_ptr<SolverMarketBenchmarkInput> input) {
+  BenchmarkMatrix A;
+  {
+    SolverMarketBenchmarkQuiet quiet;
+    A.build_from_coo(input->n, input->entries);
+    A.send_to_device();
+  }
+  auto device_A = SolverMarketDeviceCSR<double, int>::wrap(A);
+  DeviceView<double> x("x", A.get_n()), y("y", A.get_n());
+  Kokkos::deep_copy(x, 1.0);
+  for (auto _ : state) {
+    SolverMarketSpMV(device_A, x, y);
+    Kokkos::fence();
+  }
+  // Compulsory traffic: the CSR once, x read once, y written once
+  const size_t bytes = SolverMarketBenchmarkCSRBytes(A.get_n(), A.get_nnz()) + 2 * size_t(A.get_n()) * sizeof(double);
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(A.get_nnz()));
+  state.counters["GB/s"] = benchmark::Counter(double(bytes) / 1e9, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void BM_SpMVSELL(benchmark::State& state, std::shared_ptr<SolverMarketBenchmarkInput> input) {
+  BenchmarkMatrix A;
+  {
+    SolverMarketBenchmarkQuiet quiet;
+    A.build_from_coo(input->n, input->entries);
+    A.send_to_device();
+  }
+  auto device_A = SolverMarketToSELL(SolverMarketDeviceCSR<double, int>::wrap(A));
+  DeviceView<double> x("x", A.get_n()), y("y", A.get_n());
+  Kokkos::deep_copy(x, 1.0);
+  for (auto _ : state) {
+    SolverMarketSpMV(device_A, x, y);
+    Kokkos::fence();
+  }
+  // Compulsory traffic: the padded values and columns, the chunk arrays, x read once, y written once
+  const size_t bytes = device_A.padded() * (sizeof(double) + sizeof(int)) + size_t(device_A.n_chunks) * (sizeof(size_t) + sizeof(int))
+                       + device_A.rows.extent(0) * sizeof(int) + 2 * size_t(A.get_n()) * sizeof(double);
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(A.get_nnz()));
+  state.counters["GB/s"] = benchmark::Counter(double(bytes) / 1e9, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["padding"] = device_A.padding_overhead();
+}
+
+static void BM_Dot(benchmark::State& state, std::shared_ptr<SolverMarketBenchmarkInput> input) {
+  DeviceView<double> x("x", input->n), y("y", input->n);
+  Kokkos::deep_copy(x, 1.0);
+  Kokkos::deep_copy(y, 2.0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SolverMarketDot(x, y));
+  }
+  state.counters["GB/s"] = benchmark::Counter(2.0 * input->n * sizeof(double) / 1e9, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void BM_Generate(benchmark::State& state, std::string spec) {
+  BenchmarkMatrix A;
+  SolverMarketBenchmarkQuiet quiet;
+  for (auto _ : state) {
+    if (SolverMarketGenerate(spec, A) != SolverMarketGeneratorSuccess) {
+      state.SkipWithError("generate failed");
+      break;
+    }
+    benchmark::DoNotOptimize(A.get_host_values_pointer());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(A.get_nnz()));
+  state.counters["threads"] = double(Host().concurrency());
+}
+
+static void SolverMarketRegisterBenchmarks(std::shared_ptr<SolverMarketBenchmarkInput> input) {
+  const std::string suffix = "/" + input->name;
+  benchmark::RegisterBenchmark(("BM_Read" + suffix).c_str(), BM_Read, input)->Unit(benchmark::kMillisecond)->UseRealTime();
+  benchmark::RegisterBenchmark(("BM_BuildCSR" + suffix).c_str(), BM_BuildCSR, input)->Unit(benchmark::kMillisecond)->UseRealTime();
+  benchmark::RegisterBenchmark(("BM_SendToDevice" + suffix).c_str(), BM_SendToDevice, input)->Unit(benchmark::kMillisecond)->UseRealTime();
+  benchmark::RegisterBenchmark(("BM_SpMV" + suffix).c_str(), BM_SpMV, input)->Unit(benchmark::kMicrosecond)->UseRealTime();
+  benchmark::RegisterBenchmark(("BM_SpMVSELL" + suffix).c_str(), BM_SpMVSELL, input)->Unit(benchmark::kMicrosecond)->UseRealTime();
+  benchmark::RegisterBenchmark(("BM_Dot" + suffix).c_str(), BM_Dot, input)->Unit(benchmark::kMicrosecond)->UseRealTime();
+}
+
+int main(int argc, char** argv) {
+  Kokkos::initialize(argc, argv); {
+    benchmark::Initialize(&argc, argv);
+    benchmark::AddCustomContext("solver_market_commit", SOLVER_MARKET_GIT_COMMIT);
+
+    // Scaled synthetic inputs: 65k, 262k and 1M rows
+    for (int nx : {256, 512, 1024}) {
+      SolverMarketRegisterBenchmarks(std::make_shared<SolverMarketBenchmarkInput>(SolverMarketBenchmarkLaplacian(nx)));
+    }
+
+    // Generated inputs, about 2M nonzeros each
+    for (const std::string spec : {"laplace3d:n=64", "elasticity3d:n=20", "randomspd:n=131072,row_nnz=16,skew=0.6"}) {
+      benchmark::RegisterBenchmark(("BM_Generate/" + spec).c_str(), BM_Generate, spec)->Unit(benchmark::kMillisecond)->UseRealTime();
+    }
+
+    // Matrices of the repository (or of SOLVER_MARKET_MATRICES)
+    const char* env = std::getenv("SOLVER_MARKET_MATRICES");
+    const std::filesystem::path directory = env ? env : SOLVER_MARKET_MATRICES_DIR;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+      if (entry.path().extension() != ".mtx") continue;
+      const std::string file = entry.path().string();
+      const SolverMarketBenchmarkFileKind kind = SolverMarketBenchmarkKind(file);
+      if (kind == SolverMarketBenchmarkSkip) continue;
+      if (kind == SolverMarketBenchmarkVector) {
+        benchmark::RegisterBenchmark(("BM_ReadVector/" + entry.path().stem().string()).c_str(), BM_ReadVector, file)
+            ->Unit(benchmark::kMillisecond)->UseRealTime();
+        continue;
+      }
+      auto input = std::make_shared<SolverMarketBenchmarkInput>();
+      if (SolverMarketBenchmarkFromFile(file, *input)) SolverMarketRegisterBenchmarks(input);
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+  }
+  Kokkos::finalize();
+  return 0;
+}
@@ -4,7 +4,12 @@
 #include <cstring>
 
 #include "solver-market-csr-matrix.hpp"
+#include "solver-market-generators.hpp"
+#include "solver-market-memory.hpp"
+#include "solver-market-perf.hpp"
+#include "solver-market-scaling.hpp"
 #include "solver-market-vector.hpp"
+#include "solver-market-tuner.hpp"
 #include <chrono>
 #include <solver-market-output.h>
 
@@ -25,28 +30,75 @@ void check_AMGX_error(AMGX_RC rc, const char *msg)
 int main(int argc, char* argv[])
 {
     Kokkos::initialize();
+    SolverMarketCheckThreadBinding();
     {
     std::string matrix_file;
+    std::string generate_spec;
     std::string rhs_file;
     std::string config_file;
+    std::string solution_file;
+    bool print_features = false;
+    bool two_pass = false;
+    double host_memory_budget = 0.0; /* MB, 0 = no budget*/
+    SolverMarketAssemblyOptions assembly;
+    SolverMarketScalingMethod scaling_method = SolverMarketScalingNone;
+    bool tune = false;
+    bool use_tuned = false;
+    double tune_budget = 300.0;
+    std::string tune_space_file = "../src/AMGX/params-files/tuning-space.txt";
 
     // 1. Parse input arguments
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg.rfind("--matrix=", 0) == 0) {
             matrix_file = arg.substr(9);  // after "--matrix="
+        } else if (arg.rfind("--generate=", 0) == 0) {
+            generate_spec = arg.substr(11);  // after "--generate=", see solver-market-generators.hpp
         } else if (arg.rfind("--rhs=", 0) == 0) {
             rhs_file = arg.substr(6);  // after "--rhs="
         } else if (arg.rfind("--config=", 0) == 0) {
             config_file = arg.substr(9);  // after "--rhs="
+        } else if (arg.rfind("--solution=", 0) == 0) {
+            solution_file = arg.substr(11);  // after "--solution="
+        } else if (arg == "--features") {
+            print_features = true;
+        } else if (arg == "--two-pass") {
+            two_pass = true;
+        } else if (arg.rfind("--host-memory-budget=", 0) == 0) {
+            host_memory_budget = std::stod(arg.substr(21));  // after "--host-memory-budget="
+        } else if (arg == "--sum-duplicates") {
+            assembly.sum_duplicates = true;
+        } else if (arg.rfind("--drop-tolerance=", 0) == 0) {
+            assembly.drop_tolerance = std::stod(arg.substr(17));  // after "--drop-tolerance="
+        } else if (arg.rfind("--scaling=", 0) == 0) {
+            if (SolverMarketParseScaling(arg.substr(10), scaling_method)) {  // after "--scaling="
+                std::cerr << "Unknown scaling: " << arg.substr(10) << " (none, jacobi, ruiz)" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--tune") {
+            tune = true;
+        } else if (arg == "--use-tuned") {
+            use_tuned = true;
+        } else if (arg.rfind("--tune-budget=", 0) == 0) {
+            tune_budget = std::stod(arg.substr(14));  // after "--tune-budget="
+        } else if (arg.rfind("--tune-space=", 0) == 0) {
+            tune_space_file = arg.substr(13);  // after "--tune-space="
+        } else if (arg == "--perf") {
+            SolverMarketPerf::instance().set_enabled(true);  // hardware counters, see solver-market-perf.hpp
+        } else if (arg == "--memory") {
+            SolverMarketMemory::instance().set_enabled(true);  // per-phase memory, see solver-market-memory.hpp
         } else {
             std::cerr << "Unknown argument: " << arg << std::endl;
             return EXIT_FAILURE;
         }
     }
 
-    if (matrix_file.empty() || config_file.empty()) {
-        std::cerr << "Usage: " << argv[0] << " --matrix=<matrix_file.mtx> --rhs=<rhs_file.mtx> (optional) --config=<config_file.mtx> " << std::endl;
+    if (matrix_file.empty() == generate_spec.empty() || config_file.empty()) {
+        std::cerr << "Usage: " << argv[0] << " --matrix=<matrix_file.mtx> | --generate=<name>:<key>=<value>,... --rhs=<rhs_file.mtx> (optional) --config=<config_file.mtx> --solution=<solution_file.mtx> (optional) --features (optional)"
+                  << " --tune --tune-budget=<seconds> --tune-space=<space_file> --use-tuned (optional)"
+                  << " --two-pass --host-memory-budget=<MB> (optional)"
+                  << " --sum-duplicates --drop-tolerance=<tol> (optional)"
+                  << " --scaling=none|jacobi|ruiz (optional) --perf --memory (optional)" << std::endl;
         return EXIT_FAILURE;
     }
 
@@ -83,12 +135,7 @@ int main(int argc, char* argv[])
     //I: index are 32 bits
     auto mode = AMGX_mode_dDDI;
 
-    // 5. Create solver object
-    AMGX_solver_handle solver = NULL;
-    rc = AMGX_solver_create(&solver, rsrc, mode, config);
-    check_AMGX_error(rc, "AMGX_solver_create:");
-
-    // 6. Create matrix and vectors
+    // 5. Create matrix and vectors
     AMGX_matrix_handle A = NULL;
     AMGX_vector_handle x = NULL;
     AMGX_vector_handle b = NULL;
@@ -97,49 +144,214 @@ int main(int argc, char* argv[])
     AMGX_vector_create(&x, rsrc, mode);
     AMGX_vector_create(&b, rsrc, mode);
 
-    // 7. Read system from .mtx file
+    // 6. Read system from .mtx file, or generate it in memory
     auto matrix =  SolverMarketCSRMatrix<double, int>();
-    auto result = matrix.read_matrix_market_file(matrix_file, SolverMarketCSRMatrixFull);
+    if (two_pass) matrix.setReadMode(SolverMarketReadTwoPass);
+    matrix.setHostMemoryBudget(size_t(host_memory_budget * 1024 * 1024));
+    matrix.setAssemblyOptions(assembly);
+    if (!generate_spec.empty()){
+        if (SolverMarketGenerate(generate_spec, matrix) != SolverMarketGeneratorSuccess){
+            return EXIT_FAILURE;
+        }
+        matrix_file = "generate:" + generate_spec;  // id of the features record
+    }else{
+        auto result = matrix.read_matrix_market_file(matrix_file, SolverMarketCSRMatrixFull);
+    }
+
+    // Optional: matrix statistics and fingerprint, appended to solver_features.log
+    SolverMarketMatrixFeatures features;
+    if (print_features || tune || use_tuned){
+        matrix.compute_features(features);
+    }
+    if (print_features){
+        features.print();
+        features.write_record(matrix_file);
+    }
+
+    // Optional: equilibration, after the fingerprint (keyed on the matrix as read)
+    SolverMarketScaling<double, int> scaling(scaling_method);
+    if (scaling_method != SolverMarketScalingNone){
+        if (scaling.apply(matrix) != 0){
+            return EXIT_FAILURE;
+        }
+        scaling.print();
+    }
 
     matrix.send_to_device();
+    SolverMarketMemoryRegion upload_region("upload");  // AMGX copy of the matrix, device usage only
     AMGX_matrix_upload_all(A,
           matrix.get_n(), 
           matrix.get_nnz(), 1, 1, matrix.get_device_offsets_pointer(), matrix.get_device_columns_pointer(), matrix.get_device_values_pointer(), 0);
+    upload_region.stop();
     
     
     if (rhs_file.empty()){
     std::cout <<"No vector b given, filling with 1"<<std::endl;
     
     auto vector_b =  SolverMarketVector<double, int>(matrix.get_n(), 1.0);
+    scaling.scale_rhs(vector_b);
     AMGX_vector_upload(b, matrix.get_n(), 1, vector_b.get_host_values_pointer());}
     else{
     auto vector_b =  SolverMarketVector<double, int>(rhs_file);
+    if (scaling.scale_rhs(vector_b) != 0){
+        return EXIT_FAILURE;
+    }
     AMGX_vector_upload(b, matrix.get_n(), 1, vector_b.get_host_values_pointer());}
     
     auto vector_x =  SolverMarketVector<double, int>(matrix.get_n(), 0.0);
     AMGX_vector_upload(x, matrix.get_n(), 1, vector_x.get_host_values_pointer());
 
+    // 7. Optional: tuned configuration, keyed by the matrix fingerprint
+    if (tune || use_tuned){
+        SolverMarketTuningCache cache;
+        SolverMarketTuningCandidate tuned;
+        bool exact = false;
+        bool found = (cache.lookup("amgx", features, tuned, exact) == 0);
+
+        if (tune){
+            SolverMarketTuningSpace space;
+            if (space.read_file(tune_space_file)){
+                return EXIT_FAILURE;
+            }
+
+            SolverMarketTuner tuner;
+            tuner.time_budget = tune_budget;
+
+            // One trial: base config + candidate, capped iterations, residual history kept
+            auto trial = [&](const SolverMarketTuningCandidate& candidate, int max_iterations){
+                SolverMarketTuningTrial trial_result;
+                std::ostringstream parameters;
+                parameters << SolverMarketCandidateToString(candidate)
+                           << ", main:max_iters=" << max_iterations
+                           << ", main:tolerance=" << tuner.tolerance
+                           << ", main:convergence=RELATIVE_INI_CORE"
+                           << ", main:monitor_residual=1, main:store_res_history=1, main:print_solve_stats=0";
+
+                AMGX_config_handle trial_config = nullptr;
+                AMGX_solver_handle trial_solver = nullptr;
+                if (AMGX_config_create_from_file(&trial_config, config_file.c_str()) != AMGX_RC_OK) return trial_result;
+                if (AMGX_config_add_parameters(&trial_config, parameters.str().c_str()) != AMGX_RC_OK ||
+                    AMGX_solver_create(&trial_solver, rsrc, mode, trial_config) != AMGX_RC_OK){
+                    AMGX_config_destroy(trial_config);
+                    return trial_result;
+                }
+
+                AMGX_vector_upload(x, matrix.get_n(), 1, vector_x.get_host_values_pointer());
+
+                auto trial_start = std::chrono::high_resolution_clock::now();
+                AMGX_RC trial_rc = AMGX_solver_setup(trial_solver, A);
+                auto trial_end = std::chrono::high_resolution_clock::now();
+                trial_result.setup_time = std::chrono::duration<double>(trial_end - trial_start).count();
+
+                if (trial_rc == AMGX_RC_OK){
+                    trial_start = std::chrono::high_resolution_clock::now();
+                    trial_rc = AMGX_solver_solve(trial_solver, b, x);
+                    trial_end = std::chrono::high_resolution_clock::now();
+                    trial_result.solve_time = std::chrono::duration<double>(trial_end - trial_start).count();
+                }
+
+                if (trial_rc == AMGX_RC_OK){
+                    AMGX_SOLVE_STATUS status;
+                    AMGX_solver_get_status(trial_solver, &status);
+                    AMGX_solver_get_iterations_number(trial_solver, &trial_result.iterations);
+                    for (int it = 0; it <= trial_result.iterations; it++){
+                        double residual;
+                        if (AMGX_solver_get_iteration_residual(trial_solver, it, 0, &residual) != AMGX_RC_OK) break;
+                        trial_result.residual_history.push_back(residual);
+                    }
+                    if (trial_result.residual_history.size() > 1 && trial_result.residual_history.front() > 0){
+                        trial_result.relative_residual = trial_result.residual_history.back() / trial_result.residual_history.front();
+                    }
+                    trial_result.success = (status != AMGX_SOLVE_FAILED);
+                    trial_result.converged = (status == AMGX_SOLVE_SUCCESS);
+                }
+
+                AMGX_solver_destroy(trial_solver);
+                AMGX_config_destroy(trial_config);
+                return trial_result;
+            };
+
+            double best_time;
+            SolverMarketTuningCandidate best;
+            if (tuner.run(space, trial, best, best_time, found ? tuned : SolverMarketTuningCandidate()) == 0){
+                cache.store("amgx", features, best, best_time);
+                tuned = best;
+                found = true;
+            }
+            // Trials left their iterate in x
+            AMGX_vector_upload(x, matrix.get_n(), 1, vector_x.get_host_values_pointer());
+        }
+
+        if (found){
+            std::string tuned_parameters = SolverMarketCandidateToString(tuned);
+            std::cout << "Using tuned parameters: " << tuned_parameters << std::endl;
+            rc = AMGX_config_add_parameters(&config, tuned_parameters.c_str());
+            check_AMGX_error(rc, "AMGX_config_add_parameters:");
+        }else{
+            std::cout << "No tuned configuration found, using " << config_file << std::endl;
+        }
+    }
+
+    // 8. Create solver object
+    AMGX_solver_handle solver = NULL;
+    rc = AMGX_solver_create(&solver, rsrc, mode, config);
+    check_AMGX_error(rc, "AMGX_solver_create:");
+
     //SolverMarket: time setup
     auto start = std::chrono::high_resolution_clock::now();
-    // 8. Setup the solver (analysis phase)
+    // 9. Setup the solver (analysis phase)
+    SolverMarketPerfRegion setup_region("setup");
+    SolverMarketMemoryRegion setup_memory_region("setup");
     rc = AMGX_solver_setup(solver, A);
+    setup_memory_region.stop();
+    setup_region.stop();
     check_AMGX_error(rc, "AMGX_solver_setup:");
     auto end = std::chrono::high_resolution_clock::now();
     SolverMarketSetupTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     
     //SolverMarket time solve
     start = std::chrono::high_resolution_clock::now();
-    // 9. Solve the system
+    // 10. Solve the system
+    SolverMarketPerfRegion solve_region("solve");
+    SolverMarketMemoryRegion solve_memory_region("solve");
     rc = AMGX_solver_solve(solver, b, x);
+    solve_memory_region.stop();
+    solve_region.stop();
     end = std::chrono::high_resolution_clock::now();
     SolverMarketSolveTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
     check_AMGX_error(rc, "AMGX_solver_solve:");
     //No need to print stuff: AMGX handles it (optional in config/json file)
 
-    SolverMarketOutput(SolverMarketSetupTime, SolverMarketSolveTime, rc==0, argc, argv);
+    // flop/byte of the solve: one SpMV (2 flops per nonzero) per iteration, the preconditioner is not counted
+    if (SolverMarketPerf::instance().enabled()){
+        int perf_iterations = 0;
+        AMGX_solver_get_iterations_number(solver, &perf_iterations);
+        SolverMarketPerf::instance().set_flops("solve", 2.0 * double(matrix.get_nnz()) * perf_iterations);
+        SolverMarketPerf::instance().print();
+    }
+    SolverMarketMemory::instance().print();
+
+    SolverMarketOutput(SolverMarketSetupTime, SolverMarketSolveTime, rc==0, argc, argv,
+                       SolverMarketPerf::instance().summary(), SolverMarketMemory::instance().summary());
+
+    // Iterations with this scaling: compare runs of the same matrix in solver_output.log
+    if (scaling_method != SolverMarketScalingNone){
+        int iterations = 0;
+        AMGX_solver_get_iterations_number(solver, &iterations);
+        std::cout << "[Info][SolverMarket][Scaling] " << SolverMarketScalingName(scaling_method) << ": " << iterations
+                  << " iterations, setup " << SolverMarketSetupTime.count() << " ms, solve " << SolverMarketSolveTime.count()
+                  << " ms (+ " << scaling.elapsed_ms() << " ms scaling)" << std::endl;
+    }
+
+    // Optional: save the solution, of the original system
+    if (!solution_file.empty()){
+        AMGX_vector_download(x, vector_x.get_host_values_pointer());
+        scaling.unscale_solution(vector_x);
+        vector_x.write_matrix_market_file(solution_file);
+    }
 
-    // 10. Clean up and shut down
+    // 11. Clean up and shut down
     AMGX_solver_destroy(solver);
     AMGX_matrix_destroy(A);
     AMGX_vector_destroy(x);
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "solver-market-scheduler.hpp"
+
+/* Throughput mode: a file of independent jobs run side by side on disjoint blocks of cores
+(see solver-market-scheduler.hpp), solver_market_driver for lines of options. The metric is
+the number of jobs per hour of the whole queue, appended to solver_batch.log. */
+
+int main(int argc, char* argv[])
+{
+    std::string jobs_file;
+    std::string executable = argv[0];
+    std::string driver = executable.substr(0, executable.find_last_of('/') + 1) + "solver_market_driver";
+    std::string log_dir = "batch-logs";
+    std::string cpu_list;
+    int concurrency = 0;  /* 0: measured*/
+    int max_concurrency = 0;  /* 0: one per cpu*/
+
+    // 1. Parse input arguments
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--jobs=", 0) == 0) {
+            jobs_file = arg.substr(7);  // after "--jobs="
+        } else if (arg.rfind("--driver=", 0) == 0) {
+            driver = arg.substr(9);  // after "--driver="
+        } else if (arg.rfind("--concurrency=", 0) == 0) {
+            const std::string value = arg.substr(14);  // after "--concurrency="
+            concurrency = (value == "auto") ? 0 : std::stoi(value);
+        } else if (arg.rfind("--max-concurrency=", 0) == 0) {
+            max_concurrency = std::stoi(arg.substr(18));  // after "--max-concurrency="
+        } else if (arg.rfind("--cpus=", 0) == 0) {
+            cpu_list = arg.substr(7);  // after "--cpus=", e.g. 0-63
+        } else if (arg.rfind("--logs=", 0) == 0) {
+            log_dir = arg.substr(7);  // after "--logs="
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (jobs_file.empty() || concurrency < 0) {
+        std::cerr << "Usage: " << argv[0] << " --jobs=<jobs.txt> --driver=<solver_market_driver> (optional)"
+                  << " --concurrency=auto|<n> --max-concurrency=<n> (optional) --cpus=<list> (optional, e.g. 0-63)"
+                  << " --logs=<dir> (optional)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // 2. Jobs and cores
+    std::vector<SolverMarketBatchJob> jobs;
+    if (SolverMarketReadBatchJobs(jobs_file, driver, jobs) != SolverMarketSchedulerSuccess) return EXIT_FAILURE;
+    const std::vector<int> cpus = cpu_list.empty() ? SolverMarketAvailableCpus() : SolverMarketOrderCpus(SolverMarketParseCpuList(cpu_list));
+    if (cpus.empty()) {
+        std::cerr << "[Error][SolverMarket][Batch] No cpu to run on" << std::endl;
+        return EXIT_FAILURE;
+    }
+    SolverMarketScheduler scheduler(cpus, log_dir);
+    std::cout << "[Info][SolverMarket][Batch] " << jobs.size() << " jobs on cpus " << SolverMarketCpuListString(cpus) << std::endl;
+
+    // 3. Concurrency: given, or measured on the first job (its copies are extra runs)
+    if (concurrency == 0) {
+        const int limit = std::min<int>(max_concurrency > 0 ? max_concurrency : int(cpus.size()), int(jobs.size()));
+        const auto makespans = scheduler.calibrate(jobs.front(), limit);
+        if (makespans.empty()) return EXIT_FAILURE;
+        concurrency = SolverMarketBestConcurrency(makespans);
+    }
+    concurrency = std::min<int>(concurrency, int(cpus.size()));
+    std::cout << "[Info][SolverMarket][Batch] Running " << concurrency << " job(s) at a time, "
+              << cpus.size() / concurrency << " cpus each" << std::endl;
+
+    // 4. The queue
+    std::vector<SolverMarketBatchResult> results;
+    const double seconds = scheduler.run(jobs, concurrency, results);
+    int failed = 0;
+    for (const auto& result : results) failed += (result.exit_code != 0);
+    const double jobs_per_hour = 3600.0 * double(int(jobs.size()) - failed) / seconds;
+    std::cout << "[Info][SolverMarket][Batch] " << int(jobs.size()) - failed << "/" << jobs.size() << " jobs succeeded in " << seconds
+              << " s: " << jobs_per_hour << " solves/hour" << std::endl;
+
+    // One record per queue, one write (concurrent batches may share the file)
+    std::ostringstream record;
+    record << jobs_file << " concurrency=" << concurrency << " cpus=" << cpus.size() << " jobs=" << jobs.size()
+           << " failed=" << failed << " makespan_s=" << seconds << " solves_per_hour=" << jobs_per_hour << "\n";
+    const std::string line = record.str();
+    const int log = ::open("solver_batch.log", O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (log < 0 || ::write(log, line.data(), line.size()) != ssize_t(line.size())) {
+        std::cerr << "Error: Could not open solver_batch.log for writing.\n";
+    }
+    if (log >= 0) ::close(log);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
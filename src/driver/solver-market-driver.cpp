@@ -0,0 +1,272 @@
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+
+#include "solver-market-baseline.hpp"
+#include "solver-market-generators.hpp"
+#include "solver-market-memory.hpp"
+#include "solver-market-perf.hpp"
+#include "solver-market-scaling.hpp"
+#include "solver-market-solver.hpp"
+#include <solver-market-output.h>
+
+/* One process, one load: the matrix is read and sent to the device once, then every selected
+backend of libsolvermarket is set up and solved on the same device-resident data. */
+
+static int run_driver(int argc, char* argv[])
+{
+    std::string matrix_file;
+    std::string generate_spec;
+    std::string rhs_file;
+    std::string solution_prefix;
+    std::string backends_list;
+    std::map<std::string, std::string> configs;  // backend -> config file
+    int repeat = 1;
+    int repetitions = 1;
+    std::string samples_file;
+    SolverMarketScalingMethod scaling_method = SolverMarketScalingNone;
+    bool scaling_compare = false;
+
+    // 1. Parse input arguments
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--matrix=", 0) == 0) {
+            matrix_file = arg.substr(9);  // after "--matrix="
+        } else if (arg.rfind("--generate=", 0) == 0) {
+            generate_spec = arg.substr(11);  // after "--generate=", see solver-market-generators.hpp
+        } else if (arg.rfind("--rhs=", 0) == 0) {
+            rhs_file = arg.substr(6);  // after "--rhs="
+        } else if (arg.rfind("--solution=", 0) == 0) {
+            solution_prefix = arg.substr(11);  // after "--solution=", written as <prefix>-<backend>.mtx
+        } else if (arg.rfind("--backends=", 0) == 0) {
+            backends_list = arg.substr(11);  // after "--backends="
+        } else if (arg.rfind("--amgx-config=", 0) == 0) {
+            configs["amgx"] = arg.substr(14);  // after "--amgx-config="
+        } else if (arg.rfind("--muelu-config=", 0) == 0) {
+            configs["muelu"] = arg.substr(15);  // after "--muelu-config="
+        } else if (arg.rfind("--native-config=", 0) == 0) {
+            configs["native"] = arg.substr(16);  // after "--native-config="
+        } else if (arg.rfind("--repeat=", 0) == 0) {
+            repeat = std::stoi(arg.substr(9));  // after "--repeat="
+        } else if (arg.rfind("--repetitions=", 0) == 0) {
+            repetitions = std::stoi(arg.substr(14));  // after "--repetitions=", independent runs per backend
+        } else if (arg.rfind("--samples=", 0) == 0) {
+            samples_file = arg.substr(10);  // after "--samples=", see solver-market-baseline.hpp
+        } else if (arg.rfind("--scaling=", 0) == 0) {
+            if (SolverMarketParseScaling(arg.substr(10), scaling_method)) {  // after "--scaling="
+                std::cerr << "Unknown scaling: " << arg.substr(10) << " (none, jacobi, ruiz)" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--scaling-compare") {
+            scaling_compare = true;
+        } else if (arg == "--perf") {
+            SolverMarketPerf::instance().set_enabled(true);  // hardware counters, see solver-market-perf.hpp
+        } else if (arg == "--memory") {
+            SolverMarketMemory::instance().set_enabled(true);  // per-phase memory, see solver-market-memory.hpp
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (matrix_file.empty() == generate_spec.empty() || repeat < 1 || repetitions < 1) {
+        std::cerr << "Usage: " << argv[0] << " --matrix=<matrix_file.mtx> | --generate=<name>:<key>=<value>,... --rhs=<rhs_file.mtx> (optional)"
+                  << " --backends=amgx,muelu,native (optional, default: every backend of this build)"
+                  << " --amgx-config=<config.json> --muelu-config=<params.xml|.yaml> --native-config=<params.txt>"
+                  << " --repeat=<n> (optional, solves per backend) --solution=<prefix> (optional)"
+                  << " --repetitions=<n> --samples=<file> (optional, timing samples for solver_market_regress)"
+                  << " --scaling=none|jacobi|ruiz --scaling-compare (optional) --perf --memory (optional)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> backends;
+    if (backends_list.empty()) {
+        backends = SolverMarketAvailableBackends();
+    } else {
+        std::istringstream list(backends_list);
+        std::string backend;
+        while (std::getline(list, backend, ',')) {
+            if (!backend.empty()) backends.push_back(backend);
+        }
+    }
+    if (backends.empty()) {
+        std::cerr << "[Error][SolverMarket][Driver] No backend compiled in this build" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // 2. Read (or generate) the system once, the device copy is shared by all backends
+    SolverMarketSolverMatrix A;
+    if (!generate_spec.empty()) {
+        if (SolverMarketGenerate(generate_spec, A) != SolverMarketGeneratorSuccess) return EXIT_FAILURE;
+        matrix_file = "generate:" + generate_spec;
+    } else if (A.read_matrix_market_file(matrix_file, SolverMarketCSRMatrixFull) != 0) {
+        std::cerr << "[Error][SolverMarket][Driver] Could not read " << matrix_file << std::endl;
+        return EXIT_FAILURE;
+    }
+    A.send_to_device();
+
+    // Baseline key of the matrix as read, before any scaling
+    SolverMarketMatrixFeatures features;
+    if (!samples_file.empty()) A.compute_features(features);
+
+    SolverMarketSolverVector b;
+    if (rhs_file.empty()) {
+        std::cout << "No vector b given, filling with 1" << std::endl;
+        b = SolverMarketSolverVector(A.get_n(), 1.0);
+    } else if (b.read_matrix_market_file(rhs_file) != 0 || b.get_n() != A.get_n()) {
+        std::cerr << "[Error][SolverMarket][Driver] Could not read " << rhs_file << " (or size differs from the matrix)" << std::endl;
+        return EXIT_FAILURE;
+    }
+    b.send_to_device();
+
+    // Counters and memory of the read, then each backend records its own setup and solve
+    SolverMarketPerf::instance().print();
+    SolverMarketMemory::instance().print();
+
+    // 3. Every backend on the same A and b. One run: configure, setup, `repeat` solves, record.
+    // solve_ms is the mean over the solves that completed (a failed solve ends the loop)
+    auto run_backend = [&](const std::string& backend, SolverMarketScaling<double, int>& scaling,
+                           SolverMarketSolverStats& stats, double& solve_ms) {
+        const std::string config_file = configs.count(backend) ? configs[backend] : "";
+        auto solver = SolverMarketCreateSolver(backend);
+        if (!solver || config_file.empty()) {
+            if (solver) std::cerr << "[Error][SolverMarket][Driver] No config given for " << backend << " (--" << backend << "-config=)" << std::endl;
+            return false;
+        }
+
+        std::cout << "[Info][SolverMarket][Driver] Running " << backend << " with " << config_file
+                  << " (scaling " << SolverMarketScalingName(scaling.method()) << ")" << std::endl;
+        SolverMarketPerf::instance().clear();
+        // The read stays in the memory record of every backend, its peak is part of the job
+        SolverMarketMemory::instance().erase("setup");
+        SolverMarketMemory::instance().erase("solve");
+        bool success = (solver->configure(config_file) == SolverMarketSolverSuccess);
+        if (success) {
+            SolverMarketPerfRegion setup_region("setup");
+            SolverMarketMemoryRegion setup_memory_region("setup");
+            success = (solver->setup(A) == SolverMarketSolverSuccess);
+        }
+
+        // Fresh zero initial guess for each solve so repeats time the same work
+        SolverMarketSolverVector x;
+        solve_ms = 0;
+        int solves = 0;
+        for (int r = 0; success && r < repeat; r++) {
+            x = SolverMarketSolverVector(A.get_n(), 0.0);
+            x.send_to_device();
+            SolverMarketPerfRegion solve_region("solve");
+            SolverMarketMemoryRegion solve_memory_region("solve");
+            success = (solver->solve(b, x) == SolverMarketSolverSuccess);
+            solve_ms += solver->stats().solve_ms;
+            solves++;
+        }
+        if (solves > 0) solve_ms /= solves;
+        solver->stats().print();
+        solver->print_details();
+        stats = solver->stats();
+        // flop/byte of the solves: one SpMV (2 flops per nonzero) per iteration, the preconditioner is not counted
+        SolverMarketPerf::instance().set_flops("solve", 2.0 * double(A.get_nnz()) * stats.iterations * solves);
+        SolverMarketPerf::instance().print();
+        SolverMarketMemory::instance().print();
+
+        // Same record as the input decks, with the backend in the input line
+        std::vector<std::string> output_args = {argv[0], "--backend=" + backend, "--matrix=" + matrix_file,
+                                                "--config=" + config_file, "--repeat=" + std::to_string(repeat),
+                                                std::string("--scaling=") + SolverMarketScalingName(scaling.method())};
+        std::vector<char*> output_argv;
+        for (auto& arg : output_args) output_argv.push_back(&arg[0]);
+        SolverMarketOutput(std::chrono::milliseconds((long long)solver->stats().setup_ms),
+                           std::chrono::milliseconds((long long)solve_ms),
+                           success, (int)output_argv.size(), output_argv.data(),
+                           SolverMarketPerf::instance().summary(), SolverMarketMemory::instance().summary());
+
+        // Solution of the original system
+        if (success && !solution_prefix.empty() && scaling.unscale_solution(x) == 0) {
+            x.write_matrix_market_file(solution_prefix + "-" + backend + ".mtx");
+        }
+        return success;
+    };
+
+    // Unscaled reference runs first, A and b are scaled in place afterwards
+    std::map<std::string, SolverMarketSolverStats> reference_stats;
+    std::map<std::string, double> reference_solve_ms;
+    SolverMarketScaling<double, int> scaling(scaling_method);
+    if (scaling_compare && scaling_method != SolverMarketScalingNone) {
+        SolverMarketScaling<double, int> no_scaling;
+        no_scaling.apply(A);
+        for (const auto& backend : backends) {
+            run_backend(backend, no_scaling, reference_stats[backend], reference_solve_ms[backend]);
+        }
+    }
+    if (scaling_method != SolverMarketScalingNone) {
+        if (scaling.apply(A) != 0 || scaling.scale_rhs(b) != 0) return EXIT_FAILURE;
+        scaling.print();
+        A.send_to_device();
+        b.send_to_device();
+    }
+
+    int exit_code = EXIT_SUCCESS;
+    std::vector<SolverMarketBaselineEntry> samples;
+    for (const auto& backend : backends) {
+        SolverMarketSolverStats stats;
+        double solve_ms = 0;
+
+        // `repetitions` independent runs (configure, setup, solves): one timing sample each
+        const std::string config_file = configs.count(backend) ? configs[backend] : "";
+        SolverMarketBaselineEntry setup_samples, solve_samples;
+        setup_samples.key = {features.fingerprint_string(), backend,
+                             SolverMarketHashFile(config_file, std::string("scaling=") + SolverMarketScalingName(scaling_method) +
+                                                               ";repeat=" + std::to_string(repeat)),
+                             SolverMarketHostSignature(Device::name())};
+        setup_samples.label = matrix_file + " " + config_file;
+        solve_samples = setup_samples;
+        setup_samples.metric = "setup_ms";
+        solve_samples.metric = "solve_ms";
+        bool success = true;
+        for (int r = 0; success && r < repetitions; r++) {
+            success = run_backend(backend, scaling, stats, solve_ms);
+            setup_samples.samples.push_back(stats.setup_ms);
+            solve_samples.samples.push_back(solve_ms);
+        }
+        if (!success) exit_code = EXIT_FAILURE;
+        else if (!samples_file.empty()) {
+            samples.push_back(setup_samples);
+            samples.push_back(solve_samples);
+        }
+
+        if (reference_stats.count(backend)) {
+            const auto& reference = reference_stats[backend];
+            std::cout << "[Info][SolverMarket][Scaling][" << backend << "] " << SolverMarketScalingName(scaling_method)
+                      << ": iterations " << reference.iterations << " -> " << stats.iterations
+                      << ", setup " << reference.setup_ms << " -> " << stats.setup_ms << " ms"
+                      << ", solve " << reference_solve_ms[backend] << " -> " << solve_ms << " ms"
+                      << " (+ " << scaling.elapsed_ms() << " ms scaling)"
+                      << (reference.converged ? "" : ", unscaled run did not converge") << std::endl;
+        }
+    }
+
+    if (!samples_file.empty()) {
+        std::ofstream file(samples_file);
+        for (const auto& entry : samples) file << entry.to_line() << "\n";
+        if (!file) {
+            std::cerr << "Error: Could not open " << samples_file << " for writing.\n";
+            exit_code = EXIT_FAILURE;
+        }
+    }
+
+    return exit_code;
+}
+
+int main(int argc, char* argv[])
+{
+    Kokkos::initialize(argc, argv);
+    SolverMarketInitializeBackends(&argc, &argv);
+    int exit_code = run_driver(argc, argv);
+    SolverMarketFinalizeBackends();
+    Kokkos::finalize();
+    return exit_code;
+}
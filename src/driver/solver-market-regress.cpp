@@ -0,0 +1,112 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "solver-market-baseline.hpp"
+#include "solver-market-scheduler.hpp"
+
+/* Performance regression check: runs a benchmark set (lines of solver_market_driver options,
+see solver-market-scheduler.hpp), one job at a time, each with --repetitions=<n> --samples=<file>,
+then records the samples as the baseline (--record) or compares them with it
+(solver-market-baseline.hpp). Exits with failure on any regression or failed job. */
+
+int main(int argc, char* argv[])
+{
+    std::string set_file;
+    std::string executable = argv[0];
+    std::string driver = executable.substr(0, executable.find_last_of('/') + 1) + "solver_market_driver";
+    std::string baseline_file = "solver_market_baseline.tsv";
+    std::string log_dir = "regress-logs";
+    std::string cpu_list;
+    int repetitions = 5;
+    double alpha = 0.05;
+    double threshold = 0.05;
+    bool record = false;
+
+    // 1. Parse input arguments
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--set=", 0) == 0) {
+            set_file = arg.substr(6);  // after "--set="
+        } else if (arg.rfind("--driver=", 0) == 0) {
+            driver = arg.substr(9);  // after "--driver="
+        } else if (arg.rfind("--baseline=", 0) == 0) {
+            baseline_file = arg.substr(11);  // after "--baseline="
+        } else if (arg == "--record") {
+            record = true;
+        } else if (arg.rfind("--repetitions=", 0) == 0) {
+            repetitions = std::stoi(arg.substr(14));  // after "--repetitions="
+        } else if (arg.rfind("--alpha=", 0) == 0) {
+            alpha = std::stod(arg.substr(8));  // after "--alpha="
+        } else if (arg.rfind("--threshold=", 0) == 0) {
+            threshold = std::stod(arg.substr(12));  // after "--threshold=", relative change of the medians
+        } else if (arg.rfind("--cpus=", 0) == 0) {
+            cpu_list = arg.substr(7);  // after "--cpus=", e.g. 0-15
+        } else if (arg.rfind("--logs=", 0) == 0) {
+            log_dir = arg.substr(7);  // after "--logs="
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (set_file.empty() || repetitions < 1) {
+        std::cerr << "Usage: " << argv[0] << " --set=<benchmarks.txt> --baseline=<file> (optional) --record (optional)"
+                  << " --repetitions=<n> --alpha=<p> --threshold=<relative change> (optional)"
+                  << " --driver=<solver_market_driver> --cpus=<list> --logs=<dir> (optional)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // 2. The benchmark set, every job asked for its timing samples
+    std::vector<SolverMarketBatchJob> jobs;
+    if (SolverMarketReadBatchJobs(set_file, driver, jobs) != SolverMarketSchedulerSuccess) return EXIT_FAILURE;
+    for (auto& job : jobs) {
+        job.args.push_back("--repetitions=" + std::to_string(repetitions));
+        job.args.push_back("--samples=" + log_dir + "/" + job.name + ".samples");
+    }
+
+    // 3. One job at a time on the whole set of cores: no job disturbs the timings of another
+    const std::vector<int> cpus = cpu_list.empty() ? SolverMarketAvailableCpus() : SolverMarketOrderCpus(SolverMarketParseCpuList(cpu_list));
+    if (cpus.empty()) {
+        std::cerr << "[Error][SolverMarket][Regress] No cpu to run on" << std::endl;
+        return EXIT_FAILURE;
+    }
+    SolverMarketScheduler scheduler(cpus, log_dir);
+    std::vector<SolverMarketBatchResult> results;
+    scheduler.run(jobs, 1, results);
+
+    std::vector<SolverMarketBaselineEntry> current;
+    int failed = 0;
+    for (const auto& result : results) {
+        if (result.exit_code != 0 ||
+            SolverMarketReadBaselineEntries(log_dir + "/" + result.name + ".samples", current) != SolverMarketBaselineSuccess) {
+            std::cerr << "[Error][SolverMarket][Regress] " << result.name << " failed, see " << result.log_file << std::endl;
+            failed++;
+        }
+    }
+
+    // 4. Record, or compare
+    SolverMarketBaselineStore store(baseline_file);
+    if (record) {
+        if (store.store(current) != SolverMarketBaselineSuccess) return EXIT_FAILURE;
+        std::cout << "[Info][SolverMarket][Regress] Recorded " << current.size() << " baselines of " << repetitions
+                  << " repetitions in " << baseline_file << std::endl;
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    const auto comparisons = store.compare(current, alpha, threshold);
+    SolverMarketPrintBaselineComparisons(std::cout, comparisons);
+    int regressions = 0, missing = 0;
+    for (const auto& comparison : comparisons) {
+        regressions += (comparison.verdict == SolverMarketBaselineRegression);
+        missing += (comparison.verdict == SolverMarketBaselineNew);
+    }
+    std::cout << "[Info][SolverMarket][Regress] " << comparisons.size() << " metrics, " << regressions << " regression(s)"
+              << " (p < " << alpha << ", change > " << 100.0 * threshold << "%), " << failed << " failed job(s)" << std::endl;
+    if (missing) {
+        std::cout << "[Warning][SolverMarket][Regress] " << missing << " metrics have no baseline in " << baseline_file
+                  << " for this host, record them with --record" << std::endl;
+    }
+
+    return (regressions || failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
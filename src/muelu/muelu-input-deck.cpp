@@ -38,6 +38,10 @@ The source code is not MueLu specific and can be used with any Stratimikos strat
 
 // Xpetra include
 #include <Xpetra_Parameters.hpp>
+#include <Xpetra_CrsMatrixWrap.hpp>
+#include <Xpetra_MultiVectorFactory.hpp>
+#include <Xpetra_TpetraCrsMatrix.hpp>
+#include <Xpetra_TpetraMultiVector.hpp>
 
 // MueLu includes
 #include <Thyra_MueLuPreconditionerFactory.hpp>
@@ -49,6 +53,60 @@ The source code is not MueLu specific and can be used with any Stratimikos strat
 #include <chrono>
 
 #include <solver-market-output.h>
+#include <solver-market-csr-matrix.hpp>
+#include <solver-market-generators.hpp>
+#include <solver-market-memory.hpp>
+#include <solver-market-numa.hpp>
+#include <solver-market-perf.hpp>
+#include <solver-market-vector.hpp>
+#include <solver-market-tpetra.hpp>
+#include <solver-market-tuner.hpp>
+
+// Set `path` (sublists separated by '/') in a parameter list. An existing parameter keeps
+// its type, a new one is typed from the value: int, double, bool, or string otherwise.
+void SolverMarketSetParameter(Teuchos::ParameterList &list, const std::string &path, const std::string &value) {
+  Teuchos::ParameterList *sublist = &list;
+  std::string name                = path;
+  for (auto slash = name.find('/'); slash != std::string::npos; slash = name.find('/')) {
+    sublist = &sublist->sublist(name.substr(0, slash));
+    name    = name.substr(slash + 1);
+  }
+
+  std::istringstream in(value);
+  int as_int;
+  double as_double;
+  bool is_int    = (in >> as_int) && in.eof();
+  in.clear();
+  in.str(value);
+  bool is_double = (in >> as_double) && in.eof();
+  bool is_bool   = (value == "true" || value == "false");
+
+  if (sublist->isParameter(name)) {
+    if (sublist->isType<int>(name)) {
+      sublist->set(name, std::stoi(value));
+      return;
+    }
+    if (sublist->isType<double>(name)) {
+      sublist->set(name, std::stod(value));
+      return;
+    }
+    if (sublist->isType<bool>(name)) {
+      sublist->set(name, value == "true");
+      return;
+    }
+    sublist->set(name, value);
+    return;
+  }
+
+  if (is_int)
+    sublist->set(name, as_int);
+  else if (is_double)
+    sublist->set(name, as_double);
+  else if (is_bool)
+    sublist->set(name, value == "true");
+  else
+    sublist->set(name, value);
+}
 
 template <typename Scalar, class LocalOrdinal, class GlobalOrdinal, class Node>
 int main_(Teuchos::CommandLineProcessor &clp, Xpetra::UnderlyingLib lib, int argc, char *argv[]) {
@@ -120,6 +178,24 @@ int main_(Teuchos::CommandLineProcessor &clp, Xpetra::UnderlyingLib lib, int arg
     clp.setOption("multivector", &numVectors, "number of rhs to solve simultaneously");
     int numSolves = 1;
     clp.setOption("numSolves", &numSolves, "number of times the system should be solved");
+    bool tune = false;
+    clp.setOption("tune", "no-tune", &tune, "tune the solver configuration for this matrix and cache the winner");
+    bool useTuned = false;
+    clp.setOption("use-tuned", "no-use-tuned", &useTuned, "use the tuned configuration cached for this matrix");
+    double tuneBudget = 300.0;
+    clp.setOption("tune-budget", &tuneBudget, "time budget of the tuning, in seconds");
+    std::string tuneSpaceFile = "../src/muelu/params-files/tuning-space.txt";
+    clp.setOption("tune-space", &tuneSpaceFile, "tuning space file");
+    bool solverMarketReader = false;
+    clp.setOption("solver-market-reader", "trilinos-reader", &solverMarketReader,
+                  "read --matrix/--rhs with the SolverMarket reader and build the Tpetra matrix from its device CSR (single rank, double, Tpetra)");
+    std::string generateSpec;
+    clp.setOption("generate", &generateSpec,
+                  "generate the matrix in memory instead of reading --matrix, e.g. laplace3d:n=64 (see solver-market-generators.hpp, implies --solver-market-reader)");
+    bool perf = false;
+    clp.setOption("perf", "no-perf", &perf, "hardware counters around read, setup and solve (see solver-market-perf.hpp)");
+    bool memory = false;
+    clp.setOption("memory", "no-memory", &memory, "peak RSS and Kokkos allocations of read, assemble, upload, setup and solve (see solver-market-memory.hpp)");
 
     switch (clp.parse(argc, argv)) {
       case Teuchos::CommandLineProcessor::PARSE_HELP_PRINTED: return EXIT_SUCCESS;
@@ -127,6 +203,9 @@ int main_(Teuchos::CommandLineProcessor &clp, Xpetra::UnderlyingLib lib, int arg
       case Teuchos::CommandLineProcessor::PARSE_UNRECOGNIZED_OPTION: return EXIT_FAILURE;
       case Teuchos::CommandLineProcessor::PARSE_SUCCESSFUL: break;
     }
+    if (generateSpec != "") solverMarketReader = true;
+    SolverMarketPerf::instance().set_enabled(perf || SolverMarketPerf::instance().enabled());
+    SolverMarketMemory::instance().set_enabled(memory || SolverMarketMemory::instance().enabled());
 
     RCP<Teuchos::FancyOStream> fancy = Teuchos::fancyOStream(Teuchos::rcpFromRef(std::cout));
     Teuchos::FancyOStream &out       = *fancy;
@@ -159,9 +238,57 @@ int main_(Teuchos::CommandLineProcessor &clp, Xpetra::UnderlyingLib lib, int arg
     RCP<MultiVector> X, B;
     RCP<LOVector> blocknumber;
 
-    std::ostringstream galeriStream;
-    MatrixLoad<SC, LocalOrdinal, GlobalOrdinal, Node>(comm, lib, binaryFormat, matrixFile, rhsFile, rowMapFile, colMapFile, domainMapFile, rangeMapFile, coordFile, coordMapFile, nullFile, materialFile, blockNumberFile, map, A, coordinates, nullspace, material, blocknumber, X, B, numVectors, matrixParameters, xpetraParameters, galeriStream);    out << galeriStream.str();
+    // SolverMarket: same reader (and device CSR) as the AMGX deck, instead of MatrixLoad's serial ASCII reader
+    SolverMarketCSRMatrix<double, int> solverMarketMatrix;
+    auto loadStart = std::chrono::high_resolution_clock::now();
+    if (solverMarketReader) {
+      TEUCHOS_TEST_FOR_EXCEPTION((matrixFile == "" && generateSpec == "") || binaryFormat || lib != Xpetra::UseTpetra, std::runtime_error,
+                                 "--solver-market-reader needs an ascii --matrix file (or --generate) and Tpetra");
+      // The host CSR is placed by first touch: warn if the threads are not pinned
+      SolverMarketCheckThreadBinding();
+      if constexpr (std::is_same<Scalar, double>::value) {
+        using TpetraCrsMatrix   = Tpetra::CrsMatrix<Scalar, LocalOrdinal, GlobalOrdinal, Node>;
+        using TpetraMultiVector = Tpetra::MultiVector<Scalar, LocalOrdinal, GlobalOrdinal, Node>;
+
+        if (generateSpec != "")
+          TEUCHOS_TEST_FOR_EXCEPTION(SolverMarketGenerate(generateSpec, solverMarketMatrix) != SolverMarketGeneratorSuccess,
+                                     std::runtime_error, "Could not generate " + generateSpec);
+        else
+          TEUCHOS_TEST_FOR_EXCEPTION(solverMarketMatrix.read_matrix_market_file(matrixFile, SolverMarketCSRMatrixFull) != 0,
+                                     std::runtime_error, "Could not read " + matrixFile);
+        solverMarketMatrix.send_to_device();
+        RCP<TpetraCrsMatrix> tpetraA = SolverMarketToTpetraCrsMatrix<TpetraCrsMatrix>(solverMarketMatrix, comm);
+        A   = rcp(new Xpetra::CrsMatrixWrap<Scalar, LocalOrdinal, GlobalOrdinal, Node>(
+                  rcp(new Xpetra::TpetraCrsMatrix<Scalar, LocalOrdinal, GlobalOrdinal, Node>(tpetraA))));
+        map = A->getRowMap();
+
+        X = Xpetra::MultiVectorFactory<Scalar, LocalOrdinal, GlobalOrdinal, Node>::Build(map, numVectors);
+        if (rhsFile != "") {
+          SolverMarketVector<double, int> rhs;
+          TEUCHOS_TEST_FOR_EXCEPTION(rhs.read_matrix_market_file(rhsFile) != 0 || rhs.get_n() != solverMarketMatrix.get_n(),
+                                     std::runtime_error, "Could not read a rhs of the matrix size from " + rhsFile);
+          rhs.send_to_device();
+          RCP<TpetraMultiVector> tpetraB = rcp(new TpetraMultiVector(tpetraA->getRowMap(), numVectors));
+          for (int j = 0; j < numVectors; j++)
+            SolverMarketCopyToTpetra(rhs, *tpetraB, j);
+          B = Xpetra::toXpetra(tpetraB);
+        } else {
+          // As MatrixLoad: b = A x for a random x
+          B = Xpetra::MultiVectorFactory<Scalar, LocalOrdinal, GlobalOrdinal, Node>::Build(map, numVectors);
+          X->randomize();
+          A->apply(*X, *B);
+        }
+      } else {
+        TEUCHOS_TEST_FOR_EXCEPTION(true, std::runtime_error, "--solver-market-reader only reads double matrices");
+      }
+    } else {
+      std::ostringstream galeriStream;
+      MatrixLoad<SC, LocalOrdinal, GlobalOrdinal, Node>(comm, lib, binaryFormat, matrixFile, rhsFile, rowMapFile, colMapFile, domainMapFile, rangeMapFile, coordFile, coordMapFile, nullFile, materialFile, blockNumberFile, map, A, coordinates, nullspace, material, blocknumber, X, B, numVectors, matrixParameters, xpetraParameters, galeriStream);    out << galeriStream.str();
+    }
     X->putScalar(0);
+    auto loadEnd = std::chrono::high_resolution_clock::now();
+    out << "SolverMarket: matrix load time " << std::chrono::duration<double, std::milli>(loadEnd - loadStart).count() << " ms ("
+        << (generateSpec != "" ? "solver-market generator" : solverMarketReader ? "solver-market reader" : "MatrixLoad") << ")" << std::endl;
 
     //
     // Build Thyra linear algebra objects
@@ -173,6 +300,106 @@ int main_(Teuchos::CommandLineProcessor &clp, Xpetra::UnderlyingLib lib, int arg
     RCP<Thyra::MultiVectorBase<Scalar> > thyraX       = Teuchos::rcp_const_cast<Thyra::MultiVectorBase<Scalar> >(Xpetra::ThyraUtils<Scalar, LocalOrdinal, GlobalOrdinal, Node>::toThyraMultiVector(X));
     RCP<const Thyra::MultiVectorBase<Scalar> > thyraB = Xpetra::ThyraUtils<Scalar, LocalOrdinal, GlobalOrdinal, Node>::toThyraMultiVector(B);
 
+    //
+    // SolverMarket: optional tuned configuration, keyed by the matrix fingerprint
+    //
+    if (tune || useTuned) {
+      TEUCHOS_TEST_FOR_EXCEPTION((matrixFile == "" && generateSpec == "") || binaryFormat, std::runtime_error,
+                                 "Tuning needs an ascii --matrix file (or --generate) to fingerprint");
+
+      // Fingerprint only depends on the structure, the value type does not matter
+      if (!solverMarketReader)
+        solverMarketMatrix.read_matrix_market_file(matrixFile, SolverMarketCSRMatrixFull);
+      SolverMarketMatrixFeatures features;
+      solverMarketMatrix.compute_features(features);
+
+      SolverMarketTuningCache cache;
+      SolverMarketTuningCandidate tuned;
+      bool exact = false;
+      bool found = (cache.lookup("muelu", features, tuned, exact) == 0);
+
+      if (tune) {
+        SolverMarketTuningSpace space;
+        TEUCHOS_TEST_FOR_EXCEPTION(space.read_file(tuneSpaceFile) != 0, std::runtime_error,
+                                   "Could not read tuning space " + tuneSpaceFile);
+
+        SolverMarketTuner tuner;
+        tuner.time_budget = tuneBudget;
+
+        // One trial: xml parameters + candidate, capped iterations, quiet
+        auto trial = [&](const SolverMarketTuningCandidate &candidate, int maxIterations) {
+          SolverMarketTuningTrial trialResult;
+          try {
+            RCP<ParameterList> trialList = rcp(new ParameterList(*paramList));
+            for (auto &parameter : candidate)
+              SolverMarketSetParameter(*trialList, parameter.first, parameter.second);
+
+            ParameterList &belosList  = trialList->sublist("Linear Solver Types").sublist("Belos");
+            ParameterList &krylovList = belosList.sublist("Solver Types").sublist(belosList.get<std::string>("Solver Type"));
+            krylovList.set("Maximum Iterations", maxIterations);
+            krylovList.set("Convergence Tolerance", tuner.tolerance);
+            krylovList.set("Verbosity", 0);
+            if (trialList->sublist("Preconditioner Types").isSublist("MueLu"))
+              trialList->sublist("Preconditioner Types").sublist("MueLu").set("verbosity", "none");
+
+            Stratimikos::LinearSolverBuilder<Scalar> trialBuilder;
+            Stratimikos::enableMueLu<Scalar, LocalOrdinal, GlobalOrdinal, Node>(trialBuilder);
+            trialBuilder.setParameterList(trialList);
+
+            auto trialStart = std::chrono::high_resolution_clock::now();
+            RCP<Thyra::LinearOpWithSolveFactoryBase<Scalar> > trialFactory = Thyra::createLinearSolveStrategy(trialBuilder);
+            auto trialPrecFactory                                           = trialFactory->getPreconditionerFactory();
+            RCP<Thyra::LinearOpWithSolveBase<Scalar> > trialInverseA;
+            if (!trialPrecFactory.is_null()) {
+              RCP<Thyra::PreconditionerBase<Scalar> > trialPrec = trialPrecFactory->createPrec();
+              Thyra::initializePrec<Scalar>(*trialPrecFactory, thyraA, trialPrec.ptr());
+              trialInverseA = trialFactory->createOp();
+              Thyra::initializePreconditionedOp<Scalar>(*trialFactory, thyraA, trialPrec, trialInverseA.ptr());
+            } else {
+              trialInverseA = Thyra::linearOpWithSolve(*trialFactory, thyraA);
+            }
+            auto trialEnd          = std::chrono::high_resolution_clock::now();
+            trialResult.setup_time = std::chrono::duration<double>(trialEnd - trialStart).count();
+
+            thyraX->assign(0.);
+            trialStart                            = std::chrono::high_resolution_clock::now();
+            Thyra::SolveStatus<Scalar> trialStatus = Thyra::solve<Scalar>(*trialInverseA, Thyra::NOTRANS, *thyraB, thyraX.ptr());
+            trialEnd                              = std::chrono::high_resolution_clock::now();
+            trialResult.solve_time                = std::chrono::duration<double>(trialEnd - trialStart).count();
+
+            trialResult.success   = true;
+            trialResult.converged = (trialStatus.solveStatus == Thyra::SOLVE_STATUS_CONVERGED);
+            trialResult.iterations = maxIterations;
+            if (!trialStatus.extraParameters.is_null() && trialStatus.extraParameters->isParameter("Belos/Iteration Count"))
+              trialResult.iterations = trialStatus.extraParameters->template get<int>("Belos/Iteration Count");
+            if (trialStatus.achievedTol >= 0)
+              trialResult.relative_residual = trialStatus.achievedTol;
+          } catch (std::exception &e) {
+            out << "Rejected candidate " << SolverMarketCandidateToString(candidate) << ": " << e.what() << std::endl;
+            trialResult.success = false;
+          }
+          return trialResult;
+        };
+
+        double bestTime;
+        SolverMarketTuningCandidate best;
+        if (tuner.run(space, trial, best, bestTime, found ? tuned : SolverMarketTuningCandidate()) == 0) {
+          cache.store("muelu", features, best, bestTime);
+          tuned = best;
+          found = true;
+        }
+        X->putScalar(0);
+      }
+
+      if (found) {
+        out << "Using tuned parameters: " << SolverMarketCandidateToString(tuned) << std::endl;
+        for (auto &parameter : tuned)
+          SolverMarketSetParameter(*paramList, parameter.first, parameter.second);
+      } else {
+        out << "No tuned configuration found, using " << xmlFileName << std::endl;
+      }
+    }
+
     //
     // Build Stratimikos solver
     //
@@ -205,11 +432,15 @@ int main_(Teuchos::CommandLineProcessor &clp, Xpetra::UnderlyingLib lib, int arg
       //SolverMarket: time setup
       auto start = std::chrono::high_resolution_clock::now();
 
+      SolverMarketPerfRegion setup_region("setup");
+      SolverMarketMemoryRegion setup_memory_region("setup");
       prec = precFactory->createPrec();
       // Build a Thyra operator corresponding to A^{-1} computed using the Stratimikos solver.
       Thyra::initializePrec<Scalar>(*precFactory, thyraA, prec.ptr());
       thyraInverseA = solverFactory->createOp();
       Thyra::initializePreconditionedOp<Scalar>(*solverFactory, thyraA, prec, thyraInverseA.ptr());
+      setup_memory_region.stop();
+      setup_region.stop();
       auto end = std::chrono::high_resolution_clock::now();
       SolverMarketSetupTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     } else {
@@ -219,7 +450,12 @@ int main_(Teuchos::CommandLineProcessor &clp, Xpetra::UnderlyingLib lib, int arg
     //SolverMarket time solve
     auto start = std::chrono::high_resolution_clock::now();
     // Solve Ax = b.
+    SolverMarketPerfRegion solve_region("solve");
+    SolverMarketMemoryRegion solve_memory_region("solve");
     Thyra::SolveStatus<Scalar> status = Thyra::solve<Scalar>(*thyraInverseA, Thyra::NOTRANS, *thyraB, thyraX.ptr());
+    solve_memory_region.stop();
+    solve_region.stop();
+    const RCP<ParameterList> solveParameters = status.extraParameters;  /* iteration count of the measured solve*/
     auto end = std::chrono::high_resolution_clock::now();
     SolverMarketSolveTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
@@ -268,7 +504,18 @@ int main_(Teuchos::CommandLineProcessor &clp, Xpetra::UnderlyingLib lib, int arg
     TimeMonitor::clearCounters();
     out << std::endl;
 
-    SolverMarketOutput(SolverMarketSetupTime, SolverMarketSolveTime, success, argc, argv);
+    // flop/byte of the measured solve: one SpMV (2 flops per nonzero) per Belos iteration, the preconditioner is not counted
+    if (SolverMarketPerf::instance().enabled()) {
+      if (!solveParameters.is_null() && solveParameters->isType<int>("Belos/Iteration Count")) {
+        const int iterations = solveParameters->get<int>("Belos/Iteration Count");
+        SolverMarketPerf::instance().set_flops("solve", 2.0 * double(A->getGlobalNumEntries()) * iterations);
+      }
+      SolverMarketPerf::instance().print();
+    }
+    SolverMarketMemory::instance().print();
+
+    SolverMarketOutput(SolverMarketSetupTime, SolverMarketSolveTime, success, argc, argv,
+                       SolverMarketPerf::instance().summary(), SolverMarketMemory::instance().summary());
   }
   TEUCHOS_STANDARD_CATCH_STATEMENTS(verbose, std::cerr, success);
 
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-vector.hpp"
+
+/* Python module solvermarket: the Matrix Market and binary readers and writers of
+SolverMarketCSRMatrix and SolverMarketVector. The NumPy arrays (indptr, indices, data, values)
+and the scipy.sparse.csr_matrix of a loaded object wrap its host Views: no copy, and the object
+stays alive as long as one of them does. The GIL is released while a file is parsed or written,
+so loads from several Python threads run concurrently.
+
+Indices are 32 bit (the reader's limit, and what scipy keeps without a copy), values float64 or
+complex128. Symmetric files keep their stored triangle, as in C++. */
+
+namespace py = pybind11;
+
+// Objects held by Python. Kokkos is finalized at exit only once they are all gone
+inline std::atomic<long>& SolverMarketPythonLive() {
+  static std::atomic<long> live(0);
+  return live;
+}
+
+template <typename _OBJECT_>
+std::shared_ptr<_OBJECT_> SolverMarketPythonMake() {
+  SolverMarketPythonLive()++;
+  return std::shared_ptr<_OBJECT_>(new _OBJECT_(), [](_OBJECT_* object) {
+    delete object;
+    SolverMarketPythonLive()--;
+  });
+}
+
+// NumPy element of a value type (Kokkos::complex and std::complex share their layout)
+template <typename _TYPE_>
+struct SolverMarketPythonScalar { using type = _TYPE_; };
+template <typename _TYPE_>
+struct SolverMarketPythonScalar<Kokkos::complex<_TYPE_>> { using type = std::complex<_TYPE_>; };
+
+// 1D array on host memory owned by owner (a Python object kept alive by the array)
+template <typename _TYPE_>
+py::array SolverMarketPythonArray(_TYPE_* data, const size_t n, py::handle owner) {
+  using Scalar = typename SolverMarketPythonScalar<_TYPE_>::type;
+  static_assert(sizeof(Scalar) == sizeof(_TYPE_), "NumPy element and value type differ in size");
+  return py::array_t<Scalar>({n}, {sizeof(Scalar)}, reinterpret_cast<Scalar*>(data), owner);
+}
+
+inline const char* SolverMarketPythonFieldName(const SolverMarketField field) {
+  switch (field) {
+    case SolverMarketFieldInteger: return "integer";
+    case SolverMarketFieldComplex: return "complex";
+    case SolverMarketFieldPattern: return "pattern";
+    default: return "real";
+  }
+}
+
+inline SolverMarketFileFormat SolverMarketPythonParseFormat(const std::string& format) {
+  if (format == "coordinate") return SolverMarketFileCoordinate;
+  if (format == "array") return SolverMarketFileArray;
+  throw py::value_error("format must be 'coordinate' or 'array', got '" + format + "'");
+}
+
+inline SolverMarketCSRMatrixType SolverMarketPythonParseSymmetry(const std::string& symmetry) {
+  if (symmetry == "general") return SolverMarketCSRMatrixGeneral;
+  if (symmetry == "symmetric") return SolverMarketCSRMatrixSymmetric;
+  if (symmetry == "skew-symmetric") return SolverMarketCSRMatrixSkewSymmetric;
+  if (symmetry == "hermitian") return SolverMarketCSRMatrixHermitian;
+  throw py::value_error("symmetry must be 'general', 'symmetric', 'skew-symmetric' or 'hermitian', got '" + symmetry + "'");
+}
+
+// true for complex128, false for float64, anything else is refused
+inline bool SolverMarketPythonIsComplex(const py::object& dtype) {
+  const py::dtype type = py::dtype::from_args(dtype);
+  if (type.kind() == 'f' && type.itemsize() == 8) return false;
+  if (type.kind() == 'c' && type.itemsize() == 16) return true;
+  throw py::value_error("dtype must be float64 or complex128");
+}
+
+inline void SolverMarketPythonCheck(const int status, const std::string& what, const std::string& filename) {
+  if (status != 0)
+    throw std::runtime_error(what + " '" + filename + "' failed with status " + std::to_string(status) + " (details on stderr)");
+}
+
+// --- Loads (GIL released during the read) ---
+
+template <typename _TYPE_>
+std::shared_ptr<SolverMarketCSRMatrix<_TYPE_, int>> SolverMarketPythonReadMatrix(const std::string& filename, const bool sum_duplicates,
+                                                                               const double drop_tolerance, const size_t memory_budget) {
+  auto A = SolverMarketPythonMake<SolverMarketCSRMatrix<_TYPE_, int>>();
+  SolverMarketAssemblyOptions assembly;
+  assembly.sum_duplicates = sum_duplicates;
+  assembly.drop_tolerance = drop_tolerance;
+  A->setAssemblyOptions(assembly);
+  A->setHostMemoryBudget(memory_budget);
+  int status;
+  {
+    py::gil_scoped_release release;
+    status = A->read_matrix_market_file(filename, SolverMarketCSRMatrixFull);
+  }
+  SolverMarketPythonCheck(status, "Reading matrix", filename);
+  return A;
+}
+
+template <typename _TYPE_>
+std::shared_ptr<SolverMarketCSRMatrix<_TYPE_, int>> SolverMarketPythonReadBinaryMatrix(const std::string& filename) {
+  auto A = SolverMarketPythonMake<SolverMarketCSRMatrix<_TYPE_, int>>();
+  int status;
+  {
+    py::gil_scoped_release release;
+    status = A->read_binary_file(filename);
+  }
+  SolverMarketPythonCheck(status, "Mapping binary matrix", filename);
+  return A;
+}
+
+template <typename _TYPE_>
+std::shared_ptr<SolverMarketVector<_TYPE_, int>> SolverMarketPythonReadVector(const std::string& filename, const bool binary) {
+  auto v = SolverMarketPythonMake<SolverMarketVector<_TYPE_, int>>();
+  int status;
+  {
+    py::gil_scoped_release release;
+    status = binary ? v->read_binary_file(filename) : v->read_matrix_market_file(filename);
+  }
+  SolverMarketPythonCheck(status, binary ? "Mapping binary vector" : "Reading vector", filename);
+  return v;
+}
+
+// --- Writes of Python data (a copy into a SolverMarket object, then its writer) ---
+
+template <typename _TYPE_>
+void SolverMarketPythonWriteMatrix(const std::string& filename, const py::object& matrix, const SolverMarketCSRMatrixType mtype,
+                                   const SolverMarketFileFormat format) {
+  using Scalar = typename SolverMarketPythonScalar<_TYPE_>::type;
+  using Indices = py::array_t<int, py::array::c_style | py::array::forcecast>;
+  const py::object coo = matrix.attr("tocoo")();
+  const auto shape = coo.attr("shape").cast<std::pair<long, long>>();
+  if (shape.first != shape.second) throw py::value_error("Only square matrices can be written");
+  const Indices rows(py::object(coo.attr("row"))), columns(py::object(coo.attr("col")));
+  const py::array_t<Scalar, py::array::c_style | py::array::forcecast> values(py::object(coo.attr("data")));
+  const size_t nnz = size_t(values.size());
+  if (size_t(rows.size()) != nnz || size_t(columns.size()) != nnz) throw py::value_error("row, col and data differ in length");
+
+  int status;
+  {
+    py::gil_scoped_release release;
+    const int* i = rows.data();
+    const int* j = columns.data();
+    const Scalar* a = values.data();
+    std::vector<std::tuple<int, int, _TYPE_>> entries(nnz);
+    for (size_t k = 0; k < nnz; k++) entries[k] = std::make_tuple(i[k], j[k], _TYPE_(a[k]));
+    SolverMarketCSRMatrix<_TYPE_, int> A;
+    status = A.build_from_coo(int(shape.first), entries, SolverMarketCSRMatrixFull, mtype);
+    if (status == 0) status = A.write_matrix_market_file(filename, format);
+  }
+  SolverMarketPythonCheck(status, "Writing matrix", filename);
+}
+
+template <typename _TYPE_>
+void SolverMarketPythonWriteVector(const std::string& filename, const py::object& values_object, const SolverMarketFileFormat format) {
+  using Scalar = typename SolverMarketPythonScalar<_TYPE_>::type;
+  const py::array_t<Scalar, py::array::c_style | py::array::forcecast> values(values_object);
+  if (values.ndim() != 1) throw py::value_error("Only 1D arrays can be written as vectors");
+  const int n = int(values.size());
+
+  int status;
+  {
+    py::gil_scoped_release release;
+    SolverMarketVector<_TYPE_, int> v(n);
+    std::copy(values.data(), values.data() + n, v.get_host_values_pointer());
+    status = v.write_matrix_market_file(filename, format);
+  }
+  SolverMarketPythonCheck(status, "Writing vector", filename);
+}
+
+// --- Classes ---
+
+template <typename _TYPE_>
+void SolverMarketPythonBindMatrix(py::module_& m, const char* name) {
+  using Matrix = SolverMarketCSRMatrix<_TYPE_, int>;
+  py::class_<Matrix, std::shared_ptr<Matrix>>(m, name, "Square CSR matrix read by solvermarket. indptr, indices and data share its memory.")
+      .def_property_readonly("n", [](Matrix& A) { return A.get_n(); })
+      .def_property_readonly("nnz", [](Matrix& A) { return A.get_nnz(); })
+      .def_property_readonly("shape", [](Matrix& A) { return py::make_tuple(A.get_n(), A.get_n()); })
+      .def_property_readonly("symmetry", [](Matrix& A) { return SolverMarketSymmetryName(A.getType()); },
+                             "Symmetry of the file: a symmetric matrix holds the stored triangle only")
+      .def_property_readonly("field", [](Matrix& A) { return SolverMarketPythonFieldName(A.getField()); })
+      .def_property_readonly("shared", &Matrix::isShared, "True when the arrays are a mapping of a binary file")
+      .def_property_readonly("indptr", [](py::object self) {
+        auto& A = self.cast<Matrix&>();
+        return SolverMarketPythonArray(A.get_host_offsets_pointer(), size_t(A.get_n()) + 1, self);
+      })
+      .def_property_readonly("indices", [](py::object self) {
+        auto& A = self.cast<Matrix&>();
+        return SolverMarketPythonArray(A.get_host_columns_pointer(), size_t(A.get_nnz()), self);
+      })
+      .def_property_readonly("data", [](py::object self) {
+        auto& A = self.cast<Matrix&>();
+        return SolverMarketPythonArray(A.get_host_values_pointer(), size_t(A.get_nnz()), self);
+      })
+      .def("to_scipy", [](py::object self) {
+        auto& A = self.cast<Matrix&>();
+        const py::object csr_matrix = py::module_::import("scipy.sparse").attr("csr_matrix");
+        const py::tuple arrays = py::make_tuple(self.attr("data"), self.attr("indices"), self.attr("indptr"));
+        return csr_matrix(arrays, py::arg("shape") = py::make_tuple(A.get_n(), A.get_n()), py::arg("copy") = false);
+      }, "scipy.sparse.csr_matrix on the same memory (no copy)")
+      .def("write", [](Matrix& A, const std::string& filename, const std::string& format) {
+        const SolverMarketFileFormat file_format = SolverMarketPythonParseFormat(format);
+        int status;
+        {
+          py::gil_scoped_release release;
+          status = A.write_matrix_market_file(filename, file_format);
+        }
+        SolverMarketPythonCheck(status, "Writing matrix", filename);
+      }, py::arg("filename"), py::arg("format") = "coordinate")
+      .def("write_binary", [](Matrix& A, const std::string& filename) {
+        int status;
+        {
+          py::gil_scoped_release release;
+          status = A.write_binary_file(filename);
+        }
+        SolverMarketPythonCheck(status, "Writing binary matrix", filename);
+      }, py::arg("filename"))
+      .def("__repr__", [name](Matrix& A) {
+        return std::string("<solvermarket.") + name + " n=" + std::to_string(A.get_n()) + " nnz=" + std::to_string(A.get_nnz()) + " " +
+               SolverMarketPythonFieldName(A.getField()) + " " + SolverMarketSymmetryName(A.getType()) + ">";
+      });
+}
+
+template <typename _TYPE_>
+void SolverMarketPythonBindVector(py::module_& m, const char* name) {
+  using Vector = SolverMarketVector<_TYPE_, int>;
+  py::class_<Vector, std::shared_ptr<Vector>>(m, name, "Vector read by solvermarket. values shares its memory.")
+      .def_property_readonly("n", [](Vector& v) { return v.get_n(); })
+      .def("__len__", [](Vector& v) { return size_t(v.get_n()); })
+      .def_property_readonly("values", [](py::object self) {
+        auto& v = self.cast<Vector&>();
+        return SolverMarketPythonArray(v.get_host_values_pointer(), size_t(v.get_n()), self);
+      })
+      .def("write", [](Vector& v, const std::string& filename, const std::string& format) {
+        const SolverMarketFileFormat file_format = SolverMarketPythonParseFormat(format);
+        int status;
+        {
+          py::gil_scoped_release release;
+          status = v.write_matrix_market_file(filename, file_format);
+        }
+        SolverMarketPythonCheck(status, "Writing vector", filename);
+      }, py::arg("filename"), py::arg("format") = "coordinate")
+      .def("write_binary", [](Vector& v, const std::string& filename) {
+        int status;
+        {
+          py::gil_scoped_release release;
+          status = v.write_binary_file(filename);
+        }
+        SolverMarketPythonCheck(status, "Writing binary vector", filename);
+      }, py::arg("filename"))
+      .def("__repr__", [name](Vector& v) { return std::string("<solvermarket.") + name + " n=" + std::to_string(v.get_n()) + ">"; });
+}
+
+PYBIND11_MODULE(solvermarket, m) {
+  m.doc() = "Matrix Market and binary CSR/vector I/O of solver-market, zero-copy NumPy/SciPy views";
+
+  // Kokkos of this process, unless the host application already started it
+  if (!Kokkos::is_initialized()) {
+    Kokkos::initialize();
+    py::module_::import("atexit").attr("register")(py::cpp_function([]() {
+      // Arrays still referenced at exit keep their Views: leave them to the process teardown
+      if (SolverMarketPythonLive() == 0 && Kokkos::is_initialized()) Kokkos::finalize();
+    }));
+  }
+
+  SolverMarketPythonBindMatrix<double>(m, "CSRMatrix");
+  SolverMarketPythonBindMatrix<Kokkos::complex<double>>(m, "ComplexCSRMatrix");
+  SolverMarketPythonBindVector<double>(m, "Vector");
+  SolverMarketPythonBindVector<Kokkos::complex<double>>(m, "ComplexVector");
+
+  m.def("read_matrix", [](const std::string& filename, const py::object& dtype, const bool sum_duplicates, const double drop_tolerance,
+                          const size_t memory_budget) -> py::object {
+    if (SolverMarketPythonIsComplex(dtype))
+      return py::cast(SolverMarketPythonReadMatrix<Kokkos::complex<double>>(filename, sum_duplicates, drop_tolerance, memory_budget));
+    return py::cast(SolverMarketPythonReadMatrix<double>(filename, sum_duplicates, drop_tolerance, memory_budget));
+  }, "Matrix Market coordinate file into a CSRMatrix (ComplexCSRMatrix for complex128). memory_budget in bytes, 0: none",
+        py::arg("filename"), py::arg("dtype") = "float64", py::arg("sum_duplicates") = false, py::arg("drop_tolerance") = -1.0,
+        py::arg("memory_budget") = 0);
+
+  m.def("read_binary_matrix", [](const std::string& filename, const py::object& dtype) -> py::object {
+    if (SolverMarketPythonIsComplex(dtype)) return py::cast(SolverMarketPythonReadBinaryMatrix<Kokkos::complex<double>>(filename));
+    return py::cast(SolverMarketPythonReadBinaryMatrix<double>(filename));
+  }, "Binary CSR file (write_binary) mapped into a CSRMatrix, no parse and no copy", py::arg("filename"), py::arg("dtype") = "float64");
+
+  m.def("read_vector", [](const std::string& filename, const py::object& dtype) -> py::object {
+    if (SolverMarketPythonIsComplex(dtype)) return py::cast(SolverMarketPythonReadVector<Kokkos::complex<double>>(filename, false));
+    return py::cast(SolverMarketPythonReadVector<double>(filename, false));
+  }, "Matrix Market vector file into a Vector (ComplexVector for complex128)", py::arg("filename"), py::arg("dtype") = "float64");
+
+  m.def("read_binary_vector", [](const std::string& filename, const py::object& dtype) -> py::object {
+    if (SolverMarketPythonIsComplex(dtype)) return py::cast(SolverMarketPythonReadVector<Kokkos::complex<double>>(filename, true));
+    return py::cast(SolverMarketPythonReadVector<double>(filename, true));
+  }, "Binary vector file (write_binary) mapped into a Vector", py::arg("filename"), py::arg("dtype") = "float64");
+
+  // Shortcuts to the SciPy/NumPy objects, the SolverMarket object lives on as their base
+  m.def("load_matrix", [](const std::string& filename, const py::object& dtype, const bool sum_duplicates, const double drop_tolerance) {
+    return py::module_::import("solvermarket").attr("read_matrix")(filename, dtype, sum_duplicates, drop_tolerance).attr("to_scipy")();
+  }, "Matrix Market file into a scipy.sparse.csr_matrix sharing the reader's memory", py::arg("filename"), py::arg("dtype") = "float64",
+        py::arg("sum_duplicates") = false, py::arg("drop_tolerance") = -1.0);
+
+  m.def("load_vector", [](const std::string& filename, const py::object& dtype) {
+    return py::module_::import("solvermarket").attr("read_vector")(filename, dtype).attr("values");
+  }, "Matrix Market vector file into a NumPy array sharing the reader's memory", py::arg("filename"), py::arg("dtype") = "float64");
+
+  m.def("write_matrix", [](const std::string& filename, const py::object& matrix, const std::string& symmetry, const std::string& format) {
+    const SolverMarketCSRMatrixType mtype = SolverMarketPythonParseSymmetry(symmetry);
+    const SolverMarketFileFormat file_format = SolverMarketPythonParseFormat(format);
+    if (py::dtype::from_args(matrix.attr("dtype")).kind() == 'c')
+      SolverMarketPythonWriteMatrix<Kokkos::complex<double>>(filename, matrix, mtype, file_format);
+    else
+      SolverMarketPythonWriteMatrix<double>(filename, matrix, mtype, file_format);
+  }, "Any square scipy.sparse matrix to a Matrix Market file. Symmetric matrices: pass the triangle to store",
+        py::arg("filename"), py::arg("matrix"), py::arg("symmetry") = "general", py::arg("format") = "coordinate");
+
+  m.def("write_vector", [](const std::string& filename, const py::object& values, const std::string& format) {
+    const SolverMarketFileFormat file_format = SolverMarketPythonParseFormat(format);
+    const py::array array = py::array::ensure(values);
+    if (!array) throw py::value_error("values is not convertible to a NumPy array");
+    if (array.dtype().kind() == 'c')
+      SolverMarketPythonWriteVector<Kokkos::complex<double>>(filename, values, file_format);
+    else
+      SolverMarketPythonWriteVector<double>(filename, values, file_format);
+  }, "1D array to a Matrix Market vector file", py::arg("filename"), py::arg("values"), py::arg("format") = "coordinate");
+}
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-vector.hpp"
+#include "solver-market-protocol.hpp"
+#include "solver-market-shared.hpp"
+
+/* Minimal client of solver_market_server: sends one job, prints the result as key=value lines
+and returns the job status as exit code. Kokkos is only started when the client itself reads or
+writes Matrix Market files (--binary, --memfd, --save-solution=). */
+
+
+int main(int argc, char* argv[])
+{
+    std::string socket_path = SolverMarketDefaultSocket;
+    std::string save_solution_file;
+    bool binary = false;
+    bool memfd = false;
+    SolverMarketJob job;
+
+    // 1. Parse input arguments
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--socket=", 0) == 0) {
+            socket_path = arg.substr(9);  // after "--socket="
+        } else if (arg.rfind("--matrix=", 0) == 0) {
+            job.matrix = arg.substr(9);  // after "--matrix="
+        } else if (arg.rfind("--rhs=", 0) == 0) {
+            job.rhs = arg.substr(6);  // after "--rhs="
+        } else if (arg.rfind("--config=", 0) == 0) {
+            job.config = arg.substr(9);  // after "--config="
+        } else if (arg.rfind("--backend=", 0) == 0) {
+            job.backend = arg.substr(10);  // after "--backend="
+        } else if (arg.rfind("--key=", 0) == 0) {
+            job.matrix_key = arg.substr(6);  // after "--key="
+        } else if (arg.rfind("--solution=", 0) == 0) {
+            job.solution = arg.substr(11);  // after "--solution=", written by the server
+        } else if (arg.rfind("--save-solution=", 0) == 0) {
+            save_solution_file = arg.substr(16);  // after "--save-solution=", written by the client
+        } else if (arg == "--binary") {
+            binary = true;
+        } else if (arg == "--memfd") {
+            memfd = true;
+        } else if (arg.rfind("--shm=", 0) == 0) {
+            job.matrix_shm = arg.substr(6);  // after "--shm=", segment created by the caller
+        } else if (arg == "--no-cache") {
+            job.use_cache = false;
+        } else if (arg == "--stats") {
+            job.command = "stats";
+        } else if (arg == "--evict") {
+            job.command = "evict";
+        } else if (arg == "--shutdown") {
+            job.command = "shutdown";
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (job.command == "solve" && job.matrix.empty() && job.matrix_shm.empty()) {
+        std::cerr << "Usage: " << argv[0] << " --matrix=<matrix_file.mtx> --rhs=<rhs_file.mtx> (optional) --config=<config_file> (optional)"
+                  << " --backend=amgx (optional) --key=<cache_key> (optional) --solution=<server_side_file.mtx> (optional)"
+                  << " --save-solution=<client_side_file.mtx> (optional) --binary | --memfd | --shm=<segment> --no-cache (optional)"
+                  << " --socket=<path> (optional)\n"
+                  << "       " << argv[0] << " --stats | --evict [--matrix=<file> | --key=<key>] | --shutdown" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const bool needs_kokkos = binary || memfd || !save_solution_file.empty();
+    if (needs_kokkos) Kokkos::initialize();
+    int status = SolverMarketServerSuccess;
+    {
+    // 2. Binary mode: the matrix (and rhs) are read here and shipped as CSR, the server does no file I/O
+    if (binary && job.command == "solve") {
+        auto matrix = SolverMarketCSRMatrix<double, int>();
+        if (matrix.read_matrix_market_file(job.matrix, SolverMarketCSRMatrixFull) != 0) {
+            std::cerr << "Error: cannot read " << job.matrix << std::endl;
+            status = SolverMarketServerErrorMatrixRead;
+        } else {
+            auto& csr = job.matrix_payload;
+            csr.n = matrix.get_n();
+            csr.nnz = matrix.get_nnz();
+            csr.offsets.assign(matrix.get_host_offsets_pointer(), matrix.get_host_offsets_pointer() + csr.n + 1);
+            csr.columns.assign(matrix.get_host_columns_pointer(), matrix.get_host_columns_pointer() + csr.nnz);
+            csr.values.assign(matrix.get_host_values_pointer(), matrix.get_host_values_pointer() + csr.nnz);
+            job.has_matrix_payload = true;
+        }
+        if (status == SolverMarketServerSuccess && !job.rhs.empty()) {
+            auto vector_b = SolverMarketVector<double, int>();
+            if (vector_b.read_matrix_market_file(job.rhs) != 0) {
+                std::cerr << "Error: cannot read " << job.rhs << std::endl;
+                status = SolverMarketServerErrorRhsRead;
+            } else {
+                job.rhs_payload.assign(vector_b.get_host_values_pointer(), vector_b.get_host_values_pointer() + vector_b.get_n());
+                job.has_rhs_payload = true;
+                job.rhs.clear();
+            }
+        }
+    }
+    // 3. memfd mode: the CSR goes to an anonymous segment whose descriptor follows the job, the server maps it
+    SolverMarketSharedSegment segment;
+    if (memfd && job.command == "solve" && status == SolverMarketServerSuccess) {
+        auto matrix = SolverMarketCSRMatrix<double, int>();
+        if (matrix.read_matrix_market_file(job.matrix, SolverMarketCSRMatrixFull) != 0) {
+            std::cerr << "Error: cannot read " << job.matrix << std::endl;
+            status = SolverMarketServerErrorMatrixRead;
+        } else if (segment.create_memfd("solver-market-matrix", SolverMarketSharedMatrix, matrix.get_n(), matrix.get_nnz(),
+                                        sizeof(int), sizeof(double)) != SolverMarketSharedSuccess) {
+            status = SolverMarketServerErrorMatrixRead;
+        } else {
+            std::copy(matrix.get_host_offsets_pointer(), matrix.get_host_offsets_pointer() + matrix.get_n() + 1, segment.offsets<int>());
+            std::copy(matrix.get_host_columns_pointer(), matrix.get_host_columns_pointer() + matrix.get_nnz(), segment.columns<int>());
+            std::copy(matrix.get_host_values_pointer(), matrix.get_host_values_pointer() + matrix.get_nnz(), segment.values<double>());
+            job.has_matrix_fd = true;
+            job.matrix_fd = segment.fd();
+        }
+    }
+    job.return_solution = !save_solution_file.empty();
+
+    // 4. Send the job, wait for the result
+    if (status == SolverMarketServerSuccess) {
+        int fd = SolverMarketConnect(socket_path);
+        SolverMarketJobResult result;
+        if (fd < 0) {
+            std::cerr << "Error: no server listening on " << socket_path << std::endl;
+            status = SolverMarketServerErrorConnection;
+        } else if (!SolverMarketSendJob(fd, job) || !SolverMarketRecvResult(fd, result)) {
+            std::cerr << "Error: connection to " << socket_path << " lost" << std::endl;
+            status = SolverMarketServerErrorConnection;
+        } else {
+            status = result.status;
+            std::cout << "status=" << result.status << "\n";
+            if (!result.message.empty()) std::cout << "message=" << result.message << "\n";
+            if (job.command == "solve") {
+                std::cout << "load_ms=" << result.load_ms << "\n"
+                          << "setup_ms=" << result.setup_ms << "\n"
+                          << "solve_ms=" << result.solve_ms << "\n"
+                          << "iterations=" << result.iterations << "\n"
+                          << "residual=" << result.residual << "\n"
+                          << "matrix_cached=" << result.matrix_cached << "\n"
+                          << "solver_cached=" << result.solver_cached << std::endl;
+            }
+
+            if (!save_solution_file.empty() && !result.solution.empty()) {
+                auto vector_x = SolverMarketVector<double, int>(int(result.solution.size()));
+                std::copy(result.solution.begin(), result.solution.end(), vector_x.get_host_values_pointer());
+                vector_x.write_matrix_market_file(save_solution_file);
+            }
+        }
+        if (fd >= 0) ::close(fd);
+    }
+    }
+    if (needs_kokkos) Kokkos::finalize();
+    return status;
+}
@@ -0,0 +1,322 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "solver-market-shared.hpp"
+
+#pragma once
+
+/* Wire format between solver_market_client and solver_market_server (Unix domain socket,
+one job per connection):
+
+  [uint64 header length][header: "key=value\n" lines][binary payload, payload_bytes long]
+
+The payload carries the optional binary CSR matrix and right-hand side of a job, and the
+optional solution of a result:
+  CSR:    uint64 n, uint64 nnz, int32 offsets[n+1], int32 columns[nnz], float64 values[nnz]
+  vector: uint64 n, float64 values[n]
+Numbers are in host byte order: client and server run on the same machine.
+
+Larger matrices skip the socket copy: the job names a POSIX shared memory segment (matrix_shm), or
+a memfd follows the message as SCM_RIGHTS ancillary data (matrix_fd=1), both in the segment layout
+of solver-market-shared.hpp. */
+
+constexpr const char* SolverMarketDefaultSocket = "/tmp/solver_market.sock";
+constexpr uint64_t SolverMarketDefaultMaxPayloadBytes = uint64_t(4) << 30;  /* larger payloads are refused (server --max-payload-mb)*/
+
+enum SolverMarketServerStatus {
+    SolverMarketServerSuccess,
+    SolverMarketServerErrorConnection,
+    SolverMarketServerErrorProtocol,
+    SolverMarketServerErrorUnknownCommand,
+    SolverMarketServerErrorUnknownBackend,
+    SolverMarketServerErrorMatrixRead,
+    SolverMarketServerErrorRhsRead,
+    SolverMarketServerErrorConfig,
+    SolverMarketServerErrorSetup,
+    SolverMarketServerErrorSolve,
+    SolverMarketServerErrorInternal     /* exception while serving the job*/
+};
+
+struct SolverMarketCSRPayload {
+    uint64_t n = 0;
+    uint64_t nnz = 0;
+    std::vector<int> offsets, columns;
+    std::vector<double> values;
+};
+
+struct SolverMarketJob {
+    std::string command = "solve";  /* solve | stats | evict | shutdown*/
+    std::string backend = "amgx";
+    std::string matrix;             /* path, or empty when the matrix is in the payload*/
+    std::string rhs;                /* path, empty: payload rhs if any, else ones*/
+    std::string config;             /* backend configuration file*/
+    std::string matrix_key;         /* cache key, default: path + modification time, or payload hash*/
+    std::string solution;           /* path the server writes the solution to, optional*/
+    bool return_solution = false;   /* solution sent back in the result payload*/
+    bool use_cache = true;
+
+    bool has_matrix_payload = false;
+    SolverMarketCSRPayload matrix_payload;
+    bool has_rhs_payload = false;
+    std::vector<double> rhs_payload;
+
+    std::string matrix_shm;         /* shared memory segment name, optional*/
+    bool has_matrix_fd = false;     /* a segment fd follows the message*/
+    int matrix_fd = -1;
+};
+
+struct SolverMarketJobResult {
+    int status = SolverMarketServerSuccess;
+    std::string message;
+    double load_ms = 0, setup_ms = 0, solve_ms = 0;
+    int iterations = 0;
+    double residual = 0;
+    bool matrix_cached = false, solver_cached = false;
+    std::vector<double> solution;
+};
+
+// --- Raw socket I/O ---
+
+inline bool SolverMarketSendAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t sent = ::send(fd, p, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        p += sent;
+        size -= size_t(sent);
+    }
+    return true;
+}
+
+inline bool SolverMarketRecvAll(int fd, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t received = ::recv(fd, p, size, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        p += received;
+        size -= size_t(received);
+    }
+    return true;
+}
+
+// --- Payload encoding ---
+
+inline void SolverMarketAppendBytes(std::string& out, const void* data, size_t size) {
+    out.append(static_cast<const char*>(data), size);
+}
+
+inline void SolverMarketAppendVector(std::string& out, const std::vector<double>& values) {
+    const uint64_t n = values.size();
+    SolverMarketAppendBytes(out, &n, sizeof(n));
+    SolverMarketAppendBytes(out, values.data(), n * sizeof(double));
+}
+
+inline void SolverMarketAppendCSR(std::string& out, const SolverMarketCSRPayload& csr) {
+    SolverMarketAppendBytes(out, &csr.n, sizeof(csr.n));
+    SolverMarketAppendBytes(out, &csr.nnz, sizeof(csr.nnz));
+    SolverMarketAppendBytes(out, csr.offsets.data(), (csr.n + 1) * sizeof(int));
+    SolverMarketAppendBytes(out, csr.columns.data(), csr.nnz * sizeof(int));
+    SolverMarketAppendBytes(out, csr.values.data(), csr.nnz * sizeof(double));
+}
+
+// Reads from payload[pos], false if truncated
+inline bool SolverMarketTakeBytes(const std::string& payload, size_t& pos, void* data, size_t size) {
+    if (pos + size > payload.size()) return false;
+    std::memcpy(data, payload.data() + pos, size);
+    pos += size;
+    return true;
+}
+
+inline bool SolverMarketTakeVector(const std::string& payload, size_t& pos, std::vector<double>& values) {
+    uint64_t n;
+    if (!SolverMarketTakeBytes(payload, pos, &n, sizeof(n)) || n > payload.size()) return false;
+    values.resize(n);
+    return SolverMarketTakeBytes(payload, pos, values.data(), n * sizeof(double));
+}
+
+// The CSR comes from another process: sizes must fit the int indices, offsets must start at 0,
+// never decrease and end at nnz, and every column must be a row of the matrix
+inline bool SolverMarketCheckCSR(const SolverMarketCSRPayload& csr) {
+    const uint64_t int_max = uint64_t(std::numeric_limits<int>::max());
+    if (csr.n > int_max || csr.nnz > int_max) return false;
+    if (csr.offsets.size() != csr.n + 1 || csr.columns.size() != csr.nnz || csr.values.size() != csr.nnz) return false;
+    if (csr.offsets[0] != 0 || uint64_t(csr.offsets[csr.n]) != csr.nnz) return false;
+    for (uint64_t i = 0; i < csr.n; i++)
+        if (csr.offsets[i + 1] < csr.offsets[i]) return false;
+    for (const int j : csr.columns)
+        if (j < 0 || uint64_t(j) >= csr.n) return false;
+    return true;
+}
+
+inline bool SolverMarketTakeCSR(const std::string& payload, size_t& pos, SolverMarketCSRPayload& csr) {
+    if (!SolverMarketTakeBytes(payload, pos, &csr.n, sizeof(csr.n)) ||
+        !SolverMarketTakeBytes(payload, pos, &csr.nnz, sizeof(csr.nnz))) return false;
+    if (csr.n >= payload.size() || csr.nnz > payload.size()) return false;
+    csr.offsets.resize(csr.n + 1);
+    csr.columns.resize(csr.nnz);
+    csr.values.resize(csr.nnz);
+    return SolverMarketTakeBytes(payload, pos, csr.offsets.data(), (csr.n + 1) * sizeof(int)) &&
+           SolverMarketTakeBytes(payload, pos, csr.columns.data(), csr.nnz * sizeof(int)) &&
+           SolverMarketTakeBytes(payload, pos, csr.values.data(), csr.nnz * sizeof(double)) &&
+           SolverMarketCheckCSR(csr);
+}
+
+// --- Messages ---
+
+inline bool SolverMarketSendMessage(int fd, const std::map<std::string, std::string>& fields, const std::string& payload) {
+    std::string header;
+    for (const auto& [key, value] : fields) header += key + "=" + value + "\n";
+    header += "payload_bytes=" + std::to_string(payload.size()) + "\n";
+    const uint64_t length = header.size();
+    return SolverMarketSendAll(fd, &length, sizeof(length)) &&
+           SolverMarketSendAll(fd, header.data(), header.size()) &&
+           SolverMarketSendAll(fd, payload.data(), payload.size());
+}
+
+// false on a malformed header or a payload above max_payload_bytes (nothing is allocated for it)
+inline bool SolverMarketRecvMessage(int fd, std::map<std::string, std::string>& fields, std::string& payload,
+                                    const uint64_t max_payload_bytes = SolverMarketDefaultMaxPayloadBytes) {
+    uint64_t length;
+    if (!SolverMarketRecvAll(fd, &length, sizeof(length)) || length > (uint64_t(1) << 20)) return false;
+    std::string header(length, '\0');
+    if (!SolverMarketRecvAll(fd, header.data(), length)) return false;
+
+    fields.clear();
+    std::istringstream lines(header);
+    std::string line;
+    while (std::getline(lines, line)) {
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos) return false;
+        fields[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+    const std::string size = fields.count("payload_bytes") ? fields["payload_bytes"] : "0";
+    if (size.empty() || size.size() > 19 || size.find_first_not_of("0123456789") != std::string::npos) return false;
+    const uint64_t payload_bytes = std::stoull(size);
+    if (payload_bytes > max_payload_bytes) return false;
+    payload.assign(payload_bytes, '\0');
+    return SolverMarketRecvAll(fd, payload.data(), payload_bytes);
+}
+
+inline bool SolverMarketSendJob(int fd, const SolverMarketJob& job) {
+    std::map<std::string, std::string> fields = {
+        {"command", job.command}, {"backend", job.backend}, {"matrix", job.matrix}, {"rhs", job.rhs},
+        {"config", job.config}, {"matrix_key", job.matrix_key}, {"solution", job.solution},
+        {"return_solution", job.return_solution ? "1" : "0"}, {"use_cache", job.use_cache ? "1" : "0"},
+        {"matrix_payload", job.has_matrix_payload ? "1" : "0"}, {"rhs_payload", job.has_rhs_payload ? "1" : "0"},
+        {"matrix_shm", job.matrix_shm}, {"matrix_fd", job.has_matrix_fd ? "1" : "0"}};
+    std::string payload;
+    if (job.has_matrix_payload) SolverMarketAppendCSR(payload, job.matrix_payload);
+    if (job.has_rhs_payload) SolverMarketAppendVector(payload, job.rhs_payload);
+    if (!SolverMarketSendMessage(fd, fields, payload)) return false;
+    return !job.has_matrix_fd || SolverMarketSendFd(fd, job.matrix_fd);
+}
+
+inline bool SolverMarketRecvJob(int fd, SolverMarketJob& job, const uint64_t max_payload_bytes = SolverMarketDefaultMaxPayloadBytes) {
+    std::map<std::string, std::string> fields;
+    std::string payload;
+    if (!SolverMarketRecvMessage(fd, fields, payload, max_payload_bytes)) return false;
+
+    job = SolverMarketJob();
+    job.command = fields["command"];
+    job.backend = fields["backend"];
+    job.matrix = fields["matrix"];
+    job.rhs = fields["rhs"];
+    job.config = fields["config"];
+    job.matrix_key = fields["matrix_key"];
+    job.solution = fields["solution"];
+    job.return_solution = (fields["return_solution"] == "1");
+    job.use_cache = (fields["use_cache"] != "0");
+    job.has_matrix_payload = (fields["matrix_payload"] == "1");
+    job.has_rhs_payload = (fields["rhs_payload"] == "1");
+    job.matrix_shm = fields["matrix_shm"];
+    job.has_matrix_fd = (fields["matrix_fd"] == "1");
+
+    size_t pos = 0;
+    if (job.has_matrix_payload && !SolverMarketTakeCSR(payload, pos, job.matrix_payload)) return false;
+    if (job.has_rhs_payload && !SolverMarketTakeVector(payload, pos, job.rhs_payload)) return false;
+    if (job.has_matrix_fd && (job.matrix_fd = SolverMarketRecvFd(fd)) < 0) return false;
+    return pos == payload.size();
+}
+
+inline bool SolverMarketSendResult(int fd, const SolverMarketJobResult& result) {
+    std::ostringstream load, setup, solve, residual;
+    load.precision(17); setup.precision(17); solve.precision(17); residual.precision(17);
+    load << result.load_ms; setup << result.setup_ms; solve << result.solve_ms; residual << result.residual;
+    std::map<std::string, std::string> fields = {
+        {"status", std::to_string(result.status)}, {"message", result.message},
+        {"load_ms", load.str()}, {"setup_ms", setup.str()}, {"solve_ms", solve.str()},
+        {"iterations", std::to_string(result.iterations)}, {"residual", residual.str()},
+        {"matrix_cached", result.matrix_cached ? "1" : "0"}, {"solver_cached", result.solver_cached ? "1" : "0"}};
+    std::string payload;
+    if (!result.solution.empty()) SolverMarketAppendVector(payload, result.solution);
+    return SolverMarketSendMessage(fd, fields, payload);
+}
+
+inline bool SolverMarketRecvResult(int fd, SolverMarketJobResult& result) {
+    std::map<std::string, std::string> fields;
+    std::string payload;
+    if (!SolverMarketRecvMessage(fd, fields, payload)) return false;
+
+    result = SolverMarketJobResult();
+    try {
+        result.status = std::stoi(fields["status"]);
+        result.message = fields["message"];
+        result.load_ms = std::stod(fields["load_ms"]);
+        result.setup_ms = std::stod(fields["setup_ms"]);
+        result.solve_ms = std::stod(fields["solve_ms"]);
+        result.iterations = std::stoi(fields["iterations"]);
+        result.residual = std::stod(fields["residual"]);
+    } catch (const std::exception&) {
+        return false;
+    }
+    result.matrix_cached = (fields["matrix_cached"] == "1");
+    result.solver_cached = (fields["solver_cached"] == "1");
+
+    size_t pos = 0;
+    if (!payload.empty() && !SolverMarketTakeVector(payload, pos, result.solution)) return false;
+    return pos == payload.size();
+}
+
+// --- Connections ---
+
+inline int SolverMarketConnect(const std::string& socket_path) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 64 bit FNV-1a over 8 byte words (bytes for the tail), cache key of payload and shared matrices
+inline uint64_t SolverMarketHashBytes(const void* data, size_t size, uint64_t hash = 1469598103934665603ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, 8);
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    }
+    for (; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,427 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <csignal>
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "solver-market-solver.hpp"
+#include "solver-market-protocol.hpp"
+#include "solver-market-shared.hpp"
+#include <chrono>
+#include <solver-market-output.h>
+
+/* Persistent solve service: Kokkos and the libsolvermarket backends are initialized once, then jobs
+are taken from a Unix domain socket one at a time. Device-resident matrices and set-up solvers (the
+preconditioner hierarchy) are kept in LRU caches, so a job on an already seen matrix/backend/config
+only pays the solve. */
+
+
+// Least recently used cache, entries are destroyed with the given callback when evicted
+template <typename _ENTRY_>
+class SolverMarketLRUCache {
+public:
+  SolverMarketLRUCache(size_t capacity, std::function<void(const std::string&, _ENTRY_&)> destroy)
+      : capacity_(capacity), destroy_(destroy) {}
+
+  // nullptr if absent, otherwise the entry becomes the most recently used
+  _ENTRY_* find(const std::string& key){
+    auto it = index_.find(key);
+    if (it == index_.end()) return nullptr;
+    items_.splice(items_.begin(), items_, it->second);
+    return &it->second->second;
+  }
+
+  _ENTRY_& insert(const std::string& key, _ENTRY_ entry){
+    erase(key);
+    while (capacity_ > 0 && items_.size() >= capacity_){
+      erase(items_.back().first);
+    }
+    items_.emplace_front(key, entry);
+    index_[key] = items_.begin();
+    return items_.front().second;
+  }
+
+  void erase(const std::string& key){
+    auto it = index_.find(key);
+    if (it == index_.end()) return;
+    auto item = it->second;
+    index_.erase(it);
+    destroy_(item->first, item->second);
+    items_.erase(item);
+  }
+
+  void erase_if(const std::function<bool(const std::string&, const _ENTRY_&)>& predicate){
+    std::vector<std::string> keys;
+    for (const auto& [key, entry] : items_){
+      if (predicate(key, entry)) keys.push_back(key);
+    }
+    for (const auto& key : keys) erase(key);
+  }
+
+  void clear(){ erase_if([](const std::string&, const _ENTRY_&){ return true; }); }
+
+  size_t size() const { return items_.size(); }
+
+private:
+  size_t capacity_;
+  std::function<void(const std::string&, _ENTRY_&)> destroy_;
+  std::list<std::pair<std::string, _ENTRY_>> items_;
+  std::unordered_map<std::string, typename std::list<std::pair<std::string, _ENTRY_>>::iterator> index_;
+};
+
+struct SolverMarketCachedMatrix {
+  std::shared_ptr<SolverMarketSolverMatrix> A;
+};
+
+struct SolverMarketCachedSolver {
+  std::string matrix_key;
+  std::shared_ptr<SolverMarketSolver> solver;
+};
+
+volatile std::sig_atomic_t SolverMarketServerStop = 0;
+
+void SolverMarketServerSignal(int){
+  SolverMarketServerStop = 1;
+}
+
+// "path@mtime:size", empty if the file does not exist: a rewritten file gets a new key
+std::string file_key(const std::string& path){
+  struct stat info;
+  if (path.empty() || ::stat(path.c_str(), &info) != 0) return "";
+  return path + "@" + std::to_string(info.st_mtime) + ":" + std::to_string(info.st_size);
+}
+
+double elapsed_ms(std::chrono::high_resolution_clock::time_point start){
+  return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+
+int main(int argc, char* argv[])
+{
+    Kokkos::initialize();
+    SolverMarketInitializeBackends(&argc, &argv);
+    {
+    std::string socket_path = SolverMarketDefaultSocket;
+    std::string default_config_file;
+    std::string default_muelu_config_file;
+    std::string default_native_config_file;
+    size_t max_matrices = 16;
+    size_t max_solvers = 16;
+    uint64_t max_payload_bytes = SolverMarketDefaultMaxPayloadBytes;
+
+    // 1. Parse input arguments
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--socket=", 0) == 0) {
+            socket_path = arg.substr(9);  // after "--socket="
+        } else if (arg.rfind("--config=", 0) == 0) {
+            default_config_file = arg.substr(9);  // after "--config="
+        } else if (arg.rfind("--muelu-config=", 0) == 0) {
+            default_muelu_config_file = arg.substr(15);  // after "--muelu-config="
+        } else if (arg.rfind("--native-config=", 0) == 0) {
+            default_native_config_file = arg.substr(16);  // after "--native-config="
+        } else if (arg.rfind("--max-matrices=", 0) == 0) {
+            max_matrices = std::stoul(arg.substr(15));  // after "--max-matrices="
+        } else if (arg.rfind("--max-solvers=", 0) == 0) {
+            max_solvers = std::stoul(arg.substr(14));  // after "--max-solvers="
+        } else if (arg.rfind("--max-payload-mb=", 0) == 0) {
+            max_payload_bytes = std::stoull(arg.substr(17)) << 20;  // after "--max-payload-mb="
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: " << argv[0] << " --socket=<path> (optional) --config=<default_amgx_config.json> (optional)"
+                      << " --muelu-config=<default_params.xml> --native-config=<default_params.txt> (optional)"
+                      << " --max-matrices=<count> --max-solvers=<count> --max-payload-mb=<MB> (optional)" << std::endl;
+            SolverMarketFinalizeBackends();
+            Kokkos::finalize();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // 2. Backends of this build
+    std::string backends;
+    for (const auto& backend : SolverMarketAvailableBackends()) backends += " " + backend;
+    std::cout << "[Info][SolverMarket][Server] backends:" << (backends.empty() ? " none" : backends) << std::endl;
+
+    // 3. Caches, a matrix takes the solvers built on it along when evicted
+    SolverMarketLRUCache<SolverMarketCachedSolver> solvers(max_solvers,
+        [](const std::string&, SolverMarketCachedSolver& entry){
+            entry.solver.reset();
+        });
+    SolverMarketLRUCache<SolverMarketCachedMatrix> matrices(max_matrices,
+        [&solvers](const std::string& key, SolverMarketCachedMatrix& entry){
+            solvers.erase_if([&key](const std::string&, const SolverMarketCachedSolver& solver){
+                return solver.matrix_key == key;
+            });
+            entry.A.reset();
+        });
+
+    // 4. Socket
+    int server_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    ::unlink(socket_path.c_str());
+    if (server_fd < 0 || ::bind(server_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(server_fd, 16) != 0) {
+        std::cerr << "Error: could not listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        SolverMarketFinalizeBackends();
+        Kokkos::finalize();
+        return EXIT_FAILURE;
+    }
+
+    // No SA_RESTART: accept() returns on SIGINT/SIGTERM and the loop exits cleanly
+    struct sigaction action{};
+    action.sa_handler = SolverMarketServerSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::cout << "[Info][SolverMarket][Server] listening on " << socket_path << std::endl;
+
+    size_t jobs_served = 0;
+
+    // One solve job, matrices and solvers not found in the caches are built and cached
+    auto solve = [&](const SolverMarketJob& job, std::shared_ptr<SolverMarketSharedSegment> segment, SolverMarketJobResult& result){
+        const std::string config_file = !job.config.empty() ? job.config
+                                      : (job.backend == "muelu") ? default_muelu_config_file
+                                      : (job.backend == "native") ? default_native_config_file : default_config_file;
+        auto backends = SolverMarketAvailableBackends();
+        if (std::find(backends.begin(), backends.end(), job.backend) == backends.end()) {
+            result.status = SolverMarketServerErrorUnknownBackend;
+            result.message = "unknown backend " + job.backend;
+            return;
+        }
+        const std::string config_key = file_key(config_file);
+        if (config_key.empty()) {
+            result.status = SolverMarketServerErrorConfig;
+            result.message = "cannot open config " + config_file;
+            return;
+        }
+
+        // Matrix key: given, or derived from the file / payload content
+        std::string matrix_key = job.matrix_key;
+        if (matrix_key.empty() && job.has_matrix_payload) {
+            const auto& csr = job.matrix_payload;
+            uint64_t hash = SolverMarketHashBytes(csr.offsets.data(), csr.offsets.size() * sizeof(int));
+            hash = SolverMarketHashBytes(csr.columns.data(), csr.columns.size() * sizeof(int), hash);
+            hash = SolverMarketHashBytes(csr.values.data(), csr.values.size() * sizeof(double), hash);
+            matrix_key = "payload:" + std::to_string(hash);
+        } else if (matrix_key.empty() && segment) {
+            const void* data = &segment->header();
+            matrix_key = "shared:" + std::to_string(SolverMarketHashBytes(data, segment->bytes()));
+        } else if (matrix_key.empty()) {
+            matrix_key = file_key(job.matrix);
+            if (matrix_key.empty()) {
+                result.status = SolverMarketServerErrorMatrixRead;
+                result.message = "cannot open matrix " + job.matrix;
+                return;
+            }
+        }
+        // Uncached jobs never replace (or reuse) cached entries
+        if (!job.use_cache) matrix_key += "#uncached";
+        const std::string solver_key = matrix_key + "|" + job.backend + "|" + config_key;
+
+        // 5. Matrix, read and sent to the device once per key, shared by every backend
+        auto start = std::chrono::high_resolution_clock::now();
+        SolverMarketCachedMatrix* matrix = matrices.find(matrix_key);
+        result.matrix_cached = (matrix != nullptr);
+        if (!matrix) {
+            // A payload is laid out as a segment so that all sources share the attach path
+            if (job.has_matrix_payload) {
+                const auto& csr = job.matrix_payload;
+                segment = std::make_shared<SolverMarketSharedSegment>();
+                if (segment->create_memfd("solver-market-payload", SolverMarketSharedMatrix, csr.n, csr.nnz,
+                                          sizeof(int), sizeof(double)) != SolverMarketSharedSuccess) {
+                    result.status = SolverMarketServerErrorMatrixRead;
+                    result.message = "cannot allocate the payload matrix";
+                    return;
+                }
+                std::copy(csr.offsets.begin(), csr.offsets.end(), segment->offsets<int>());
+                std::copy(csr.columns.begin(), csr.columns.end(), segment->columns<int>());
+                std::copy(csr.values.begin(), csr.values.end(), segment->values<double>());
+            }
+
+            // A shared segment is wrapped as is: the device copy is the only copy
+            SolverMarketCachedMatrix entry;
+            entry.A = std::make_shared<SolverMarketSolverMatrix>();
+            const int status = segment ? entry.A->attach_shared_segment(segment)
+                                       : entry.A->read_matrix_market_file(job.matrix, SolverMarketCSRMatrixFull);
+            if (status != 0) {
+                result.status = SolverMarketServerErrorMatrixRead;
+                result.message = (segment ? "cannot use shared matrix, status " : "cannot read matrix " + job.matrix + ", status ")
+                               + std::to_string(status);
+                return;
+            }
+            entry.A->send_to_device();
+            matrix = &matrices.insert(matrix_key, entry);
+        }
+        result.load_ms = elapsed_ms(start);
+        SolverMarketSolverMatrix& A = *matrix->A;
+        const int n = A.get_n();
+
+        // 6. Solver, set up once per (matrix, backend, config)
+        start = std::chrono::high_resolution_clock::now();
+        SolverMarketCachedSolver* solver = solvers.find(solver_key);
+        result.solver_cached = (solver != nullptr);
+        if (!solver) {
+            SolverMarketCachedSolver entry;
+            entry.matrix_key = matrix_key;
+            entry.solver = SolverMarketCreateSolver(job.backend);
+            if (entry.solver->configure(config_file) != SolverMarketSolverSuccess) {
+                result.status = SolverMarketServerErrorConfig;
+                result.message = "cannot parse config " + config_file;
+                return;
+            }
+            const int status = entry.solver->setup(A);
+            if (status != SolverMarketSolverSuccess) {
+                result.status = SolverMarketServerErrorSetup;
+                result.message = job.backend + " setup, status " + std::to_string(status);
+                return;
+            }
+            solver = &solvers.insert(solver_key, entry);
+        }
+        result.setup_ms = result.solver_cached ? 0.0 : elapsed_ms(start);
+
+        // 7. Right-hand side (file, payload or ones) and zero initial guess
+        SolverMarketSolverVector vector_b;
+        if (!job.rhs.empty()) {
+            if (vector_b.read_matrix_market_file(job.rhs) != 0 || vector_b.get_n() != n) {
+                result.status = SolverMarketServerErrorRhsRead;
+                result.message = "cannot read a rhs of size " + std::to_string(n) + " from " + job.rhs;
+            }
+        } else {
+            vector_b = SolverMarketSolverVector(n, 1.0);
+            if (job.has_rhs_payload) {
+                if (job.rhs_payload.size() != size_t(n)) {
+                    result.status = SolverMarketServerErrorRhsRead;
+                    result.message = "rhs payload of size " + std::to_string(job.rhs_payload.size()) + ", expected " + std::to_string(n);
+                } else {
+                    std::copy(job.rhs_payload.begin(), job.rhs_payload.end(), vector_b.get_host_values_pointer());
+                }
+            }
+        }
+
+        if (result.status == SolverMarketServerSuccess) {
+            auto vector_x = SolverMarketSolverVector(n, 0.0);
+            vector_b.send_to_device();
+            vector_x.send_to_device();
+
+            // 8. Solve
+            const int status = solver->solver->solve(vector_b, vector_x);
+            const auto& stats = solver->solver->stats();
+            result.solve_ms = stats.solve_ms;
+            result.iterations = stats.iterations;
+            result.residual = stats.residual;
+
+            if (status != SolverMarketSolverSuccess) {
+                result.status = SolverMarketServerErrorSolve;
+                result.message = (status == SolverMarketSolverErrorNotConverged) ? "solve did not converge" : "solve failed";
+            }
+            if (status == SolverMarketSolverSuccess || status == SolverMarketSolverErrorNotConverged) {
+                if (!job.solution.empty()) vector_x.write_matrix_market_file(job.solution);
+                if (job.return_solution) {
+                    result.solution.assign(vector_x.get_host_values_pointer(), vector_x.get_host_values_pointer() + n);
+                }
+            }
+        }
+
+        // Same record as the input decks, the arguments describe the job
+        std::vector<std::string> args = {"solver_market_server", "--backend=" + job.backend,
+            "--matrix=" + (job.has_matrix_payload ? std::string("<payload>") : segment ? "<shared>" : job.matrix),
+            "--rhs=" + job.rhs, "--config=" + config_file,
+            "--matrix-cached=" + std::to_string(result.matrix_cached),
+            "--solver-cached=" + std::to_string(result.solver_cached)};
+        std::vector<char*> args_pointers;
+        for (auto& arg : args) args_pointers.push_back(arg.data());
+        SolverMarketOutput(std::chrono::milliseconds(long(result.setup_ms)), std::chrono::milliseconds(long(result.solve_ms)),
+                           result.status == SolverMarketServerSuccess, int(args_pointers.size()), args_pointers.data());
+    };
+
+    // 9. Job loop, one job per connection
+    while (!SolverMarketServerStop) {
+        int client_fd = ::accept(server_fd, nullptr, nullptr);
+        if (client_fd < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: accept: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        SolverMarketJob job;
+        SolverMarketJobResult result;
+        // A bad job (or a failing backend) is answered with an error, it never stops the server
+        try {
+            if (!SolverMarketRecvJob(client_fd, job, max_payload_bytes)) {
+                result.status = SolverMarketServerErrorProtocol;
+                result.message = "malformed job";
+            } else if (job.command == "solve") {
+                // Shared matrix: named segment, or memfd received with the job (owned by the segment from here)
+                std::shared_ptr<SolverMarketSharedSegment> segment;
+                if (!job.matrix_shm.empty() || job.has_matrix_fd) {
+                    segment = std::make_shared<SolverMarketSharedSegment>();
+                    const int status = job.has_matrix_fd ? segment->open_fd(job.matrix_fd) : segment->open_shared(job.matrix_shm);
+                    if (status != SolverMarketSharedSuccess) {
+                        result.status = SolverMarketServerErrorMatrixRead;
+                        result.message = "cannot map shared matrix, status " + std::to_string(status);
+                    }
+                }
+                if (result.status == SolverMarketServerSuccess) solve(job, segment, result);
+                jobs_served++;
+                // Uncached entries (and their solvers) go away whatever the outcome
+                matrices.erase_if([](const std::string& key, const SolverMarketCachedMatrix&){
+                    return key.size() > 9 && key.compare(key.size() - 9, 9, "#uncached") == 0;
+                });
+            } else if (job.command == "stats") {
+                std::ostringstream stats;
+                stats << "jobs " << jobs_served << ", matrices cached " << matrices.size()
+                      << ", solvers cached " << solvers.size();
+                result.message = stats.str();
+                SolverMarketBufferPool::instance().print_statistics();
+            } else if (job.command == "evict") {
+                // One matrix (and its solvers) if a key is given, everything otherwise
+                if (job.matrix_key.empty() && job.matrix.empty()) {
+                    matrices.clear();
+                } else {
+                    matrices.erase(job.matrix_key.empty() ? file_key(job.matrix) : job.matrix_key);
+                }
+            } else if (job.command == "shutdown") {
+                SolverMarketServerStop = 1;
+            } else {
+                result.status = SolverMarketServerErrorUnknownCommand;
+                result.message = "unknown command " + job.command;
+            }
+        } catch (const std::exception& e) {
+            result = SolverMarketJobResult();
+            result.status = SolverMarketServerErrorInternal;
+            result.message = std::string("exception: ") + e.what();
+        } catch (...) {
+            result = SolverMarketJobResult();
+            result.status = SolverMarketServerErrorInternal;
+            result.message = "unknown exception";
+        }
+
+        std::cout << "[Info][SolverMarket][Server][" << job.command << "] status " << result.status
+                  << (result.message.empty() ? "" : ", " + result.message) << std::endl;
+        SolverMarketSendResult(client_fd, result);
+        ::close(client_fd);
+    }
+
+    // 10. Clean up and shut down
+    ::close(server_fd);
+    ::unlink(socket_path.c_str());
+    matrices.clear();
+    solvers.clear();
+    std::cout << "[Info][SolverMarket][Server] stopped after " << jobs_served << " jobs" << std::endl;
+    }
+    SolverMarketFinalizeBackends();
+    Kokkos::finalize();
+    return EXIT_SUCCESS;
+}
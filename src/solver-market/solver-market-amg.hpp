@@ -0,0 +1,150 @@
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "solver-market-header.hpp"
+#include "solver-market-sparse.hpp"
+
+#pragma once
+
+/* Native smoothed aggregation AMG, every phase in Kokkos so that the setup and solve costs of the
+vendor AMGs can be compared with a hierarchy we can instrument end to end.
+
+Setup, per level:
+  - strength of connection: a_ij strong if |a_ij| >= theta sqrt(|a_ii a_jj|) (theta = 0 keeps all),
+    weak entries are lumped into the diagonal of the filtered matrix used to smooth P
+  - aggregation: parallel MIS-2 (the roots are a maximal set of vertices 3 apart), then every vertex
+    joins the aggregate of a neighbouring root or of an aggregated neighbour
+  - tentative prolongator: constant near null space, 1/sqrt(|aggregate|) on the aggregate
+  - smoothed prolongator P = (I - omega D^-1 A_filtered) P_tentative, omega = 4/3 / lambda_max(D^-1 A),
+    lambda_max from a power iteration
+  - Galerkin coarse operator R (A P) with R = P^T, two SpGEMMs
+The coarsest level (<= coarse_size rows) is solved by a dense LU on the host.
+
+Solve: V(1,1) cycle with Chebyshev smoothing (degree k, interval [lambda_max/ratio, lambda_max]),
+symmetric, so it can precondition CG. Timers are kept per level for every phase. */
+
+struct SolverMarketAMGOptions {
+    int max_levels = 10;
+    int coarse_size = 500;                 /* direct solve at or below this many rows*/
+    double strength_threshold = 0.0;       /* theta*/
+    double prolongator_damping = 4.0 / 3.0;/* omega * lambda_max*/
+    int chebyshev_degree = 2;
+    double chebyshev_ratio = 30.0;         /* lambda_min = lambda_max / ratio*/
+    double chebyshev_boost = 1.1;          /* safety factor on the estimated lambda_max*/
+    int power_iterations = 10;
+    bool timers = true;                    /* per level solve timers (fence after each phase)*/
+
+    // 0 on success, 1 on an unknown key or a bad value
+    int set(const std::string& key, const std::string& value) {
+      try {
+        if (key == "max_levels") max_levels = std::stoi(value);
+        else if (key == "coarse_size") coarse_size = std::stoi(value);
+        else if (key == "strength_threshold") strength_threshold = std::stod(value);
+        else if (key == "prolongator_damping") prolongator_damping = std::stod(value);
+        else if (key == "chebyshev_degree") chebyshev_degree = std::stoi(value);
+        else if (key == "chebyshev_ratio") chebyshev_ratio = std::stod(value);
+        else if (key == "chebyshev_boost") chebyshev_boost = std::stod(value);
+        else if (key == "power_iterations") power_iterations = std::stoi(value);
+        else if (key == "timers") timers = (value == "1" || value == "true");
+        else return 1;
+      } catch (std::exception&) {
+        return 1;
+      }
+      return 0;
+    }
+};
+
+struct SolverMarketAMGLevelStats {
+    size_t rows = 0;
+    size_t nnz = 0;
+    /* setup (ms)*/
+    double eigen_ms = 0;        /* inverse diagonal, power iteration*/
+    double aggregation_ms = 0;  /* strength, MIS-2, aggregates*/
+    double prolongator_ms = 0;  /* tentative, smoothed (SpGEMM), transpose*/
+    double rap_ms = 0;          /* Galerkin product, or the LU factorization on the coarsest level*/
+    /* solve (ms), accumulated over all cycles*/
+    double smooth_ms = 0;       /* Chebyshev, or the LU solve on the coarsest level*/
+    double transfer_ms = 0;     /* residual, restriction, prolongation*/
+
+    double setup_ms() const { return eigen_ms + aggregation_ms + prolongator_ms + rap_ms; }
+};
+
+template <typename _TYPE_, typename _ITYPE_=int>
+class SolverMarketAMG {
+public:
+  using matrix_type = SolverMarketDeviceCSR<_TYPE_, _ITYPE_>;
+
+  SolverMarketAMG() = default;
+  SolverMarketAMG(const SolverMarketAMGOptions& options) : options_(options) {}
+
+  void setOptions(const SolverMarketAMGOptions& options) { options_ = options; }
+  const SolverMarketAMGOptions& getOptions() const { return options_; }
+
+  // Full setup on the device matrix A (kept by reference, it must outlive the hierarchy)
+  int setup(const matrix_type& A);
+
+  // New values, same pattern: the aggregates (and tentative prolongators) are reused
+  int resetup(const matrix_type& A);
+
+  // z = M^{-1} r, one V-cycle from a zero initial guess
+  void apply(const DeviceView<_TYPE_>& r, const DeviceView<_TYPE_>& z);
+  void operator()(const DeviceView<_TYPE_>& r, const DeviceView<_TYPE_>& z) { apply(r, z); }
+
+  int num_levels() const { return int(levels_.size()); }
+  const matrix_type& level_matrix(int level) const { return levels_[level].A; }
+  const matrix_type& level_prolongator(int level) const { return levels_[level].P; }
+  const DeviceView<_ITYPE_>& level_aggregates(int level) const { return levels_[level].aggregates; }
+  _TYPE_ level_lambda_max(int level) const { return levels_[level].lambda_max; }
+
+  // sum nnz(A_l) / nnz(A_0) and sum n_l / n_0
+  double operator_complexity() const;
+  double grid_complexity() const;
+
+  const std::vector<SolverMarketAMGLevelStats>& level_stats() const { return stats_; }
+  double setup_ms() const;
+  int cycles() const { return cycles_; }
+  void reset_solve_timers();
+
+  // One line per level (size, setup and solve timers), then the complexities
+  void print_hierarchy() const;
+
+private:
+  struct Level {
+    matrix_type A;
+    matrix_type P, R;               /* to/from the next level*/
+    matrix_type P_tentative;
+    DeviceView<_ITYPE_> aggregates;
+    _ITYPE_ num_aggregates = 0;
+    DeviceView<_TYPE_> inv_diagonal;
+    _TYPE_ lambda_max = 0;
+    DeviceView<_TYPE_> x, b, r, w;  /* cycle work vectors*/
+  };
+
+  SolverMarketAMGOptions options_;
+  std::vector<Level> levels_;
+  std::vector<SolverMarketAMGLevelStats> stats_;
+  int cycles_ = 0;
+
+  /* Coarsest level: dense LU (row major, partial pivoting) on the host, up to coarse_direct_limit rows*/
+  static constexpr size_t coarse_direct_limit = 2000;
+  std::vector<_TYPE_> coarse_lu_;
+  std::vector<int> coarse_pivots_;
+  HostView<_TYPE_> coarse_rhs_h_;
+
+  int build(const matrix_type& A, bool reuse_aggregates);
+  void smoothers(Level& level, SolverMarketAMGLevelStats& stats);
+  void prolongator(Level& level, SolverMarketAMGLevelStats& stats, bool reuse_aggregates);
+  void factor_coarse(SolverMarketAMGLevelStats& stats);
+  void solve_coarse(const DeviceView<_TYPE_>& b, const DeviceView<_TYPE_>& x);
+  void chebyshev(Level& level, bool zero_guess);
+  void cycle(int l);
+  void allocate_work(Level& level);
+};
+
+#include "solver-market-amg.tpp"
@@ -0,0 +1,556 @@
+#pragma once
+
+/* Kernels of the AMG setup. Free functions, so that the lambdas capture Views and not the hierarchy*/
+
+KOKKOS_INLINE_FUNCTION uint32_t SolverMarketHash32(uint32_t x) {
+  x = ((x >> 16) ^ x) * 0x45d9f3bu;
+  x = ((x >> 16) ^ x) * 0x45d9f3bu;
+  return (x >> 16) ^ x;
+}
+
+// diagonal(i) = a_ii (0 when not stored)
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMGDiagonal(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A, const DeviceView<_TYPE_>& diagonal) {
+  auto offsets = A.offsets;
+  auto columns = A.columns;
+  auto values = A.values;
+  Kokkos::parallel_for("SolverMarket::amg_diagonal", Kokkos::RangePolicy<Device>(0, A.n_rows), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    _TYPE_ d = 0;
+    for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) if (columns(k) == i) d = values(k);
+    diagonal(i) = d;
+  });
+}
+
+// lambda_max(D^-1 A) by power iteration from a pseudo random vector
+template <typename _TYPE_, typename _ITYPE_>
+_TYPE_ SolverMarketAMGPowerIteration(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A, const DeviceView<_TYPE_>& inv_diagonal,
+                                     const int iterations) {
+  const size_t n = A.n_rows;
+  DeviceView<_TYPE_> x(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::power_x"), n);
+  DeviceView<_TYPE_> y(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::power_y"), n);
+  Kokkos::parallel_for("SolverMarket::power_init", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const size_t i) {
+    x(i) = _TYPE_(SolverMarketHash32(uint32_t(i)) & 0xFFFF) / _TYPE_(0xFFFF) - _TYPE_(0.5);
+  });
+  _TYPE_ norm = std::sqrt(SolverMarketDot(x, x));
+  _TYPE_ lambda = 0;
+  if (norm == _TYPE_(0)) return lambda;
+  SolverMarketAxpby(_TYPE_(1) / norm, x, _TYPE_(0), x);
+  for (int it = 0; it < iterations; it++) {
+    SolverMarketSpMV(A, x, y);
+    Kokkos::parallel_for("SolverMarket::power_scale", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const size_t i) {
+      y(i) *= inv_diagonal(i);
+    });
+    lambda = std::sqrt(SolverMarketDot(y, y));  /* ||D^-1 A x|| with ||x|| = 1*/
+    if (lambda == _TYPE_(0)) break;
+    SolverMarketAxpby(_TYPE_(1) / lambda, y, _TYPE_(0), x);
+  }
+  return lambda;
+}
+
+/* Prolongator smoother S = I - omega D_f^-1 A_f. A_f keeps the diagonal and the strong entries
+(|a_ij| >= theta sqrt(|a_ii a_jj|)), the weak ones are added to its diagonal D_f. The pattern of S,
+diagonal excluded, is also the strength graph of the aggregation. */
+template <typename _TYPE_, typename _ITYPE_>
+SolverMarketDeviceCSR<_TYPE_, _ITYPE_> SolverMarketAMGSmoothingOperator(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A,
+                                                                        const DeviceView<_TYPE_>& diagonal,
+                                                                        const _TYPE_ theta, const _TYPE_ omega) {
+  const _ITYPE_ n = A.n_rows;
+  auto a_offsets = A.offsets;
+  auto a_columns = A.columns;
+  auto a_values = A.values;
+  SolverMarketDeviceCSR<_TYPE_, _ITYPE_> S;
+  S.n_rows = n;
+  S.n_cols = n;
+  S.offsets = DeviceView<_ITYPE_>("SolverMarket::smoother_offsets", size_t(n) + 1);
+  auto s_offsets = S.offsets;
+
+  Kokkos::parallel_for("SolverMarket::smoother_count", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    _ITYPE_ count = 1;
+    for (_ITYPE_ k = a_offsets(i); k < a_offsets(i + 1); k++) {
+      const _ITYPE_ j = a_columns(k);
+      if (j != i && a_values(k) != _TYPE_(0) &&
+          Kokkos::fabs(a_values(k)) >= theta * Kokkos::sqrt(Kokkos::fabs(diagonal(i) * diagonal(j)))) count++;
+    }
+    s_offsets(i + 1) = count;
+  });
+  const size_t nnz = SolverMarketScanOffsets(s_offsets, n);
+  S.columns = DeviceView<_ITYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::smoother_columns"), nnz);
+  S.values = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::smoother_values"), nnz);
+  auto s_columns = S.columns;
+  auto s_values = S.values;
+
+  Kokkos::parallel_for("SolverMarket::smoother_fill", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    _TYPE_ filtered_diagonal = diagonal(i);
+    for (_ITYPE_ k = a_offsets(i); k < a_offsets(i + 1); k++) {
+      const _ITYPE_ j = a_columns(k);
+      if (j != i && Kokkos::fabs(a_values(k)) < theta * Kokkos::sqrt(Kokkos::fabs(diagonal(i) * diagonal(j))))
+        filtered_diagonal += a_values(k);
+    }
+    const _TYPE_ scale = (filtered_diagonal != _TYPE_(0)) ? omega / filtered_diagonal : omega;
+    _ITYPE_ p = s_offsets(i);
+    bool diagonal_done = false;
+    for (_ITYPE_ k = a_offsets(i); k < a_offsets(i + 1); k++) {
+      const _ITYPE_ j = a_columns(k);
+      if (!diagonal_done && j >= i) {
+        s_columns(p) = i;
+        s_values(p) = _TYPE_(1) - omega;
+        p++;
+        diagonal_done = true;
+      }
+      if (j != i && a_values(k) != _TYPE_(0) &&
+          Kokkos::fabs(a_values(k)) >= theta * Kokkos::sqrt(Kokkos::fabs(diagonal(i) * diagonal(j)))) {
+        s_columns(p) = j;
+        s_values(p) = -scale * a_values(k);
+        p++;
+      }
+    }
+    if (!diagonal_done) {
+      s_columns(p) = i;
+      s_values(p) = _TYPE_(1) - omega;
+    }
+  });
+  return S;
+}
+
+/* Distance-2 maximal independent set (Bell, Dalton, Olson 2012): every vertex carries a tuple
+(state, random, index), OUT < UNDECIDED < IN. Each round the maximum tuple over the distance-2
+neighbourhood is found by two max propagations; an undecided vertex holding that maximum joins the
+set, one that sees an IN vertex leaves. Returns 1 for the vertices in the set. The graph is taken
+symmetric. */
+template <typename _ITYPE_>
+DeviceView<int> SolverMarketMIS2(const DeviceView<_ITYPE_>& offsets, const DeviceView<_ITYPE_>& columns, const _ITYPE_ n) {
+  constexpr uint64_t OUT = 0, UNDECIDED = 1, IN = 2;
+  DeviceView<uint64_t> tuples(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::mis2_tuples"), n);
+  DeviceView<uint64_t> max1(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::mis2_max1"), n);
+  DeviceView<uint64_t> max2(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::mis2_max2"), n);
+  Kokkos::parallel_for("SolverMarket::mis2_init", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    tuples(i) = (UNDECIDED << 62) | (uint64_t(SolverMarketHash32(uint32_t(i)) & 0x3FFFFFFFu) << 32) | uint64_t(uint32_t(i));
+  });
+
+  _ITYPE_ undecided = n;
+  for (_ITYPE_ round = 0; undecided > 0 && round <= n; round++) {
+    Kokkos::parallel_for("SolverMarket::mis2_max1", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+      uint64_t m = tuples(i);
+      for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) m = (tuples(columns(k)) > m) ? tuples(columns(k)) : m;
+      max1(i) = m;
+    });
+    Kokkos::parallel_for("SolverMarket::mis2_max2", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+      uint64_t m = max1(i);
+      for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) m = (max1(columns(k)) > m) ? max1(columns(k)) : m;
+      max2(i) = m;
+    });
+    undecided = 0;
+    Kokkos::parallel_reduce("SolverMarket::mis2_update", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i, _ITYPE_& count) {
+      const uint64_t t = tuples(i);
+      if ((t >> 62) != UNDECIDED) return;
+      const uint64_t low = t & ((uint64_t(1) << 62) - 1);
+      if (max2(i) == t) tuples(i) = (IN << 62) | low;
+      else if ((max2(i) >> 62) == IN) tuples(i) = (OUT << 62) | low;
+      else count++;
+    }, undecided);
+  }
+
+  DeviceView<int> in_set("SolverMarket::mis2", n);
+  Kokkos::parallel_for("SolverMarket::mis2_result", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    in_set(i) = ((tuples(i) >> 62) == IN) ? 1 : 0;
+  });
+  return in_set;
+}
+
+/* Aggregates on the strength graph: the MIS-2 vertices are the roots, their neighbours join them,
+then the vertices next to an aggregated neighbour join that aggregate. With a maximal MIS-2 this
+covers every vertex; anything left becomes a singleton. aggregates(i) is the aggregate of vertex i,
+the number of aggregates is returned. */
+template <typename _ITYPE_>
+_ITYPE_ SolverMarketAMGAggregate(const DeviceView<_ITYPE_>& offsets, const DeviceView<_ITYPE_>& columns, const _ITYPE_ n,
+                                 DeviceView<_ITYPE_>& aggregates) {
+  DeviceView<int> roots = SolverMarketMIS2(offsets, columns, n);
+  aggregates = DeviceView<_ITYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::aggregates"), n);
+
+  DeviceView<_ITYPE_> ids("SolverMarket::aggregate_ids", size_t(n) + 1);
+  Kokkos::parallel_for("SolverMarket::aggregate_roots", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    ids(i + 1) = roots(i);
+  });
+  _ITYPE_ num_aggregates = SolverMarketScanOffsets(ids, n);
+  Kokkos::parallel_for("SolverMarket::aggregate_phase0", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    aggregates(i) = roots(i) ? ids(i) : _ITYPE_(-1);
+  });
+
+  // Phase 1 reads the roots only, phase 2 a copy of phase 1: no vertex reads an entry being written
+  Kokkos::parallel_for("SolverMarket::aggregate_phase1", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    if (roots(i)) return;
+    for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) {
+      if (roots(columns(k))) { aggregates(i) = aggregates(columns(k)); return; }
+    }
+  });
+  DeviceView<_ITYPE_> phase1(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::aggregates_phase1"), n);
+  Kokkos::deep_copy(phase1, aggregates);
+  Kokkos::parallel_for("SolverMarket::aggregate_phase2", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    if (phase1(i) >= 0) return;
+    for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) {
+      if (phase1(columns(k)) >= 0) { aggregates(i) = phase1(columns(k)); return; }
+    }
+  });
+
+  Kokkos::deep_copy(ids, _ITYPE_(0));
+  Kokkos::parallel_for("SolverMarket::aggregate_left", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    ids(i + 1) = (aggregates(i) < 0) ? 1 : 0;
+  });
+  const _ITYPE_ left = SolverMarketScanOffsets(ids, n);
+  if (left > 0) {
+    Kokkos::parallel_for("SolverMarket::aggregate_singletons", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+      if (aggregates(i) < 0) aggregates(i) = num_aggregates + ids(i);
+    });
+    num_aggregates += left;
+  }
+  return num_aggregates;
+}
+
+// Tentative prolongator of the constant vector: P(i, aggregate(i)) = 1/sqrt(|aggregate|)
+template <typename _TYPE_, typename _ITYPE_>
+SolverMarketDeviceCSR<_TYPE_, _ITYPE_> SolverMarketAMGTentativeProlongator(const DeviceView<_ITYPE_>& aggregates, const _ITYPE_ n,
+                                                                           const _ITYPE_ num_aggregates) {
+  SolverMarketDeviceCSR<_TYPE_, _ITYPE_> P;
+  P.n_rows = n;
+  P.n_cols = num_aggregates;
+  P.offsets = DeviceView<_ITYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::tentative_offsets"), size_t(n) + 1);
+  P.columns = DeviceView<_ITYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::tentative_columns"), n);
+  P.values = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::tentative_values"), n);
+  auto offsets = P.offsets;
+  auto columns = P.columns;
+  auto values = P.values;
+
+  DeviceView<_ITYPE_> sizes("SolverMarket::aggregate_sizes", num_aggregates);
+  Kokkos::parallel_for("SolverMarket::aggregate_sizes", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    Kokkos::atomic_add(&sizes(aggregates(i)), _ITYPE_(1));
+  });
+  Kokkos::parallel_for("SolverMarket::tentative_fill", Kokkos::RangePolicy<Device>(0, size_t(n) + 1), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    offsets(i) = i;
+    if (i == n) return;
+    columns(i) = aggregates(i);
+    values(i) = _TYPE_(1) / Kokkos::sqrt(_TYPE_(sizes(aggregates(i))));
+  });
+  return P;
+}
+
+/* One Chebyshev step after the first (Ifpack2 recurrence): w = c1 w + c2 D^-1 (b - A x), x += w*/
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMGChebyshevStep(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A, const DeviceView<_TYPE_>& inv_diagonal,
+                                  const DeviceView<_TYPE_>& b, const DeviceView<_TYPE_>& x, const DeviceView<_TYPE_>& r,
+                                  const DeviceView<_TYPE_>& w, const _TYPE_ c1, const _TYPE_ c2) {
+  SolverMarketResidual(A, x, b, r);
+  Kokkos::parallel_for("SolverMarket::chebyshev_step", Kokkos::RangePolicy<Device>(0, A.n_rows), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    w(i) = c1 * w(i) + c2 * inv_diagonal(i) * r(i);
+    x(i) += w(i);
+  });
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMGInvert(const DeviceView<_TYPE_>& diagonal, const DeviceView<_TYPE_>& inv_diagonal) {
+  Kokkos::parallel_for("SolverMarket::amg_invert", Kokkos::RangePolicy<Device>(0, diagonal.extent(0)), KOKKOS_LAMBDA(const size_t i) {
+    inv_diagonal(i) = (diagonal(i) != _TYPE_(0)) ? _TYPE_(1) / diagonal(i) : _TYPE_(1);
+  });
+}
+
+inline double SolverMarketAMGElapsed(const std::chrono::high_resolution_clock::time_point& start, const bool fence = true) {
+  if (fence) Kokkos::fence();
+  return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+/* SolverMarketAMG*/
+
+template <typename _TYPE_, typename _ITYPE_>
+int SolverMarketAMG<_TYPE_, _ITYPE_>::setup(const matrix_type& A) {
+  return build(A, false);
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+int SolverMarketAMG<_TYPE_, _ITYPE_>::resetup(const matrix_type& A) {
+  if (levels_.empty() || levels_[0].A.n_rows != A.n_rows) {
+    std::cout << "[Warning][SolverMarket][AMG][resetup] no hierarchy for this matrix, full setup" << std::endl;
+    return build(A, false);
+  }
+  return build(A, true);
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+int SolverMarketAMG<_TYPE_, _ITYPE_>::build(const matrix_type& A, bool reuse_aggregates) {
+  if (A.n_rows == 0 || A.n_rows != A.n_cols) {
+    std::cout << "[Error][SolverMarket][AMG][setup] the matrix must be square and not empty" << std::endl;
+    return 1;
+  }
+  const int reused_levels = int(levels_.size());
+  if (!reuse_aggregates) {
+    levels_.clear();
+    levels_.reserve(std::max(options_.max_levels, 1));
+    levels_.emplace_back();
+  }
+  stats_.assign(reuse_aggregates ? reused_levels : 1, SolverMarketAMGLevelStats());
+  levels_[0].A = A;
+
+  for (int l = 0;; l++) {
+    const _ITYPE_ n = levels_[l].A.n_rows;
+    stats_[l].rows = n;
+    stats_[l].nnz = levels_[l].A.nnz();
+    smoothers(levels_[l], stats_[l]);
+
+    const bool coarsest = reuse_aggregates ? (l == reused_levels - 1)
+                                           : (n <= options_.coarse_size || l + 1 >= options_.max_levels);
+    if (coarsest) {
+      levels_[l].P = matrix_type();
+      levels_[l].R = matrix_type();
+      break;
+    }
+
+    prolongator(levels_[l], stats_[l], reuse_aggregates);
+    if (!reuse_aggregates && (levels_[l].num_aggregates == 0 || levels_[l].num_aggregates >= n)) {
+      std::cout << "[Warning][SolverMarket][AMG][setup] aggregation stalled at level " << l << " (" << n << " rows)" << std::endl;
+      levels_[l].P = matrix_type();
+      levels_[l].R = matrix_type();
+      break;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    matrix_type coarse = SolverMarketSpGEMM(levels_[l].R, SolverMarketSpGEMM(levels_[l].A, levels_[l].P));
+    stats_[l].rap_ms = SolverMarketAMGElapsed(start);
+    if (!reuse_aggregates) {
+      levels_.emplace_back();
+      stats_.emplace_back();
+    }
+    levels_[l + 1].A = coarse;
+  }
+
+  for (size_t l = 0; l < levels_.size(); l++) allocate_work(levels_[l]);
+  factor_coarse(stats_.back());
+  return 0;
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMG<_TYPE_, _ITYPE_>::smoothers(Level& level, SolverMarketAMGLevelStats& stats) {
+  auto start = std::chrono::high_resolution_clock::now();
+  const _ITYPE_ n = level.A.n_rows;
+  level.inv_diagonal = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::amg_inv_diagonal"), n);
+  SolverMarketAMGDiagonal(level.A, level.inv_diagonal);
+  SolverMarketAMGInvert<_TYPE_, _ITYPE_>(level.inv_diagonal, level.inv_diagonal);
+  level.lambda_max = SolverMarketAMGPowerIteration(level.A, level.inv_diagonal, options_.power_iterations);
+  stats.eigen_ms = SolverMarketAMGElapsed(start);
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMG<_TYPE_, _ITYPE_>::prolongator(Level& level, SolverMarketAMGLevelStats& stats, bool reuse_aggregates) {
+  const _ITYPE_ n = level.A.n_rows;
+  auto start = std::chrono::high_resolution_clock::now();
+  DeviceView<_TYPE_> diagonal(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::amg_diagonal"), n);
+  SolverMarketAMGDiagonal(level.A, diagonal);
+  const _TYPE_ omega = (level.lambda_max > _TYPE_(0)) ? _TYPE_(options_.prolongator_damping) / level.lambda_max : _TYPE_(0);
+  matrix_type smoother = SolverMarketAMGSmoothingOperator(level.A, diagonal, _TYPE_(options_.strength_threshold), omega);
+  if (!reuse_aggregates) {
+    level.num_aggregates = SolverMarketAMGAggregate(smoother.offsets, smoother.columns, n, level.aggregates);
+    if (level.num_aggregates == 0 || level.num_aggregates >= n) return;
+    level.P_tentative = SolverMarketAMGTentativeProlongator<_TYPE_, _ITYPE_>(level.aggregates, n, level.num_aggregates);
+  }
+  stats.aggregation_ms = SolverMarketAMGElapsed(start);
+
+  start = std::chrono::high_resolution_clock::now();
+  level.P = SolverMarketSpGEMM(smoother, level.P_tentative);
+  level.R = SolverMarketTranspose(level.P);
+  stats.prolongator_ms = SolverMarketAMGElapsed(start);
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMG<_TYPE_, _ITYPE_>::allocate_work(Level& level) {
+  const size_t n = level.A.n_rows;
+  level.x = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::amg_x"), n);
+  level.b = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::amg_b"), n);
+  level.r = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::amg_r"), n);
+  level.w = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::amg_w"), n);
+}
+
+// Dense LU with partial pivoting of the coarsest matrix, on the host
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMG<_TYPE_, _ITYPE_>::factor_coarse(SolverMarketAMGLevelStats& stats) {
+  const matrix_type& A = levels_.back().A;
+  const size_t n = A.n_rows;
+  coarse_lu_.clear();
+  coarse_pivots_.clear();
+  if (n > coarse_direct_limit) {
+    std::cout << "[Warning][SolverMarket][AMG][setup] coarsest level has " << n << " rows, above the direct solve limit ("
+              << coarse_direct_limit << "), smoothed instead" << std::endl;
+    return;
+  }
+  auto start = std::chrono::high_resolution_clock::now();
+  HostView<_ITYPE_> offsets("SolverMarket::coarse_offsets", n + 1);
+  HostView<_ITYPE_> columns("SolverMarket::coarse_columns", A.nnz());
+  HostView<_TYPE_> values("SolverMarket::coarse_values", A.nnz());
+  Kokkos::deep_copy(offsets, A.offsets);
+  Kokkos::deep_copy(columns, A.columns);
+  Kokkos::deep_copy(values, A.values);
+
+  coarse_lu_.assign(n * n, _TYPE_(0));
+  coarse_pivots_.resize(n);
+  for (size_t i = 0; i < n; i++)
+    for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) coarse_lu_[i * n + columns(k)] = values(k);
+
+  for (size_t k = 0; k < n; k++) {
+    size_t pivot = k;
+    for (size_t i = k + 1; i < n; i++)
+      if (std::abs(coarse_lu_[i * n + k]) > std::abs(coarse_lu_[pivot * n + k])) pivot = i;
+    coarse_pivots_[k] = int(pivot);
+    if (pivot != k)
+      for (size_t j = 0; j < n; j++) std::swap(coarse_lu_[k * n + j], coarse_lu_[pivot * n + j]);
+    // A singular coarse operator (pure Neumann problem) gets a unit pivot: the null space component is dropped
+    if (coarse_lu_[k * n + k] == _TYPE_(0)) coarse_lu_[k * n + k] = _TYPE_(1);
+    const _TYPE_ inv_pivot = _TYPE_(1) / coarse_lu_[k * n + k];
+    for (size_t i = k + 1; i < n; i++) {
+      const _TYPE_ factor = coarse_lu_[i * n + k] * inv_pivot;
+      coarse_lu_[i * n + k] = factor;
+      if (factor == _TYPE_(0)) continue;
+      for (size_t j = k + 1; j < n; j++) coarse_lu_[i * n + j] -= factor * coarse_lu_[k * n + j];
+    }
+  }
+  coarse_rhs_h_ = HostView<_TYPE_>("SolverMarket::coarse_rhs", n);
+  stats.rap_ms = SolverMarketAMGElapsed(start, false);
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMG<_TYPE_, _ITYPE_>::solve_coarse(const DeviceView<_TYPE_>& b, const DeviceView<_TYPE_>& x) {
+  const size_t n = coarse_pivots_.size();
+  Kokkos::deep_copy(coarse_rhs_h_, b);
+  for (size_t k = 0; k < n; k++) std::swap(coarse_rhs_h_(k), coarse_rhs_h_(coarse_pivots_[k]));
+  for (size_t i = 0; i < n; i++) {
+    _TYPE_ sum = coarse_rhs_h_(i);
+    for (size_t j = 0; j < i; j++) sum -= coarse_lu_[i * n + j] * coarse_rhs_h_(j);
+    coarse_rhs_h_(i) = sum;
+  }
+  for (size_t i = n; i-- > 0;) {
+    _TYPE_ sum = coarse_rhs_h_(i);
+    for (size_t j = i + 1; j < n; j++) sum -= coarse_lu_[i * n + j] * coarse_rhs_h_(j);
+    coarse_rhs_h_(i) = sum / coarse_lu_[i * n + i];
+  }
+  Kokkos::deep_copy(x, coarse_rhs_h_);
+}
+
+/* Chebyshev smoothing of A x = b on [lambda_max / ratio, lambda_max], lambda_max boosted. With a
+zero guess the first step skips the residual (x = D^-1 b / theta)*/
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMG<_TYPE_, _ITYPE_>::chebyshev(Level& level, bool zero_guess) {
+  const _TYPE_ lambda_max = _TYPE_(options_.chebyshev_boost) * level.lambda_max;
+  const _TYPE_ lambda_min = lambda_max / _TYPE_(options_.chebyshev_ratio);
+  const _TYPE_ theta = (lambda_max + lambda_min) / 2;
+  const _TYPE_ delta = (lambda_max - lambda_min) / 2;
+  const _TYPE_ sigma = theta / delta;
+  _TYPE_ rhok = _TYPE_(1) / sigma;
+
+  auto x = level.x;
+  auto w = level.w;
+  auto inv_diagonal = level.inv_diagonal;
+  if (zero_guess) {
+    auto b = level.b;
+    Kokkos::parallel_for("SolverMarket::chebyshev_first", Kokkos::RangePolicy<Device>(0, level.A.n_rows), KOKKOS_LAMBDA(const _ITYPE_ i) {
+      w(i) = inv_diagonal(i) * b(i) / theta;
+      x(i) = w(i);
+    });
+  } else {
+    SolverMarketAMGChebyshevStep(level.A, inv_diagonal, level.b, x, level.r, w, _TYPE_(0), _TYPE_(1) / theta);
+  }
+  for (int k = 1; k < options_.chebyshev_degree; k++) {
+    const _TYPE_ rhokp1 = _TYPE_(1) / (2 * sigma - rhok);
+    const _TYPE_ c1 = rhokp1 * rhok;
+    const _TYPE_ c2 = 2 * rhokp1 / delta;
+    rhok = rhokp1;
+    SolverMarketAMGChebyshevStep(level.A, inv_diagonal, level.b, x, level.r, w, c1, c2);
+  }
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMG<_TYPE_, _ITYPE_>::cycle(int l) {
+  Level& level = levels_[l];
+  SolverMarketAMGLevelStats& stats = stats_[l];
+  const bool timers = options_.timers;
+  auto start = std::chrono::high_resolution_clock::now();
+
+  if (l + 1 == num_levels()) {
+    if (!coarse_pivots_.empty()) solve_coarse(level.b, level.x);
+    else chebyshev(level, true);
+    if (timers) stats.smooth_ms += SolverMarketAMGElapsed(start);
+    return;
+  }
+
+  chebyshev(level, true);
+  if (timers) { stats.smooth_ms += SolverMarketAMGElapsed(start); start = std::chrono::high_resolution_clock::now(); }
+  Level& coarse = levels_[l + 1];
+  SolverMarketResidual(level.A, level.x, level.b, level.r);
+  SolverMarketSpMV(level.R, level.r, coarse.b);
+  if (timers) stats.transfer_ms += SolverMarketAMGElapsed(start);
+
+  cycle(l + 1);
+
+  start = std::chrono::high_resolution_clock::now();
+  SolverMarketSpMV(level.P, coarse.x, level.x, _TYPE_(1), _TYPE_(1));
+  if (timers) { stats.transfer_ms += SolverMarketAMGElapsed(start); start = std::chrono::high_resolution_clock::now(); }
+  chebyshev(level, false);
+  if (timers) stats.smooth_ms += SolverMarketAMGElapsed(start);
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMG<_TYPE_, _ITYPE_>::apply(const DeviceView<_TYPE_>& r, const DeviceView<_TYPE_>& z) {
+  if (levels_.empty()) {
+    Kokkos::deep_copy(z, r);
+    return;
+  }
+  Kokkos::deep_copy(levels_[0].b, r);
+  cycle(0);
+  Kokkos::deep_copy(z, levels_[0].x);
+  cycles_++;
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+double SolverMarketAMG<_TYPE_, _ITYPE_>::operator_complexity() const {
+  if (stats_.empty() || stats_[0].nnz == 0) return 0;
+  double nnz = 0;
+  for (const auto& s : stats_) nnz += double(s.nnz);
+  return nnz / double(stats_[0].nnz);
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+double SolverMarketAMG<_TYPE_, _ITYPE_>::grid_complexity() const {
+  if (stats_.empty() || stats_[0].rows == 0) return 0;
+  double rows = 0;
+  for (const auto& s : stats_) rows += double(s.rows);
+  return rows / double(stats_[0].rows);
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+double SolverMarketAMG<_TYPE_, _ITYPE_>::setup_ms() const {
+  double total = 0;
+  for (const auto& s : stats_) total += s.setup_ms();
+  return total;
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMG<_TYPE_, _ITYPE_>::reset_solve_timers() {
+  for (auto& s : stats_) s.smooth_ms = s.transfer_ms = 0;
+  cycles_ = 0;
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketAMG<_TYPE_, _ITYPE_>::print_hierarchy() const {
+  const std::string prefix = "[Info][SolverMarket][AMG] ";
+  std::cout << prefix << std::setw(5) << "level" << std::setw(12) << "rows" << std::setw(14) << "nnz"
+            << std::setw(9) << "nnz/row" << std::setw(11) << "eigen(ms)" << std::setw(10) << "aggr(ms)"
+            << std::setw(10) << "prol(ms)" << std::setw(10) << "rap(ms)" << std::setw(12) << "smooth(ms)"
+            << std::setw(14) << "transfer(ms)" << std::endl;
+  for (size_t l = 0; l < stats_.size(); l++) {
+    const auto& s = stats_[l];
+    std::cout << prefix << std::setw(5) << l << std::setw(12) << s.rows << std::setw(14) << s.nnz
+              << std::setw(9) << std::fixed << std::setprecision(1) << (s.rows ? double(s.nnz) / double(s.rows) : 0.0)
+              << std::setprecision(3) << std::setw(11) << s.eigen_ms << std::setw(10) << s.aggregation_ms
+              << std::setw(10) << s.prolongator_ms << std::setw(10) << s.rap_ms << std::setw(12) << s.smooth_ms
+              << std::setw(14) << s.transfer_ms << std::endl;
+  }
+  std::cout.unsetf(std::ios::fixed);
+  std::cout << std::setprecision(6);
+  std::cout << prefix << "levels " << stats_.size() << ", operator complexity " << operator_complexity()
+            << ", grid complexity " << grid_complexity() << ", setup " << setup_ms() << " ms, " << cycles_ << " cycles"
+            << std::endl;
+}
@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <unistd.h>
+
+#include "solver-market-log.hpp"
+
+#pragma once
+
+/* Performance baselines: timings of a benchmark set stored per
+(matrix fingerprint, backend, config hash, host signature) and compared run against run.
+
+A run of solver_market_driver with --repetitions=<n> --samples=<file> writes the setup and solve
+times of its n independent runs (configure, setup, solve) per backend. solver_market_regress runs
+a set of such jobs and either records their samples as the baseline or compares them with it.
+A metric regresses when its samples are significantly larger than the baseline ones (one-sided
+Mann-Whitney U test, no normality assumed, robust to the odd slow run) and the medians differ by
+more than a threshold: significance alone would flag 1% drifts on quiet machines, the threshold
+alone would flag noise. With the default alpha of 0.05, at least 4 repetitions on each side are
+needed for any change to be significant (p >= 1/C(2n, n)).
+
+Store: one tab separated line per entry, the last entry of a key wins, so re-recording appends:
+  fingerprint  backend  config_hash  host  metric  s1,s2,...  label */
+
+enum SolverMarketBaselineStatus {
+    SolverMarketBaselineSuccess,
+    SolverMarketBaselineErrorFile,
+    SolverMarketBaselineNotFound
+};
+
+// FNV-1a of the bytes of a file then of `salt` (options that change the run but are not in the file)
+inline std::string SolverMarketHashFile(const std::string& filename, const std::string& salt = "")
+{
+    uint64_t hash = 1469598103934665603ULL;
+    auto add = [&hash](const char* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= uint8_t(data[i]);
+            hash *= 1099511628211ULL;
+        }
+    };
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return "none";
+    char buffer[1 << 14];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) add(buffer, size_t(file.gcount()));
+    add(salt.data(), salt.size());
+    std::ostringstream s;
+    s << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return s.str();
+}
+
+// Where the timings come from: cpu model, logical cpus and the device (Kokkos execution space name)
+inline std::string SolverMarketHostSignature(const std::string& device = "")
+{
+    std::string model = "unknown";
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0 && line.find(':') != std::string::npos) {
+            model = line.substr(line.find(':') + 1);
+            break;
+        }
+    }
+    std::string signature;
+    for (const char c : model) {
+        if (c == ' ' || c == '\t') {
+            if (!signature.empty() && signature.back() != '_') signature += '_';
+        } else {
+            signature += c;
+        }
+    }
+    while (!signature.empty() && signature.back() == '_') signature.pop_back();
+    signature += "/" + std::to_string(::sysconf(_SC_NPROCESSORS_ONLN)) + "cpus";
+    if (!device.empty()) signature += "/" + device;
+    return signature;
+}
+
+struct SolverMarketBaselineKey {
+    std::string fingerprint;  /* SolverMarketMatrixFeatures::fingerprint_string()*/
+    std::string backend;
+    std::string config_hash;  /* SolverMarketHashFile of the config file and run options*/
+    std::string host;         /* SolverMarketHostSignature()*/
+
+    bool operator<(const SolverMarketBaselineKey& other) const {
+        return std::tie(fingerprint, backend, config_hash, host) < std::tie(other.fingerprint, other.backend, other.config_hash, other.host);
+    }
+};
+
+struct SolverMarketBaselineEntry {
+    SolverMarketBaselineKey key;
+    std::string metric;            /* setup_ms, solve_ms*/
+    std::vector<double> samples;   /* one per repetition*/
+    std::string label;             /* matrix and config files, for the reader only*/
+
+    std::string to_line() const {
+        std::ostringstream line;
+        line << key.fingerprint << "\t" << key.backend << "\t" << key.config_hash << "\t" << key.host << "\t" << metric << "\t";
+        line << std::setprecision(9);
+        for (size_t i = 0; i < samples.size(); i++) line << (i ? "," : "") << samples[i];
+        line << "\t" << label;
+        return line.str();
+    }
+
+    // Returns 0 on success
+    int from_line(const std::string& line) {
+        std::vector<std::string> fields;
+        std::istringstream in(line);
+        std::string field;
+        while (std::getline(in, field, '\t')) fields.push_back(field);
+        if (fields.size() < 6) return 1;
+        key = {fields[0], fields[1], fields[2], fields[3]};
+        metric = fields[4];
+        samples.clear();
+        std::istringstream values(fields[5]);
+        std::string value;
+        while (std::getline(values, value, ',')) {
+            char* end = nullptr;
+            const double sample = std::strtod(value.c_str(), &end);
+            if (end == value.c_str()) return 1;
+            samples.push_back(sample);
+        }
+        label = fields.size() > 6 ? fields[6] : "";
+        return samples.empty() ? 1 : 0;
+    }
+};
+
+inline double SolverMarketMedian(std::vector<double> samples)
+{
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    const size_t m = samples.size() / 2;
+    return (samples.size() % 2) ? samples[m] : 0.5 * (samples[m - 1] + samples[m]);
+}
+
+/* One-sided Mann-Whitney U test: p-value of "the current samples tend to be larger than the
+baseline ones". Exact distribution for small samples without ties, normal approximation with
+tie and continuity corrections otherwise. */
+inline double SolverMarketMannWhitneyGreater(const std::vector<double>& baseline, const std::vector<double>& current)
+{
+    const size_t n1 = current.size(), n2 = baseline.size();
+    if (n1 == 0 || n2 == 0) return 1.0;
+    double u = 0;  /* pairs where current > baseline, ties count half*/
+    bool ties = false;
+    for (const double c : current) {
+        for (const double b : baseline) {
+            if (c > b) u += 1;
+            else if (c == b) { u += 0.5; ties = true; }
+        }
+    }
+
+    if (!ties && n1 * n2 <= 400) {
+        // count[n][m][k]: arrangements of n current and m baseline samples with U = k
+        const size_t max_u = n1 * n2;
+        std::vector<std::vector<std::vector<double>>> count(n1 + 1, std::vector<std::vector<double>>(n2 + 1, std::vector<double>(max_u + 1, 0.0)));
+        for (size_t n = 0; n <= n1; n++) {
+            for (size_t m = 0; m <= n2; m++) {
+                if (n == 0 || m == 0) { count[n][m][0] = 1; continue; }
+                for (size_t k = 0; k <= n * m; k++) {
+                    // The largest sample is a current one (above the m baseline ones) or a baseline one
+                    count[n][m][k] = (k >= m ? count[n - 1][m][k - m] : 0.0) + count[n][m - 1][k];
+                }
+            }
+        }
+        double tail = 0, total = 0;
+        for (size_t k = 0; k <= max_u; k++) {
+            total += count[n1][n2][k];
+            if (double(k) >= u) tail += count[n1][n2][k];
+        }
+        return tail / total;
+    }
+
+    std::vector<double> all(current);
+    all.insert(all.end(), baseline.begin(), baseline.end());
+    std::sort(all.begin(), all.end());
+    double tie_term = 0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j] == all[i]) j++;
+        const double t = double(j - i);
+        tie_term += t * t * t - t;
+        i = j;
+    }
+    const double n = double(n1 + n2);
+    const double variance = double(n1) * double(n2) / 12.0 * ((n + 1) - tie_term / (n * (n - 1)));
+    if (variance <= 0) return 1.0;
+    const double z = (u - double(n1) * double(n2) / 2.0 - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+enum SolverMarketBaselineVerdict {
+    SolverMarketBaselineUnchanged,
+    SolverMarketBaselineRegression,
+    SolverMarketBaselineImprovement,
+    SolverMarketBaselineNew          /* no baseline for this key*/
+};
+
+inline const char* SolverMarketBaselineVerdictName(const SolverMarketBaselineVerdict verdict)
+{
+    switch (verdict) {
+        case SolverMarketBaselineRegression: return "REGRESSION";
+        case SolverMarketBaselineImprovement: return "improved";
+        case SolverMarketBaselineNew: return "new";
+        default: return "ok";
+    }
+}
+
+struct SolverMarketBaselineComparison {
+    SolverMarketBaselineEntry current;
+    double baseline_median = 0;
+    double current_median = 0;
+    double change = 0;   /* current / baseline medians - 1*/
+    double p_value = 1;  /* of the direction of the change*/
+    SolverMarketBaselineVerdict verdict = SolverMarketBaselineNew;
+};
+
+// A change counts when it is significant at `alpha` and larger than `threshold` (relative, on medians)
+inline SolverMarketBaselineComparison SolverMarketCompareBaseline(const SolverMarketBaselineEntry& current,
+                                                                  const SolverMarketBaselineEntry* baseline,
+                                                                  const double alpha = 0.05, const double threshold = 0.05)
+{
+    SolverMarketBaselineComparison comparison;
+    comparison.current = current;
+    comparison.current_median = SolverMarketMedian(current.samples);
+    if (!baseline) return comparison;
+
+    comparison.baseline_median = SolverMarketMedian(baseline->samples);
+    comparison.change = comparison.baseline_median > 0 ? comparison.current_median / comparison.baseline_median - 1.0 : 0.0;
+    comparison.verdict = SolverMarketBaselineUnchanged;
+    if (comparison.change > 0) {
+        comparison.p_value = SolverMarketMannWhitneyGreater(baseline->samples, current.samples);
+        if (comparison.p_value < alpha && comparison.change > threshold) comparison.verdict = SolverMarketBaselineRegression;
+    } else {
+        comparison.p_value = SolverMarketMannWhitneyGreater(current.samples, baseline->samples);
+        if (comparison.p_value < alpha && -comparison.change > threshold) comparison.verdict = SolverMarketBaselineImprovement;
+    }
+    return comparison;
+}
+
+// Entries of a samples file or of the store, later lines of a key and metric replace earlier ones
+inline int SolverMarketReadBaselineEntries(const std::string& filename, std::vector<SolverMarketBaselineEntry>& entries)
+{
+    std::ifstream file(filename);
+    if (!file.is_open()) return SolverMarketBaselineErrorFile;
+    std::map<std::pair<SolverMarketBaselineKey, std::string>, size_t> index;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        SolverMarketBaselineEntry entry;
+        if (entry.from_line(line)) {
+            SolverMarketLog() << "[Warning][SolverMarket][Baseline][read] Skipping malformed line of " << filename << "\n";
+            continue;
+        }
+        const auto id = std::make_pair(entry.key, entry.metric);
+        if (index.count(id)) {
+            entries[index[id]] = entry;
+        } else {
+            index[id] = entries.size();
+            entries.push_back(entry);
+        }
+    }
+    return SolverMarketBaselineSuccess;
+}
+
+/* Persistent store of baselines, append only like the tuning cache */
+class SolverMarketBaselineStore {
+public:
+
+    explicit SolverMarketBaselineStore(const std::string& filename = "solver_market_baseline.tsv") : filename_(filename) {}
+
+    int lookup(const SolverMarketBaselineKey& key, const std::string& metric, SolverMarketBaselineEntry& entry) const {
+        std::vector<SolverMarketBaselineEntry> entries;
+        if (SolverMarketReadBaselineEntries(filename_, entries) != SolverMarketBaselineSuccess) return SolverMarketBaselineNotFound;
+        for (const auto& candidate : entries) {
+            if (!(candidate.key < key) && !(key < candidate.key) && candidate.metric == metric) {
+                entry = candidate;
+                return SolverMarketBaselineSuccess;
+            }
+        }
+        return SolverMarketBaselineNotFound;
+    }
+
+    int store(const std::vector<SolverMarketBaselineEntry>& entries) const {
+        std::ostringstream lines;
+        for (const auto& entry : entries) lines << entry.to_line() << "\n";
+        std::ofstream file(filename_, std::ios::app);
+        if (!file.is_open() || !(file << lines.str())) {
+            SolverMarketLog(std::cerr) << "Error: Could not open " << filename_ << " for writing.\n";
+            return SolverMarketBaselineErrorFile;
+        }
+        return SolverMarketBaselineSuccess;
+    }
+
+    // Every current entry against the baseline of its key
+    std::vector<SolverMarketBaselineComparison> compare(const std::vector<SolverMarketBaselineEntry>& current,
+                                                        const double alpha, const double threshold) const {
+        std::vector<SolverMarketBaselineEntry> stored;
+        SolverMarketReadBaselineEntries(filename_, stored);
+        std::vector<SolverMarketBaselineComparison> comparisons;
+        for (const auto& entry : current) {
+            const SolverMarketBaselineEntry* baseline = nullptr;
+            for (const auto& candidate : stored) {
+                if (!(candidate.key < entry.key) && !(entry.key < candidate.key) && candidate.metric == entry.metric) baseline = &candidate;
+            }
+            comparisons.push_back(SolverMarketCompareBaseline(entry, baseline, alpha, threshold));
+        }
+        return comparisons;
+    }
+
+    const std::string& filename() const { return filename_; }
+
+private:
+    std::string filename_;
+};
+
+// Summary table, one line per comparison
+inline void SolverMarketPrintBaselineComparisons(std::ostream& out, const std::vector<SolverMarketBaselineComparison>& comparisons)
+{
+    std::ostringstream table;
+    table << std::left << std::setw(40) << "matrix" << std::setw(8) << "backend" << std::setw(10) << "metric"
+          << std::right << std::setw(12) << "baseline" << std::setw(12) << "current" << std::setw(9) << "change"
+          << std::setw(9) << "p" << "  " << "status" << "\n";
+    table << std::fixed;
+    for (const auto& c : comparisons) {
+        std::string label = c.current.label.substr(0, c.current.label.find(' '));
+        if (label.size() > 38) label = "..." + label.substr(label.size() - 35);
+        table << std::left << std::setw(40) << label << std::setw(8) << c.current.key.backend << std::setw(10) << c.current.metric
+              << std::right << std::setprecision(3);
+        if (c.verdict == SolverMarketBaselineNew) {
+            table << std::setw(12) << "-" << std::setw(12) << c.current_median << std::setw(9) << "-" << std::setw(9) << "-";
+        } else {
+            table << std::setw(12) << c.baseline_median << std::setw(12) << c.current_median
+                  << std::setw(8) << std::setprecision(1) << std::showpos << 100.0 * c.change << std::noshowpos << "%"
+                  << std::setw(9) << std::setprecision(3) << c.p_value;
+        }
+        table << "  " << SolverMarketBaselineVerdictName(c.verdict) << "\n";
+    }
+    SolverMarketLog(out) << table.str();
+}
@@ -0,0 +1,245 @@
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "solver-market-krylov.hpp"
+
+#pragma once
+
+/* Batched Krylov solvers: many small systems A_s x_s = b_s sharing one sparsity pattern, solved
+in a single kernel launch. One team per system runs the whole iteration (SpMV and dot products
+over TeamThreadRange, team reductions), so the launch, reduction and host synchronisation costs
+of a solve are paid once for the batch instead of a few times per iteration and per system.
+The work vectors of a system live in team scratch memory: the fast level 0 while they fit, the
+level 1 (global memory) beyond.
+
+  SolverMarketBatchedCSR<double, int> A = SolverMarketBatchedCSR<double, int>::wrap(pattern, values);
+  auto results = SolverMarketBatchedSolve(A, B, X, SolverMarketBatchedCG, 1e-8, 200);
+
+values, B and X hold one system per row (n_systems x nnz, n_systems x n_rows). Jacobi
+preconditioned, the diagonal of each system is taken from its own values. */
+
+enum SolverMarketBatchedMethod {
+  SolverMarketBatchedCG,       /* symmetric positive definite systems*/
+  SolverMarketBatchedBiCGStab  /* nonsymmetric systems*/
+};
+
+inline int SolverMarketParseBatchedMethod(const std::string& text, SolverMarketBatchedMethod& method) {
+  if (text == "cg") method = SolverMarketBatchedCG;
+  else if (text == "bicgstab") method = SolverMarketBatchedBiCGStab;
+  else return 1;
+  return 0;
+}
+
+// One pattern (offsets, columns) and the values of every system
+template <typename _TYPE_, typename _ITYPE_>
+struct SolverMarketBatchedCSR {
+  _ITYPE_ n_rows = 0;
+  DeviceView<_ITYPE_> offsets;  /* n_rows + 1*/
+  DeviceView<_ITYPE_> columns;
+  DeviceBatchView<_TYPE_> values;  /* n_systems x nnz*/
+
+  size_t n_systems() const { return values.extent(0); }
+  size_t nnz() const { return columns.extent(0); }
+
+  // Pattern of a (square) device CSR, its own values are not used
+  static SolverMarketBatchedCSR wrap(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& pattern, const DeviceBatchView<_TYPE_>& values) {
+    SolverMarketBatchedCSR A;
+    A.n_rows = pattern.n_rows;
+    A.offsets = pattern.offsets;
+    A.columns = pattern.columns;
+    A.values = values;
+    return A;
+  }
+};
+
+// Work vectors of a team
+template <typename _TYPE_>
+using SolverMarketBatchedScratchView = Kokkos::View<_TYPE_*, typename Device::scratch_memory_space, Kokkos::MemoryTraits<Kokkos::Unmanaged>>;
+
+// Level 0 scratch (shared memory on GPUs) is kept for batches whose vectors fit in 32 KB per team
+constexpr size_t SolverMarketBatchedLevel0Bytes = 32 * 1024;
+
+inline int SolverMarketBatchedVectors(const SolverMarketBatchedMethod method) {
+  return method == SolverMarketBatchedCG ? 5 : 8;
+}
+
+/* Solves every system of the batch, X holds the initial guesses. Returns the result of each
+system: iterations, relative residual ||b - A x|| / ||b|| and convergence. */
+template <typename _TYPE_, typename _ITYPE_>
+std::vector<SolverMarketKrylovResult> SolverMarketBatchedSolve(const SolverMarketBatchedCSR<_TYPE_, _ITYPE_>& A,
+                                                               const DeviceBatchView<_TYPE_>& B, const DeviceBatchView<_TYPE_>& X,
+                                                               const SolverMarketBatchedMethod method,
+                                                               const double tolerance, const int max_iterations) {
+  using Policy = Kokkos::TeamPolicy<Device>;
+  using Member = typename Policy::member_type;
+  using Scratch = SolverMarketBatchedScratchView<_TYPE_>;
+
+  const size_t n_systems = A.n_systems();
+  const _ITYPE_ n = A.n_rows;
+  DeviceView<int> iterations("SolverMarket::batched_iterations", n_systems);
+  DeviceView<double> residuals("SolverMarket::batched_residuals", n_systems);
+  DeviceView<int> converged("SolverMarket::batched_converged", n_systems);
+
+  const int n_vectors = SolverMarketBatchedVectors(method);
+  const size_t bytes = size_t(n_vectors) * Scratch::shmem_size(n);
+  const int level = bytes <= SolverMarketBatchedLevel0Bytes ? 0 : 1;
+  const Policy policy = Policy(int(n_systems), Kokkos::AUTO).set_scratch_size(level, Kokkos::PerTeam(bytes));
+
+  auto offsets = A.offsets;
+  auto columns = A.columns;
+  auto values = A.values;
+
+  Kokkos::parallel_for("SolverMarket::batched_solve", policy, KOKKOS_LAMBDA(const Member& member) {
+    const int s = member.league_rank();
+    Scratch inv_diagonal(member.team_scratch(level), n);
+    Scratch r(member.team_scratch(level), n);
+
+    // y = A_s x over the rows of the team
+    auto spmv = [&](const Scratch& x, const Scratch& y) {
+      Kokkos::parallel_for(Kokkos::TeamThreadRange(member, n), [&](const _ITYPE_ i) {
+        _TYPE_ sum = 0;
+        for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) sum += values(s, k) * x(columns(k));
+        y(i) = sum;
+      });
+      member.team_barrier();
+    };
+    auto dot = [&](const Scratch& x, const Scratch& y) {
+      _TYPE_ result = 0;
+      Kokkos::parallel_reduce(Kokkos::TeamThreadRange(member, n), [&](const _ITYPE_ i, _TYPE_& sum) { sum += x(i) * y(i); }, result);
+      return result;
+    };
+
+    // D_s^-1, r = b - A_s x, ||b||
+    _TYPE_ bb = 0;
+    Kokkos::parallel_reduce(Kokkos::TeamThreadRange(member, n), [&](const _ITYPE_ i, _TYPE_& sum) {
+      _TYPE_ d = 0, ax = 0;
+      for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) {
+        const _ITYPE_ j = columns(k);
+        if (j == i) d += values(s, k);
+        ax += values(s, k) * X(s, j);
+      }
+      inv_diagonal(i) = (d != _TYPE_(0)) ? _TYPE_(1) / d : _TYPE_(1);
+      r(i) = B(s, i) - ax;
+      sum += B(s, i) * B(s, i);
+    }, bb);
+    member.team_barrier();
+    const double norm_b = (bb != _TYPE_(0)) ? Kokkos::sqrt(double(bb)) : 1.0;
+
+    int it = 0;
+    double residual = Kokkos::sqrt(double(dot(r, r))) / norm_b;
+    bool done = residual <= tolerance;
+
+    if (method == SolverMarketBatchedCG) {
+      Scratch z(member.team_scratch(level), n);
+      Scratch p(member.team_scratch(level), n);
+      Scratch q(member.team_scratch(level), n);
+      _TYPE_ rz = 0;
+      Kokkos::parallel_reduce(Kokkos::TeamThreadRange(member, n), [&](const _ITYPE_ i, _TYPE_& sum) {
+        z(i) = inv_diagonal(i) * r(i);
+        p(i) = z(i);
+        sum += r(i) * z(i);
+      }, rz);
+      member.team_barrier();
+
+      while (!done && it < max_iterations) {
+        spmv(p, q);
+        const _TYPE_ pq = dot(p, q);
+        if (pq == _TYPE_(0)) break;  /* breakdown*/
+        const _TYPE_ alpha = rz / pq;
+        _TYPE_ rr = 0;
+        Kokkos::parallel_reduce(Kokkos::TeamThreadRange(member, n), [&](const _ITYPE_ i, _TYPE_& sum) {
+          X(s, i) += alpha * p(i);
+          r(i) -= alpha * q(i);
+          z(i) = inv_diagonal(i) * r(i);
+          sum += r(i) * r(i);
+        }, rr);
+        member.team_barrier();
+        it++;
+        residual = Kokkos::sqrt(double(rr)) / norm_b;
+        done = residual <= tolerance;
+        if (done) break;
+
+        const _TYPE_ rz_new = dot(r, z);
+        const _TYPE_ beta = rz_new / rz;
+        rz = rz_new;
+        Kokkos::parallel_for(Kokkos::TeamThreadRange(member, n), [&](const _ITYPE_ i) { p(i) = z(i) + beta * p(i); });
+        member.team_barrier();
+      }
+    } else {
+      // Right preconditioned, s = r - alpha v is kept in r
+      Scratch r_hat(member.team_scratch(level), n);
+      Scratch p(member.team_scratch(level), n);
+      Scratch v(member.team_scratch(level), n);
+      Scratch p_hat(member.team_scratch(level), n);
+      Scratch s_hat(member.team_scratch(level), n);
+      Scratch t(member.team_scratch(level), n);
+      Kokkos::parallel_for(Kokkos::TeamThreadRange(member, n), [&](const _ITYPE_ i) {
+        r_hat(i) = r(i);
+        p(i) = 0;
+        v(i) = 0;
+      });
+      member.team_barrier();
+
+      _TYPE_ rho = 1, alpha = 1, omega = 1;
+      while (!done && it < max_iterations) {
+        const _TYPE_ rho_new = dot(r_hat, r);
+        if (rho_new == _TYPE_(0)) break;  /* breakdown*/
+        const _TYPE_ beta = (rho_new / rho) * (alpha / omega);
+        rho = rho_new;
+        Kokkos::parallel_for(Kokkos::TeamThreadRange(member, n), [&](const _ITYPE_ i) {
+          p(i) = r(i) + beta * (p(i) - omega * v(i));
+          p_hat(i) = inv_diagonal(i) * p(i);
+        });
+        member.team_barrier();
+        spmv(p_hat, v);
+        const _TYPE_ r_hat_v = dot(r_hat, v);
+        if (r_hat_v == _TYPE_(0)) break;
+        alpha = rho / r_hat_v;
+        _TYPE_ ss = 0;
+        Kokkos::parallel_reduce(Kokkos::TeamThreadRange(member, n), [&](const _ITYPE_ i, _TYPE_& sum) {
+          r(i) -= alpha * v(i);
+          X(s, i) += alpha * p_hat(i);
+          s_hat(i) = inv_diagonal(i) * r(i);
+          sum += r(i) * r(i);
+        }, ss);
+        member.team_barrier();
+        it++;
+        residual = Kokkos::sqrt(double(ss)) / norm_b;
+        done = residual <= tolerance;
+        if (done) break;
+
+        spmv(s_hat, t);
+        const _TYPE_ tt = dot(t, t);
+        omega = (tt != _TYPE_(0)) ? dot(t, r) / tt : _TYPE_(0);
+        _TYPE_ rr = 0;
+        Kokkos::parallel_reduce(Kokkos::TeamThreadRange(member, n), [&](const _ITYPE_ i, _TYPE_& sum) {
+          X(s, i) += omega * s_hat(i);
+          r(i) -= omega * t(i);
+          sum += r(i) * r(i);
+        }, rr);
+        member.team_barrier();
+        residual = Kokkos::sqrt(double(rr)) / norm_b;
+        done = residual <= tolerance;
+        if (omega == _TYPE_(0)) break;
+      }
+    }
+
+    Kokkos::single(Kokkos::PerTeam(member), [&]() {
+      iterations(s) = it;
+      residuals(s) = residual;
+      converged(s) = done ? 1 : 0;
+    });
+  });
+
+  auto host_iterations = Kokkos::create_mirror_view_and_copy(Host(), iterations);
+  auto host_residuals = Kokkos::create_mirror_view_and_copy(Host(), residuals);
+  auto host_converged = Kokkos::create_mirror_view_and_copy(Host(), converged);
+  std::vector<SolverMarketKrylovResult> results(n_systems);
+  for (size_t s = 0; s < n_systems; s++) {
+    results[s].iterations = host_iterations(s);
+    results[s].residual = host_residuals(s);
+    results[s].converged = host_converged(s) != 0;
+  }
+  return results;
+}
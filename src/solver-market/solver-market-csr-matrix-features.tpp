@@ -0,0 +1,189 @@
+// Reduction type of the feature pass. Everything is either a sum, a min or a max,
+// so the join is order independent and the result does not depend on the number of threads.
+struct SolverMarketFeaturesReduction {
+  uint64_t hash;
+  uint64_t hist[SOLVER_MARKET_FEATURES_HIST_BINS];
+  uint64_t row_min, row_max;
+  uint64_t bandwidth, empty_rows, duplicates, missing_diag, zero_diag, dominant_rows;
+  uint64_t struct_asym, num_asym;
+  double row_sum, row_sum_sq, dominance_min;
+};
+
+// splitmix64 finalizer, used to decorrelate the per-row hashes before summing them
+KOKKOS_INLINE_FUNCTION uint64_t solver_market_mix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+struct SolverMarketFeaturesFunctor {
+  using value_type = SolverMarketFeaturesReduction;
+
+  HostView<_ITYPE_> offsets, columns;
+  HostView<_TYPE_> values;
+  bool check_symmetry;
+  double tolerance;
+
+  KOKKOS_INLINE_FUNCTION void init(value_type& r) const {
+    r.hash = 0;
+    for (int b = 0; b < SOLVER_MARKET_FEATURES_HIST_BINS; b++) r.hist[b] = 0;
+    r.row_min = ~uint64_t(0);
+    r.row_max = 0;
+    r.bandwidth = r.empty_rows = r.duplicates = r.missing_diag = r.zero_diag = r.dominant_rows = 0;
+    r.struct_asym = r.num_asym = 0;
+    r.row_sum = r.row_sum_sq = 0.0;
+    r.dominance_min = 1e300;
+  }
+
+  KOKKOS_INLINE_FUNCTION void join(value_type& dst, const value_type& src) const {
+    dst.hash += src.hash;
+    for (int b = 0; b < SOLVER_MARKET_FEATURES_HIST_BINS; b++) dst.hist[b] += src.hist[b];
+    if (src.row_min < dst.row_min) dst.row_min = src.row_min;
+    if (src.row_max > dst.row_max) dst.row_max = src.row_max;
+    if (src.bandwidth > dst.bandwidth) dst.bandwidth = src.bandwidth;
+    dst.empty_rows += src.empty_rows;
+    dst.duplicates += src.duplicates;
+    dst.missing_diag += src.missing_diag;
+    dst.zero_diag += src.zero_diag;
+    dst.dominant_rows += src.dominant_rows;
+    dst.struct_asym += src.struct_asym;
+    dst.num_asym += src.num_asym;
+    dst.row_sum += src.row_sum;
+    dst.row_sum_sq += src.row_sum_sq;
+    if (src.dominance_min < dst.dominance_min) dst.dominance_min = src.dominance_min;
+  }
+
+  // Binary search of column `col` in (sorted) row `row`, returns -1 if absent
+  KOKKOS_INLINE_FUNCTION int64_t find(const _ITYPE_ row, const _ITYPE_ col) const {
+    int64_t lo = offsets(row), hi = int64_t(offsets(row + 1)) - 1;
+    while (lo <= hi) {
+      int64_t mid = lo + (hi - lo) / 2;
+      if (columns(mid) == col) {
+        while (mid > int64_t(offsets(row)) && columns(mid - 1) == col) mid--;
+        return mid;
+      }
+      if (columns(mid) < col) lo = mid + 1;
+      else hi = mid - 1;
+    }
+    return -1;
+  }
+
+  KOKKOS_INLINE_FUNCTION void operator()(const _ITYPE_ i, value_type& r) const {
+    const uint64_t start = offsets(i), end = offsets(i + 1);
+    const uint64_t len = end - start;
+
+    r.row_sum += double(len);
+    r.row_sum_sq += double(len) * double(len);
+    if (len < r.row_min) r.row_min = len;
+    if (len > r.row_max) r.row_max = len;
+
+    int bin = 0;
+    for (uint64_t l = len; l > 0 && bin < SOLVER_MARKET_FEATURES_HIST_BINS - 1; l >>= 1) bin++;
+    r.hist[bin] += 1;
+
+    if (len == 0) r.empty_rows += 1;
+
+    // FNV-1a over the row length and columns, then mixed with the row index
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = (h ^ len) * 0x100000001b3ULL;
+
+    bool found_diag = false;
+    double diag = 0.0, offdiag = 0.0;
+
+    for (uint64_t k = start; k < end; k++) {
+      const _ITYPE_ j = columns(k);
+      h = (h ^ uint64_t(j)) * 0x100000001b3ULL;
+
+      const uint64_t dist = (int64_t(i) > int64_t(j)) ? uint64_t(i) - uint64_t(j) : uint64_t(j) - uint64_t(i);
+      if (dist > r.bandwidth) r.bandwidth = dist;
+
+      if (k > start && columns(k - 1) == j) r.duplicates += 1;
+
+      const double a = Kokkos::abs(values(k));
+      if (j == i) {
+        found_diag = true;
+        diag += a;
+      } else {
+        offdiag += a;
+        if (check_symmetry) {
+          const int64_t kt = find(j, i);
+          if (kt < 0) {
+            r.struct_asym += 1;
+          } else {
+            const double at = Kokkos::abs(values(kt));
+            const double diff = Kokkos::abs(values(k) - values(kt));
+            if (diff > tolerance * (a > at ? a : at)) r.num_asym += 1;
+          }
+        }
+      }
+    }
+
+    r.hash += solver_market_mix64(h ^ solver_market_mix64(uint64_t(i)));
+
+    if (!found_diag) r.missing_diag += 1;
+    else if (diag == 0.0) r.zero_diag += 1;
+
+    if (len > 0) {
+      if (diag >= offdiag) r.dominant_rows += 1;
+      const double ratio = (offdiag > 0.0) ? diag / offdiag : 1e300;
+      if (ratio < r.dominance_min) r.dominance_min = ratio;
+    }
+  }
+};
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::compute_features(SolverMarketMatrixFeatures& features){
+
+    if (not(is_allocated_)){
+        SolverMarketLog() << "[Error][SolverMarket][CsrMatrix][compute_features] You want to analyze a CSR matrix that has not been allocated\n";
+        return 1;
+    }
+
+    Kokkos::Timer timer;
+
+    SolverMarketFeaturesFunctor<_TYPE_, _ITYPE_> functor;
+    functor.offsets = offsets_h_;
+    functor.columns = columns_h_;
+    functor.values = values_h_;
+    // Symmetric-like files only hold one triangle: the check would flag every off-diagonal entry
+    functor.check_symmetry = (mtype_ == SolverMarketCSRMatrixGeneral || mtype_ == SolverMarketCSRMatrixTypeNone);
+    functor.tolerance = 100 * std::numeric_limits<_TYPE_>::epsilon();
+
+    SolverMarketFeaturesReduction r;
+    Kokkos::parallel_reduce("SolverMarket::compute_features", Kokkos::RangePolicy<Host>(0, n_), functor, r);
+
+    features = SolverMarketMatrixFeatures();
+    features.n = n_;
+    features.nnz = nnz_;
+    features.fingerprint = solver_market_mix64(r.hash ^ solver_market_mix64(uint64_t(n_)) ^ (uint64_t(nnz_) << 1));
+
+    const double mean = (n_ > 0) ? r.row_sum / double(n_) : 0.0;
+    const double var = (n_ > 0) ? r.row_sum_sq / double(n_) - mean * mean : 0.0;
+    features.row_nnz_min = (n_ > 0) ? r.row_min : 0;
+    features.row_nnz_max = r.row_max;
+    features.row_nnz_mean = mean;
+    features.row_nnz_std = (var > 0.0) ? std::sqrt(var) : 0.0;
+    for (int b = 0; b < SOLVER_MARKET_FEATURES_HIST_BINS; b++) features.row_nnz_histogram[b] = r.hist[b];
+
+    features.bandwidth = r.bandwidth;
+    features.empty_rows = r.empty_rows;
+    features.duplicates = r.duplicates;
+    features.missing_diagonal = r.missing_diag;
+    features.zero_diagonal = r.zero_diag;
+    features.diagonally_dominant_rows = r.dominant_rows;
+    features.diagonal_dominance_min = (r.dominance_min < 1e300) ? r.dominance_min : 0.0;
+
+    features.structural_asymmetric_entries = r.struct_asym;
+    features.numerical_asymmetric_entries = r.num_asym;
+    features.structurally_symmetric = (r.struct_asym == 0);
+    features.numerically_symmetric = (r.struct_asym == 0) && (r.num_asym == 0);
+
+    features.analysis_time = timer.seconds();
+
+    SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][compute_features] Fingerprint " << features.fingerprint_string()
+              << " computed in " << features.analysis_time * 1000 << " ms\n";
+
+    return 0;
+}
@@ -3,8 +3,22 @@
 #include <sstream>
 #include <string>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <atomic>
+#include <memory>
+#include <tuple>
+#include <vector>
 
 #include "solver-market-header.hpp"
+#include "solver-market-writer.hpp"
+#include "solver-market-matrix-features.hpp"
+#include "solver-market-pool.hpp"
+#include "solver-market-numa.hpp"
+#include "solver-market-perf.hpp"
+#include "solver-market-parse.hpp"
+#include "solver-market-memory.hpp"
+#include "solver-market-shared.hpp"
 
 #pragma once
 
@@ -19,6 +33,30 @@ enum SolverMarketCSRMatrixType {
     SolverMarketCSRMatrixTypeNone,
     SolverMarketCSRMatrixGeneral,
     SolverMarketCSRMatrixSymmetric,
+    SolverMarketCSRMatrixSkewSymmetric, /* a_ji = -a_ij, one triangle stored (as symmetric)*/
+    SolverMarketCSRMatrixHermitian      /* a_ji = conj(a_ij), one triangle stored (as symmetric)*/
+};
+
+// Symmetry token of the Matrix Market banner
+inline const char* SolverMarketSymmetryName(const SolverMarketCSRMatrixType mtype) {
+    switch (mtype) {
+        case SolverMarketCSRMatrixSymmetric: return "symmetric";
+        case SolverMarketCSRMatrixSkewSymmetric: return "skew-symmetric";
+        case SolverMarketCSRMatrixHermitian: return "hermitian";
+        default: return "general";
+    }
+}
+
+template <typename _TYPE_>
+inline _TYPE_ SolverMarketConjugate(const _TYPE_& value) { return value; }
+template <typename _TYPE_>
+inline Kokkos::complex<_TYPE_> SolverMarketConjugate(const Kokkos::complex<_TYPE_>& value) { return Kokkos::conj(value); }
+
+/* Assembly of the CSR after the read. Defaults keep every entry of the file as is */
+struct SolverMarketAssemblyOptions {
+    bool sum_duplicates = false;  /* merge entries with the same (i,j) into their sum*/
+    double drop_tolerance = -1.0; /* drop entries with |a_ij| <= tolerance (after summation), < 0: off*/
+    bool keep_diagonal = true;    /* never drop a diagonal entry*/
 };
 
 template <typename _TYPE_, typename _ITYPE_=size_t>
@@ -34,11 +72,46 @@ public:
   SolverMarketCSRMatrix(std::string filename, SolverMarketCSRMatrixView mview, SolverMarketCSRMatrixType mtype= SolverMarketCSRMatrixTypeNone){
     read_matrix_market_file(filename, mview, mtype);
   }
+
+  SolverMarketCSRMatrix(const SolverMarketCSRMatrix&) = default;
+  SolverMarketCSRMatrix(SolverMarketCSRMatrix&&) = default;
+  SolverMarketCSRMatrix& operator=(const SolverMarketCSRMatrix&) = default;
+  SolverMarketCSRMatrix& operator=(SolverMarketCSRMatrix&&) = default;
+
+  // Storage goes back to the buffer pool (if no View still references it)
+  ~SolverMarketCSRMatrix(){
+    release_buffers();
+  }
   
   int read_matrix_market_file(std::string filename, SolverMarketCSRMatrixView mview, SolverMarketCSRMatrixType mtype= SolverMarketCSRMatrixTypeNone);
 
+  // CSR from 0-based COO entries (i, j, value), in any order: same row sort and assembly as the reader
+  int build_from_coo(const _ITYPE_ n, const std::vector<std::tuple<int, int, _TYPE_>>& entries,
+                     SolverMarketCSRMatrixView mview = SolverMarketCSRMatrixFull,
+                     SolverMarketCSRMatrixType mtype = SolverMarketCSRMatrixGeneral);
+
+  // CSR filled row by row, in parallel, without a COO: row(i, emit) calls emit(j, value) for each
+  // entry of row i, in any order. It is called twice per row (lengths, then fill) and must emit the same entries
+  template <typename _ROW_>
+  int generate(const _ITYPE_ n, _ROW_ row, SolverMarketCSRMatrixType mtype = SolverMarketCSRMatrixGeneral);
+
   int send_to_device();
 
+  // Write the host CSR, full round-trip precision. Symmetric matrices keep their stored triangle
+  int write_matrix_market_file(std::string filename, SolverMarketFileFormat format = SolverMarketFileCoordinate);
+
+  // CSR from a binary segment (solver-market-shared.hpp): the host Views wrap the mapping, no copy.
+  // The segment stays mapped as long as this matrix (or a copy of it) uses it
+  int read_shared_memory(std::string name);
+  int read_binary_file(std::string filename);
+  int attach_shared_segment(std::shared_ptr<SolverMarketSharedSegment> segment);
+
+  // Binary segment file of the host CSR, mapped back by read_binary_file
+  int write_binary_file(std::string filename);
+
+  // Structural/numerical statistics and fingerprint, one parallel pass on the host CSR
+  int compute_features(SolverMarketMatrixFeatures& features);
+
   _ITYPE_* get_host_offsets_pointer(){return offsets_h_.data();}
   _ITYPE_* get_host_columns_pointer(){return columns_h_.data();}
 
@@ -73,14 +146,33 @@ bool isLower() const { return mview_ == SolverMarketCSRMatrixLower; }
 bool isUpper() const { return mview_ == SolverMarketCSRMatrixUpper; }
 bool isGeneral() const { return mtype_ == SolverMarketCSRMatrixGeneral; }
 bool isSymmetric() const { return mtype_ == SolverMarketCSRMatrixSymmetric; }
+bool isSkewSymmetric() const { return mtype_ == SolverMarketCSRMatrixSkewSymmetric; }
+bool isHermitian() const { return mtype_ == SolverMarketCSRMatrixHermitian; }
 bool hasValidView() const { return mview_ != SolverMarketCSRMatrixViewNone; }
 bool hasValidType() const { return mtype_ != SolverMarketCSRMatrixTypeNone; }
+bool isShared() const { return segment_ != nullptr; }
+// Field of the last file read (pattern matrices hold 1 for every stored entry)
+SolverMarketField getField() const { return field_; }
+
+// --- Reader memory mode ---
+// Auto reads in memory unless the estimated peak exceeds the budget (bytes, 0 = no budget)
+void setReadMode(SolverMarketReadMode mode) { read_mode_ = mode; }
+void setHostMemoryBudget(size_t bytes) { host_memory_budget_ = bytes; }
+SolverMarketReadMode getReadMode() const { return read_mode_; }
+size_t getHostMemoryBudget() const { return host_memory_budget_; }
+
+// --- Assembly (duplicates, explicit zeros) ---
+void setAssemblyOptions(const SolverMarketAssemblyOptions& options) { assembly_ = options; }
+SolverMarketAssemblyOptions getAssemblyOptions() const { return assembly_; }
+size_t getNumMergedEntries() const { return num_merged_; }
+size_t getNumPrunedEntries() const { return num_pruned_; }
 
 private:
 
   _ITYPE_ n_; /* size of the matrix (assumed square)*/
   _ITYPE_ nnz_; /* # of non-zero elements*/
   bool is_allocated_ = false;
+  bool fresh_columns_ = false, fresh_values_ = false;  /* not touched yet, see place_entries*/
 
   HostView<_ITYPE_> offsets_h_, columns_h_;
   HostView<_TYPE_> values_h_;
@@ -88,10 +180,38 @@ private:
   DeviceView<_ITYPE_> offsets_d_, columns_d_;
   DeviceView<_TYPE_> values_d_;
 
+  /* Pooled buffers (capacity >= size), the views above are their leading subviews*/
+  HostView<_ITYPE_> offsets_h_buffer_, columns_h_buffer_;
+  HostView<_TYPE_> values_h_buffer_;
+  DeviceView<_ITYPE_> offsets_d_buffer_, columns_d_buffer_;
+  DeviceView<_TYPE_> values_d_buffer_;
+
+  /* Mapping the host views point into when built from a segment (their buffers are then empty)*/
+  std::shared_ptr<SolverMarketSharedSegment> segment_;
+
   SolverMarketCSRMatrixView mview_=SolverMarketCSRMatrixViewNone;
   SolverMarketCSRMatrixType mtype_=SolverMarketCSRMatrixTypeNone;
+  SolverMarketField field_=SolverMarketFieldReal;
+
+  SolverMarketReadMode read_mode_=SolverMarketReadAuto;
+  size_t host_memory_budget_=0;
+
+  SolverMarketAssemblyOptions assembly_;
+  size_t num_merged_=0, num_pruned_=0;
 
   int allocate(const _ITYPE_ n, const _ITYPE_ nnz);
+  int allocate_offsets(const _ITYPE_ n);    /* host offsets, releases the previous storage*/
+  int allocate_entries(const _ITYPE_ nnz);  /* host columns and values, device storage*/
+  void place_entries();                     /* NUMA first touch of fresh columns and values, by rows*/
+  void allocate_device(const _ITYPE_ n, const _ITYPE_ nnz);
+  void release_buffers();
+  bool use_two_pass(const size_t n, const size_t nnz) const;
+  template <SolverMarketField _FIELD_>
+  int read_body_two_pass(std::ifstream& file, const _ITYPE_ n, const _ITYPE_ declared_nnz);
+  int coo_to_csr(const std::vector<std::tuple<int, int, _TYPE_>>& entries, const int n);
+  void report_empty_rows();
+  void assemble_rows();
 
 };
-#include "solver-market-csr-matrix.tpp"
\ No newline at end of file
+#include "solver-market-csr-matrix.tpp"
+#include "solver-market-csr-matrix-features.tpp"
\ No newline at end of file
@@ -1,64 +1,302 @@
+// Order of the values of duplicates: any strict order will do, complex values by (real, imag)
+template<typename _TYPE_>
+inline bool SolverMarketValueLess(const _TYPE_& a, const _TYPE_& b){ return a < b; }
+template<typename _TYPE_>
+inline bool SolverMarketValueLess(const Kokkos::complex<_TYPE_>& a, const Kokkos::complex<_TYPE_>& b){
+    return a.real() < b.real() || (a.real() == b.real() && a.imag() < b.imag());
+}
+
+// Sort one CSR row by column, then value: duplicates end in the same order whatever the
+// order they were scattered in. Short rows: insertion sort, no allocation
+template<typename _TYPE_, typename _ITYPE_>
+void SolverMarketSortRow(_ITYPE_* columns, _TYPE_* values, const size_t length){
+    if (length <= 32) {
+        for (size_t a = 1; a < length; a++) {
+            const _ITYPE_ c = columns[a];
+            const _TYPE_ v = values[a];
+            size_t b = a;
+            for (; b > 0 && (columns[b - 1] > c || (columns[b - 1] == c && SolverMarketValueLess(v, values[b - 1]))); b--) {
+                columns[b] = columns[b - 1];
+                values[b] = values[b - 1];
+            }
+            columns[b] = c;
+            values[b] = v;
+        }
+        return;
+    }
+    std::vector<std::pair<_ITYPE_, _TYPE_>> row(length);
+    for (size_t a = 0; a < length; a++) row[a] = {columns[a], values[a]};
+    std::sort(row.begin(), row.end(), [](const std::pair<_ITYPE_, _TYPE_>& a, const std::pair<_ITYPE_, _TYPE_>& b) {
+        return a.first < b.first || (a.first == b.first && SolverMarketValueLess(a.second, b.second));
+    });
+    for (size_t a = 0; a < length; a++) {
+        columns[a] = row[a].first;
+        values[a] = row[a].second;
+    }
+}
+
 template<typename _TYPE_, typename _ITYPE_>
 int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::send_to_device(){
 
     if (not(is_allocated_)){
-        std::cout<<"[Error][SolverMarket][CsrMatrix][send_to_device] You want to send to device a CSR matrix that has not been allocated\n";
+        SolverMarketLog() << "[Error][SolverMarket][CsrMatrix][send_to_device] You want to send to device a CSR matrix that has not been allocated\n";
         return 1;
     }
 
+    SolverMarketMemoryRegion upload_region("upload");
     Kokkos::deep_copy(offsets_d_, offsets_h_);
     Kokkos::deep_copy(columns_d_, columns_h_);
     Kokkos::deep_copy(values_d_, values_h_);
+    upload_region.stop();
 
-    std::cout << "[Info][SolverMarket][CsrMatrix][send_to_device] Values successfuly sent to device\n";
+    SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][send_to_device] Values successfuly sent to device\n";
 
     return 0;
   }
 
 template<typename _TYPE_, typename _ITYPE_>
 int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::allocate(const _ITYPE_ n, const _ITYPE_ nnz){
+    if (allocate_offsets(n)) return 1;
+    return allocate_entries(nnz);
+  }
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::allocate_offsets(const _ITYPE_ n){
+    // Previous storage goes back to the pool first, so a reload can get it back
+    release_buffers();
+
     n_ = n;
+    const auto rows = std::make_pair(size_t(0), size_t(n) + 1);
+
+    // Not initialized: the reader fills every entry, send_to_device overwrites the device copies.
+    // New host buffers are first touched in parallel (solver-market-numa.hpp)
+    bool fresh = false;
+    offsets_h_buffer_ = SolverMarketViewPool<_ITYPE_, Host>::instance().acquire("offsets_h_", rows.second, false, &fresh);
+    if (fresh) SolverMarketNumaPlace(offsets_h_buffer_, offsets_h_buffer_.extent(0));
+    offsets_h_ = Kokkos::subview(offsets_h_buffer_, rows);
+    return 0;
+  }
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::allocate_entries(const _ITYPE_ nnz){
     nnz_ = nnz;
+    const auto entries = std::make_pair(size_t(0), size_t(nnz));
 
-    offsets_h_ = HostView<_ITYPE_>("offsets_h_", n+1);
-    columns_h_ = HostView<_ITYPE_>("columns_h_", nnz);
-    values_h_ = HostView<_TYPE_>("values_h_", nnz);
+    // Fresh columns and values are placed by place_entries() once the offsets are known
+    columns_h_buffer_ = SolverMarketViewPool<_ITYPE_, Host>::instance().acquire("columns_h_", entries.second, false, &fresh_columns_);
+    values_h_buffer_ = SolverMarketViewPool<_TYPE_, Host>::instance().acquire("values_h_", entries.second, false, &fresh_values_);
 
-    offsets_d_ = DeviceView<_ITYPE_>("offsets_d_", n+1);
-    columns_d_ = DeviceView<_ITYPE_>("columns_d_", nnz);
-    values_d_ = DeviceView<_TYPE_>("values_d_", nnz);
+    columns_h_ = Kokkos::subview(columns_h_buffer_, entries);
+    values_h_ = Kokkos::subview(values_h_buffer_, entries);
 
-    std::cout << "[Info][SolverMarket][CsrMatrix][allocate] Successfuly allocated on host and device\n";
+    allocate_device(n_, nnz);
+
+    SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][allocate] Successfuly allocated on host and device\n";
 
 
     is_allocated_ = true;
     return 0;
   }
 
+template<typename _TYPE_, typename _ITYPE_>
+void SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::place_entries(){
+    // First touch by rows, not an even split of the entries: with skewed row lengths the pages of
+    // a row then still sit on the node of the thread that owns the row in the host kernels
+    if (fresh_columns_) SolverMarketNumaPlaceRows(columns_h_, offsets_h_, size_t(n_));
+    if (fresh_values_) SolverMarketNumaPlaceRows(values_h_, offsets_h_, size_t(n_));
+    fresh_columns_ = fresh_values_ = false;
+  }
+
+template<typename _TYPE_, typename _ITYPE_>
+void SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::allocate_device(const _ITYPE_ n, const _ITYPE_ nnz){
+    const auto rows = std::make_pair(size_t(0), size_t(n) + 1);
+    const auto entries = std::make_pair(size_t(0), size_t(nnz));
+
+    offsets_d_buffer_ = SolverMarketViewPool<_ITYPE_, Device>::instance().acquire("offsets_d_", rows.second);
+    columns_d_buffer_ = SolverMarketViewPool<_ITYPE_, Device>::instance().acquire("columns_d_", entries.second);
+    values_d_buffer_ = SolverMarketViewPool<_TYPE_, Device>::instance().acquire("values_d_", entries.second);
+
+    offsets_d_ = Kokkos::subview(offsets_d_buffer_, rows);
+    columns_d_ = Kokkos::subview(columns_d_buffer_, entries);
+    values_d_ = Kokkos::subview(values_d_buffer_, entries);
+  }
+
+template<typename _TYPE_, typename _ITYPE_>
+void SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::release_buffers(){
+    // Drop the subviews first: the pool only takes back buffers nobody else references
+    offsets_h_ = HostView<_ITYPE_>();
+    columns_h_ = HostView<_ITYPE_>();
+    values_h_ = HostView<_TYPE_>();
+    offsets_d_ = DeviceView<_ITYPE_>();
+    columns_d_ = DeviceView<_ITYPE_>();
+    values_d_ = DeviceView<_TYPE_>();
+
+    SolverMarketViewPool<_ITYPE_, Host>::instance().release(offsets_h_buffer_);
+    SolverMarketViewPool<_ITYPE_, Host>::instance().release(columns_h_buffer_);
+    SolverMarketViewPool<_TYPE_, Host>::instance().release(values_h_buffer_);
+    SolverMarketViewPool<_ITYPE_, Device>::instance().release(offsets_d_buffer_);
+    SolverMarketViewPool<_ITYPE_, Device>::instance().release(columns_d_buffer_);
+    SolverMarketViewPool<_TYPE_, Device>::instance().release(values_d_buffer_);
+
+    // Unmapped once no other matrix shares it
+    segment_.reset();
+
+    is_allocated_ = false;
+  }
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::read_shared_memory(std::string name)
+{
+    auto segment = std::make_shared<SolverMarketSharedSegment>();
+    const int status = segment->open_shared(name);
+    if (status != SolverMarketSharedSuccess) return status;
+    return attach_shared_segment(segment);
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::read_binary_file(std::string filename)
+{
+    auto segment = std::make_shared<SolverMarketSharedSegment>();
+    const int status = segment->open_file(filename);
+    if (status != SolverMarketSharedSuccess) return status;
+    return attach_shared_segment(segment);
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::attach_shared_segment(std::shared_ptr<SolverMarketSharedSegment> segment)
+{
+    if (segment == nullptr || !segment->is_open()) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][attach_shared] Segment is not mapped\n";
+        return SolverMarketSharedErrorOpen;
+    }
+    const auto& header = segment->header();
+    if (header.kind != SolverMarketSharedMatrix) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][attach_shared] Segment does not hold a matrix\n";
+        return SolverMarketSharedErrorKind;
+    }
+    if (header.index_bytes != sizeof(_ITYPE_) || header.value_bytes != sizeof(_TYPE_)) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][attach_shared] Segment stores " << header.index_bytes << " byte indices and "
+                  << header.value_bytes << " byte values, the matrix uses " << sizeof(_ITYPE_) << " and " << sizeof(_TYPE_) << "\n";
+        return SolverMarketSharedErrorType;
+    }
+    // Sizes and tags come from another process too: n and nnz must be indices of this type, and the
+    // view and type must be values of their enums before they are cast
+    if (header.n > uint64_t(std::numeric_limits<_ITYPE_>::max()) || header.nnz > uint64_t(std::numeric_limits<_ITYPE_>::max())) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][attach_shared] n= " << header.n << ", nnz= " << header.nnz
+                  << " do not fit the " << sizeof(_ITYPE_) << " byte index type\n";
+        return SolverMarketSharedErrorType;
+    }
+    if (header.matrix_view > SolverMarketCSRMatrixUpper || header.matrix_type > SolverMarketCSRMatrixHermitian) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][attach_shared] Unknown matrix view " << header.matrix_view
+                  << " or type " << header.matrix_type << "\n";
+        return SolverMarketSharedErrorType;
+    }
+
+    // The producer is another process: the offsets must describe valid rows, and the columns must be
+    // rows of the matrix, before anyone walks them (SpMV, device upload)
+    const size_t n = header.n;
+    const size_t nnz = header.nnz;
+    _ITYPE_* offsets = segment->offsets<_ITYPE_>();
+    size_t bad_rows = 0;
+    Kokkos::parallel_reduce("SolverMarketSharedOffsets", Kokkos::RangePolicy<Host>(0, n), KOKKOS_LAMBDA(const size_t i, size_t& bad) {
+        if (offsets[i + 1] < offsets[i]) bad++;
+    }, bad_rows);
+    if (bad_rows > 0 || size_t(offsets[0]) != 0 || size_t(offsets[n]) != nnz) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][attach_shared] Invalid CSR offsets (" << bad_rows << " decreasing rows, first "
+                  << offsets[0] << ", last " << offsets[n] << " for nnz " << nnz << ")\n";
+        return SolverMarketSharedErrorOffsets;
+    }
+    const _ITYPE_* columns = segment->columns<_ITYPE_>();
+    size_t bad_columns = 0;
+    Kokkos::parallel_reduce("SolverMarketSharedColumns", Kokkos::RangePolicy<Host>(0, nnz), KOKKOS_LAMBDA(const size_t k, size_t& bad) {
+        if (columns[k] < _ITYPE_(0) || size_t(columns[k]) >= n) bad++;
+    }, bad_columns);
+    if (bad_columns > 0) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][attach_shared] " << bad_columns << " column indices outside [0, " << n << ")\n";
+        return SolverMarketSharedErrorColumns;
+    }
+
+    release_buffers();
+    n_ = n;
+    nnz_ = nnz;
+    segment_ = segment;
+
+    // Unmanaged host views on the mapping, pooled device buffers for send_to_device
+    offsets_h_ = HostView<_ITYPE_>(offsets, n + 1);
+    columns_h_ = HostView<_ITYPE_>(segment->columns<_ITYPE_>(), nnz);
+    values_h_ = HostView<_TYPE_>(segment->values<_TYPE_>(), nnz);
+    allocate_device(n_, nnz_);
+    is_allocated_ = true;
+
+    mview_ = header.matrix_view ? SolverMarketCSRMatrixView(header.matrix_view) : SolverMarketCSRMatrixFull;
+    mtype_ = header.matrix_type ? SolverMarketCSRMatrixType(header.matrix_type) : SolverMarketCSRMatrixGeneral;
+
+    SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][attach_shared] Mapped n= " << n_ << ", nnz= " << nnz_
+              << " (" << SolverMarketToMB(segment->bytes()) << " MB, no copy)\n";
+    return SolverMarketSharedSuccess;
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::write_binary_file(std::string filename)
+{
+    if (not(is_allocated_)){
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][write_binary] You want to write a CSR matrix that has not been allocated\n";
+        return MtxWriterErrorNotAllocated;
+    }
+
+    SolverMarketSharedSegment segment;
+    if (segment.create_file(filename, SolverMarketSharedMatrix, n_, nnz_, sizeof(_ITYPE_), sizeof(_TYPE_)) != SolverMarketSharedSuccess) {
+        return MtxWriterErrorFileNotOpened;
+    }
+    segment.header().matrix_view = uint16_t(mview_);
+    segment.header().matrix_type = uint16_t(mtype_);
+    std::memcpy(segment.offsets<_ITYPE_>(), offsets_h_.data(), (size_t(n_) + 1) * sizeof(_ITYPE_));
+    std::memcpy(segment.columns<_ITYPE_>(), columns_h_.data(), size_t(nnz_) * sizeof(_ITYPE_));
+    std::memcpy(segment.values<_TYPE_>(), values_h_.data(), size_t(nnz_) * sizeof(_TYPE_));
+    segment.close();
+
+    SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][write_binary] Wrote " << nnz_ << " entries to " << filename << "\n";
+    return MtxWriterSuccess;
+}
+
 template<typename _TYPE_, typename _ITYPE_>
 int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::read_matrix_market_file(std::string filename, SolverMarketCSRMatrixView mview, SolverMarketCSRMatrixType mtype)
 {
 
     std::ifstream file(filename);
     if (!file.is_open()) {
-        std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file] Could not open file" << filename << std::endl;
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Could not open file" << filename << std::endl;
         return  MtxReaderErrorFileNotFound;
     }else{
-        std::cout << "[Info][SolverMarket][CsrMatrix][read_from_file] Reading file "<< filename << std::endl;
+        SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][read_from_file] Reading file "<< filename << std::endl;
     }
 
+    // Hardware counters and memory of the read and of its phases, when enabled
+    // (solver-market-perf.hpp, solver-market-memory.hpp)
+    SolverMarketPerfRegion read_region("read");
+    SolverMarketMemoryRegion read_memory_region("read");
+
+    // The RSS high-water mark restarts here, so the peak reported at the end is the read's own
+    // and not the one of an earlier load (the memory regions above already took theirs)
+    const bool rss_reset = SolverMarketResetPeakRSS();
+    auto log_read_completed = [&]() {
+        SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][read_from_file] Read completed with " << nnz_ << " nonzeros ("
+                  << (rss_reset ? "peak RSS " : "process peak RSS ") << SolverMarketToMB(SolverMarketPeakRSS()) << " MB)\n";
+    };
+
     std::string line;
     bool foundSize = false;
     bool foundHeader = false;
     bool justFoundHeader=false;
     bool found_lower = false, found_upper = false;
-    int declared_nnz = 0;
-    int file_line_count = 0;
-    int n, nnz;
+    _ITYPE_ declared_nnz = 0;
+    size_t file_line_count = 0;
+    int n = 0;
     SolverMarketCSRMatrixType read_type = SolverMarketCSRMatrixTypeNone;
 
-    //Tuple for the mtw lines
-    std::vector<std::tuple<int, int, _TYPE_>> entries;
+    //Tuple for the mtw lines, scratch reused between loads
+    SolverMarketPooledScratch<std::tuple<int, int, _TYPE_>> entries_scratch;
+    auto& entries = entries_scratch.get();
 
 
     while (std::getline(file, line)) {
@@ -80,26 +318,35 @@ int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::read_matrix_market_file(std::string
                 header >> banner >> object >> format >> field >> symmetry;
 
                 if (object != "matrix" || format != "coordinate") {
-                    std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file] Only 'matrix coordinate' format is supported.\n";
+                    SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Only 'matrix coordinate' format is supported.\n";
                     return MtxReaderUnsupportedObject;
                 }
 
+                if (SolverMarketParseFieldName(field, field_) || !SolverMarketFieldFits<_TYPE_>(field_)) {
+                    SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Unsupported field '" << field
+                              << "' for this value type (complex needs Kokkos::complex storage)\n";
+                    return MtxReaderUnsupportedField;
+                }
+
+                // Symmetric-like files store one triangle, kept as is (see isSymmetric)
                 if (symmetry == "general") read_type = SolverMarketCSRMatrixGeneral;
                 else if (symmetry == "symmetric") read_type = SolverMarketCSRMatrixSymmetric;
+                else if (symmetry == "skew-symmetric") read_type = SolverMarketCSRMatrixSkewSymmetric;
+                else if (symmetry == "hermitian" && field_ == SolverMarketFieldComplex) read_type = SolverMarketCSRMatrixHermitian;
                 else {
-                    std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file]  Unsupported matrix type: " << symmetry << "\n";
+                    SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file]  Unsupported matrix type: " << symmetry << "\n";
                     return MtxReaderUnsupportedMatrixType;
                 }
 
 
                 if (mtype == SolverMarketCSRMatrixTypeNone){
                     mtype_ = read_type;
-                    std::cout << "[Info][SolverMarket][CsrMatrix][read_from_file] Matrix type read in mtx header: "<<read_type<<".\n";
+                    SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][read_from_file] Matrix type read in mtx header: "<<read_type<<".\n";
                 }else{
                     if (mtype_ == read_type)
-                        std::cout << "[Info][SolverMarket][CsrMatrix][read_from_file] Matrix type read in mtx header: "<<read_type<<".\n";
+                        SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][read_from_file] Matrix type read in mtx header: "<<read_type<<".\n";
                     else
-                        std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file] Matrix type read in mtx header: "<<read_type<<" but mtx reader was called with type"<<mtype<<".\n";
+                        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Matrix type read in mtx header: "<<read_type<<" but mtx reader was called with type"<<mtype<<".\n";
                         return MtxReaderTypeReadIsNotTypeGiven;
                 }
 
@@ -111,111 +358,593 @@ int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::read_matrix_market_file(std::string
         //Get metadata
         std::istringstream lineData(line);
         if (!foundSize) {
-            int n1;
-            lineData >> n >> n1 >> declared_nnz;
-            std::cout << "[Info][SolverMarket][CsrMatrix][read_from_file] n0= " << n << ", n1= " << n1 << ", nnz= " << declared_nnz << "\n";
+            // Parsed wide and checked: an oversized nnz is refused instead of clamped, and nothing
+            // is sized from a garbage line (rows are int in the COO entries and the parse kernels)
+            long long n0 = -1, n1 = -1, header_nnz = -1;
+            lineData >> n0 >> n1 >> header_nnz;
+            SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][read_from_file] n0= " << n0 << ", n1= " << n1 << ", nnz= " << header_nnz << "\n";
+            const unsigned long long max_index = std::numeric_limits<_ITYPE_>::max();
+            const unsigned long long max_rows = std::min<unsigned long long>(std::numeric_limits<int>::max(), max_index);
+            if (lineData.fail() || n0 < 0 || n0 != n1 || header_nnz < 0
+                || (unsigned long long)n0 > max_rows || (unsigned long long)header_nnz > max_index) {
+                SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Invalid size line '" << line
+                                           << "': square matrix expected, with n and nnz within the index type\n";
+                return MtxReaderErrorInvalidSize;
+            }
+            n = int(n0);
+            declared_nnz = _ITYPE_(header_nnz);
             foundSize = true;
-        //Get line
-        } else {
-            _ITYPE_ i, j;
-            _TYPE_ val;
-            lineData >> i >> j >> val;
-            i -= 1; j -= 1;  // Convert from 1-based to 0-based
 
-            //Append the tuple to entries (resize everytime so sub-optimal)
-            entries.emplace_back(i, j, val);
-
-            if (i > j) found_lower = true;
-            if (i < j) found_upper = true;
-            file_line_count+=1;
+            // Bounded memory: no COO entries, the body is read twice straight into the CSR
+            if (use_two_pass(n, declared_nnz)) {
+                mview_ = mview;
+                const int status = SolverMarketDispatchField(field_, [&](auto field) {
+                    return read_body_two_pass<decltype(field)::value>(file, n, declared_nnz);
+                });
+                if (!status) log_read_completed();
+                return status;
+            }
+            // Reserved up to what the rest of the file can hold (an entry line is at least "i j v\n")
+            const std::streampos body = file.tellg();
+            file.seekg(0, std::ios::end);
+            const size_t body_bytes = size_t(file.tellg() - body);
+            file.seekg(body);
+            if (declared_nnz > 0) entries.reserve(std::min(size_t(declared_nnz), body_bytes / 6 + 1));
+            break; // the body is parsed below
         }
     }
 
-    if (not(foundHeader)){
-        std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file] No header found in mtx file.\n";
+    if (not(foundHeader) || not(foundSize)){
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] No header or no size line found in mtx file.\n";
         return MtxReaderWrongHeaderOrNoHeader;
     }
 
+    // Body: one slot per line, parsed in parallel straight from the file blocks by the kernel
+    // of the field. The triangles seen are noted on the way
+    size_t stored = 0;
+    std::atomic<bool> lower_seen(false), upper_seen(false);
+    SolverMarketPerfRegion parse_region("read:parse");
+    int parse_status = SolverMarketDispatchField(field_, [&](auto field) {
+        using EntryValue = SolverMarketEntryValue<decltype(field)::value, _TYPE_>;
+        return SolverMarketParseBody(file,
+            [&](const size_t first, const size_t nlines) { entries.resize(first + nlines); },
+            [&](const char* p, const char* end, const size_t slot) -> int {
+                if (SolverMarketIsEmptyLine(p, end)) return -1;
+                long long i, j;
+                _TYPE_ val;
+                if (!SolverMarketParseInteger(p, end, i) || !SolverMarketParseInteger(p, end, j) || !EntryValue::parse(p, end, val)) {
+                    return MtxReaderErrorInvalidEntry;
+                }
+                if (i > j && !lower_seen.load(std::memory_order_relaxed)) lower_seen.store(true, std::memory_order_relaxed);
+                if (i < j && !upper_seen.load(std::memory_order_relaxed)) upper_seen.store(true, std::memory_order_relaxed);
+                entries[slot] = std::make_tuple(int(i - 1), int(j - 1), val);  // Convert from 1-based to 0-based
+                return 0;
+            },
+            [&](const size_t from, const size_t to) { entries[to] = entries[from]; },
+            stored);
+    });
+    parse_region.stop();
+    entries.resize(stored);
+    if (parse_status) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Could not parse an entry line\n";
+        return parse_status;
+    }
+    file_line_count = stored;
+    found_lower = lower_seen;
+    found_upper = upper_seen;
+
     file.close();
-    nnz = entries.size();
 
     /* set view type */
     mview_ = mview;
 
+    if (file_line_count != size_t(declared_nnz)) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] " << file_line_count << " elements in the mtx file, "
+                  << declared_nnz << " announced in the header\n";
+        return MtxReaderErrorWrongNnz;
+    }
+
     // Allocate memory
-    int failed = allocate(n, nnz);
+    int failed = allocate(n, declared_nnz);
     if (failed) {
-        std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file] Memory allocation failed\n";
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Memory allocation failed\n";
         return MtxReaderErrorFileMemAllocFailed;
     }
 
-    if (file_line_count != declared_nnz) {
-        std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file] More elements in the mtx file than announced in the header\n";
-        return MtxReaderErrorWrongNnz;
-    }
-
-
-    // Sort by row, then by column, 3rd argument is the compare operator, (row then column)
-    std::sort(entries.begin(), entries.end(), [](auto& a, auto& b) {
-        if (std::get<0>(a) == std::get<0>(b))
-            return std::get<1>(a) < std::get<1>(b);
-        return std::get<0>(a) < std::get<0>(b);
-    });
-
 
     //Some checks
     if ((found_lower) && (mview_ == SolverMarketCSRMatrixUpper)) {
-        std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file] mview is upper, but lower elements found\n";
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] mview is upper, but lower elements found\n";
         return MtxReaderErrorUpperViewButLowerFound;
     }
     if ((found_upper) && (mview_ == SolverMarketCSRMatrixLower)) {
-        std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file] mview is lower, but upper elements found\n";
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] mview is lower, but upper elements found\n";
         return MtxReaderErrorLowerViewButUpperFound;
     }
     if (!(found_upper && found_lower) && mview_ == SolverMarketCSRMatrixFull) {
-        std::cout << "[Warning][SolverMarket][CsrMatrix][read_from_file] mview is full, but only lower or upper elements found\n";
+        SolverMarketLog() << "[Warning][SolverMarket][CsrMatrix][read_from_file] mview is full, but only lower or upper elements found\n";
     }
 
 
-    // Initialize with 0's
-    for (_ITYPE_ i=0; i<n+1; i++){
-        offsets_h_(i)=0;
+    SolverMarketPerfRegion build_region("read:build");
+    SolverMarketMemoryRegion assemble_region("assemble");
+    int build_status = coo_to_csr(entries, n);
+    assemble_region.stop();
+    build_region.stop();
+    if (build_status) return build_status;
+
+    report_empty_rows();
+
+    log_read_completed();
+    return 0;
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::build_from_coo(const _ITYPE_ n, const std::vector<std::tuple<int, int, _TYPE_>>& entries,
+                                                          SolverMarketCSRMatrixView mview, SolverMarketCSRMatrixType mtype)
+{
+    mview_ = mview;
+    mtype_ = mtype;
+    if (allocate(n, _ITYPE_(entries.size()))) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][build_from_coo] Memory allocation failed\n";
+        return MtxReaderErrorFileMemAllocFailed;
+    }
+    return coo_to_csr(entries, int(n));
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+template<typename _ROW_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::generate(const _ITYPE_ n, _ROW_ row, SolverMarketCSRMatrixType mtype)
+{
+    // Memory of the generated matrix, the generators have no read phase (solver-market-memory.hpp)
+    SolverMarketMemoryRegion assemble_region("assemble");
+
+    // Pass 1: row lengths, scanned into the offsets (nnz is only known after the scan)
+    SolverMarketPooledScratch<_ITYPE_> offsets_scratch(size_t(n) + 1);
+    auto& offsets = offsets_scratch.get();
+    offsets.assign(size_t(n) + 1, 0);
+    Kokkos::parallel_for("SolverMarket::generate_count", Kokkos::RangePolicy<Host>(0, n), [&](const _ITYPE_ i) {
+        _ITYPE_ length = 0;
+        row(i, [&](const _ITYPE_, const _TYPE_) { length++; });
+        offsets[i + 1] = length;
+    });
+    // Scanned in size_t: a total beyond the index type is an error, not a wrapped offset
+    size_t total = 0;
+    for (size_t i = 0; i < size_t(n); i++) {
+        total += size_t(offsets[i + 1]);
+        if (total > size_t(std::numeric_limits<_ITYPE_>::max())) {
+            SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][generate] More than " << std::numeric_limits<_ITYPE_>::max()
+                                       << " nonzeros, the index type cannot hold the offsets\n";
+            return MtxReaderErrorWrongNnz;
+        }
+        offsets[i + 1] = _ITYPE_(total);
+    }
+
+    mview_ = SolverMarketCSRMatrixFull;
+    mtype_ = mtype;
+    if (allocate(n, offsets[n])) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][generate] Memory allocation failed\n";
+        return MtxReaderErrorFileMemAllocFailed;
     }
 
-    // First pass: count entries per row
-    for (auto& [i, j, val] : entries) {
+    // Pass 2: each row writes its own slice, then is sorted like a read row. The row partition of
+    // this loop is the first touch of fresh columns and values
+    fresh_columns_ = fresh_values_ = false;
+    auto offsets_h = offsets_h_;
+    auto columns = columns_h_;
+    auto values = values_h_;
+    Kokkos::parallel_for("SolverMarket::generate_fill", Kokkos::RangePolicy<Host>(0, n), [&](const _ITYPE_ i) {
+        _ITYPE_ k = offsets[i];
+        offsets_h(i) = k;
+        row(i, [&](const _ITYPE_ j, const _TYPE_ value) {
+            columns(k) = j;
+            values(k) = value;
+            k++;
+        });
+        SolverMarketSortRow(&columns(offsets[i]), &values(offsets[i]), size_t(k - offsets[i]));
+    });
+    offsets_h(n) = offsets[n];
+
+    SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][generate] Generated " << n_ << " rows, " << nnz_ << " nonzeros\n";
+    return 0;
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::coo_to_csr(const std::vector<std::tuple<int, int, _TYPE_>>& entries, const int n)
+{
+    // Parallel COO -> CSR: check, count, scan, scatter, sort each row
+    const size_t nentries = entries.size();
+    size_t first_invalid = nentries;
+    Kokkos::parallel_reduce("SolverMarket::check_indices", Kokkos::RangePolicy<Host>(0, nentries), [&](const size_t k, size_t& invalid) {
+        const int i = std::get<0>(entries[k]), j = std::get<1>(entries[k]);
+        if ((i >= n || i < 0 || j >= n || j < 0) && k < invalid) invalid = k;
+    }, Kokkos::Min<size_t>(first_invalid));
+    if (first_invalid < nentries) {
+        const int i = std::get<0>(entries[first_invalid]), j = std::get<1>(entries[first_invalid]);
         if (i >= n || i < 0) {
-            std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file] Invalid row index " << i <<std::endl;
+            SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][coo_to_csr] Invalid row index " << i <<std::endl;
             return MtxReaderErrorOutOfBoundRowIndex;
         }
-        if (j >= n || j < 0) {
-            std::cerr << "[Error][SolverMarket][CsrMatrix][read_from_file] Invalid col index " << j <<std::endl;
-            return MtxReaderErrorOutOfBoundColIndex;
-        }
-         offsets_h_(i+1)+=1;
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][coo_to_csr] Invalid col index " << j <<std::endl;
+        return MtxReaderErrorOutOfBoundColIndex;
+    }
+
+    auto offsets = offsets_h_;
+    auto columns = columns_h_;
+    auto values = values_h_;
+    Kokkos::parallel_for("SolverMarket::zero_offsets", Kokkos::RangePolicy<Host>(0, n + 1), [&](const int i) {
+        offsets(i) = 0;
+    });
+    Kokkos::parallel_for("SolverMarket::count_rows", Kokkos::RangePolicy<Host>(0, nentries), [&](const size_t k) {
+        Kokkos::atomic_add(&offsets(std::get<0>(entries[k]) + 1), _ITYPE_(1));
+    });
+    Kokkos::parallel_scan("SolverMarket::scan_rows", Kokkos::RangePolicy<Host>(0, n), [&](const int i, _ITYPE_& update, const bool final) {
+        const _ITYPE_ count = offsets(i + 1);
+        update += count;
+        if (final) offsets(i + 1) = update;
+    });
+    place_entries();
+
+    // Row order is restored by the row sort (column, then value: deterministic duplicates)
+    SolverMarketPooledScratch<int> row_fill_scratch(n);
+    auto& row_fill = row_fill_scratch.get();
+    row_fill.assign(n, 0);
+    Kokkos::parallel_for("SolverMarket::scatter_rows", Kokkos::RangePolicy<Host>(0, nentries), [&](const size_t k) {
+        const auto& [i, j, val] = entries[k];
+        const _ITYPE_ offset = offsets(i) + Kokkos::atomic_fetch_add(&row_fill[i], 1);
+        columns(offset) = j;
+        values(offset) = val;
+    });
+    Kokkos::parallel_for("SolverMarket::sort_rows", Kokkos::RangePolicy<Host>(0, n), [&](const int i) {
+        SolverMarketSortRow(&columns(offsets(i)), &values(offsets(i)), size_t(offsets(i + 1) - offsets(i)));
+    });
+
+    assemble_rows();
+    return 0;
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+bool SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::use_two_pass(const size_t n, const size_t nnz) const
+{
+    if (read_mode_ != SolverMarketReadAuto) return read_mode_ == SolverMarketReadTwoPass;
+    if (host_memory_budget_ == 0) return false;
+
+    // In memory peak: COO entries + row counters + host CSR
+    const size_t csr_bytes = (n + 1) * sizeof(_ITYPE_) + nnz * (sizeof(_ITYPE_) + sizeof(_TYPE_));
+    const size_t in_memory_bytes = nnz * sizeof(std::tuple<int, int, _TYPE_>) + n * sizeof(int) + csr_bytes;
+
+    if (csr_bytes > host_memory_budget_) {
+        SolverMarketLog() << "[Warning][SolverMarket][CsrMatrix][read_from_file] The CSR alone (" << SolverMarketToMB(csr_bytes)
+                  << " MB) exceeds the host memory budget (" << SolverMarketToMB(host_memory_budget_) << " MB)\n";
+    }
+    return in_memory_bytes > host_memory_budget_;
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+template<SolverMarketField _FIELD_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::read_body_two_pass(std::ifstream& file, const _ITYPE_ n, const _ITYPE_ declared_nnz)
+{
+    SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][read_from_file] Two-pass read, CSR allocated from the counted rows\n";
+    const std::streampos body = file.tellg();
+
+    // Offsets only: columns and values are sized from the entries counted below, so a wrong
+    // header fails before anything proportional to its nnz is allocated
+    if (allocate_offsets(n)) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Memory allocation failed\n";
+        return MtxReaderErrorFileMemAllocFailed;
+    }
+    for (_ITYPE_ i=0; i<n+1; i++){
+        offsets_h_(i)=0;
     }
 
-    // Prefix sum for empty rows
-    for (int i = 0; i < n; ++i) {
+    // First pass: count entries per row, check indices and triangles
+    std::atomic<bool> lower_seen(false), upper_seen(false);
+    size_t file_line_count = 0;
+    int parse_status = SolverMarketParseBody(file,
+        [](const size_t, const size_t) {},
+        [&](const char* p, const char* end, const size_t) -> int {
+            if (SolverMarketIsEmptyLine(p, end)) return -1;
+            long long i, j;
+            if (!SolverMarketParseInteger(p, end, i) || !SolverMarketParseInteger(p, end, j)) return MtxReaderErrorInvalidEntry;
+            i -= 1; j -= 1;  // Convert from 1-based to 0-based
+
+            if (i >= n || i < 0) {
+                SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Invalid row index " << i <<std::endl;
+                return MtxReaderErrorOutOfBoundRowIndex;
+            }
+            if (j >= n || j < 0) {
+                SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Invalid col index " << j <<std::endl;
+                return MtxReaderErrorOutOfBoundColIndex;
+            }
+            if (i > j && !lower_seen.load(std::memory_order_relaxed)) lower_seen.store(true, std::memory_order_relaxed);
+            if (i < j && !upper_seen.load(std::memory_order_relaxed)) upper_seen.store(true, std::memory_order_relaxed);
+            Kokkos::atomic_add(&offsets_h_(i + 1), _ITYPE_(1));
+            return 0;
+        },
+        [](const size_t, const size_t) {},
+        file_line_count);
+    if (parse_status) return parse_status;
+    const bool found_lower = lower_seen, found_upper = upper_seen;
+
+    if (file_line_count != size_t(declared_nnz)) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] " << file_line_count << " elements in the mtx file, "
+                  << declared_nnz << " announced in the header\n";
+        return MtxReaderErrorWrongNnz;
+    }
+    if ((found_lower) && (mview_ == SolverMarketCSRMatrixUpper)) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] mview is upper, but lower elements found\n";
+        return MtxReaderErrorUpperViewButLowerFound;
+    }
+    if ((found_upper) && (mview_ == SolverMarketCSRMatrixLower)) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] mview is lower, but upper elements found\n";
+        return MtxReaderErrorLowerViewButUpperFound;
+    }
+    if (!(found_upper && found_lower) && mview_ == SolverMarketCSRMatrixFull) {
+        SolverMarketLog() << "[Warning][SolverMarket][CsrMatrix][read_from_file] mview is full, but only lower or upper elements found\n";
+    }
+
+    // offsets_h_(i+1) becomes the end of row i
+    for (_ITYPE_ i = 0; i < n; ++i) {
         offsets_h_(i + 1) += offsets_h_(i);
     }
+    if (allocate_entries(_ITYPE_(file_line_count))) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][read_from_file] Memory allocation failed\n";
+        return MtxReaderErrorFileMemAllocFailed;
+    }
+    place_entries();
+
+    // Second pass: scatter, offsets_h_(i+1) is used as a decreasing cursor of row i
+    file.clear();
+    file.seekg(body);
+    size_t scattered = 0;
+    parse_status = SolverMarketParseBody(file,
+        [](const size_t, const size_t) {},
+        [&](const char* p, const char* end, const size_t) -> int {
+            if (SolverMarketIsEmptyLine(p, end)) return -1;
+            long long i, j;
+            _TYPE_ val;
+            if (!SolverMarketParseInteger(p, end, i) || !SolverMarketParseInteger(p, end, j) || !SolverMarketEntryValue<_FIELD_, _TYPE_>::parse(p, end, val)) {
+                return MtxReaderErrorInvalidEntry;
+            }
+            const _ITYPE_ k = Kokkos::atomic_fetch_sub(&offsets_h_(i), _ITYPE_(1)) - 1;  // row i-1 in 0-based
+            columns_h_(k) = _ITYPE_(j - 1);
+            values_h_(k) = val;
+            return 0;
+        },
+        [](const size_t, const size_t) {},
+        scattered);
+    if (parse_status) return parse_status;
+
+    // Each cursor stopped at the start of its row: shift back to CSR offsets
+    for (_ITYPE_ i = 0; i < n; ++i) {
+        offsets_h_(i) = offsets_h_(i + 1);
+    }
+    offsets_h_(n) = declared_nnz;
+
+    // Sort columns within each row, in place
+    SolverMarketMemoryRegion assemble_region("assemble");
+    auto offsets = offsets_h_;
+    auto columns = columns_h_;
+    auto values = values_h_;
+    Kokkos::parallel_for("SolverMarket::sort_rows", Kokkos::RangePolicy<Host>(0, n), [&](const int i) {
+        SolverMarketSortRow(&columns(offsets(i)), &values(offsets(i)), size_t(offsets(i + 1) - offsets(i)));
+    });
+
+    assemble_rows();
+    assemble_region.stop();
 
-    // Second pass: fill in column and value arrays
-    std::vector<int> row_fill(n, 0);
-    for (auto& [i, j, val] : entries) {
-        int offset = offsets_h_(i) + row_fill[i];
-        columns_h_(offset) = j;
-        values_h_(offset) = val;
-        row_fill[i]++;
+    report_empty_rows();
+    return 0;
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+void SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::assemble_rows()
+{
+    num_merged_ = num_pruned_ = 0;
+    const bool sum = assembly_.sum_duplicates;
+    const bool drop = assembly_.drop_tolerance >= 0;
+    if (!sum && !drop) return;
+
+    // Rows are sorted: merge runs of equal columns and prune, in place within each row
+    const double tolerance = assembly_.drop_tolerance;
+    const bool keep_diagonal = assembly_.keep_diagonal;
+    auto offsets = offsets_h_;
+    auto columns = columns_h_;
+    auto values = values_h_;
+    SolverMarketPooledScratch<size_t> lengths_scratch(n_);
+    auto& lengths = lengths_scratch.get();
+    lengths.resize(n_);
+
+    size_t merged = 0;
+    Kokkos::parallel_reduce("SolverMarket::assemble_rows", Kokkos::RangePolicy<Host>(0, n_), [&](const size_t i, size_t& row_merged) {
+        const size_t begin = offsets(i), end = offsets(i + 1);
+        size_t out = begin;
+        for (size_t k = begin; k < end;) {
+            const _ITYPE_ c = columns(k);
+            _TYPE_ v = values(k);
+            size_t next = k + 1;
+            if (sum) {
+                for (; next < end && columns(next) == c; next++) v += values(next);
+                row_merged += next - k - 1;
+            }
+            k = next;
+            using std::abs;  /* Kokkos::abs of complex values found by ADL*/
+            if (drop && abs(v) <= tolerance && !(keep_diagonal && size_t(c) == i)) continue;
+            columns(out) = c;
+            values(out) = v;
+            out++;
+        }
+        lengths[i] = out - begin;
+    }, merged);
+
+    // Close the gaps between rows (rows only move to the left: in order)
+    const size_t nnz_before = nnz_;
+    size_t total = 0;
+    for (size_t i = 0; i < size_t(n_); i++) {
+        const size_t begin = offsets(i);
+        if (total != begin) {
+            std::copy(&columns(begin), &columns(begin) + lengths[i], &columns(total));
+            std::copy(&values(begin), &values(begin) + lengths[i], &values(total));
+        }
+        offsets(i) = total;
+        total += lengths[i];
     }
+    offsets(n_) = total;
+
+    // Same buffers, shorter views
+    nnz_ = total;
+    const auto entries = std::make_pair(size_t(0), size_t(nnz_));
+    columns_h_ = Kokkos::subview(columns_h_buffer_, entries);
+    values_h_ = Kokkos::subview(values_h_buffer_, entries);
+    columns_d_ = Kokkos::subview(columns_d_buffer_, entries);
+    values_d_ = Kokkos::subview(values_d_buffer_, entries);
+
+    num_merged_ = merged;
+    num_pruned_ = nnz_before - total - merged;
+    SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][assemble] " << num_merged_ << " duplicate entries merged, " << num_pruned_
+              << " entries pruned (|a_ij| <= " << tolerance << "), nnz " << nnz_before << " -> " << nnz_ << "\n";
+}
 
-    // // Detect empty rows
-    for (int i = 0; i < n; ++i) {
+template<typename _TYPE_, typename _ITYPE_>
+void SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::report_empty_rows()
+{
+    // Detect empty rows (one line, see compute_features for a full report)
+    int empty_rows = 0, first_empty_row = -1;
+    for (int i = 0; i < n_; ++i) {
         if (offsets_h_(i) == offsets_h_(i+1)) {
-            std::cout << "[Warning][SolverMarket][CsrMatrix][read_from_file] Row " << i << " is empty\n";
+            if (empty_rows == 0) first_empty_row = i;
+            empty_rows++;
         }
     }
+    if (empty_rows > 0) {
+        SolverMarketLog() << "[Warning][SolverMarket][CsrMatrix][read_from_file] " << empty_rows << " empty row(s), first one is row " << first_empty_row << "\n";
+    }
+}
 
-    std::cout << "[Info][SolverMarket][CsrMatrix][read_from_file] Read completed with " << nnz << " nonzeros\n";
-    return 0;
-}
\ No newline at end of file
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketCSRMatrix<_TYPE_, _ITYPE_>::write_matrix_market_file(std::string filename, SolverMarketFileFormat format)
+{
+    if (not(is_allocated_)){
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][write_to_file] You want to write a CSR matrix that has not been allocated\n";
+        return MtxWriterErrorNotAllocated;
+    }
+
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][write_to_file] Could not open file " << filename << std::endl;
+        return MtxWriterErrorFileNotOpened;
+    }
+
+    Kokkos::Timer timer;
+    const bool array = (format == SolverMarketFileArray);
+
+    std::string header = std::string("%%MatrixMarket matrix ") + (array ? "array " : "coordinate ")
+                       + SolverMarketFieldName<_TYPE_>() + " " + SolverMarketSymmetryName(mtype_) + "\n";
+    SolverMarketAppendNumber(header, n_);
+    header += " ";
+    SolverMarketAppendNumber(header, n_);
+    if (!array) {
+        header += " ";
+        SolverMarketAppendNumber(header, nnz_);
+    }
+    header += "\n";
+
+    int status = (std::fwrite(header.data(), 1, header.size(), file) == header.size()) ? MtxWriterSuccess : MtxWriterErrorWriteFailed;
+
+    // Blocks of ~256k entries, a few MB of text each
+    const size_t block_entries = size_t(1) << 18;
+    auto offsets = offsets_h_;
+    auto columns = columns_h_;
+    auto values = values_h_;
+
+    if (status == MtxWriterSuccess && !array) {
+        // Symmetric-like matrices are written as the lower triangle the format requires: an upper
+        // entry (read with mview Upper) is swapped, with its sign or conjugate
+        const bool lower = mtype_ != SolverMarketCSRMatrixGeneral;
+        const size_t block_rows = std::max<size_t>(1, size_t(n_) * block_entries / std::max<size_t>(1, size_t(nnz_)));
+        status = SolverMarketWriteBlocks(file, n_, block_rows, [&](const size_t begin, const size_t end, std::string& buffer) {
+            buffer.reserve(32 * size_t(offsets(end) - offsets(begin)));
+            for (size_t i = begin; i < end; i++) {
+                for (size_t k = offsets(i); k < size_t(offsets(i + 1)); k++) {
+                    size_t r = i, c = columns(k);
+                    _TYPE_ v = values(k);
+                    if (lower && r < c) {
+                        std::swap(r, c);
+                        if (isSkewSymmetric()) v = -v;
+                        if (isHermitian()) v = SolverMarketConjugate(v);
+                    }
+                    SolverMarketAppendNumber(buffer, r + 1);
+                    buffer += ' ';
+                    SolverMarketAppendNumber(buffer, c + 1);
+                    buffer += ' ';
+                    SolverMarketAppendNumber(buffer, v);
+                    buffer += '\n';
+                }
+            }
+        });
+    }
+
+    if (status == MtxWriterSuccess && array) {
+        // Array format is column major: transpose once (counting sort) so a block of
+        // columns is contiguous. Symmetric-like matrices only keep the lower triangle
+        // (strictly lower for skew-symmetric), upper entries are folded with their sign or conjugate.
+        std::vector<size_t> col_offsets(size_t(n_) + 1, 0);
+        std::vector<_ITYPE_> rows(nnz_);
+        std::vector<_TYPE_> vals(nnz_);
+        const bool lower = mtype_ != SolverMarketCSRMatrixGeneral;
+        const size_t diagonal_skip = isSkewSymmetric() ? 1 : 0;
+
+        for (size_t i = 0; i < size_t(n_); i++) {
+            for (size_t k = offsets(i); k < size_t(offsets(i + 1)); k++) {
+                size_t c = columns(k);
+                if (lower) c = std::min<size_t>(i, c);
+                col_offsets[c + 1]++;
+            }
+        }
+        for (size_t c = 0; c < size_t(n_); c++) col_offsets[c + 1] += col_offsets[c];
+        std::vector<size_t> col_fill(col_offsets.begin(), col_offsets.end() - 1);
+        for (size_t i = 0; i < size_t(n_); i++) {
+            for (size_t k = offsets(i); k < size_t(offsets(i + 1)); k++) {
+                size_t r = i, c = columns(k);
+                _TYPE_ v = values(k);
+                if (lower && r < c) {
+                    std::swap(r, c);
+                    if (isSkewSymmetric()) v = -v;
+                    if (isHermitian()) v = SolverMarketConjugate(v);
+                }
+                rows[col_fill[c]] = r;
+                vals[col_fill[c]] = v;
+                col_fill[c]++;
+            }
+        }
+
+        const size_t block_cols = std::max<size_t>(1, block_entries / std::max<size_t>(1, size_t(n_)));
+        status = SolverMarketWriteBlocks(file, n_, block_cols, [&](const size_t begin, const size_t end, std::string& buffer) {
+            std::vector<_TYPE_> dense(n_);
+            buffer.reserve(24 * size_t(n_) * (end - begin));
+            for (size_t c = begin; c < end; c++) {
+                std::fill(dense.begin(), dense.end(), _TYPE_(0));
+                for (size_t k = col_offsets[c]; k < col_offsets[c + 1]; k++) {
+                    dense[rows[k]] += vals[k]; /* duplicates are summed*/
+                }
+                for (size_t r = (lower ? c + diagonal_skip : 0); r < size_t(n_); r++) {
+                    SolverMarketAppendNumber(buffer, dense[r]);
+                    buffer += '\n';
+                }
+            }
+        });
+    }
+
+    if (std::fclose(file) != 0 && status == MtxWriterSuccess) {
+        status = MtxWriterErrorWriteFailed;
+    }
+
+    if (status != MtxWriterSuccess) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][CsrMatrix][write_to_file] Write failed for file " << filename << std::endl;
+        return status;
+    }
+
+    SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][write_to_file] Wrote " << nnz_ << " nonzeros to " << filename
+              << " in " << timer.seconds() * 1000 << " ms\n";
+    return MtxWriterSuccess;
+}
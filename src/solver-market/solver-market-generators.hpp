@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "solver-market-csr-matrix.hpp"
+
+#pragma once
+
+/* In-memory test matrices: SolverMarketCSRMatrix filled directly (and in parallel) from a spec
+string, no .mtx file. Every deck takes it as --generate=<spec> instead of --matrix=<file>.
+
+  <name>:<key>=<value>,<key>=<value>,...     n=<m> sets every grid dimension (nx, ny, nz)
+
+  laplace2d      nx, ny                         5-point Laplacian, Dirichlet
+  laplace3d      nx, ny, nz                     7-point Laplacian, Dirichlet
+  laplace3d27    nx, ny, nz                     27-point Laplacian (26 on the diagonal), Dirichlet
+  anisotropic2d  nx, ny, eps (1e-3)             -eps u_xx - u_yy, 5-point, Dirichlet
+  jump3d         nx, ny, nz, contrast (1e6),    7-point -div(k grad u), k = contrast on a checkerboard of
+                 blocks (4)                     blocks^3 boxes and 1 elsewhere, harmonic face means
+  elasticity2d   nx, ny, poisson (0.3)          2 dofs per node (interleaved), 9-point spring network
+  elasticity3d   nx, ny, nz, poisson (0.3)      3 dofs per node (interleaved), 27-point spring network
+  randomspd      n, row_nnz (8), skew (0),      random symmetric pattern, diagonally dominant; row lengths
+                 seed (1)                       follow a Pareto tail, skew in [0, 1) (0: all alike)
+
+Every matrix is symmetric positive definite, stored in full (both triangles) with sorted rows. It is
+tagged general: a symmetric tag would mean one stored triangle to the writers.
+Examples: laplace3d:n=128   anisotropic2d:nx=2000,ny=500,eps=1e-4   randomspd:n=1000000,row_nnz=16,skew=0.6 */
+
+enum SolverMarketGeneratorStatus {
+    SolverMarketGeneratorSuccess,
+    SolverMarketGeneratorErrorSpec,       /* not <name>:<key>=<value>,...*/
+    SolverMarketGeneratorErrorUnknown,    /* no generator of that name*/
+    SolverMarketGeneratorErrorParameter,  /* unknown key or value out of range*/
+    SolverMarketGeneratorErrorBuild       /* CSR allocation/assembly failed*/
+};
+
+struct SolverMarketGeneratorSpec {
+    std::string name;
+    std::map<std::string, std::string> parameters;
+
+    // Parameter as a number, fallback if absent; a value that is not a number is an error
+    int get(const std::string& key, double fallback, double& value) const {
+        auto it = parameters.find(key);
+        if (it == parameters.end()) {
+            value = fallback;
+            return 0;
+        }
+        std::istringstream in(it->second);
+        return ((in >> value) && in.eof()) ? 0 : 1;
+    }
+};
+
+inline int SolverMarketParseGeneratorSpec(const std::string& text, SolverMarketGeneratorSpec& spec)
+{
+    spec = SolverMarketGeneratorSpec();
+    const auto colon = text.find(':');
+    spec.name = text.substr(0, colon);
+    if (spec.name.empty()) return SolverMarketGeneratorErrorSpec;
+    if (colon == std::string::npos) return SolverMarketGeneratorSuccess;
+
+    std::istringstream list(text.substr(colon + 1));
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        if (item.empty()) continue;
+        const auto eq = item.find('=');
+        if (eq == std::string::npos || eq == 0 || eq + 1 == item.size()) return SolverMarketGeneratorErrorSpec;
+        spec.parameters[item.substr(0, eq)] = item.substr(eq + 1);
+    }
+    return SolverMarketGeneratorSuccess;
+}
+
+// Grid point (x, y, z) <-> row, x fastest
+struct SolverMarketGrid {
+    int nx = 1, ny = 1, nz = 1;
+
+    int size() const { return nx * ny * nz; }
+    int index(const int x, const int y, const int z) const { return x + nx * (y + ny * z); }
+    void point(const int i, int& x, int& y, int& z) const {
+        x = i % nx;
+        y = (i / nx) % ny;
+        z = i / (nx * ny);
+    }
+    bool inside(const int x, const int y, const int z) const {
+        return x >= 0 && x < nx && y >= 0 && y < ny && z >= 0 && z < nz;
+    }
+};
+
+// Symmetric stencil on a grid with Dirichlet boundaries: the diagonal keeps the couplings to the
+// points outside, so every row is the same operator and the matrix is SPD
+template <typename _TYPE_, typename _ITYPE_, typename _WEIGHT_>
+int SolverMarketGenerateStencil(const SolverMarketGrid& grid, const int reach_z, const bool full_box,
+                                _WEIGHT_ weight, SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& matrix)
+{
+    return matrix.generate(_ITYPE_(grid.size()), [&](const _ITYPE_ i, auto&& emit) {
+        int x, y, z;
+        grid.point(int(i), x, y, z);
+        _TYPE_ diagonal = 0;
+        for (int dz = -reach_z; dz <= reach_z; dz++)
+            for (int dy = -1; dy <= 1; dy++)
+                for (int dx = -1; dx <= 1; dx++) {
+                    const int distance = std::abs(dx) + std::abs(dy) + std::abs(dz);
+                    if (distance == 0 || (!full_box && distance > 1)) continue;
+                    const _TYPE_ w = weight(x, y, z, dx, dy, dz);
+                    diagonal += w;
+                    if (grid.inside(x + dx, y + dy, z + dz)) emit(_ITYPE_(grid.index(x + dx, y + dy, z + dz)), -w);
+                }
+        emit(i, diagonal);
+    }, SolverMarketCSRMatrixGeneral);
+}
+
+// Spring network: node a and its neighbour at offset d (unit vector e = d/|d|) are tied by the block
+// K = (mu I + (lambda + mu) e e^T) / |d|^2, lambda = 2 nu / (1 - 2 nu), mu = 1. Springs to the points outside
+// the grid are clamped (diagonal only), which makes the matrix SPD. Row = node * dim + component
+template <typename _TYPE_, typename _ITYPE_>
+int SolverMarketGenerateElasticity(const SolverMarketGrid& grid, const int dim, const double poisson,
+                                   SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& matrix)
+{
+    const double mu = 1.0, lambda = 2.0 * poisson / (1.0 - 2.0 * poisson);
+    const int reach_z = (dim == 3) ? 1 : 0;
+    auto block = [=](const int dx, const int dy, const int dz, const int a, const int b) {
+        const double d[3] = {double(dx), double(dy), double(dz)};
+        const double length2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        return ((a == b ? mu : 0.0) + (lambda + mu) * d[a] * d[b] / length2) / length2;
+    };
+
+    return matrix.generate(_ITYPE_(grid.size()) * dim, [&](const _ITYPE_ row, auto&& emit) {
+        const int node = int(row / dim), a = int(row % dim);
+        int x, y, z;
+        grid.point(node, x, y, z);
+        double diagonal = 0;
+        for (int dz = -reach_z; dz <= reach_z; dz++)
+            for (int dy = -1; dy <= 1; dy++)
+                for (int dx = -1; dx <= 1; dx++) {
+                    if (dx == 0 && dy == 0 && dz == 0) continue;
+                    const bool inside = grid.inside(x + dx, y + dy, z + dz);
+                    const _ITYPE_ neighbour = _ITYPE_(grid.index(x + dx, y + dy, z + dz)) * dim;
+                    for (int b = 0; b < dim; b++) {
+                        const double k = block(dx, dy, dz, a, b);
+                        if (b == a) diagonal += k;
+                        if (inside && k != 0.0) emit(neighbour + b, _TYPE_(-k));
+                    }
+                }
+        // d_a d_b (a != b) changes sign when d is mirrored along axis a, and the neighbourhood (clamped
+        // springs included) is mirror symmetric: those terms sum to zero, the diagonal block is diagonal
+        emit(row, _TYPE_(diagonal));
+    }, SolverMarketCSRMatrixGeneral);
+}
+
+inline uint64_t SolverMarketSplitMix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Counter based stream, one per row: cheap to start, unlike a seeded std::mt19937_64
+struct SolverMarketRandomStream {
+    uint64_t state;
+
+    uint64_t next() { return SolverMarketSplitMix64(state++); }
+    double uniform() { return double(next() >> 11) * 0x1.0p-53; }  /* [0, 1)*/
+    int below(const int m) { return int((next() >> 32) * uint64_t(m) >> 32); }  /* [0, m)*/
+};
+
+// Row i draws k_i partners, k_i = (row_nnz - 1) / 2 (1 - skew) u^-skew (mean (row_nnz - 1) / 2 whatever the
+// skew), each pair is stored in both triangles. Duplicates are summed, then a_ii = 1 + sum_j |a_ij|.
+// One random stream per row: the matrix only depends on the seed, not on the thread count
+template <typename _TYPE_, typename _ITYPE_>
+int SolverMarketGenerateRandomSPD(const int n, const double row_nnz, const double skew, const uint64_t seed,
+                                  SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& matrix)
+{
+    const double mean_partners = std::max(0.0, (row_nnz - 1.0) / 2.0) * (1.0 - skew);
+    auto partners = [&](const int i, SolverMarketRandomStream& rng) {
+        rng.state = SolverMarketSplitMix64(seed ^ SolverMarketSplitMix64(uint64_t(i)));
+        const double u = 1.0 - rng.uniform();  /* (0, 1]*/
+        // u^-skew grows without bound as u -> 0 for skew near 1: clamped before the int conversion
+        const double target = std::min(mean_partners * std::pow(u, -skew), double(n));
+        int k = int(target);
+        if (rng.uniform() < target - k) k++;
+        return std::min(k, n - 1);
+    };
+
+    // Slot of each row in the COO: its diagonal plus 2 entries per partner
+    std::vector<size_t> slots(size_t(n) + 1, 0);
+    Kokkos::parallel_for("SolverMarket::randomspd_count", Kokkos::RangePolicy<Host>(0, n), [&](const int i) {
+        SolverMarketRandomStream rng;
+        slots[i + 1] = 1 + 2 * size_t(partners(i, rng));
+    });
+    for (size_t i = 0; i < size_t(n); i++) slots[i + 1] += slots[i];
+    if (slots[n] > size_t(std::numeric_limits<_ITYPE_>::max())) {
+        std::cerr << "[Error][SolverMarket][Generator] randomspd draws " << slots[n] << " entries, more than the index type holds" << std::endl;
+        return MtxReaderErrorWrongNnz;
+    }
+
+    std::vector<std::tuple<int, int, _TYPE_>> entries(slots[n]);
+    Kokkos::parallel_for("SolverMarket::randomspd_fill", Kokkos::RangePolicy<Host>(0, n), [&](const int i) {
+        SolverMarketRandomStream rng;
+        const int k = partners(i, rng);
+        size_t slot = slots[i];
+        entries[slot++] = {i, i, _TYPE_(0)};
+        for (int p = 0; p < k; p++) {
+            int j = rng.below(n - 1);
+            if (j >= i) j++;  /* never the diagonal*/
+            const _TYPE_ v = _TYPE_(-(0.1 + 0.9 * rng.uniform()));
+            entries[slot++] = {i, j, v};
+            entries[slot++] = {j, i, v};
+        }
+    });
+
+    const SolverMarketAssemblyOptions assembly = matrix.getAssemblyOptions();
+    SolverMarketAssemblyOptions summed;
+    summed.sum_duplicates = true;
+    matrix.setAssemblyOptions(summed);
+    const int status = matrix.build_from_coo(_ITYPE_(n), entries, SolverMarketCSRMatrixFull, SolverMarketCSRMatrixGeneral);
+    matrix.setAssemblyOptions(assembly);
+    if (status) return status;
+
+    _ITYPE_* offsets = matrix.get_host_offsets_pointer();
+    _ITYPE_* columns = matrix.get_host_columns_pointer();
+    _TYPE_* values = matrix.get_host_values_pointer();
+    Kokkos::parallel_for("SolverMarket::randomspd_diagonal", Kokkos::RangePolicy<Host>(0, n), [&](const int i) {
+        _TYPE_ sum = 1;
+        _ITYPE_ diagonal = offsets[i];
+        for (_ITYPE_ k = offsets[i]; k < offsets[i + 1]; k++) {
+            if (columns[k] == _ITYPE_(i)) diagonal = k;
+            else sum += std::abs(values[k]);
+        }
+        values[diagonal] = sum;
+    });
+    return 0;
+}
+
+// Fill `matrix` from a spec (see the top of this file). Host CSR only, call send_to_device() after
+template <typename _TYPE_, typename _ITYPE_>
+int SolverMarketGenerate(const std::string& text, SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& matrix)
+{
+    SolverMarketGeneratorSpec spec;
+    if (SolverMarketParseGeneratorSpec(text, spec)) {
+        std::cerr << "[Error][SolverMarket][Generator] Bad spec " << text << ", expected <name>:<key>=<value>,..." << std::endl;
+        return SolverMarketGeneratorErrorSpec;
+    }
+
+    // Rows per grid point and largest row length bound the size before anything is allocated
+    struct Generator {
+        std::vector<std::string> keys;
+        int dimensions;
+        int rows_per_point;
+        int row_entries;
+    };
+    const std::map<std::string, Generator> generators = {
+        {"laplace2d", {{"nx", "ny"}, 2, 1, 5}},
+        {"laplace3d", {{"nx", "ny", "nz"}, 3, 1, 7}},
+        {"laplace3d27", {{"nx", "ny", "nz"}, 3, 1, 27}},
+        {"anisotropic2d", {{"nx", "ny", "eps"}, 2, 1, 5}},
+        {"jump3d", {{"nx", "ny", "nz", "contrast", "blocks"}, 3, 1, 7}},
+        {"elasticity2d", {{"nx", "ny", "poisson"}, 2, 2, 2 * 9}},
+        {"elasticity3d", {{"nx", "ny", "nz", "poisson"}, 3, 3, 3 * 27}},
+        {"randomspd", {{"n", "row_nnz", "skew", "seed"}, 0, 1, 0}},  /* random row lengths: its COO size is checked*/
+    };
+    auto generator = generators.find(spec.name);
+    if (generator == generators.end()) {
+        std::cerr << "[Error][SolverMarket][Generator] Unknown generator " << spec.name << ", one of:";
+        for (const auto& g : generators) std::cerr << " " << g.first;
+        std::cerr << std::endl;
+        return SolverMarketGeneratorErrorUnknown;
+    }
+
+    // n= is shorthand for every grid dimension, an explicit nx/ny/nz wins
+    const auto& keys = generator->second.keys;
+    for (const auto& parameter : spec.parameters) {
+        const bool grid_shorthand = (parameter.first == "n" && generator->second.dimensions > 0);
+        if (!grid_shorthand && std::find(keys.begin(), keys.end(), parameter.first) == keys.end()) {
+            std::cerr << "[Error][SolverMarket][Generator] " << spec.name << " has no parameter " << parameter.first << std::endl;
+            return SolverMarketGeneratorErrorParameter;
+        }
+    }
+
+    double n, nx, ny, nz, value1, value2, value3;
+    SolverMarketGrid grid;
+    const int dimensions = generator->second.dimensions;
+    auto integer = [](const double value) { return value == std::floor(value); };
+    if (spec.get("n", 32, n) || spec.get("nx", n, nx) || spec.get("ny", n, ny) || spec.get("nz", dimensions == 3 ? n : 1, nz) ||
+        (dimensions > 0 && (nx < 1 || ny < 1 || nz < 1 || !integer(nx) || !integer(ny) || !integer(nz) ||
+                            nx * ny * nz * generator->second.rows_per_point > double(std::numeric_limits<int>::max()) ||
+                            nx * ny * nz * generator->second.rows_per_point * generator->second.row_entries >
+                                double(std::numeric_limits<_ITYPE_>::max())))) {
+        std::cerr << "[Error][SolverMarket][Generator] Grid dimensions must be integers >= 1 (and fit the index type)" << std::endl;
+        return SolverMarketGeneratorErrorParameter;
+    }
+    grid.nx = int(nx);
+    grid.ny = int(ny);
+    grid.nz = int(nz);
+
+    std::cout << "[Info][SolverMarket][Generator] Generating " << text << std::endl;
+    int status = SolverMarketGeneratorSuccess;
+    const std::string& name = spec.name;
+    if (name == "laplace2d" || name == "laplace3d" || name == "laplace3d27") {
+        status = SolverMarketGenerateStencil(grid, name == "laplace2d" ? 0 : 1, name == "laplace3d27",
+                                             [](int, int, int, int, int, int) { return _TYPE_(1); }, matrix);
+    } else if (name == "anisotropic2d") {
+        if (spec.get("eps", 1e-3, value1) || value1 <= 0) {
+            std::cerr << "[Error][SolverMarket][Generator] eps must be > 0" << std::endl;
+            return SolverMarketGeneratorErrorParameter;
+        }
+        const _TYPE_ eps = _TYPE_(value1);
+        status = SolverMarketGenerateStencil(grid, 0, false,
+                                             [=](int, int, int, int dx, int, int) { return dx ? eps : _TYPE_(1); }, matrix);
+    } else if (name == "jump3d") {
+        if (spec.get("contrast", 1e6, value1) || spec.get("blocks", 4, value2) || value1 <= 0 || value2 < 1 || !integer(value2)) {
+            std::cerr << "[Error][SolverMarket][Generator] jump3d needs contrast > 0, integer blocks >= 1" << std::endl;
+            return SolverMarketGeneratorErrorParameter;
+        }
+        const double contrast = value1;
+        const int blocks = int(value2);
+        auto k = [=, &grid](const int x, const int y, const int z) {
+            const int bx = x * blocks / grid.nx, by = y * blocks / grid.ny, bz = z * blocks / grid.nz;
+            return ((bx + by + bz) % 2) ? contrast : 1.0;
+        };
+        status = SolverMarketGenerateStencil(grid, 1, false, [&](int x, int y, int z, int dx, int dy, int dz) {
+            const double ka = k(x, y, z);
+            if (!grid.inside(x + dx, y + dy, z + dz)) return _TYPE_(ka);
+            const double kb = k(x + dx, y + dy, z + dz);
+            return _TYPE_(2.0 * ka * kb / (ka + kb));
+        }, matrix);
+    } else if (name == "elasticity2d" || name == "elasticity3d") {
+        if (spec.get("poisson", 0.3, value1) || value1 < 0 || value1 >= 0.5) {
+            std::cerr << "[Error][SolverMarket][Generator] poisson must be in [0, 0.5)" << std::endl;
+            return SolverMarketGeneratorErrorParameter;
+        }
+        status = SolverMarketGenerateElasticity(grid, name == "elasticity2d" ? 2 : 3, value1, matrix);
+    } else if (name == "randomspd") {
+        if (spec.get("n", 1000, n) || spec.get("row_nnz", 8, value1) || spec.get("skew", 0, value2) || spec.get("seed", 1, value3) ||
+            n < 2 || n > double(std::numeric_limits<int>::max()) || !integer(n) || value1 < 1 || value2 < 0 || value2 >= 1) {
+            std::cerr << "[Error][SolverMarket][Generator] randomspd needs an integer n >= 2, row_nnz >= 1, 0 <= skew < 1" << std::endl;
+            return SolverMarketGeneratorErrorParameter;
+        }
+        status = SolverMarketGenerateRandomSPD(int(n), value1, value2, uint64_t(value3), matrix);
+    }
+    return status ? SolverMarketGeneratorErrorBuild : SolverMarketGeneratorSuccess;
+}
@@ -1,5 +1,7 @@
 #include <Kokkos_Core.hpp>
 
+#include "solver-market-log.hpp"
+
 #pragma once 
 
 using Device = Kokkos::DefaultExecutionSpace;
@@ -15,6 +17,13 @@ using HostView=Kokkos::View<_TYPE_*, Host>;
 template<typename _TYPE_>
 using DeviceView=Kokkos::View<_TYPE_*, Device>;
 
+// One vector per row, each row contiguous (batched systems, Krylov bases)
+template<typename _TYPE_>
+using DeviceBatchView=Kokkos::View<_TYPE_**, Kokkos::LayoutRight, Device>;
+
+template<typename _TYPE_>
+using HostBatchView=Kokkos::View<_TYPE_**, Kokkos::LayoutRight, Host>;
+
 enum MtxReaderStatus {
     MtxReaderSuccess,
     MtxReaderErrorFileNotFound,
@@ -28,5 +37,26 @@ enum MtxReaderStatus {
     MtxReaderUnsupportedMatrixType,
     MtxReaderTypeReadIsNotTypeGiven,
     MtxReaderNotAVector,
-    MtxReaderWrongHeaderOrNoHeader
-};
\ No newline at end of file
+    MtxReaderWrongHeaderOrNoHeader,
+    MtxReaderErrorInvalidEntry,
+    MtxReaderUnsupportedField,
+    MtxReaderErrorInvalidSize    /* size line unreadable, not square, or beyond the index type*/
+};
+
+enum MtxWriterStatus {
+    MtxWriterSuccess,
+    MtxWriterErrorFileNotOpened,
+    MtxWriterErrorNotAllocated,
+    MtxWriterErrorWriteFailed
+};
+
+enum SolverMarketFileFormat {
+    SolverMarketFileCoordinate, /* i j value, stored entries only*/
+    SolverMarketFileArray       /* dense, column major*/
+};
+
+enum SolverMarketReadMode {
+    SolverMarketReadAuto,     /* in memory, two pass if the host memory budget would be exceeded*/
+    SolverMarketReadInMemory, /* COO entries, sort, CSR: fastest, ~3x the CSR at peak*/
+    SolverMarketReadTwoPass   /* count per row, then scatter into the CSR: peak ~ the CSR*/
+};
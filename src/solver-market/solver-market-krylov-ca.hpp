@@ -0,0 +1,436 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "solver-market-krylov.hpp"
+
+#pragma once
+
+/* Communication reducing variants of the preconditioned conjugate gradient, same interface as
+SolverMarketPCG. Every dot product of a Krylov method is a global reduction: a fence and a
+device to host copy on one node, an allreduce across ranks. SolverMarketPCG pays three per
+iteration.
+
+SolverMarketPipelinedCG (Ghysels and Vanroose) pays one. The three dot products of an iteration
+are fused into the kernel of its vector updates, reduced into a device View without waiting,
+and read back only after the preconditioner and the SpMV of the next iteration are launched.
+It keeps four more vectors than CG and applies M and A to w instead of p.
+
+SolverMarketSStepCG (Chronopoulos and Gear) pays one per s iterations. Each outer step builds a
+basis of s vectors of the Krylov space of M A from the residual (a Chebyshev basis on
+[0, 1.1 lambda_max(M A)], better conditioned than the monomial one), makes it A-conjugate to the
+previous block and updates x along all s directions. All inner products of the step come from a
+single block reduction, the s x s systems are solved on the host.
+
+Both update the residual recursively and drift from b - A x in finite precision, more than CG
+does. The true residual replaces it, and the method restarts from x, when the recursive residual
+reaches the tolerance or drops by SolverMarketReplacementDrop from its peak since the last
+replacement (before the drift grows). Convergence is declared on a true residual only. A rank
+deficient s-step basis (large s, ill conditioned M A), or a recursive residual that stopped
+decreasing at the accuracy the basis allows, halves s and restarts. The iterations of
+SolverMarketSStepCG are a multiple of s. */
+
+constexpr double SolverMarketReplacementDrop = 1e-8;  /* residual replacement once the residual lost this factor*/
+constexpr int SolverMarketSStepMax = 8;               /* largest s, bounds the per row arrays of the kernels*/
+constexpr double SolverMarketSStepPivotTolerance = 1e-12; /* relative pivot of P^T A P under which the basis is rank deficient*/
+constexpr int SolverMarketSStepStallSteps = 4;         /* outer steps without progress before s is halved*/
+constexpr int SolverMarketSStepPowerIterations = 5;    /* lambda_max(M A) estimate of the Chebyshev basis*/
+
+// Vector updates of a pipelined CG iteration fused with the dot products (r, u), (w, u), (r, r) of the next
+// one. update = false: dot products only (start, residual replacement)
+template <typename _TYPE_>
+struct SolverMarketPipelinedCGStep {
+  using value_type = _TYPE_[];
+  const unsigned value_count = 3;
+  DeviceView<_TYPE_> x, r, u, w, m, am, z, q, s, p;  /* m = M w, am = A m*/
+  _TYPE_ alpha = 0, beta = 0;
+  bool update = true;
+
+  KOKKOS_INLINE_FUNCTION void operator()(const size_t i, value_type sums) const {
+    if (update) {
+      const _TYPE_ z_i = am(i) + beta * z(i);
+      const _TYPE_ q_i = m(i) + beta * q(i);
+      const _TYPE_ s_i = w(i) + beta * s(i);
+      const _TYPE_ p_i = u(i) + beta * p(i);
+      z(i) = z_i;
+      q(i) = q_i;
+      s(i) = s_i;
+      p(i) = p_i;
+      x(i) += alpha * p_i;
+      r(i) -= alpha * s_i;
+      u(i) -= alpha * q_i;
+      w(i) -= alpha * z_i;
+    }
+    sums[0] += r(i) * u(i);
+    sums[1] += w(i) * u(i);
+    sums[2] += r(i) * r(i);
+  }
+
+  KOKKOS_INLINE_FUNCTION void init(value_type sums) const {
+    for (unsigned k = 0; k < value_count; k++) sums[k] = 0;
+  }
+
+  KOKKOS_INLINE_FUNCTION void join(value_type sums, const value_type other) const {
+    for (unsigned k = 0; k < value_count; k++) sums[k] += other[k];
+  }
+};
+
+// Preconditioned pipelined CG, x holds the initial guess. Relative residual criterion
+template <typename _MATRIX_, typename _TYPE_, typename _PRECONDITIONER_>
+SolverMarketKrylovResult SolverMarketPipelinedCG(const _MATRIX_& A, const DeviceView<_TYPE_>& b,
+                                                 const DeviceView<_TYPE_>& x, _PRECONDITIONER_& M,
+                                                 const double tolerance, const int max_iterations) {
+  SolverMarketKrylovResult result;
+  const size_t n = A.n_rows;
+  SolverMarketPipelinedCGStep<_TYPE_> step;
+  step.x = x;
+  step.r = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::pipelined_cg_r"), n);
+  step.u = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::pipelined_cg_u"), n);
+  step.w = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::pipelined_cg_w"), n);
+  step.m = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::pipelined_cg_m"), n);
+  step.am = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::pipelined_cg_am"), n);
+  /* multiplied by beta = 0 at the first iteration: must not hold NaNs*/
+  step.z = DeviceView<_TYPE_>("SolverMarket::pipelined_cg_z", n);
+  step.q = DeviceView<_TYPE_>("SolverMarket::pipelined_cg_q", n);
+  step.s = DeviceView<_TYPE_>("SolverMarket::pipelined_cg_s", n);
+  step.p = DeviceView<_TYPE_>("SolverMarket::pipelined_cg_p", n);
+  DeviceView<_TYPE_> dots("SolverMarket::pipelined_cg_dots", 3);
+  auto host_dots = Kokkos::create_mirror_view(dots);
+
+  double norm_b = std::sqrt(double(SolverMarketDot(b, b)));
+  result.reductions++;
+  if (norm_b == 0) norm_b = 1;
+
+  // r = b - A x, u = M r, w = A u and their dot products, reduced without waiting
+  auto restart = [&]() {
+    SolverMarketResidual(A, x, b, step.r);
+    M(step.r, step.u);
+    SolverMarketSpMV(A, step.u, step.w);
+    step.update = false;
+    Kokkos::parallel_reduce("SolverMarket::pipelined_cg_dots", Kokkos::RangePolicy<Device>(0, n), step, dots);
+  };
+  restart();
+  bool fresh = true;   /* the dot products in flight are those of the true residual*/
+
+  _TYPE_ alpha = 0, gamma_old = 0;
+  double peak = 0;     /* largest residual since the last replacement*/
+  for (int it = 0;; it++) {
+    // Overlapped with the reduction in flight
+    M(step.w, step.m);
+    SolverMarketSpMV(A, step.m, step.am);
+
+    Kokkos::deep_copy(host_dots, dots);
+    result.reductions++;
+    const _TYPE_ gamma = host_dots(0), delta = host_dots(1);
+    result.residual = std::sqrt(double(host_dots(2))) / norm_b;
+    peak = std::max(peak, result.residual);
+    if ((result.residual <= tolerance || result.residual <= SolverMarketReplacementDrop * peak) && !fresh) {
+      // Residual replacement
+      restart();
+      fresh = true;
+      peak = 0;
+      gamma_old = 0;
+      it--;
+      continue;
+    }
+    if (result.residual <= tolerance) {
+      result.converged = true;
+      break;
+    }
+    if (it == max_iterations) break;
+
+    const _TYPE_ beta = (gamma_old != _TYPE_(0)) ? gamma / gamma_old : _TYPE_(0);
+    const _TYPE_ denominator = (gamma_old != _TYPE_(0)) ? delta - beta * gamma / alpha : delta;
+    if (denominator == _TYPE_(0)) break;  /* breakdown*/
+    alpha = gamma / denominator;
+    gamma_old = gamma;
+
+    step.alpha = alpha;
+    step.beta = beta;
+    step.update = true;
+    Kokkos::parallel_reduce("SolverMarket::pipelined_cg_step", Kokkos::RangePolicy<Device>(0, n), step, dots);
+    fresh = false;
+    result.iterations = it + 1;
+  }
+  return result;
+}
+
+// Inner products of an s-step CG outer step, in one reduction:
+// C = (A P_prev)^T V (s x s, zero without a previous block), G = V^T W (s x s), V^T r (s), r^T r
+template <typename _TYPE_>
+struct SolverMarketSStepGram {
+  using value_type = _TYPE_[];
+  unsigned value_count;
+  int s;
+  bool has_previous;
+  DeviceBatchView<_TYPE_> V, W, AP;  /* W = A V, AP = A P_prev*/
+  DeviceView<_TYPE_> r;
+
+  SolverMarketSStepGram(const int s, const bool has_previous, const DeviceBatchView<_TYPE_>& V, const DeviceBatchView<_TYPE_>& W,
+                        const DeviceBatchView<_TYPE_>& AP, const DeviceView<_TYPE_>& r)
+      : value_count(unsigned(2 * s * s + s + 1)), s(s), has_previous(has_previous), V(V), W(W), AP(AP), r(r) {}
+
+  KOKKOS_INLINE_FUNCTION void operator()(const size_t i, value_type sums) const {
+    _TYPE_ v[SolverMarketSStepMax];
+    for (int j = 0; j < s; j++) v[j] = V(j, i);
+    if (has_previous) {
+      for (int l = 0; l < s; l++) {
+        const _TYPE_ ap = AP(l, i);
+        for (int j = 0; j < s; j++) sums[l * s + j] += ap * v[j];
+      }
+    }
+    for (int j = 0; j < s; j++) {
+      const _TYPE_ w = W(j, i);
+      for (int k = 0; k < s; k++) sums[s * s + k * s + j] += v[k] * w;
+    }
+    const _TYPE_ r_i = r(i);
+    for (int j = 0; j < s; j++) sums[2 * s * s + j] += v[j] * r_i;
+    sums[2 * s * s + s] += r_i * r_i;
+  }
+
+  KOKKOS_INLINE_FUNCTION void init(value_type sums) const {
+    for (unsigned k = 0; k < value_count; k++) sums[k] = 0;
+  }
+
+  KOKKOS_INLINE_FUNCTION void join(value_type sums, const value_type other) const {
+    for (unsigned k = 0; k < value_count; k++) sums[k] += other[k];
+  }
+};
+
+// Coefficients of an s-step CG update, captured by value by the kernel
+template <typename _TYPE_>
+struct SolverMarketSStepCoefficients {
+  _TYPE_ B[SolverMarketSStepMax * SolverMarketSStepMax];  /* B(l, j) = B[l * s + j], P = V - P_prev B*/
+  _TYPE_ a[SolverMarketSStepMax];                         /* x += P a*/
+};
+
+// In place Cholesky factor (lower, row major) of a small s x s SPD matrix. False if not numerically positive
+// definite: a pivot below pivot_tolerance times its diagonal entry
+inline bool SolverMarketSmallCholesky(std::vector<double>& L, const int s, const double pivot_tolerance = 0) {
+  for (int j = 0; j < s; j++) {
+    double d = L[j * s + j];
+    for (int k = 0; k < j; k++) d -= L[j * s + k] * L[j * s + k];
+    if (!(d > pivot_tolerance * L[j * s + j])) return false;
+    L[j * s + j] = std::sqrt(d);
+    for (int i = j + 1; i < s; i++) {
+      double v = L[i * s + j];
+      for (int k = 0; k < j; k++) v -= L[i * s + k] * L[j * s + k];
+      L[i * s + j] = v / L[j * s + j];
+    }
+  }
+  return true;
+}
+
+// Solves L L^T y = y in place
+inline void SolverMarketSmallCholeskySolve(const std::vector<double>& L, const int s, double* y) {
+  for (int i = 0; i < s; i++) {
+    for (int k = 0; k < i; k++) y[i] -= L[i * s + k] * y[k];
+    y[i] /= L[i * s + i];
+  }
+  for (int i = s - 1; i >= 0; i--) {
+    for (int k = i + 1; k < s; k++) y[i] -= L[k * s + i] * y[k];
+    y[i] /= L[i * s + i];
+  }
+}
+
+// Largest eigenvalue of M A by power iteration
+template <typename _MATRIX_, typename _TYPE_, typename _PRECONDITIONER_>
+double SolverMarketEstimateLambdaMax(const _MATRIX_& A, _PRECONDITIONER_& M, const DeviceView<_TYPE_>& y,
+                                     const DeviceView<_TYPE_>& t, const int iterations, int& reductions) {
+  Kokkos::parallel_for("SolverMarket::power_start", Kokkos::RangePolicy<Device>(0, y.extent(0)), KOKKOS_LAMBDA(const size_t i) {
+    y(i) = _TYPE_(1) + _TYPE_(i % 7) / _TYPE_(7);
+  });
+  double norm = std::sqrt(double(SolverMarketDot(y, y)));
+  reductions++;
+  double lambda = 0;
+  for (int k = 0; k < iterations && norm > 0; k++) {
+    SolverMarketAxpby(_TYPE_(1.0 / norm), y, _TYPE_(0), y);
+    SolverMarketSpMV(A, y, t);
+    M(t, y);
+    norm = std::sqrt(double(SolverMarketDot(y, y)));
+    reductions++;
+    lambda = norm;
+  }
+  return lambda;
+}
+
+// Preconditioned s-step CG, x holds the initial guess. Relative residual criterion, s clamped to [1, SolverMarketSStepMax]
+template <typename _MATRIX_, typename _TYPE_, typename _PRECONDITIONER_>
+SolverMarketKrylovResult SolverMarketSStepCG(const _MATRIX_& A, const DeviceView<_TYPE_>& b,
+                                             const DeviceView<_TYPE_>& x, _PRECONDITIONER_& M,
+                                             const double tolerance, const int max_iterations, int s = 4) {
+  SolverMarketKrylovResult result;
+  s = std::max(1, std::min(s, SolverMarketSStepMax));
+  const size_t n = A.n_rows;
+  DeviceView<_TYPE_> r(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::sstep_cg_r"), n);
+  DeviceBatchView<_TYPE_> V(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::sstep_cg_V"), s, n);
+  DeviceBatchView<_TYPE_> W(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::sstep_cg_W"), s, n);
+  DeviceBatchView<_TYPE_> P(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::sstep_cg_P"), s, n);
+  DeviceBatchView<_TYPE_> AP(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::sstep_cg_AP"), s, n);
+  auto row = [n](const DeviceBatchView<_TYPE_>& block, const int j) { return DeviceView<_TYPE_>(block.data() + size_t(j) * n, n); };
+  const int n_sums = 2 * s * s + s + 1;
+  DeviceView<_TYPE_> sums("SolverMarket::sstep_cg_sums", n_sums);
+  auto host_sums = Kokkos::create_mirror_view(sums);
+
+  double norm_b = std::sqrt(double(SolverMarketDot(b, b)));
+  result.reductions++;
+  if (norm_b == 0) norm_b = 1;
+
+  // Chebyshev basis on [0, 1.1 lambda_max]: T_0 = v, T_1 = (M A - theta) v / theta, T_j+1 = 2 (M A - theta) T_j / theta - T_j-1
+  double theta = 1;
+  if (s > 1) {
+    theta = 0.55 * SolverMarketEstimateLambdaMax(A, M, row(V, 0), row(W, 0), SolverMarketSStepPowerIterations, result.reductions);
+    if (!(theta > 0)) theta = 1;
+  }
+
+  SolverMarketResidual(A, x, b, r);
+  bool has_previous = false;
+  bool fresh = true;   /* r is the true residual*/
+  double peak = 0;     /* largest residual since the last replacement*/
+  double best = std::numeric_limits<double>::max();
+  int stalled = 0;     /* outer steps without a new smallest residual*/
+  std::vector<double> D_previous(s * s);
+  while (true) {
+    // Basis V of K_s(M A, M r) and W = A V: s SpMVs and preconditioner applications, no reduction
+    M(r, row(V, 0));
+    for (int j = 0; j < s; j++) {
+      SolverMarketSpMV(A, row(V, j), row(W, j));
+      if (j + 1 == s) break;
+      M(row(W, j), row(V, j + 1));
+      const _TYPE_ scale = _TYPE_((j == 0 ? 1.0 : 2.0) / theta);
+      const _TYPE_ shift = _TYPE_(theta);
+      Kokkos::parallel_for("SolverMarket::sstep_cg_basis", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const size_t i) {
+        V(j + 1, i) = scale * (V(j + 1, i) - shift * V(j, i)) - (j > 0 ? V(j - 1, i) : _TYPE_(0));
+      });
+    }
+
+    // The one reduction of the step
+    Kokkos::parallel_reduce("SolverMarket::sstep_cg_gram", Kokkos::RangePolicy<Device>(0, n),
+                            SolverMarketSStepGram<_TYPE_>(s, has_previous, V, W, AP, r), sums);
+    Kokkos::deep_copy(host_sums, sums);
+    result.reductions++;
+    result.residual = std::sqrt(double(host_sums(2 * s * s + s))) / norm_b;
+    peak = std::max(peak, result.residual);
+    if ((result.residual <= tolerance || result.residual <= SolverMarketReplacementDrop * peak) && !fresh) {
+      // Residual replacement
+      SolverMarketResidual(A, x, b, r);
+      has_previous = false;
+      fresh = true;
+      peak = 0;
+      continue;
+    }
+    if (result.residual <= tolerance) {
+      result.converged = true;
+      break;
+    }
+    if (result.iterations >= max_iterations) break;
+    if (result.residual < best) {
+      best = result.residual;
+      stalled = 0;
+    } else if (++stalled == SolverMarketSStepStallSteps && s > 1) {
+      // The recursion stagnates at the accuracy the basis allows: restart from the true residual with half the steps
+      s /= 2;
+      SolverMarketResidual(A, x, b, r);
+      has_previous = false;
+      fresh = true;
+      peak = 0;
+      best = std::numeric_limits<double>::max();
+      stalled = 0;
+      continue;
+    }
+
+    // B = D_prev^-1 C, D = P^T A P = G - C^T B, a = D^-1 V^T r
+    SolverMarketSStepCoefficients<_TYPE_> coefficients;
+    std::vector<double> D(s * s), column(s);
+    for (int j = 0; j < s; j++) {
+      for (int l = 0; l < s; l++) column[l] = has_previous ? double(host_sums(l * s + j)) : 0.0;
+      if (has_previous) SolverMarketSmallCholeskySolve(D_previous, s, column.data());
+      for (int l = 0; l < s; l++) coefficients.B[l * s + j] = _TYPE_(column[l]);
+    }
+    for (int k = 0; k < s; k++) {
+      for (int j = 0; j < s; j++) {
+        double d = 0.5 * double(host_sums(s * s + k * s + j) + host_sums(s * s + j * s + k));
+        if (has_previous) {
+          for (int l = 0; l < s; l++) d -= double(host_sums(l * s + k)) * double(coefficients.B[l * s + j]);
+        }
+        D[k * s + j] = d;
+      }
+    }
+    for (int k = 0; k < s; k++) {
+      for (int j = 0; j < k; j++) D[k * s + j] = D[j * s + k] = 0.5 * (D[k * s + j] + D[j * s + k]);
+    }
+    if (!SolverMarketSmallCholesky(D, s, SolverMarketSStepPivotTolerance)) {
+      // Basis numerically rank deficient: restart from the true residual with half the steps
+      if (s == 1) break;
+      s /= 2;
+      SolverMarketResidual(A, x, b, r);
+      has_previous = false;
+      fresh = true;
+      peak = 0;
+      continue;
+    }
+    for (int j = 0; j < s; j++) column[j] = double(host_sums(2 * s * s + j));
+    SolverMarketSmallCholeskySolve(D, s, column.data());
+    for (int j = 0; j < s; j++) coefficients.a[j] = _TYPE_(column[j]);
+
+    // P = V - P_prev B, A P = W - A P_prev B, x += P a, r -= A P a
+    const bool previous = has_previous;
+    Kokkos::parallel_for("SolverMarket::sstep_cg_update", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const size_t i) {
+      _TYPE_ p[SolverMarketSStepMax], ap[SolverMarketSStepMax];
+      for (int j = 0; j < s; j++) {
+        p[j] = V(j, i);
+        ap[j] = W(j, i);
+        if (previous) {
+          for (int l = 0; l < s; l++) {
+            p[j] -= P(l, i) * coefficients.B[l * s + j];
+            ap[j] -= AP(l, i) * coefficients.B[l * s + j];
+          }
+        }
+      }
+      _TYPE_ dx = 0, dr = 0;
+      for (int j = 0; j < s; j++) {
+        P(j, i) = p[j];
+        AP(j, i) = ap[j];
+        dx += p[j] * coefficients.a[j];
+        dr += ap[j] * coefficients.a[j];
+      }
+      x(i) += dx;
+      r(i) -= dr;
+    });
+    D_previous = D;
+    has_previous = true;
+    fresh = false;
+    result.iterations += s;
+  }
+  return result;
+}
+
+enum SolverMarketCGVariant {
+  SolverMarketCGClassic,    /* SolverMarketPCG*/
+  SolverMarketCGPipelined,  /* SolverMarketPipelinedCG*/
+  SolverMarketCGSStep       /* SolverMarketSStepCG*/
+};
+
+inline int SolverMarketParseCGVariant(const std::string& text, SolverMarketCGVariant& variant) {
+  if (text == "cg") variant = SolverMarketCGClassic;
+  else if (text == "pipelined_cg") variant = SolverMarketCGPipelined;
+  else if (text == "sstep_cg") variant = SolverMarketCGSStep;
+  else return 1;
+  return 0;
+}
+
+inline const char* SolverMarketCGVariantName(const SolverMarketCGVariant variant) {
+  return variant == SolverMarketCGPipelined ? "pipelined_cg" : (variant == SolverMarketCGSStep ? "sstep_cg" : "cg");
+}
+
+// Preconditioned CG in the given variant, s used by SolverMarketSStepCG only
+template <typename _MATRIX_, typename _TYPE_, typename _PRECONDITIONER_>
+SolverMarketKrylovResult SolverMarketSolveCG(const SolverMarketCGVariant variant, const _MATRIX_& A, const DeviceView<_TYPE_>& b,
+                                             const DeviceView<_TYPE_>& x, _PRECONDITIONER_& M,
+                                             const double tolerance, const int max_iterations, const int s = 4) {
+  if (variant == SolverMarketCGPipelined) return SolverMarketPipelinedCG(A, b, x, M, tolerance, max_iterations);
+  if (variant == SolverMarketCGSStep) return SolverMarketSStepCG(A, b, x, M, tolerance, max_iterations, s);
+  return SolverMarketPCG(A, b, x, M, tolerance, max_iterations);
+}
@@ -0,0 +1,174 @@
+#include <cmath>
+
+#include "solver-market-sparse.hpp"
+
+#pragma once
+
+/* Krylov methods of the native solvers, on device Views. The operator is any matrix with
+SolverMarketSpMV and SolverMarketResidual overloads (SolverMarketDeviceCSR, SolverMarketDeviceSELL).
+The preconditioner is any callable M(r, z) computing z = M^{-1} r (an AMG V-cycle, identity, ...). */
+
+struct SolverMarketKrylovResult {
+    int iterations = 0;
+    double residual = -1;   /* ||b - A x|| / ||b|| at exit*/
+    bool converged = false;
+    int reductions = 0;     /* global reductions, each one a host synchronisation*/
+};
+
+// Identity preconditioner
+struct SolverMarketIdentityPreconditioner {
+  template <typename _VIEW_>
+  void operator()(const _VIEW_& r, const _VIEW_& z) const { Kokkos::deep_copy(z, r); }
+};
+
+// Jacobi preconditioner z = D^{-1} r, rows without a stored (or with a zero) diagonal are not scaled
+template <typename _TYPE_>
+struct SolverMarketJacobiPreconditioner {
+  DeviceView<_TYPE_> inv_diagonal;
+
+  template <typename _ITYPE_>
+  explicit SolverMarketJacobiPreconditioner(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A)
+      : inv_diagonal(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::jacobi_inv_diagonal"), A.n_rows) {
+    auto offsets = A.offsets;
+    auto columns = A.columns;
+    auto values = A.values;
+    auto inv = inv_diagonal;
+    Kokkos::parallel_for("SolverMarket::jacobi_setup", Kokkos::RangePolicy<Device>(0, A.n_rows), KOKKOS_LAMBDA(const _ITYPE_ i) {
+      _TYPE_ d = 0;
+      for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) if (columns(k) == i) d += values(k);
+      inv(i) = (d != _TYPE_(0)) ? _TYPE_(1) / d : _TYPE_(1);
+    });
+  }
+
+  void operator()(const DeviceView<_TYPE_>& r, const DeviceView<_TYPE_>& z) const {
+    auto inv = inv_diagonal;
+    Kokkos::parallel_for("SolverMarket::jacobi_apply", Kokkos::RangePolicy<Device>(0, r.extent(0)), KOKKOS_LAMBDA(const size_t i) {
+      z(i) = inv(i) * r(i);
+    });
+  }
+};
+
+// Preconditioned conjugate gradient, x holds the initial guess. Relative residual criterion
+template <typename _MATRIX_, typename _TYPE_, typename _PRECONDITIONER_>
+SolverMarketKrylovResult SolverMarketPCG(const _MATRIX_& A, const DeviceView<_TYPE_>& b,
+                                         const DeviceView<_TYPE_>& x, _PRECONDITIONER_& M,
+                                         const double tolerance, const int max_iterations) {
+  SolverMarketKrylovResult result;
+  auto dot = [&result](const DeviceView<_TYPE_>& u, const DeviceView<_TYPE_>& v) {
+    result.reductions++;
+    return SolverMarketDot(u, v);
+  };
+  const size_t n = A.n_rows;
+  DeviceView<_TYPE_> r(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::pcg_r"), n);
+  DeviceView<_TYPE_> z(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::pcg_z"), n);
+  DeviceView<_TYPE_> p(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::pcg_p"), n);
+  DeviceView<_TYPE_> q(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::pcg_q"), n);
+
+  double norm_b = std::sqrt(double(dot(b, b)));
+  if (norm_b == 0) norm_b = 1;
+
+  SolverMarketResidual(A, x, b, r);
+  result.residual = std::sqrt(double(dot(r, r))) / norm_b;
+  if (result.residual <= tolerance) {
+    result.converged = true;
+    return result;
+  }
+
+  M(r, z);
+  Kokkos::deep_copy(p, z);
+  _TYPE_ rz = dot(r, z);
+
+  for (int it = 1; it <= max_iterations; it++) {
+    SolverMarketSpMV(A, p, q);
+    const _TYPE_ pq = dot(p, q);
+    if (pq == _TYPE_(0)) break;  /* breakdown*/
+    const _TYPE_ alpha = rz / pq;
+    SolverMarketAxpby(alpha, p, _TYPE_(1), x);
+    SolverMarketAxpby(-alpha, q, _TYPE_(1), r);
+
+    result.iterations = it;
+    result.residual = std::sqrt(double(dot(r, r))) / norm_b;
+    if (result.residual <= tolerance) {
+      result.converged = true;
+      break;
+    }
+
+    M(r, z);
+    const _TYPE_ rz_new = dot(r, z);
+    SolverMarketAxpby(_TYPE_(1), z, rz_new / rz, p);
+    rz = rz_new;
+  }
+  return result;
+}
+
+// Right preconditioned BiCGStab for nonsymmetric systems, x holds the initial guess. Relative residual criterion
+template <typename _MATRIX_, typename _TYPE_, typename _PRECONDITIONER_>
+SolverMarketKrylovResult SolverMarketBiCGStab(const _MATRIX_& A, const DeviceView<_TYPE_>& b,
+                                              const DeviceView<_TYPE_>& x, _PRECONDITIONER_& M,
+                                              const double tolerance, const int max_iterations) {
+  SolverMarketKrylovResult result;
+  auto dot = [&result](const DeviceView<_TYPE_>& u, const DeviceView<_TYPE_>& v) {
+    result.reductions++;
+    return SolverMarketDot(u, v);
+  };
+  const size_t n = A.n_rows;
+  DeviceView<_TYPE_> r(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::bicgstab_r"), n);
+  DeviceView<_TYPE_> r_hat(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::bicgstab_r_hat"), n);
+  DeviceView<_TYPE_> p("SolverMarket::bicgstab_p", n);
+  DeviceView<_TYPE_> v("SolverMarket::bicgstab_v", n);
+  DeviceView<_TYPE_> p_hat(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::bicgstab_p_hat"), n);
+  DeviceView<_TYPE_> s_hat(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::bicgstab_s_hat"), n);
+  DeviceView<_TYPE_> t(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::bicgstab_t"), n);
+
+  double norm_b = std::sqrt(double(dot(b, b)));
+  if (norm_b == 0) norm_b = 1;
+
+  SolverMarketResidual(A, x, b, r);
+  result.residual = std::sqrt(double(dot(r, r))) / norm_b;
+  if (result.residual <= tolerance) {
+    result.converged = true;
+    return result;
+  }
+  Kokkos::deep_copy(r_hat, r);
+
+  _TYPE_ rho = 1, alpha = 1, omega = 1;
+  for (int it = 1; it <= max_iterations; it++) {
+    const _TYPE_ rho_new = dot(r_hat, r);
+    if (rho_new == _TYPE_(0)) break;  /* breakdown*/
+    const _TYPE_ beta = (rho_new / rho) * (alpha / omega);
+    rho = rho_new;
+    // p = r + beta (p - omega v)
+    SolverMarketAxpby(-omega, v, _TYPE_(1), p);
+    SolverMarketAxpby(_TYPE_(1), r, beta, p);
+    M(p, p_hat);
+    SolverMarketSpMV(A, p_hat, v);
+    const _TYPE_ r_hat_v = dot(r_hat, v);
+    if (r_hat_v == _TYPE_(0)) break;
+    alpha = rho / r_hat_v;
+    // s = r - alpha v, kept in r
+    SolverMarketAxpby(-alpha, v, _TYPE_(1), r);
+    SolverMarketAxpby(alpha, p_hat, _TYPE_(1), x);
+
+    result.iterations = it;
+    result.residual = std::sqrt(double(dot(r, r))) / norm_b;
+    if (result.residual <= tolerance) {
+      result.converged = true;
+      break;
+    }
+
+    M(r, s_hat);
+    SolverMarketSpMV(A, s_hat, t);
+    const _TYPE_ tt = dot(t, t);
+    omega = (tt != _TYPE_(0)) ? dot(t, r) / tt : _TYPE_(0);
+    SolverMarketAxpby(omega, s_hat, _TYPE_(1), x);
+    SolverMarketAxpby(-omega, t, _TYPE_(1), r);
+
+    result.residual = std::sqrt(double(dot(r, r))) / norm_b;
+    if (result.residual <= tolerance) {
+      result.converged = true;
+      break;
+    }
+    if (omega == _TYPE_(0)) break;
+  }
+  return result;
+}
@@ -0,0 +1,54 @@
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#pragma once
+
+/* Log messages written in one piece. The message is built apart and written to the stream
+under a process-wide lock at the end of the statement, so the messages of concurrent reads
+(threads of one process, or the jobs of solver_market_batch sharing a terminal) do not
+interleave:
+
+  SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][read_from_file] Reading file " << filename << "\n";
+  SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] ...\n";
+
+Numbers are formatted with the flags and precision of the stream at construction. */
+
+inline std::mutex& SolverMarketLogMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+class SolverMarketLog {
+public:
+    explicit SolverMarketLog(std::ostream& stream = std::cout) : stream_(stream) {
+        buffer_.flags(stream.flags());
+        buffer_.precision(stream.precision());
+    }
+
+    ~SolverMarketLog() {
+        std::lock_guard<std::mutex> lock(SolverMarketLogMutex());
+        stream_ << buffer_.str();
+        stream_.flush();
+    }
+
+    SolverMarketLog(const SolverMarketLog&) = delete;
+    SolverMarketLog& operator=(const SolverMarketLog&) = delete;
+
+    template <typename _VALUE_>
+    SolverMarketLog& operator<<(const _VALUE_& value) {
+        buffer_ << value;
+        return *this;
+    }
+
+    // std::endl, std::fixed...: applied to the message, the stream is flushed at the end anyway
+    SolverMarketLog& operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+        buffer_ << manipulator;
+        return *this;
+    }
+
+private:
+    std::ostream& stream_;
+    std::ostringstream buffer_;
+};
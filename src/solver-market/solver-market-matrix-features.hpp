@@ -0,0 +1,120 @@
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#pragma once
+
+// Row lengths are binned in powers of two: bin 0 holds empty rows, bin b>0 holds
+// rows with 2^(b-1) <= nnz < 2^b, the last bin catches everything above.
+#define SOLVER_MARKET_FEATURES_HIST_BINS 16
+
+/* Structural and numerical statistics of a CSR matrix, computed in one parallel
+pass by SolverMarketCSRMatrix::compute_features. Cheap enough to be computed
+before every solve, and compact enough to be stored next to the benchmark results. */
+struct SolverMarketMatrixFeatures {
+
+  uint64_t fingerprint = 0; /* structural hash (n, nnz, offsets, columns). Values are ignored*/
+
+  uint64_t n = 0;
+  uint64_t nnz = 0;
+
+  // nnz per row
+  uint64_t row_nnz_min = 0;
+  uint64_t row_nnz_max = 0;
+  double row_nnz_mean = 0.0;
+  double row_nnz_std = 0.0;
+  uint64_t row_nnz_histogram[SOLVER_MARKET_FEATURES_HIST_BINS] = {};
+
+  uint64_t bandwidth = 0;   /* max |i-j| over stored entries*/
+  uint64_t empty_rows = 0;
+  uint64_t duplicates = 0;  /* entries sharing (i,j) with the previous entry of the row*/
+  uint64_t missing_diagonal = 0; /* rows without a stored diagonal entry*/
+  uint64_t zero_diagonal = 0;    /* rows with a stored but zero diagonal entry*/
+
+  // Diagonal dominance: ratio |a_ii| / sum_{j!=i} |a_ij| on the stored entries.
+  // For symmetric matrices stored as one triangle, only that triangle is seen.
+  uint64_t diagonally_dominant_rows = 0;
+  double diagonal_dominance_min = 0.0;
+
+  // Symmetry of the stored pattern / values. Not computed (and trivially true)
+  // for matrices read as 'symmetric', since only one triangle is stored.
+  uint64_t structural_asymmetric_entries = 0;
+  uint64_t numerical_asymmetric_entries = 0;
+  bool structurally_symmetric = false;
+  bool numerically_symmetric = false;
+
+  double analysis_time = 0.0; /* seconds*/
+
+  std::string fingerprint_string() const {
+    std::ostringstream s;
+    s << std::hex << std::setw(16) << std::setfill('0') << fingerprint;
+    return s.str();
+  }
+
+  // One line of space separated key=value pairs, stable order
+  std::string to_record() const {
+    std::ostringstream s;
+    s << "fingerprint=" << fingerprint_string()
+      << " n=" << n
+      << " nnz=" << nnz
+      << " row_nnz_min=" << row_nnz_min
+      << " row_nnz_max=" << row_nnz_max
+      << std::setprecision(6)
+      << " row_nnz_mean=" << row_nnz_mean
+      << " row_nnz_std=" << row_nnz_std
+      << " bandwidth=" << bandwidth
+      << " empty_rows=" << empty_rows
+      << " duplicates=" << duplicates
+      << " missing_diagonal=" << missing_diagonal
+      << " zero_diagonal=" << zero_diagonal
+      << " diag_dominant_rows=" << diagonally_dominant_rows
+      << " diag_dominance_min=" << diagonal_dominance_min
+      << " struct_asym_entries=" << structural_asymmetric_entries
+      << " num_asym_entries=" << numerical_asymmetric_entries
+      << " struct_symmetric=" << structurally_symmetric
+      << " num_symmetric=" << numerically_symmetric
+      << " row_nnz_hist=";
+    for (int b = 0; b < SOLVER_MARKET_FEATURES_HIST_BINS; b++) {
+      s << (b ? "," : "") << row_nnz_histogram[b];
+    }
+    return s.str();
+  }
+
+  void print() const {
+    std::cout << "\n \\---- Solver Market matrix features ----/\n\n";
+    std::cout << "fingerprint: " << fingerprint_string() << "\n";
+    std::cout << "n: " << n << ", nnz: " << nnz << "\n";
+    std::cout << "nnz/row: min " << row_nnz_min << ", max " << row_nnz_max
+              << ", mean " << row_nnz_mean << ", std " << row_nnz_std << "\n";
+    std::cout << "nnz/row histogram (log2 bins): ";
+    for (int b = 0; b < SOLVER_MARKET_FEATURES_HIST_BINS; b++) {
+      std::cout << row_nnz_histogram[b] << " ";
+    }
+    std::cout << "\n";
+    std::cout << "bandwidth: " << bandwidth << "\n";
+    std::cout << "empty rows: " << empty_rows << ", duplicate entries: " << duplicates << "\n";
+    std::cout << "missing diagonal: " << missing_diagonal << ", zero diagonal: " << zero_diagonal << "\n";
+    std::cout << "diagonally dominant rows: " << diagonally_dominant_rows << "/" << n
+              << ", min dominance ratio: " << diagonal_dominance_min << "\n";
+    std::cout << "structurally symmetric: " << structurally_symmetric
+              << " (" << structural_asymmetric_entries << " unmatched entries)\n";
+    std::cout << "numerically symmetric: " << numerically_symmetric
+              << " (" << numerical_asymmetric_entries << " mismatched values)\n";
+    std::cout << "analysis time: " << analysis_time * 1000 << " ms\n";
+    std::cout << "\n \\---------------------------------------/\n";
+  }
+
+  // Append the record to a log file, prefixed by an identifier of the matrix (e.g. its path)
+  int write_record(const std::string& matrix_id, const std::string& filename = "solver_features.log") const {
+    std::ofstream outFile(filename, std::ios::app);
+    if (!outFile.is_open()) {
+      std::cerr << "Error: Could not open " << filename << " for writing.\n";
+      return 1;
+    }
+    outFile << matrix_id << " " << to_record() << "\n";
+    return 0;
+  }
+};
@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "solver-market-header.hpp"
+
+#if defined(KOKKOS_ENABLE_CUDA)
+#include <cuda_runtime_api.h>
+#elif defined(KOKKOS_ENABLE_HIP)
+#include <hip/hip_runtime_api.h>
+#endif
+
+#pragma once
+
+/* Process memory as seen by the kernel (Linux /proc/self/status).
+All functions return 0 when the information is not available. */
+
+// Value of a "Key:   1234 kB" line of /proc/self/status, in bytes
+inline size_t SolverMarketProcStatusBytes(const std::string& key) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind(key, 0) == 0) {
+      std::istringstream data(line.substr(key.size()));
+      size_t kb = 0;
+      data >> kb;
+      return kb * 1024;
+    }
+  }
+  return 0;
+}
+
+// Resident set size high-water mark since start (or since the last reset)
+inline size_t SolverMarketPeakRSS() { return SolverMarketProcStatusBytes("VmHWM:"); }
+
+inline size_t SolverMarketCurrentRSS() { return SolverMarketProcStatusBytes("VmRSS:"); }
+
+// Reset the high-water mark to the current RSS (Linux >= 4.0), false if not permitted
+inline bool SolverMarketResetPeakRSS() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (!clear_refs.is_open()) return false;
+  clear_refs << "5";
+  return static_cast<bool>(clear_refs);
+}
+
+inline double SolverMarketToMB(const size_t bytes) { return double(bytes) / (1024.0 * 1024.0); }
+
+// Memory in use on the current device (whole device, every process), 0 without a GPU backend
+inline size_t SolverMarketDeviceMemoryUsed() {
+  size_t free_bytes = 0, total_bytes = 0;
+#if defined(KOKKOS_ENABLE_CUDA)
+  if (cudaMemGetInfo(&free_bytes, &total_bytes) != cudaSuccess) return 0;
+#elif defined(KOKKOS_ENABLE_HIP)
+  if (hipMemGetInfo(&free_bytes, &total_bytes) != hipSuccess) return 0;
+#endif
+  return total_bytes - free_bytes;
+}
+
+/* Memory of the phases of a run (read, assemble, upload, setup, solve).
+
+  SolverMarketMemory::instance().set_enabled(true);    // --memory, or SOLVER_MARKET_MEMORY=1
+  { SolverMarketMemoryRegion region("setup"); ... }
+  SolverMarketMemory::instance().summary();            // appended to the output record
+
+Per phase: the RSS high-water mark (VmHWM, reset at the start of the phase through
+/proc/self/clear_refs; where that is refused it is the peak of the process so far), the
+bytes allocated through Kokkos and the peak of the live Kokkos bytes, host and device
+spaces apart, and the device memory in use at the end of the phase. Kokkos allocations are
+seen through the Kokkos Tools allocate/deallocate callbacks, installed when the tracking is
+enabled: they replace those of a tool loaded with KOKKOS_TOOLS_LIBS. Buffers reused from
+the pool (solver-market-pool.hpp) are not allocations, and buffers allocated before the
+tracking was enabled are not live bytes. Setup and solve only see the allocations of the
+libraries going through Kokkos (Tpetra, MueLu, the native solvers): AMGX allocates on its
+own and only shows in the RSS and the device usage. Regions can nest. */
+
+struct SolverMarketMemorySample {
+  size_t rss_peak = 0;          /* VmHWM over the phase*/
+  size_t host_allocated = 0;    /* bytes allocated in Kokkos host spaces during the phase*/
+  size_t host_peak = 0;         /* peak of the live Kokkos host bytes during the phase*/
+  size_t device_allocated = 0;  /* same in device spaces*/
+  size_t device_peak = 0;
+  size_t device_used = 0;       /* device memory in use at the end, 0 if unknown*/
+
+  // Repeated phases: allocations add up, peaks are the largest
+  SolverMarketMemorySample& operator+=(const SolverMarketMemorySample& other) {
+    rss_peak = std::max(rss_peak, other.rss_peak);
+    host_allocated += other.host_allocated;
+    host_peak = std::max(host_peak, other.host_peak);
+    device_allocated += other.device_allocated;
+    device_peak = std::max(device_peak, other.device_peak);
+    device_used = std::max(device_used, other.device_used);
+    return *this;
+  }
+
+  // phase:rss_peak_mb=812.4,host_alloc_mb=610.2,host_peak_mb=610.2[,device_alloc_mb=..,device_peak_mb=..,device_used_mb=..]
+  std::string summary(const std::string& phase) const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << phase << ":rss_peak_mb=" << SolverMarketToMB(rss_peak) << ",host_alloc_mb=" << SolverMarketToMB(host_allocated)
+        << ",host_peak_mb=" << SolverMarketToMB(host_peak);
+    if (device_allocated > 0 || device_peak > 0 || device_used > 0) {
+      out << ",device_alloc_mb=" << SolverMarketToMB(device_allocated) << ",device_peak_mb=" << SolverMarketToMB(device_peak)
+          << ",device_used_mb=" << SolverMarketToMB(device_used);
+    }
+    return out.str();
+  }
+};
+
+/* Kokkos allocations and per-phase samples of the process. Disabled unless set_enabled(true)
+or SOLVER_MARKET_MEMORY=1 (then enabled at the first region) */
+class SolverMarketMemory {
+public:
+  enum Space { HostSpace, DeviceSpace, SpaceCount };
+
+  // Running totals of the Kokkos allocations, taken at the start and at the end of a region
+  struct Mark {
+    uint64_t allocated[SpaceCount] = {};
+    int64_t peak[SpaceCount] = {};  /* peak of the enclosing region so far*/
+    size_t rss_peak = 0;
+  };
+
+  static SolverMarketMemory& instance() {
+    static SolverMarketMemory memory;
+    return memory;
+  }
+
+  bool enabled() const { return enabled_; }
+  void set_enabled(const bool enabled) {
+    enabled_ = enabled;
+    if (enabled && !hooked_) {
+      Kokkos::Tools::Experimental::set_allocate_data_callback(&SolverMarketMemory::allocate_callback);
+      Kokkos::Tools::Experimental::set_deallocate_data_callback(&SolverMarketMemory::deallocate_callback);
+      hooked_ = true;
+    }
+  }
+
+  // Host for HostSpace and pinned host memory, device for the rest (Cuda, CudaUVM, HIP, SYCL...)
+  static Space space_of(const char* name) {
+    return (std::strcmp(name, "Host") == 0 || std::strstr(name, "HostPinned")) ? HostSpace : DeviceSpace;
+  }
+
+  void allocated(const Space space, const uint64_t bytes) {
+    allocated_[space] += bytes;
+    const int64_t live = (live_[space] += int64_t(bytes));
+    int64_t peak = peak_[space];
+    while (live > peak && !peak_[space].compare_exchange_weak(peak, live)) {}
+  }
+
+  // Buffers allocated before the tracking was enabled are not counted: live bytes stay >= 0
+  void deallocated(const Space space, const uint64_t bytes) {
+    int64_t live = live_[space];
+    while (!live_[space].compare_exchange_weak(live, std::max<int64_t>(live - int64_t(bytes), 0))) {}
+  }
+
+  // Start of a region: the peaks restart from the current values, the enclosing ones are kept in the mark
+  Mark begin() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Mark mark;
+    for (int s = 0; s < SpaceCount; s++) {
+      mark.allocated[s] = allocated_[s];
+      mark.peak[s] = peak_[s].exchange(live_[s]);
+    }
+    mark.rss_peak = std::max(rss_peak_, SolverMarketPeakRSS());
+    rss_reset_ = SolverMarketResetPeakRSS();
+    rss_peak_ = 0;
+    return mark;
+  }
+
+  // End of a region: its sample, and the peaks of the enclosing region include it
+  SolverMarketMemorySample end(const Mark& mark) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SolverMarketMemorySample sample;
+    sample.rss_peak = std::max(rss_peak_, SolverMarketPeakRSS());
+    rss_peak_ = std::max(mark.rss_peak, sample.rss_peak);
+    for (int s = 0; s < SpaceCount; s++) {
+      const int64_t peak = peak_[s];
+      peak_[s] = std::max(mark.peak[s], peak);
+      const size_t allocated = size_t(allocated_[s] - mark.allocated[s]);
+      (s == HostSpace ? sample.host_allocated : sample.device_allocated) = allocated;
+      (s == HostSpace ? sample.host_peak : sample.device_peak) = size_t(std::max<int64_t>(peak, 0));
+    }
+    sample.device_used = SolverMarketDeviceMemoryUsed();
+    return sample;
+  }
+
+  // Samples of a phase add up (see SolverMarketMemorySample::operator+=)
+  void record(const std::string& phase, const SolverMarketMemorySample& sample) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = phases_.find(phase);
+    if (it == phases_.end()) {
+      order_.push_back(phase);
+      phases_[phase] = sample;
+    } else {
+      it->second += sample;
+    }
+  }
+
+  bool sample(const std::string& phase, SolverMarketMemorySample& sample) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = phases_.find(phase);
+    if (it == phases_.end()) return false;
+    sample = it->second;
+    return true;
+  }
+
+  // Forget one phase (setup and solve between two backends, the read stays)
+  void erase(const std::string& phase) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (phases_.erase(phase)) {
+      for (size_t p = 0; p < order_.size(); p++) {
+        if (order_[p] == phase) order_.erase(order_.begin() + p);
+      }
+    }
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    phases_.clear();
+    order_.clear();
+  }
+
+  // memory[read:rss_peak_mb=..;assemble:...;setup:...], memory=process_peak[...] when the
+  // RSS high-water mark could not be reset, empty when disabled
+  std::string summary() {
+    if (!enabled_) return "";
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out = rss_reset_ ? "memory[" : "memory=process_peak[";
+    for (size_t p = 0; p < order_.size(); p++) {
+      if (p > 0) out += ";";
+      out += phases_[order_[p]].summary(order_[p]);
+    }
+    return out + "]";
+  }
+
+  void print() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& phase : order_) {
+      std::cout << "[Info][SolverMarket][Memory] " << phases_[phase].summary(phase) << "\n";
+    }
+  }
+
+private:
+  SolverMarketMemory() {
+    const char* env = std::getenv("SOLVER_MARKET_MEMORY");
+    enabled_ = env && std::string(env) != "0";
+  }
+
+  static void allocate_callback(const Kokkos::Tools::Experimental::SpaceHandle handle, const char*, const void*, const uint64_t bytes) {
+    instance().allocated(space_of(handle.name), bytes);
+  }
+  static void deallocate_callback(const Kokkos::Tools::Experimental::SpaceHandle handle, const char*, const void*, const uint64_t bytes) {
+    instance().deallocated(space_of(handle.name), bytes);
+  }
+
+  bool enabled_ = false;
+  bool hooked_ = false;
+  bool rss_reset_ = true;
+  std::atomic<uint64_t> allocated_[SpaceCount] = {};
+  std::atomic<int64_t> live_[SpaceCount] = {};
+  std::atomic<int64_t> peak_[SpaceCount] = {};
+  size_t rss_peak_ = 0;  /* VmHWM seen since the start of the innermost open region*/
+  std::mutex mutex_;
+  std::map<std::string, SolverMarketMemorySample> phases_;
+  std::vector<std::string> order_;
+};
+
+/* Memory of one phase, from construction to destruction (or stop()). No-op when disabled */
+class SolverMarketMemoryRegion {
+public:
+  explicit SolverMarketMemoryRegion(const std::string& phase) : phase_(phase) {
+    auto& memory = SolverMarketMemory::instance();
+    active_ = memory.enabled();
+    if (active_) {
+      memory.set_enabled(true);  // hooks the Kokkos allocations when enabled from the environment
+      mark_ = memory.begin();
+    }
+  }
+  ~SolverMarketMemoryRegion() { stop(); }
+
+  SolverMarketMemoryRegion(const SolverMarketMemoryRegion&) = delete;
+  SolverMarketMemoryRegion& operator=(const SolverMarketMemoryRegion&) = delete;
+
+  void stop() {
+    if (!active_) return;
+    auto& memory = SolverMarketMemory::instance();
+    memory.record(phase_, memory.end(mark_));
+    active_ = false;
+  }
+
+private:
+  std::string phase_;
+  bool active_ = false;
+  SolverMarketMemory::Mark mark_;
+};
@@ -0,0 +1,198 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include "solver-market-header.hpp"
+
+#pragma once
+
+/* NUMA placement of the host storage.
+
+Linux puts a page on the node of the thread that writes it first. Host Views are allocated
+without initialization and used to be filled (or zeroed) by one thread, so on a dual-socket
+node every page of a matrix sat on socket 0 and the parallel host kernels (parse, CSR
+assembly, features, writers) ran at the bandwidth of one socket.
+
+Fresh host buffers are now first touched in parallel with the static partition of
+RangePolicy<Host>: the thread that touches a block of rows or entries is the one that
+processes it in the host kernels. Vectors read by every thread (x of a SpMV) can instead be
+interleaved page by page over the nodes. The policy of the process:
+
+  SOLVER_MARKET_NUMA=first-touch (default) | interleave (vectors interleaved) | none
+
+Placement only holds if threads do not migrate: run with OMP_PROC_BIND=spread (or close)
+and OMP_PLACES=cores, SolverMarketCheckThreadBinding() warns otherwise. Buffers reused from
+the pool keep the placement of their first use. */
+
+enum SolverMarketNumaPlacement {
+    SolverMarketNumaNone,       /* pages go wherever the filling thread runs*/
+    SolverMarketNumaFirstTouch, /* parallel first touch, static partition*/
+    SolverMarketNumaInterleave  /* first touch for matrices, vectors interleaved over the nodes*/
+};
+
+inline const char* SolverMarketNumaPlacementName(const SolverMarketNumaPlacement placement)
+{
+    switch (placement) {
+        case SolverMarketNumaFirstTouch: return "first-touch";
+        case SolverMarketNumaInterleave: return "interleave";
+        default: return "none";
+    }
+}
+
+inline int SolverMarketParseNumaPlacement(const std::string& name, SolverMarketNumaPlacement& placement)
+{
+    if (name == "none") placement = SolverMarketNumaNone;
+    else if (name == "first-touch") placement = SolverMarketNumaFirstTouch;
+    else if (name == "interleave") placement = SolverMarketNumaInterleave;
+    else return 1;
+    return 0;
+}
+
+// Placement policy of the process, from SOLVER_MARKET_NUMA at first use (can be overwritten)
+inline SolverMarketNumaPlacement& SolverMarketNumaPolicy()
+{
+    static SolverMarketNumaPlacement policy = []() {
+        SolverMarketNumaPlacement placement = SolverMarketNumaFirstTouch;
+        const char* env = std::getenv("SOLVER_MARKET_NUMA");
+        if (env && SolverMarketParseNumaPlacement(env, placement)) {
+            std::cerr << "[Error][SolverMarket][Numa] Unknown SOLVER_MARKET_NUMA=" << env << ", using first-touch\n";
+            placement = SolverMarketNumaFirstTouch;
+        }
+        return placement;
+    }();
+    return policy;
+}
+
+// Online NUMA nodes, from a sysfs list such as "0-1,4". A single node 0 if unknown
+inline std::vector<int> SolverMarketNumaNodes(const std::string& path = "/sys/devices/system/node/online")
+{
+    std::vector<int> nodes;
+    std::ifstream file(path);
+    std::string list, range;
+    std::getline(file, list);
+    std::istringstream ranges(list);
+    while (std::getline(ranges, range, ',')) {
+        const size_t dash = range.find('-');
+        const int first = std::atoi(range.substr(0, dash).c_str());
+        const int last = (dash == std::string::npos) ? first : std::atoi(range.substr(dash + 1).c_str());
+        for (int node = first; node <= last && node < 1024; node++) nodes.push_back(node);
+    }
+    if (nodes.empty()) nodes.push_back(0);
+    return nodes;
+}
+
+// Interleave the pages of [data, data + bytes) over the online nodes. Must run before
+// the first touch. false when there is a single node or the kernel refused
+inline bool SolverMarketInterleavePages(void* data, const size_t bytes)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    static const std::vector<int> nodes = SolverMarketNumaNodes();
+    if (nodes.size() < 2) return false;
+
+    unsigned long mask[1024 / (8 * sizeof(unsigned long))] = {};
+    for (const int node : nodes) mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+
+    // Whole pages inside the buffer only
+    const uintptr_t page = uintptr_t(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = (uintptr_t(data) + page - 1) / page * page;
+    const uintptr_t end = (uintptr_t(data) + bytes) / page * page;
+    if (end <= begin) return false;
+    const int mpol_interleave = 3; /* MPOL_INTERLEAVE of <linux/mempolicy.h>*/
+    return syscall(SYS_mbind, begin, end - begin, mpol_interleave, mask, 8 * sizeof(mask), 0) == 0;
+#else
+    (void)data;
+    (void)bytes;
+    return false;
+#endif
+}
+
+// Write [0, n) of a fresh host buffer with the static partition of the host kernels, zeros
+template <typename _TYPE_>
+void SolverMarketFirstTouch(const HostView<_TYPE_>& view, const size_t n)
+{
+    Kokkos::parallel_for("SolverMarket::first_touch", Kokkos::RangePolicy<Host, Kokkos::Schedule<Kokkos::Static>>(0, n),
+        [&](const size_t i) { view(i) = _TYPE_(0); });
+}
+
+// First touch of the entries of a CSR with the row partition of the host kernels: the thread that
+// owns rows [i, j) in a SpMV touches entries [offsets(i), offsets(j)), however skewed the rows are
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketFirstTouchRows(const HostView<_TYPE_>& view, const HostView<_ITYPE_>& offsets, const size_t n)
+{
+    Kokkos::parallel_for("SolverMarket::first_touch_rows", Kokkos::RangePolicy<Host, Kokkos::Schedule<Kokkos::Static>>(0, n),
+        [&](const size_t i) {
+            for (size_t k = size_t(offsets(i)); k < size_t(offsets(i + 1)); k++) view(k) = _TYPE_(0);
+        });
+}
+
+// Placement of the fresh entries of a CSR of n rows, once its offsets are known. Returns true if they were zeroed
+template <typename _TYPE_, typename _ITYPE_>
+bool SolverMarketNumaPlaceRows(const HostView<_TYPE_>& view, const HostView<_ITYPE_>& offsets, const size_t n)
+{
+    if (SolverMarketNumaPolicy() == SolverMarketNumaNone || n == 0) return false;
+    SolverMarketFirstTouchRows(view, offsets, n);
+    return true;
+}
+
+// Placement of a fresh host buffer under the process policy. Returns true if [0, n) was zeroed
+template <typename _TYPE_>
+bool SolverMarketNumaPlace(const HostView<_TYPE_>& view, const size_t n, const bool shared_vector = false)
+{
+    const SolverMarketNumaPlacement policy = SolverMarketNumaPolicy();
+    if (policy == SolverMarketNumaNone || n == 0) return false;
+    if (shared_vector && policy == SolverMarketNumaInterleave) SolverMarketInterleavePages(view.data(), n * sizeof(_TYPE_));
+    SolverMarketFirstTouch(view, n);
+    return true;
+}
+
+struct SolverMarketThreadBinding {
+    int nodes = 1;           /* online NUMA nodes*/
+    int threads = 1;         /* host concurrency*/
+    int places = 0;          /* OpenMP places, 0 if unknown*/
+    bool bound = false;      /* threads bound to places (OpenMP proc_bind not false)*/
+    std::string proc_bind;   /* OMP_PROC_BIND, empty if unset*/
+    std::string omp_places;  /* OMP_PLACES, empty if unset*/
+};
+
+// State of thread binding, warns when several nodes are used by unbound threads: first-touch
+// placement is then lost as soon as the OS migrates a thread
+inline SolverMarketThreadBinding SolverMarketCheckThreadBinding(const bool verbose = true)
+{
+    SolverMarketThreadBinding binding;
+    binding.nodes = int(SolverMarketNumaNodes().size());
+    binding.threads = Host().concurrency();
+    const char* proc_bind = std::getenv("OMP_PROC_BIND");
+    const char* places = std::getenv("OMP_PLACES");
+    binding.proc_bind = proc_bind ? proc_bind : "";
+    binding.omp_places = places ? places : "";
+#if defined(_OPENMP)
+    binding.bound = omp_get_proc_bind() != omp_proc_bind_false;
+    binding.places = omp_get_num_places();
+#else
+    binding.bound = !binding.proc_bind.empty() && binding.proc_bind != "false";
+#endif
+
+    if (verbose) {
+        std::cout << "[Info][SolverMarket][Numa] " << binding.nodes << " node(s), " << binding.threads << " host threads, "
+                  << (binding.bound ? "bound" : "not bound") << " (OMP_PROC_BIND=" << binding.proc_bind
+                  << ", OMP_PLACES=" << binding.omp_places << "), placement "
+                  << SolverMarketNumaPlacementName(SolverMarketNumaPolicy()) << "\n";
+        if (binding.nodes > 1 && binding.threads > 1 && !binding.bound) {
+            std::cout << "[Warning][SolverMarket][Numa] Host threads are not pinned on a multi-node machine: set "
+                      << "OMP_PROC_BIND=spread OMP_PLACES=cores to keep the NUMA placement of the host storage\n";
+        }
+    }
+    return binding;
+}
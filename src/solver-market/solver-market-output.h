@@ -2,12 +2,18 @@
 #include <fstream>
 #include <chrono>
 #include <iomanip>
+#include <sstream>
 #include <string>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 void SolverMarketOutput(const std::chrono::milliseconds& SolverMarketSetupTime, 
                         const std::chrono::milliseconds& SolverMarketSolveTime,
                         bool success,
-                        int argc, char *argv[]) {
+                        int argc, char *argv[],
+                        const std::string& counters = "",
+                        const std::string& memory = "") {
     
     auto out_solve = std::chrono::duration_cast<std::chrono::duration<double>>(SolverMarketSolveTime);
     auto out_setup = std::chrono::duration_cast<std::chrono::duration<double>>(SolverMarketSetupTime);
@@ -23,20 +29,28 @@ void SolverMarketOutput(const std::chrono::milliseconds& SolverMarketSetupTime,
     std::cout << "\n";
     std::cout << "Success: " << success << "\n";
     std::cout << "Setup time: " << std::setprecision(6) << out_setup.count() << " s\n";
-    std::cout << "Solve time: " << std::setprecision(6) << out_solve.count() * 1000 << " ms\n\n";
+    std::cout << "Solve time: " << std::setprecision(6) << out_solve.count() * 1000 << " ms\n";
+    if (!counters.empty()) std::cout << "Counters: " << counters << "\n";  // solver-market-perf.hpp
+    if (!memory.empty()) std::cout << "Memory: " << memory << "\n";        // solver-market-memory.hpp
+    std::cout << "\n";
 
     std::cout << "\n \\-----------------------------/\n";
 
-    // --- Write to file (append mode)
-    std::ofstream outFile("solver_output.log", std::ios::app);
-    if (outFile.is_open()) {
-        outFile << input.str() << " "
-                << std::fixed << std::setprecision(6)
-                << success<< " "
-                << out_setup.count() << " "
-                << out_solve.count() * 1000 << "\n";
-        outFile.close();
-    } else {
+    // --- Write to file (append mode), one write per record: concurrent jobs (solver_market_batch)
+    // append to the same file without interleaving their lines
+    std::ostringstream record;
+    record << input.str() << " "
+           << std::fixed << std::setprecision(6)
+           << success<< " "
+           << out_setup.count() << " "
+           << out_solve.count() * 1000;
+    if (!counters.empty()) record << " " << counters;
+    if (!memory.empty()) record << " " << memory;
+    record << "\n";
+    const std::string line = record.str();
+    const int outFile = ::open("solver_output.log", O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (outFile < 0 || ::write(outFile, line.data(), line.size()) != ssize_t(line.size())) {
         std::cerr << "Error: Could not open solver_output.log for writing.\n";
     }
+    if (outFile >= 0) ::close(outFile);
 }
\ No newline at end of file
@@ -0,0 +1,396 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && !defined(__CUDA_ARCH__)
+#define SOLVER_MARKET_PARSE_X86
+#include <immintrin.h>
+#endif
+
+#include "solver-market-header.hpp"
+
+#pragma once
+
+/* Parsing kernels for Matrix Market bodies.
+
+The readers used one std::istringstream and operator>> per entry: locale aware, virtual
+calls, a few tens of MB/s per core. Here the file is read by blocks cut at line ends,
+each block is split into one chunk per host thread, and every line is parsed in place:
+- newlines are found and counted 32 (AVX2, chosen at run time) or 16 (SSE2) bytes at a time,
+- integers are parsed 8 digits at a time (SWAR): the field length comes from a bit mask,
+  not from a per-character branch, and the field boundary (whitespace) falls out of it,
+- floating point goes through std::from_chars, correctly rounded (Eisel-Lemire fast path
+  with libstdc++ >= 12).
+Every buffer handed to the parsers is followed by SolverMarketParsePadding readable bytes. */
+
+constexpr size_t SolverMarketParsePadding = 64;
+
+// --- Newlines ---
+
+inline size_t SolverMarketCountNewlinesScalar(const char* p, const char* end) {
+  size_t count = 0;
+  for (; p < end; p++) count += (*p == '\n');
+  return count;
+}
+
+inline const char* SolverMarketFindNewlineScalar(const char* p, const char* end) {
+  const void* found = std::memchr(p, '\n', size_t(end - p));
+  return found ? static_cast<const char*>(found) : end;
+}
+
+#ifdef SOLVER_MARKET_PARSE_X86
+inline size_t SolverMarketCountNewlinesSSE2(const char* p, const char* end) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  size_t count = 0;
+  for (; p + 16 <= end; p += 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    count += __builtin_popcount(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline))));
+  }
+  return count + SolverMarketCountNewlinesScalar(p, end);
+}
+
+inline const char* SolverMarketFindNewlineSSE2(const char* p, const char* end) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; p + 16 <= end; p += 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const unsigned mask = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return SolverMarketFindNewlineScalar(p, end);
+}
+
+__attribute__((target("avx2"))) inline size_t SolverMarketCountNewlinesAVX2(const char* p, const char* end) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  size_t count = 0;
+  for (; p + 32 <= end; p += 32) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    count += __builtin_popcount(unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline))));
+  }
+  return count + SolverMarketCountNewlinesScalar(p, end);
+}
+
+__attribute__((target("avx2"))) inline const char* SolverMarketFindNewlineAVX2(const char* p, const char* end) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  for (; p + 32 <= end; p += 32) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return SolverMarketFindNewlineScalar(p, end);
+}
+
+inline bool SolverMarketHasAVX2() {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+#endif
+
+inline size_t SolverMarketCountNewlines(const char* p, const char* end) {
+#ifdef SOLVER_MARKET_PARSE_X86
+  return SolverMarketHasAVX2() ? SolverMarketCountNewlinesAVX2(p, end) : SolverMarketCountNewlinesSSE2(p, end);
+#else
+  return SolverMarketCountNewlinesScalar(p, end);
+#endif
+}
+
+// First '\n' in [p, end), end if none
+inline const char* SolverMarketFindNewline(const char* p, const char* end) {
+#ifdef SOLVER_MARKET_PARSE_X86
+  return SolverMarketHasAVX2() ? SolverMarketFindNewlineAVX2(p, end) : SolverMarketFindNewlineSSE2(p, end);
+#else
+  return SolverMarketFindNewlineScalar(p, end);
+#endif
+}
+
+// --- Fields ---
+
+inline const char* SolverMarketSkipBlanks(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+  return p;
+}
+
+// Blank line, '\r' only, or a '%' comment
+inline bool SolverMarketIsEmptyLine(const char* p, const char* end) {
+  p = SolverMarketSkipBlanks(p, end);
+  return p == end || *p == '%' || *p == '\r';
+}
+
+// Number of leading decimal digits (0..8) in the 8 bytes at p
+inline int SolverMarketLeadingDigits(const uint64_t chunk) {
+  // High bit of each byte set iff the byte is not in '0'..'9'. Carries and borrows only
+  // leak upwards from a non digit byte, past the first one nothing matters.
+  const uint64_t non_digit = ((chunk + 0x4646464646464646ULL) | (chunk - 0x3030303030303030ULL)) & 0x8080808080808080ULL;
+  return non_digit ? (__builtin_ctzll(non_digit) >> 3) : 8;
+}
+
+// Value of the first `digits` characters of chunk (all digits), without a per-digit loop
+inline uint64_t SolverMarketDigitsValue(uint64_t chunk, const int digits) {
+  if (digits == 0) return 0;
+  chunk -= 0x3030303030303030ULL;
+  // Keep the digits and left pad with zeros: "123" -> "00000123"
+  chunk <<= 8 * (8 - digits);
+  chunk = (chunk * 10) + (chunk >> 8);
+  chunk = (((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+         + (((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+  return chunk;
+}
+
+// Integer field at p (leading blanks skipped), p is left after the field. False if no digit
+template <typename _T_>
+inline bool SolverMarketParseInteger(const char*& p, const char* end, _T_& value) {
+  static constexpr uint64_t power10[9] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+  p = SolverMarketSkipBlanks(p, end);
+  const bool negative = (p < end && *p == '-');
+  p += (p < end && (*p == '-' || *p == '+'));
+
+  uint64_t result = 0;
+  int total = 0;
+  for (;;) {
+    uint64_t chunk;
+    std::memcpy(&chunk, p, sizeof(chunk)); /* within the padding*/
+    int digits = SolverMarketLeadingDigits(chunk);
+    digits = std::min<int>(digits, int(end - p));
+    result = result * power10[digits] + SolverMarketDigitsValue(chunk, digits);
+    p += digits;
+    total += digits;
+    if (digits < 8) break;
+  }
+  if (total == 0 || total > 19) return false;
+  if (negative) {
+    if (!std::is_signed<_T_>::value) return false;
+    value = _T_(-int64_t(result));
+  } else {
+    value = _T_(result);
+  }
+  return true;
+}
+
+// Numerical field at p, correctly rounded for floating point
+template <typename _T_>
+inline bool SolverMarketParseValue(const char*& p, const char* end, _T_& value) {
+  p = SolverMarketSkipBlanks(p, end);
+  if (p < end && *p == '+') p++;
+  auto result = std::from_chars(p, end, value);
+  if (result.ec == std::errc::result_out_of_range && std::is_floating_point<_T_>::value) {
+    // Overflow / underflow: same answer as strtod (+-inf, subnormal or 0)
+    char* parsed;
+    value = _T_(std::strtod(p, &parsed));
+    p = parsed;
+    return true;
+  }
+  if (result.ec != std::errc()) return false;
+  p = result.ptr;
+  return true;
+}
+
+// --- Value fields ---
+
+/* Field of the Matrix Market header: what a value looks like in the file. The entry kernels
+below are specialized on it at compile time, so the per-line work only depends on what the
+file holds: nothing for pattern, the SWAR integer parser for integer, from_chars for real,
+two from_chars for complex. */
+enum SolverMarketField {
+    SolverMarketFieldReal,
+    SolverMarketFieldInteger,
+    SolverMarketFieldComplex,
+    SolverMarketFieldPattern
+};
+
+inline int SolverMarketParseFieldName(const std::string& token, SolverMarketField& field) {
+  if (token == "real" || token == "double") field = SolverMarketFieldReal;
+  else if (token == "integer") field = SolverMarketFieldInteger;
+  else if (token == "complex") field = SolverMarketFieldComplex;
+  else if (token == "pattern") field = SolverMarketFieldPattern;
+  else return 1;
+  return 0;
+}
+
+template <typename _T_>
+struct SolverMarketIsComplex : std::false_type {};
+template <typename _T_>
+struct SolverMarketIsComplex<Kokkos::complex<_T_>> : std::true_type {};
+
+// A complex file only fits complex storage, any other field fits every value type
+template <typename _TYPE_>
+inline bool SolverMarketFieldFits(const SolverMarketField field) {
+  return field != SolverMarketFieldComplex || SolverMarketIsComplex<_TYPE_>::value;
+}
+
+// End of a field: blank, end of line or '\r'
+inline bool SolverMarketFieldEnds(const char* p, const char* end) {
+  return p == end || *p == ' ' || *p == '\t' || *p == '\r';
+}
+
+template <SolverMarketField _FIELD_, typename _TYPE_, bool = SolverMarketIsComplex<_TYPE_>::value>
+struct SolverMarketEntryValue;
+
+template <typename _TYPE_, bool _COMPLEX_>
+struct SolverMarketEntryValue<SolverMarketFieldPattern, _TYPE_, _COMPLEX_> {
+  static bool parse(const char*&, const char*, _TYPE_& value) {
+    value = _TYPE_(1);
+    return true;
+  }
+};
+
+template <typename _TYPE_, bool _COMPLEX_>
+struct SolverMarketEntryValue<SolverMarketFieldInteger, _TYPE_, _COMPLEX_> {
+  static bool parse(const char*& p, const char* end, _TYPE_& value) {
+    long long integer;
+    if (!SolverMarketParseInteger(p, end, integer) || !SolverMarketFieldEnds(p, end)) return false;
+    value = _TYPE_(integer);
+    return true;
+  }
+};
+
+template <typename _TYPE_>
+struct SolverMarketEntryValue<SolverMarketFieldReal, _TYPE_, false> {
+  static bool parse(const char*& p, const char* end, _TYPE_& value) { return SolverMarketParseValue(p, end, value); }
+};
+
+template <typename _TYPE_>
+struct SolverMarketEntryValue<SolverMarketFieldReal, _TYPE_, true> {
+  static bool parse(const char*& p, const char* end, _TYPE_& value) {
+    typename _TYPE_::value_type re;
+    if (!SolverMarketParseValue(p, end, re)) return false;
+    value = _TYPE_(re, 0);
+    return true;
+  }
+};
+
+template <typename _TYPE_>
+struct SolverMarketEntryValue<SolverMarketFieldComplex, _TYPE_, true> {
+  static bool parse(const char*& p, const char* end, _TYPE_& value) {
+    typename _TYPE_::value_type re, im;
+    if (!SolverMarketParseValue(p, end, re) || !SolverMarketParseValue(p, end, im)) return false;
+    value = _TYPE_(re, im);
+    return true;
+  }
+};
+
+// Rejected by SolverMarketFieldFits before any line is parsed
+template <typename _TYPE_>
+struct SolverMarketEntryValue<SolverMarketFieldComplex, _TYPE_, false> {
+  static bool parse(const char*&, const char*, _TYPE_&) { return false; }
+};
+
+// kernel(std::integral_constant<SolverMarketField, F>()) for the field read at run time
+template <typename _KERNEL_>
+inline int SolverMarketDispatchField(const SolverMarketField field, const _KERNEL_& kernel) {
+  switch (field) {
+    case SolverMarketFieldPattern: return kernel(std::integral_constant<SolverMarketField, SolverMarketFieldPattern>());
+    case SolverMarketFieldInteger: return kernel(std::integral_constant<SolverMarketField, SolverMarketFieldInteger>());
+    case SolverMarketFieldComplex: return kernel(std::integral_constant<SolverMarketField, SolverMarketFieldComplex>());
+    default: return kernel(std::integral_constant<SolverMarketField, SolverMarketFieldReal>());
+  }
+}
+
+// --- Body driver ---
+
+/* Parse the remainder of `in` line by line, blocks of about block_bytes at a time.
+For each block:
+  reserve(first, nlines)  -> the caller makes room for slots [first, first + nlines)
+  parse_line(begin, end, slot) in parallel over host threads, one call per line (no '\n'),
+      returns 0 if the line was stored in `slot`, -1 if skipped (blank, comment), > 0 on error
+  move_slot(from, to)     -> compaction when some lines were skipped
+`stored` is the number of slots filled (slots past it are garbage). Returns 0, or the error
+of the first failing line. */
+template <typename _RESERVE_, typename _PARSE_, typename _MOVE_>
+int SolverMarketParseBody(std::istream& in, const _RESERVE_& reserve, const _PARSE_& parse_line, const _MOVE_& move_slot,
+                          size_t& stored, const size_t block_bytes = size_t(64) << 20) {
+  stored = 0;
+  std::vector<char> buffer;
+  size_t carry = 0; /* partial line kept from the previous block*/
+  const size_t nthreads = size_t(Host().concurrency());
+
+  bool eof = false;
+  while (!eof) {
+    // Fill the block after the carried bytes
+    buffer.resize(carry + block_bytes + SolverMarketParsePadding);
+    in.read(buffer.data() + carry, std::streamsize(block_bytes));
+    const size_t size = carry + size_t(in.gcount());
+    eof = !in;
+    if (size == 0) break;
+
+    // Cut after the last complete line, the rest waits for the next block
+    size_t cut = size;
+    if (!eof) {
+      const char* last = buffer.data() + size;
+      while (last > buffer.data() && last[-1] != '\n') last--;
+      cut = size_t(last - buffer.data());
+      if (cut == 0) { /* one line longer than the block: read more*/
+        carry = size;
+        continue;
+      }
+    }
+    std::memset(buffer.data() + size, 0, SolverMarketParsePadding);
+    const char* begin = buffer.data();
+    const char* end = begin + cut;
+
+    // Chunks of whole lines, about one per thread (at least 64 kB each)
+    const size_t nchunks = std::max<size_t>(1, std::min(4 * nthreads, cut / (size_t(64) << 10)));
+    std::vector<const char*> bounds(nchunks + 1, end);
+    bounds[0] = begin;
+    for (size_t c = 1; c < nchunks; c++) {
+      const char* p = begin + c * (cut / nchunks);
+      p = std::max(p, bounds[c - 1]);
+      p = SolverMarketFindNewline(p, end);
+      bounds[c] = (p < end) ? p + 1 : end;
+    }
+
+    std::vector<size_t> chunk_lines(nchunks + 1, 0), chunk_stored(nchunks, 0);
+    std::vector<int> chunk_status(nchunks, 0);
+    Kokkos::parallel_for("SolverMarket::count_lines", Kokkos::RangePolicy<Host>(0, nchunks), [&](const size_t c) {
+      const size_t n = SolverMarketCountNewlines(bounds[c], bounds[c + 1]);
+      chunk_lines[c + 1] = n + (bounds[c + 1] > bounds[c] && bounds[c + 1][-1] != '\n');
+    });
+    for (size_t c = 0; c < nchunks; c++) chunk_lines[c + 1] += chunk_lines[c];
+
+    const size_t base = stored;
+    reserve(base, chunk_lines[nchunks]);
+
+    Kokkos::parallel_for("SolverMarket::parse_lines", Kokkos::RangePolicy<Host>(0, nchunks), [&](const size_t c) {
+      size_t slot = base + chunk_lines[c];
+      const char* p = bounds[c];
+      const char* chunk_end = bounds[c + 1];
+      while (p < chunk_end) {
+        const char* line_end = SolverMarketFindNewline(p, chunk_end);
+        const int status = parse_line(p, line_end, slot);
+        if (status > 0) {
+          chunk_status[c] = status;
+          return;
+        }
+        if (status == 0) slot++;
+        p = line_end + 1;
+      }
+      chunk_stored[c] = slot - (base + chunk_lines[c]);
+    });
+
+    for (size_t c = 0; c < nchunks; c++) {
+      if (chunk_status[c]) return chunk_status[c];
+    }
+
+    // Compact the slots of skipped lines (rare: comments inside the body)
+    size_t next = base;
+    for (size_t c = 0; c < nchunks; c++) {
+      const size_t first = base + chunk_lines[c];
+      if (next != first) {
+        for (size_t s = 0; s < chunk_stored[c]; s++) move_slot(first + s, next + s);
+      }
+      next += chunk_stored[c];
+    }
+    stored = next;
+
+    // Keep the partial line
+    carry = size - cut;
+    std::memmove(buffer.data(), buffer.data() + cut, carry);
+  }
+  return 0;
+}
@@ -0,0 +1,343 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define SOLVER_MARKET_HAVE_PERF_EVENTS
+#endif
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include "solver-market-header.hpp"
+
+#pragma once
+
+/* Hardware counters around the phases of a run (Linux perf_event_open).
+
+One counter group per host thread (the OpenMP threads of Kokkos, or the calling thread):
+cycles, instructions, last level cache references and misses, branches and branch misses,
+user space only so that perf_event_paranoid <= 2 is enough. Counters run from the first
+use to the end of the process; a region reads them at its start and at its end, so regions
+can nest (read > read:parse) and cost two reads per thread.
+
+  SolverMarketPerf::instance().set_enabled(true);      // --perf, or SOLVER_MARKET_PERF=1
+  { SolverMarketPerfRegion region("setup"); ... }
+  SolverMarketPerf::instance().set_flops("solve", 2.0 * nnz * iterations);
+  SolverMarketPerf::instance().summary();              // appended to the output record
+
+Derived metrics per phase: IPC, LLC miss ratio, DRAM GB/s estimated as 64 B per LLC miss,
+branch miss ratio, and flop/byte when the caller gives the flop count of the phase. Counters
+only see host threads: on GPU backends the solve phase mostly measures the waiting host.
+Without counters (not Linux, no PMU in a VM, perf_event_paranoid > 2) regions only time the
+phase and the record says perf=unavailable. */
+
+enum SolverMarketPerfEvent {
+    SolverMarketPerfCycles,
+    SolverMarketPerfInstructions,
+    SolverMarketPerfCacheReferences, /* last level cache*/
+    SolverMarketPerfCacheMisses,     /* last level cache*/
+    SolverMarketPerfBranches,
+    SolverMarketPerfBranchMisses,
+    SolverMarketPerfEventCount
+};
+
+inline const char* SolverMarketPerfEventName(const int event)
+{
+    static const char* names[SolverMarketPerfEventCount] = {"cycles", "instructions", "llc_references", "llc_misses",
+                                                            "branches", "branch_misses"};
+    return (event >= 0 && event < SolverMarketPerfEventCount) ? names[event] : "unknown";
+}
+
+struct SolverMarketPerfSample {
+    double seconds = 0;
+    double counts[SolverMarketPerfEventCount] = {};  /* scaled for multiplexing*/
+    bool counted[SolverMarketPerfEventCount] = {};
+    double flops = 0;                                /* given by the caller, 0 if unknown*/
+
+    bool has(const int event) const { return counted[event]; }
+    double ratio(const int num, const int den) const {
+        return (has(num) && has(den) && counts[den] > 0) ? counts[num] / counts[den] : 0.0;
+    }
+    double ipc() const { return ratio(SolverMarketPerfInstructions, SolverMarketPerfCycles); }
+    double llc_miss_ratio() const { return ratio(SolverMarketPerfCacheMisses, SolverMarketPerfCacheReferences); }
+    double branch_miss_ratio() const { return ratio(SolverMarketPerfBranchMisses, SolverMarketPerfBranches); }
+    double dram_bytes() const { return has(SolverMarketPerfCacheMisses) ? 64.0 * counts[SolverMarketPerfCacheMisses] : 0.0; }
+    double dram_gbs() const { return seconds > 0 ? dram_bytes() / seconds / 1e9 : 0.0; }
+    double flop_per_byte() const { return (flops > 0 && dram_bytes() > 0) ? flops / dram_bytes() : 0.0; }
+
+    SolverMarketPerfSample& operator+=(const SolverMarketPerfSample& other) {
+        seconds += other.seconds;
+        flops += other.flops;
+        for (int e = 0; e < SolverMarketPerfEventCount; e++) {
+            counts[e] += other.counts[e];
+            counted[e] = counted[e] || other.counted[e];
+        }
+        return *this;
+    }
+
+    // phase:ipc=1.52,llc_miss=0.31,gbs=12.4,branch_miss=0.012,flop_per_byte=0.16 (what is known)
+    std::string summary(const std::string& phase) const {
+        std::ostringstream out;
+        out << phase << ":s=" << seconds;
+        if (has(SolverMarketPerfCycles) && has(SolverMarketPerfInstructions)) out << ",ipc=" << ipc();
+        if (has(SolverMarketPerfCacheReferences) && has(SolverMarketPerfCacheMisses)) out << ",llc_miss=" << llc_miss_ratio();
+        if (has(SolverMarketPerfCacheMisses)) out << ",gbs=" << dram_gbs();
+        if (has(SolverMarketPerfBranches) && has(SolverMarketPerfBranchMisses)) out << ",branch_miss=" << branch_miss_ratio();
+        if (flop_per_byte() > 0) out << ",flop_per_byte=" << flop_per_byte();
+        return out.str();
+    }
+};
+
+/* Counter groups of the host threads, opened by the constructor and closed by the destructor.
+read() gives the running totals, a sample is the difference of two reads */
+class SolverMarketPerfCounters {
+public:
+    struct Reading {
+        double seconds = 0;
+        double counts[SolverMarketPerfEventCount] = {};
+    };
+
+    SolverMarketPerfCounters() {
+#if defined(SOLVER_MARKET_HAVE_PERF_EVENTS)
+#if defined(_OPENMP)
+        groups_.resize(omp_get_max_threads());
+#pragma omp parallel
+        open_group(groups_[omp_get_thread_num()]);
+#else
+        groups_.resize(1);
+        open_group(groups_[0]);
+#endif
+        for (const auto& group : groups_) {
+            for (int e = 0; e < SolverMarketPerfEventCount; e++) counted_[e] = counted_[e] || group.index[e] >= 0;
+            if (group.leader >= 0) available_ = true;
+        }
+#endif
+    }
+
+    ~SolverMarketPerfCounters() {
+        for (auto& group : groups_) {
+            for (const int fd : group.fds) close_fd(fd);
+        }
+    }
+
+    SolverMarketPerfCounters(const SolverMarketPerfCounters&) = delete;
+    SolverMarketPerfCounters& operator=(const SolverMarketPerfCounters&) = delete;
+
+    bool available() const { return available_; }
+    bool counted(const int event) const { return counted_[event]; }
+    const std::string& error() const { return error_; }
+
+    // Totals of every thread since the groups were opened
+    Reading read() const {
+        Reading reading;
+        reading.seconds = wall_seconds();
+#if defined(SOLVER_MARKET_HAVE_PERF_EVENTS)
+        for (const auto& group : groups_) {
+            if (group.leader < 0) continue;
+            // PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING: nr, enabled, running, values
+            uint64_t data[3 + SolverMarketPerfEventCount] = {};
+            if (::read(group.leader, data, sizeof(data)) < ssize_t(3 * sizeof(uint64_t))) continue;
+            const double scale = (data[2] > 0) ? double(data[1]) / double(data[2]) : 0.0;  /* multiplexed groups*/
+            for (int e = 0; e < SolverMarketPerfEventCount; e++) {
+                if (group.index[e] >= 0 && uint64_t(group.index[e]) < data[0]) reading.counts[e] += scale * double(data[3 + group.index[e]]);
+            }
+        }
+#endif
+        return reading;
+    }
+
+    SolverMarketPerfSample sample(const Reading& begin, const Reading& end) const {
+        SolverMarketPerfSample sample;
+        sample.seconds = end.seconds - begin.seconds;
+        for (int e = 0; e < SolverMarketPerfEventCount; e++) {
+            sample.counted[e] = counted_[e];
+            sample.counts[e] = counted_[e] ? end.counts[e] - begin.counts[e] : 0.0;
+        }
+        return sample;
+    }
+
+private:
+    struct Group {
+        int leader = -1;
+        std::vector<int> fds;
+        int index[SolverMarketPerfEventCount] = {-1, -1, -1, -1, -1, -1}; /* position in the group read, -1 if not counted*/
+    };
+
+    std::vector<Group> groups_;
+    bool available_ = false;
+    bool counted_[SolverMarketPerfEventCount] = {};
+    std::string error_;
+    std::mutex mutex_;
+
+    static double wall_seconds() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void close_fd(const int fd) {
+#if defined(SOLVER_MARKET_HAVE_PERF_EVENTS)
+        if (fd >= 0) ::close(fd);
+#else
+        (void)fd;
+#endif
+    }
+
+#if defined(SOLVER_MARKET_HAVE_PERF_EVENTS)
+    // Counters of the calling thread. An event the CPU does not have is left out of the group
+    void open_group(Group& group) {
+        static const uint64_t configs[SolverMarketPerfEventCount] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_REFERENCES,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+        int position = 0;
+        for (int e = 0; e < SolverMarketPerfEventCount; e++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[e];
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.disabled = (group.leader < 0) ? 1 : 0;
+            const int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, group.leader, 0));
+            if (fd < 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (error_.empty()) error_ = std::string(SolverMarketPerfEventName(e)) + ": " + std::strerror(errno);
+                continue;
+            }
+            if (group.leader < 0) group.leader = fd;
+            group.fds.push_back(fd);
+            group.index[e] = position++;
+        }
+        if (group.leader >= 0) ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+};
+
+/* Counters and per-phase samples of the process. Disabled unless set_enabled(true) or
+SOLVER_MARKET_PERF=1; the counters are opened at the first region */
+class SolverMarketPerf {
+public:
+    static SolverMarketPerf& instance() {
+        static SolverMarketPerf perf;
+        return perf;
+    }
+
+    bool enabled() const { return enabled_; }
+    void set_enabled(const bool enabled) { enabled_ = enabled; }
+
+    // nullptr when disabled. Warns once if the counters cannot be opened
+    SolverMarketPerfCounters* counters() {
+        if (!enabled_) return nullptr;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!counters_) {
+            counters_.reset(new SolverMarketPerfCounters());
+            if (!counters_->available()) {
+                std::cout << "[Warning][SolverMarket][Perf] Hardware counters unavailable (" << counters_->error()
+                          << "), phases are only timed. See /proc/sys/kernel/perf_event_paranoid\n";
+            }
+        }
+        return counters_.get();
+    }
+
+    // Samples of a phase add up (repeated solves, several reads)
+    void record(const std::string& phase, const SolverMarketPerfSample& sample) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = phases_.find(phase);
+        if (it == phases_.end()) {
+            order_.push_back(phase);
+            phases_[phase] = sample;
+        } else {
+            it->second += sample;
+        }
+    }
+
+    void set_flops(const std::string& phase, const double flops) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = phases_.find(phase);
+        if (it != phases_.end()) it->second.flops = flops;
+    }
+
+    bool sample(const std::string& phase, SolverMarketPerfSample& sample) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = phases_.find(phase);
+        if (it == phases_.end()) return false;
+        sample = it->second;
+        return true;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        phases_.clear();
+        order_.clear();
+    }
+
+    // perf[read:s=0.21,ipc=1.1,...;setup:...;solve:...], empty when disabled
+    std::string summary() {
+        if (!enabled_) return "";
+        const bool available = counters() && counters()->available();
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string out = available ? "perf[" : "perf=unavailable[";
+        for (size_t p = 0; p < order_.size(); p++) {
+            if (p > 0) out += ";";
+            out += phases_[order_[p]].summary(order_[p]);
+        }
+        return out + "]";
+    }
+
+    void print() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& phase : order_) {
+            std::cout << "[Info][SolverMarket][Perf] " << phases_[phase].summary(phase) << "\n";
+        }
+    }
+
+private:
+    SolverMarketPerf() {
+        const char* env = std::getenv("SOLVER_MARKET_PERF");
+        enabled_ = env && std::string(env) != "0";
+    }
+
+    bool enabled_ = false;
+    std::mutex mutex_;
+    std::unique_ptr<SolverMarketPerfCounters> counters_;
+    std::map<std::string, SolverMarketPerfSample> phases_;
+    std::vector<std::string> order_;
+};
+
+/* Counters of one phase, from construction to destruction (or stop()). No-op when disabled */
+class SolverMarketPerfRegion {
+public:
+    explicit SolverMarketPerfRegion(const std::string& phase)
+        : phase_(phase), counters_(SolverMarketPerf::instance().counters()) {
+        if (counters_) begin_ = counters_->read();
+    }
+    ~SolverMarketPerfRegion() { stop(); }
+
+    SolverMarketPerfRegion(const SolverMarketPerfRegion&) = delete;
+    SolverMarketPerfRegion& operator=(const SolverMarketPerfRegion&) = delete;
+
+    void stop() {
+        if (!counters_) return;
+        SolverMarketPerf::instance().record(phase_, counters_->sample(begin_, counters_->read()));
+        counters_ = nullptr;
+    }
+
+private:
+    std::string phase_;
+    SolverMarketPerfCounters* counters_;
+    SolverMarketPerfCounters::Reading begin_;
+};
@@ -0,0 +1,318 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "solver-market-header.hpp"
+
+#pragma once
+
+/* Capacity based pool for the storage of matrices and vectors.
+
+Loading thousands of matrices in one process used to allocate (and zero) brand new
+host and device Views for every file, plus the COO scratch of the parser. Buffers
+are now taken from per-(type, space) free lists: a request is served by the
+smallest idle buffer large enough (and not more than twice too large), and a
+buffer goes back to the pool when its owner is destroyed or reloaded, unless
+someone still holds a reference to it (e.g. a View returned by a getter).
+
+Idle buffers are freed by clear(), which is hooked to Kokkos::finalize. At most
+SolverMarketDefaultMaxIdleBytes (SOLVER_MARKET_POOL_MAX_IDLE_MB) sit idle, so the
+COO scratch of one large read does not stay resident for the rest of the process. */
+
+constexpr uint64_t SolverMarketDefaultMaxIdleBytes = uint64_t(1) << 30;
+
+struct SolverMarketPoolStatistics {
+  uint64_t hits = 0;           /* requests served by an idle buffer*/
+  uint64_t misses = 0;         /* requests that needed a new allocation*/
+  uint64_t releases = 0;       /* buffers given back to the pool*/
+  uint64_t bytes_reserved = 0; /* bytes of the buffers owned by the pool, in use or idle*/
+  uint64_t bytes_idle = 0;     /* bytes of the idle buffers*/
+  uint64_t peak_bytes_reserved = 0;
+};
+
+class SolverMarketBufferPool {
+public:
+
+  static SolverMarketBufferPool& instance() {
+    static SolverMarketBufferPool pool;
+    return pool;
+  }
+
+  bool enabled() const { return enabled_; }
+  // Switched off before the idle buffers are freed, so no release lands in a cleared pool
+  void set_enabled(bool enabled) {
+    enabled_ = enabled;
+    if (!enabled) clear();
+  }
+
+  // Idle bytes above this limit are freed instead of pooled
+  void set_max_idle_bytes(uint64_t bytes) { max_idle_bytes_ = bytes; }
+  uint64_t get_max_idle_bytes() const { return max_idle_bytes_; }
+
+  SolverMarketPoolStatistics statistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+  void reset_statistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.hits = stats_.misses = stats_.releases = 0;
+    stats_.peak_bytes_reserved = stats_.bytes_reserved;
+  }
+
+  // Free every idle buffer of every typed pool
+  void clear() {
+    std::vector<std::function<void()>> clears;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      clears = clears_;
+    }
+    for (auto& c : clears) c();
+  }
+
+  void print_statistics() {
+    auto s = statistics();
+    std::cout << "[Info][SolverMarket][BufferPool][statistics] hits " << s.hits << ", misses " << s.misses
+              << ", releases " << s.releases << ", reserved " << s.bytes_reserved << " B (peak "
+              << s.peak_bytes_reserved << " B), idle " << s.bytes_idle << " B\n";
+  }
+
+  // --- Bookkeeping, used by the typed pools ---
+  void register_clear(std::function<void()> clear_function) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (clears_.empty()) Kokkos::push_finalize_hook([]() { SolverMarketBufferPool::instance().clear(); });
+    clears_.push_back(clear_function);
+  }
+
+  void on_hit(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.hits++;
+    stats_.bytes_idle -= bytes;
+  }
+
+  void on_miss(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.misses++;
+    stats_.bytes_reserved += bytes;
+    if (stats_.bytes_reserved > stats_.peak_bytes_reserved) stats_.peak_bytes_reserved = stats_.bytes_reserved;
+  }
+
+  // Returns false if the buffer should be freed instead of pooled
+  bool on_release(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_ || stats_.bytes_idle + bytes > max_idle_bytes_) {
+      stats_.bytes_reserved -= bytes;
+      return false;
+    }
+    stats_.releases++;
+    stats_.bytes_idle += bytes;
+    return true;
+  }
+
+  // Buffers entering the pool untracked: grown scratch vectors (accounted for while idle
+  // only) and shared Views whose last owner gave them back
+  bool on_adopt(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_ || stats_.bytes_idle + bytes > max_idle_bytes_) return false;
+    stats_.releases++;
+    stats_.bytes_idle += bytes;
+    stats_.bytes_reserved += bytes;
+    if (stats_.bytes_reserved > stats_.peak_bytes_reserved) stats_.peak_bytes_reserved = stats_.bytes_reserved;
+    return true;
+  }
+
+  // A pooled buffer that left the pool for good (still referenced elsewhere, or cleared)
+  void on_forget(uint64_t bytes, bool idle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.bytes_reserved -= bytes;
+    if (idle) stats_.bytes_idle -= bytes;
+  }
+
+  // Round up to a quarter of the leading power of two: <= 25% waste, better reuse across close sizes
+  static size_t round_capacity(size_t n) {
+    if (n < 64) return 64;
+    size_t p = 1;
+    while ((p << 1) <= n) p <<= 1;
+    const size_t step = p >> 2;
+    return (n + step - 1) / step * step;
+  }
+
+private:
+  SolverMarketBufferPool() {
+    const char* env = std::getenv("SOLVER_MARKET_DISABLE_POOL");
+    enabled_ = !(env && std::string(env) != "0");
+    const char* idle_mb = std::getenv("SOLVER_MARKET_POOL_MAX_IDLE_MB");
+    if (idle_mb) max_idle_bytes_ = std::strtoull(idle_mb, nullptr, 10) << 20;
+  }
+
+  std::mutex mutex_;
+  // Read without mutex_ by the typed pools, may be changed while another thread loads
+  std::atomic<bool> enabled_{true};
+  std::atomic<uint64_t> max_idle_bytes_{SolverMarketDefaultMaxIdleBytes};
+  SolverMarketPoolStatistics stats_;
+  std::vector<std::function<void()>> clears_;
+};
+
+/* Free list of 1D Views of one type in one space, best fit on capacity */
+template <typename _TYPE_, typename _SPACE_>
+class SolverMarketViewPool {
+public:
+  using view_type = Kokkos::View<_TYPE_*, _SPACE_>;
+
+  static SolverMarketViewPool& instance() {
+    static SolverMarketViewPool pool;
+    return pool;
+  }
+
+  // Returns a View of capacity >= n (its extent), not initialized unless `zero`.
+  // `fresh` tells whether it is a new allocation (pages not touched yet) or a pooled buffer
+  view_type acquire(const std::string& label, const size_t n, const bool zero = false, bool* fresh = nullptr) {
+    auto& registry = SolverMarketBufferPool::instance();
+    view_type view;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = idle_.lower_bound(n);
+      if (registry.enabled() && it != idle_.end() && it->first <= 2 * n + 64) {
+        view = it->second;
+        idle_.erase(it);
+        outstanding_.insert(view.data());
+        registry.on_hit(bytes(view));
+      }
+    }
+    if (fresh) *fresh = (view.data() == nullptr);
+    if (view.data() == nullptr) {
+      const size_t capacity = registry.enabled() ? SolverMarketBufferPool::round_capacity(n) : n;
+      view = view_type(Kokkos::view_alloc(Kokkos::WithoutInitializing, label), capacity);
+      if (registry.enabled() && view.data() != nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        outstanding_.insert(view.data());
+        registry.on_miss(bytes(view));
+      }
+    }
+    if (zero) Kokkos::deep_copy(Kokkos::subview(view, std::make_pair(size_t(0), n)), _TYPE_(0));
+    return view;
+  }
+
+  /* Give `view` back (and reset it). Only pooled if nobody else references the allocation:
+  a buffer still shared (copied owner, View kept from a getter) leaves the accounting, and
+  is adopted again if its last owner releases it. */
+  void release(view_type& view) {
+    if (view.data() == nullptr) return;
+    auto& registry = SolverMarketBufferPool::instance();
+    std::lock_guard<std::mutex> lock(mutex_);
+    const bool tracked = outstanding_.erase(view.data()) > 0;
+    if (view.use_count() == 1 && Kokkos::is_initialized()) {
+      const bool pooled = tracked ? registry.on_release(bytes(view)) : registry.on_adopt(bytes(view));
+      if (pooled) idle_.emplace(view.extent(0), view);
+    } else if (tracked) {
+      registry.on_forget(bytes(view), false);
+    }
+    view = view_type();
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : idle_) SolverMarketBufferPool::instance().on_forget(bytes(entry.second), true);
+    idle_.clear();
+  }
+
+private:
+  SolverMarketViewPool() {
+    SolverMarketBufferPool::instance().register_clear([this]() { clear(); });
+  }
+
+  static uint64_t bytes(const view_type& view) { return uint64_t(view.extent(0)) * sizeof(_TYPE_); }
+
+  std::mutex mutex_;
+  std::multimap<size_t, view_type> idle_;
+  std::unordered_set<const void*> outstanding_; /* handed out and accounted as reserved*/
+};
+
+/* Free list of std::vector scratch (parser COO entries, row fill counters).
+The capacity survives between loads, only the size is reset. Their bytes are
+counted in the statistics while they sit in the pool. */
+template <typename _TYPE_>
+class SolverMarketScratchPool {
+public:
+
+  static SolverMarketScratchPool& instance() {
+    static SolverMarketScratchPool pool;
+    return pool;
+  }
+
+  std::vector<_TYPE_> acquire(const size_t expected_size = 0) {
+    std::vector<_TYPE_> scratch;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!idle_.empty()) {
+        scratch = std::move(idle_.back());
+        idle_.pop_back();
+      }
+    }
+    auto& registry = SolverMarketBufferPool::instance();
+    const uint64_t before = scratch.capacity() * sizeof(_TYPE_);
+    if (before > 0) {
+      registry.on_forget(before, true);
+    }
+    if (registry.enabled() && before > 0 && scratch.capacity() >= expected_size) {
+      registry.on_hit(0);
+    } else {
+      std::vector<_TYPE_>().swap(scratch);
+      scratch.reserve(expected_size);
+      if (registry.enabled()) registry.on_miss(0);
+    }
+    scratch.clear();
+    return scratch;
+  }
+
+  void release(std::vector<_TYPE_>& scratch) {
+    auto& registry = SolverMarketBufferPool::instance();
+    const uint64_t capacity = scratch.capacity() * sizeof(_TYPE_);
+    if (capacity > 0 && registry.enabled()) {
+      if (registry.on_adopt(capacity)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(std::move(scratch));
+      }
+    }
+    std::vector<_TYPE_>().swap(scratch);
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& s : idle_) SolverMarketBufferPool::instance().on_forget(s.capacity() * sizeof(_TYPE_), true);
+    idle_.clear();
+  }
+
+private:
+  SolverMarketScratchPool() {
+    SolverMarketBufferPool::instance().register_clear([this]() { clear(); });
+  }
+
+  std::mutex mutex_;
+  std::vector<std::vector<_TYPE_>> idle_;
+};
+
+/* Scope guard: takes a scratch vector from the pool and gives it back on every return path */
+template <typename _TYPE_>
+class SolverMarketPooledScratch {
+public:
+  explicit SolverMarketPooledScratch(const size_t expected_size = 0)
+      : scratch_(SolverMarketScratchPool<_TYPE_>::instance().acquire(expected_size)) {}
+  ~SolverMarketPooledScratch() { SolverMarketScratchPool<_TYPE_>::instance().release(scratch_); }
+
+  SolverMarketPooledScratch(const SolverMarketPooledScratch&) = delete;
+  SolverMarketPooledScratch& operator=(const SolverMarketPooledScratch&) = delete;
+
+  std::vector<_TYPE_>& get() { return scratch_; }
+
+private:
+  std::vector<_TYPE_> scratch_;
+};
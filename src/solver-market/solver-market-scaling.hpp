@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-vector.hpp"
+
+#pragma once
+
+/* Equilibration of A x = b before the solve: the solver sees (D_r A D_c) y = D_r b and the solution
+is x = D_c y. Coefficient jumps of many orders of magnitude otherwise cost the vendor solvers
+hundreds of iterations.
+
+  jacobi  D_r = D_c = |diag(A)|^-1/2 : unit diagonal, symmetry kept (CG, AMG)
+  ruiz    iterative infinity-norm equilibration (Ruiz 2001): every row and column of the scaled
+          matrix has a max entry close to 1. On a symmetric matrix D_r = D_c, symmetry is kept
+
+  SolverMarketScaling<double, int> scaling(SolverMarketScalingRuiz);
+  scaling.apply(A);              // host values, then A.send_to_device()
+  scaling.scale_rhs(b);          // host values, then b.send_to_device()
+  ... solve ...
+  scaling.unscale_solution(x);   // host values of the solution of the scaled system
+
+Tolerances of the solvers then apply to the residual of the scaled system. */
+
+enum SolverMarketScalingMethod {
+    SolverMarketScalingNone,
+    SolverMarketScalingJacobi,
+    SolverMarketScalingRuiz
+};
+
+inline const char* SolverMarketScalingName(const SolverMarketScalingMethod method)
+{
+    switch (method) {
+        case SolverMarketScalingJacobi: return "jacobi";
+        case SolverMarketScalingRuiz: return "ruiz";
+        default: return "none";
+    }
+}
+
+inline int SolverMarketParseScaling(const std::string& name, SolverMarketScalingMethod& method)
+{
+    if (name == "none") method = SolverMarketScalingNone;
+    else if (name == "jacobi") method = SolverMarketScalingJacobi;
+    else if (name == "ruiz") method = SolverMarketScalingRuiz;
+    else return 1;
+    return 0;
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+class SolverMarketScaling {
+public:
+  explicit SolverMarketScaling(SolverMarketScalingMethod method = SolverMarketScalingNone, int max_iterations = 20, double tolerance = 1e-2)
+      : method_(method), max_iterations_(max_iterations), tolerance_(tolerance) {}
+
+  // A <- D_r A D_c on the host values (the pattern is unchanged)
+  int apply(SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& A);
+
+  // b <- D_r b and x <- D_c x, host values. The vector must have the size of the scaled matrix
+  int scale_rhs(SolverMarketVector<_TYPE_, _ITYPE_>& b) const { return multiply(b, row_scale_); }
+  int unscale_solution(SolverMarketVector<_TYPE_, _ITYPE_>& x) const { return multiply(x, col_scale_); }
+
+  SolverMarketScalingMethod method() const { return method_; }
+  const std::vector<_TYPE_>& row_scale() const { return row_scale_; }
+  const std::vector<_TYPE_>& col_scale() const { return col_scale_; }
+  int iterations() const { return iterations_; }
+  double deviation() const { return deviation_; }  /* max |1 - row/col max| of the scaled matrix (ruiz)*/
+  double elapsed_ms() const { return elapsed_ms_; }
+
+  void print() const {
+    std::cout << "[Info][SolverMarket][Scaling] " << SolverMarketScalingName(method_) << " in " << elapsed_ms_ << " ms";
+    if (method_ == SolverMarketScalingRuiz) std::cout << ", " << iterations_ << " iterations, max |1 - norm| " << deviation_;
+    if (!row_scale_.empty()) {
+      auto range = std::minmax_element(row_scale_.begin(), row_scale_.end());
+      std::cout << ", row scale in [" << *range.first << ", " << *range.second << "]";
+    }
+    if (zero_diagonal_) std::cout << ", " << zero_diagonal_ << " zero diagonal entries left unscaled";
+    std::cout << std::endl;
+  }
+
+private:
+  SolverMarketScalingMethod method_;
+  int max_iterations_;
+  double tolerance_;
+
+  std::vector<_TYPE_> row_scale_, col_scale_;
+  int iterations_ = 0;
+  double deviation_ = 0;
+  double elapsed_ms_ = 0;
+  size_t zero_diagonal_ = 0;
+
+  int multiply(SolverMarketVector<_TYPE_, _ITYPE_>& v, const std::vector<_TYPE_>& scale) const;
+  void jacobi(SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& A);
+  void ruiz(SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& A);
+};
+
+#include "solver-market-scaling.tpp"
@@ -0,0 +1,110 @@
+template <typename _TYPE_, typename _ITYPE_>
+int SolverMarketScaling<_TYPE_, _ITYPE_>::apply(SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& A)
+{
+    const size_t n = A.get_n();
+    row_scale_.assign(n, _TYPE_(1));
+    col_scale_.assign(n, _TYPE_(1));
+    iterations_ = 0;
+    deviation_ = 0;
+    zero_diagonal_ = 0;
+    if (method_ == SolverMarketScalingNone) return 0;
+    if (A.isShared()) {
+        // Writing the values would change the producer's segment
+        std::cerr << "[Error][SolverMarket][Scaling] The matrix maps a shared segment, scale a copy of it" << std::endl;
+        return 1;
+    }
+    if (!A.isFull()) {
+        std::cerr << "[Error][SolverMarket][Scaling] Needs a matrix stored in full (both triangles)" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (method_ == SolverMarketScalingJacobi) jacobi(A);
+    else ruiz(A);
+
+    const _ITYPE_* offsets = A.get_host_offsets_pointer();
+    const _ITYPE_* columns = A.get_host_columns_pointer();
+    _TYPE_* values = A.get_host_values_pointer();
+    const _TYPE_* r = row_scale_.data();
+    const _TYPE_* c = col_scale_.data();
+    Kokkos::parallel_for("SolverMarket::scale_matrix", Kokkos::RangePolicy<Host>(0, n), [&](const size_t i) {
+        for (_ITYPE_ k = offsets[i]; k < offsets[i + 1]; k++) values[k] *= r[i] * c[columns[k]];
+    });
+    elapsed_ms_ = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return 0;
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketScaling<_TYPE_, _ITYPE_>::jacobi(SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& A)
+{
+    const size_t n = A.get_n();
+    const _ITYPE_* offsets = A.get_host_offsets_pointer();
+    const _ITYPE_* columns = A.get_host_columns_pointer();
+    const _TYPE_* values = A.get_host_values_pointer();
+    size_t zero_diagonal = 0;
+    Kokkos::parallel_reduce("SolverMarket::jacobi_scale", Kokkos::RangePolicy<Host>(0, n), [&](const size_t i, size_t& zeros) {
+        _TYPE_ diagonal = 0;
+        for (_ITYPE_ k = offsets[i]; k < offsets[i + 1]; k++)
+            if (size_t(columns[k]) == i) diagonal += values[k];
+        if (diagonal == _TYPE_(0)) zeros++;
+        else row_scale_[i] = _TYPE_(1) / std::sqrt(std::abs(diagonal));
+    }, zero_diagonal);
+    zero_diagonal_ = zero_diagonal;
+    col_scale_ = row_scale_;
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketScaling<_TYPE_, _ITYPE_>::ruiz(SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& A)
+{
+    const size_t n = A.get_n();
+    const _ITYPE_* offsets = A.get_host_offsets_pointer();
+    const _ITYPE_* columns = A.get_host_columns_pointer();
+    const _TYPE_* values = A.get_host_values_pointer();
+    _TYPE_* r = row_scale_.data();
+    _TYPE_* c = col_scale_.data();
+    std::vector<_TYPE_> row_max(n), col_max(n);
+
+    // Each sweep reads A once: max |r_i a_ij c_j| by row, and by column through atomics, then
+    // r_i /= sqrt(row max), c_j /= sqrt(col max). A itself is only scaled at the end
+    for (iterations_ = 0; iterations_ < max_iterations_; iterations_++) {
+        std::fill(col_max.begin(), col_max.end(), _TYPE_(0));
+        Kokkos::parallel_for("SolverMarket::ruiz_norms", Kokkos::RangePolicy<Host>(0, n), [&](const size_t i) {
+            _TYPE_ row = 0;
+            for (_ITYPE_ k = offsets[i]; k < offsets[i + 1]; k++) {
+                const _TYPE_ a = std::abs(r[i] * values[k] * c[columns[k]]);
+                row = std::max(row, a);
+                Kokkos::atomic_max(&col_max[columns[k]], a);
+            }
+            row_max[i] = row;
+        });
+
+        double deviation = 0;
+        Kokkos::parallel_reduce("SolverMarket::ruiz_deviation", Kokkos::RangePolicy<Host>(0, n), [&](const size_t i, double& d) {
+            if (row_max[i] > 0) d = std::max(d, std::abs(1.0 - double(row_max[i])));
+            if (col_max[i] > 0) d = std::max(d, std::abs(1.0 - double(col_max[i])));
+        }, Kokkos::Max<double>(deviation));
+        deviation_ = deviation;
+        if (deviation <= tolerance_) break;
+
+        Kokkos::parallel_for("SolverMarket::ruiz_update", Kokkos::RangePolicy<Host>(0, n), [&](const size_t i) {
+            if (row_max[i] > 0) r[i] /= std::sqrt(row_max[i]);
+            if (col_max[i] > 0) c[i] /= std::sqrt(col_max[i]);
+        });
+    }
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+int SolverMarketScaling<_TYPE_, _ITYPE_>::multiply(SolverMarketVector<_TYPE_, _ITYPE_>& v, const std::vector<_TYPE_>& scale) const
+{
+    if (method_ == SolverMarketScalingNone) return 0;
+    if (size_t(v.get_n()) != scale.size()) {
+        std::cerr << "[Error][SolverMarket][Scaling] Vector of size " << v.get_n() << " for a scaling of size " << scale.size() << std::endl;
+        return 1;
+    }
+    _TYPE_* values = v.get_host_values_pointer();
+    const _TYPE_* s = scale.data();
+    Kokkos::parallel_for("SolverMarket::scale_vector", Kokkos::RangePolicy<Host>(0, scale.size()), [&](const size_t i) {
+        values[i] *= s[i];
+    });
+    return 0;
+}
@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "solver-market-log.hpp"
+
+#pragma once
+
+/* Throughput mode: a queue of independent jobs run side by side on disjoint sets of cores.
+
+A small system (tens of thousands of rows) does not scale to a whole node, so jobs run back
+to back leave most cores idle. Each job runs in its own process (solver_market_driver, or
+any command), pinned with sched_setaffinity to a block of cores, with OMP_NUM_THREADS,
+OMP_PLACES and OMP_PROC_BIND set for that block: Kokkos and the backends of the job only
+see its cores. Processes rather than partitions of one Kokkos instance: the backends (Tpetra,
+MueLu, AMGX, the native solvers) run on the default execution space, not on an instance
+they could be given. The output of a job goes to its own log file.
+
+Cores are ordered by socket and physical core (SMT siblings next to each other), then cut
+into contiguous blocks, so a block does not straddle sockets when it does not have to.
+
+The concurrency can be measured: `calibrate` runs c copies of a probe job together for
+c = 1, 2, 4... (each on cores / c cores), and SolverMarketBestConcurrency keeps the c with
+the best jobs per second, memory bandwidth contention included. */
+
+enum SolverMarketSchedulerStatus {
+    SolverMarketSchedulerSuccess,
+    SolverMarketSchedulerErrorNoCpus,
+    SolverMarketSchedulerErrorJobFile,
+    SolverMarketSchedulerErrorJobsFailed
+};
+
+struct SolverMarketBatchJob {
+    std::string name;               /* name of its log file*/
+    std::vector<std::string> args;  /* command line, args[0] is the executable (PATH is searched)*/
+};
+
+struct SolverMarketBatchResult {
+    std::string name;
+    int exit_code = -1;             /* exit status, 128 + signal if killed, -1 if it could not be started*/
+    double seconds = 0;
+    std::vector<int> cpus;
+    std::string log_file;
+};
+
+// "0-3,8,10-11" -> 0 1 2 3 8 10 11
+inline std::vector<int> SolverMarketParseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::istringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty()) continue;
+        const size_t dash = range.find('-');
+        const int first = std::atoi(range.substr(0, dash).c_str());
+        const int last = (dash == std::string::npos) ? first : std::atoi(range.substr(dash + 1).c_str());
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// Inverse of SolverMarketParseCpuList, ranges of consecutive cpus in the given order
+inline std::string SolverMarketCpuListString(const std::vector<int>& cpus)
+{
+    std::ostringstream out;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) j++;
+        out << (i > 0 ? "," : "") << cpus[i];
+        if (j > i) out << "-" << cpus[j];
+        i = j + 1;
+    }
+    return out.str();
+}
+
+// Socket then physical core then cpu number: SMT siblings end up next to each other.
+// Cpus without topology in sysfs keep their number as core
+inline std::vector<int> SolverMarketOrderCpus(std::vector<int> cpus, const std::string& sysfs = "/sys/devices/system/cpu")
+{
+    auto read_id = [&](const int cpu, const char* file, const int fallback) {
+        std::ifstream in(sysfs + "/cpu" + std::to_string(cpu) + "/topology/" + file);
+        int id = fallback;
+        if (!(in >> id)) id = fallback;
+        return id;
+    };
+    std::vector<std::tuple<int, int, int>> keys;
+    for (const int cpu : cpus) keys.emplace_back(read_id(cpu, "physical_package_id", 0), read_id(cpu, "core_id", cpu), cpu);
+    std::sort(keys.begin(), keys.end());
+    for (size_t i = 0; i < keys.size(); i++) cpus[i] = std::get<2>(keys[i]);
+    return cpus;
+}
+
+// Cpus this process may run on, ordered for SolverMarketPartitionCpus
+inline std::vector<int> SolverMarketAvailableCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+    return SolverMarketOrderCpus(cpus);
+}
+
+// `slots` contiguous blocks of the ordered cpus, sizes differing by one at most
+inline std::vector<std::vector<int>> SolverMarketPartitionCpus(const std::vector<int>& cpus, const int slots)
+{
+    std::vector<std::vector<int>> blocks;
+    if (slots < 1 || cpus.empty()) return blocks;
+    const size_t count = std::min(size_t(slots), cpus.size());
+    size_t begin = 0;
+    for (size_t b = 0; b < count; b++) {
+        const size_t end = begin + cpus.size() / count + (b < cpus.size() % count ? 1 : 0);
+        blocks.emplace_back(cpus.begin() + begin, cpus.begin() + end);
+        begin = end;
+    }
+    return blocks;
+}
+
+// The concurrency with the most jobs per second, from the makespan of `c` jobs run together.
+// Within `tolerance` of the best, the lowest concurrency wins (less memory, less contention)
+inline int SolverMarketBestConcurrency(const std::map<int, double>& makespan_seconds, const double tolerance = 0.05)
+{
+    double best_rate = 0;
+    for (const auto& [concurrency, seconds] : makespan_seconds) {
+        if (seconds > 0) best_rate = std::max(best_rate, concurrency / seconds);
+    }
+    for (const auto& [concurrency, seconds] : makespan_seconds) {
+        if (seconds > 0 && concurrency / seconds >= (1.0 - tolerance) * best_rate) return concurrency;
+    }
+    return 1;
+}
+
+/* One job per line, '#' starts a comment. A line of options ("--matrix=a.mtx --backends=native
+--native-config=p.txt") runs `driver` with them, any other line is a full command line
+(e.g. "AMGX_input_deck --matrix=a.mtx --config=c.json"). Words are separated by blanks */
+inline int SolverMarketReadBatchJobs(const std::string& filename, const std::string& driver, std::vector<SolverMarketBatchJob>& jobs)
+{
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Batch][read_jobs] Could not open file " << filename << "\n";
+        return SolverMarketSchedulerErrorJobFile;
+    }
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        SolverMarketBatchJob job;
+        std::string word;
+        while (words >> word) job.args.push_back(word);
+        if (job.args.empty()) continue;
+        if (job.args[0].rfind("--", 0) == 0) job.args.insert(job.args.begin(), driver);
+        job.name = "job-" + std::to_string(line_number);
+        jobs.push_back(job);
+    }
+    if (jobs.empty()) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Batch][read_jobs] No job in " << filename << "\n";
+        return SolverMarketSchedulerErrorJobFile;
+    }
+    return SolverMarketSchedulerSuccess;
+}
+
+extern char** environ;
+
+/* Runs a queue of jobs, `concurrency` at a time, each pinned to its own block of cores */
+class SolverMarketScheduler {
+public:
+    explicit SolverMarketScheduler(const std::vector<int>& cpus, const std::string& log_dir = "batch-logs")
+        : cpus_(cpus), log_dir_(log_dir) {}
+
+    const std::vector<int>& cpus() const { return cpus_; }
+
+    // Every job runs once. Returns the wall time of the queue, results in the order of `jobs`
+    double run(const std::vector<SolverMarketBatchJob>& jobs, const int concurrency, std::vector<SolverMarketBatchResult>& results,
+               const bool verbose = true) {
+        results.assign(jobs.size(), SolverMarketBatchResult());
+        const auto slots = SolverMarketPartitionCpus(cpus_, std::max(concurrency, 1));
+        ::mkdir(log_dir_.c_str(), 0755);
+
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        std::vector<size_t> free_slots;
+        for (size_t s = slots.size(); s > 0; s--) free_slots.push_back(s - 1);
+        std::map<pid_t, std::tuple<size_t, size_t, clock::time_point>> running;  /* pid -> job, slot, start*/
+        size_t next = 0;
+
+        while (next < jobs.size() || !running.empty()) {
+            // Fill the free slots
+            while (next < jobs.size() && !free_slots.empty()) {
+                const size_t slot = free_slots.back();
+                SolverMarketBatchResult& result = results[next];
+                result.name = jobs[next].name;
+                result.cpus = slots[slot];
+                result.log_file = log_dir_ + "/" + jobs[next].name + ".log";
+                const pid_t pid = spawn(jobs[next].args, slots[slot], result.log_file);
+                if (pid < 0) {
+                    SolverMarketLog(std::cerr) << "[Error][SolverMarket][Batch][run] Could not start " << jobs[next].name
+                                               << ": " << std::strerror(errno) << "\n";
+                } else {
+                    free_slots.pop_back();
+                    running[pid] = std::make_tuple(next, slot, clock::now());
+                }
+                next++;
+            }
+            if (running.empty()) continue;
+
+            // Wait for one of them
+            int status = 0;
+            const pid_t pid = ::waitpid(-1, &status, 0);
+            if (pid < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            auto it = running.find(pid);
+            if (it == running.end()) continue;
+            const auto [job, slot, job_start] = it->second;
+            running.erase(it);
+            free_slots.push_back(slot);
+
+            SolverMarketBatchResult& result = results[job];
+            result.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : WIFSIGNALED(status) ? 128 + WTERMSIG(status) : -1;
+            result.seconds = std::chrono::duration<double>(clock::now() - job_start).count();
+            if (verbose) {
+                SolverMarketLog() << "[Info][SolverMarket][Batch][run] " << result.name << " exit " << result.exit_code << " in "
+                                  << result.seconds << " s on cpus " << SolverMarketCpuListString(result.cpus)
+                                  << " (" << result.log_file << ")\n";
+            }
+        }
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    /* Makespan of c copies of `probe` run together, c = 1, 2, 4... up to max_concurrency (and
+    max_concurrency itself). Empty if a probe failed */
+    std::map<int, double> calibrate(const SolverMarketBatchJob& probe, const int max_concurrency) {
+        std::map<int, double> makespans;
+        const int limit = std::min<int>(std::max(max_concurrency, 1), int(cpus_.size()));
+        std::vector<int> candidates;
+        for (int c = 1; c <= limit; c *= 2) candidates.push_back(c);
+        if (candidates.back() != limit) candidates.push_back(limit);
+
+        for (const int c : candidates) {
+            std::vector<SolverMarketBatchJob> copies(c, probe);
+            for (int i = 0; i < c; i++) copies[i].name = "calibrate-c" + std::to_string(c) + "-" + std::to_string(i);
+            std::vector<SolverMarketBatchResult> results;
+            const double seconds = run(copies, c, results, false);
+            for (const auto& result : results) {
+                if (result.exit_code != 0) {
+                    SolverMarketLog(std::cerr) << "[Error][SolverMarket][Batch][calibrate] Probe " << result.name << " failed, exit "
+                                               << result.exit_code << " (" << result.log_file << ")\n";
+                    return std::map<int, double>();
+                }
+            }
+            makespans[c] = seconds;
+            SolverMarketLog() << "[Info][SolverMarket][Batch][calibrate] " << c << " job(s) x " << cpus_.size() / c
+                              << " cpus: " << seconds << " s, " << std::fixed << std::setprecision(1)
+                              << 3600.0 * c / seconds << " jobs/hour\n";
+        }
+        return makespans;
+    }
+
+private:
+    std::vector<int> cpus_;
+    std::string log_dir_;
+
+    // fork + exec, the child pinned to `cpus` with the OpenMP variables of the block, output to `log_file`
+    static pid_t spawn(const std::vector<std::string>& args, const std::vector<int>& cpus, const std::string& log_file) {
+        // Everything is built before the fork, the child only calls async-signal-safe functions
+        std::vector<std::string> environment;
+        const char* replaced[] = {"OMP_NUM_THREADS=", "OMP_PLACES=", "OMP_PROC_BIND=", "KOKKOS_NUM_THREADS="};
+        for (char** variable = environ; variable && *variable; variable++) {
+            bool keep = true;
+            for (const char* prefix : replaced) keep = keep && std::strncmp(*variable, prefix, std::strlen(prefix)) != 0;
+            if (keep) environment.push_back(*variable);
+        }
+        std::string places;
+        for (const int cpu : cpus) places += (places.empty() ? "{" : ",{") + std::to_string(cpu) + "}";
+        environment.push_back("OMP_NUM_THREADS=" + std::to_string(cpus.size()));
+        environment.push_back("KOKKOS_NUM_THREADS=" + std::to_string(cpus.size()));
+        environment.push_back("OMP_PLACES=" + places);
+        environment.push_back("OMP_PROC_BIND=close");
+
+        std::vector<char*> argv, envp;
+        for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        for (const auto& variable : environment) envp.push_back(const_cast<char*>(variable.c_str()));
+        envp.push_back(nullptr);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (const int cpu : cpus) CPU_SET(cpu, &set);
+
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            const int fd = ::open(log_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0) {
+                ::dup2(fd, STDOUT_FILENO);
+                ::dup2(fd, STDERR_FILENO);
+                ::close(fd);
+            }
+            if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+                const char message[] = "[Error][SolverMarket][Batch][spawn] sched_setaffinity failed\n";
+                (void)!::write(STDERR_FILENO, message, sizeof(message) - 1);
+                ::_exit(126);
+            }
+            ::execvpe(argv[0], argv.data(), envp.data());
+            const char message[] = "[Error][SolverMarket][Batch][spawn] exec failed\n";
+            (void)!::write(STDERR_FILENO, message, sizeof(message) - 1);
+            ::_exit(127);
+        }
+        return pid;
+    }
+};
@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "solver-market-log.hpp"
+#include "solver-market-sparse.hpp"
+
+#pragma once
+
+/* SELL-C-sigma (sliced ELLPACK) storage for the SpMV of the native solvers.
+
+Rows are cut into chunks of C rows stored column major: entry j of the C rows of a chunk are
+contiguous, so one SIMD instruction (CPU) or one warp (GPU) processes C rows at once with unit
+stride loads. A chunk is as wide as its longest row, the shorter rows are padded with zeros.
+Within windows of sigma rows, rows are sorted by decreasing length before chunking, so rows of
+similar length share a chunk and padding stays small; sigma = C does not reorder across chunks,
+sigma = n sorts globally. y is written through the row permutation, x is not permuted.
+
+C follows the hardware: the warp (32) on GPUs, the SIMD width in values on CPUs.
+
+The selector compares the lane utilization of both kernels from the row lengths alone: the CSR
+kernel runs one row per thread, a warp waits for its longest row (GPU) and a row of length L uses
+ceil(L / W) SIMD instructions (CPU); SELL wastes its padding. SELL is chosen when its padding stays
+under a limit and it uses the lanes better by a margin. The measured conversion cost and SpMV
+times give the number of SpMVs that pays the conversion back. */
+
+#if defined(KOKKOS_ENABLE_CUDA) || defined(KOKKOS_ENABLE_HIP)
+constexpr bool SolverMarketSELLOnGPU = true;
+#else
+constexpr bool SolverMarketSELLOnGPU = false;
+#endif
+
+constexpr int SolverMarketSELLMaxHostChunk = 64;  /* host kernel: one accumulator per row of a chunk*/
+
+// Warp width on GPUs, SIMD register width in values on CPUs
+template <typename _TYPE_>
+int SolverMarketSELLDefaultChunk() {
+  if (SolverMarketSELLOnGPU) return 32;
+#if defined(__AVX512F__)
+  const int simd_bytes = 64;
+#elif defined(__AVX__)
+  const int simd_bytes = 32;
+#else
+  const int simd_bytes = 16;  /* SSE2, NEON*/
+#endif
+  return std::max(1, simd_bytes / int(sizeof(_TYPE_)));
+}
+
+template <typename _TYPE_, typename _ITYPE_>
+struct SolverMarketDeviceSELL {
+  _ITYPE_ n_rows = 0;
+  _ITYPE_ n_cols = 0;
+  int chunk = 1;                      /* C*/
+  _ITYPE_ sigma = 1;                  /* sorting window*/
+  _ITYPE_ n_chunks = 0;
+  size_t stored_nnz = 0;              /* nonzeros, padding excluded*/
+  DeviceView<size_t> chunk_offsets;   /* n_chunks + 1, first entry of each chunk*/
+  DeviceView<_ITYPE_> chunk_widths;   /* n_chunks*/
+  DeviceView<_ITYPE_> rows;           /* n_chunks * C: row of each slot, -1 past the last row*/
+  DeviceView<_ITYPE_> columns;        /* padded entries: column 0, value 0*/
+  DeviceView<_TYPE_> values;
+
+  size_t nnz() const { return stored_nnz; }
+  size_t padded() const { return values.extent(0); }
+  double padding_overhead() const { return stored_nnz ? double(padded()) / double(stored_nnz) - 1.0 : 0.0; }
+};
+
+// Host side layout: row order and chunk widths from the CSR offsets
+template <typename _ITYPE_>
+struct SolverMarketSELLPlan {
+  std::vector<_ITYPE_> rows;           /* slot -> row, -1 past the last row*/
+  std::vector<_ITYPE_> chunk_widths;
+  std::vector<size_t> chunk_offsets;   /* n_chunks + 1*/
+
+  size_t padded() const { return chunk_offsets.empty() ? 0 : chunk_offsets.back(); }
+};
+
+template <typename _ITYPE_>
+SolverMarketSELLPlan<_ITYPE_> SolverMarketPlanSELL(const _ITYPE_* offsets, const _ITYPE_ n, const int chunk, _ITYPE_ sigma) {
+  SolverMarketSELLPlan<_ITYPE_> plan;
+  const _ITYPE_ n_chunks = (n + chunk - 1) / chunk;
+  plan.rows.assign(size_t(n_chunks) * chunk, _ITYPE_(-1));
+  std::iota(plan.rows.begin(), plan.rows.begin() + n, _ITYPE_(0));
+  // Windows are whole chunks
+  sigma = std::max<_ITYPE_>(chunk, ((sigma + chunk - 1) / chunk) * chunk);
+  if (sigma > chunk) {
+    for (_ITYPE_ begin = 0; begin < n; begin += sigma) {
+      const _ITYPE_ end = std::min<_ITYPE_>(n, begin + sigma);
+      std::stable_sort(plan.rows.begin() + begin, plan.rows.begin() + end, [offsets](_ITYPE_ a, _ITYPE_ b) {
+        return offsets[a + 1] - offsets[a] > offsets[b + 1] - offsets[b];
+      });
+    }
+  }
+  plan.chunk_widths.assign(n_chunks, 0);
+  plan.chunk_offsets.assign(size_t(n_chunks) + 1, 0);
+  for (_ITYPE_ c = 0; c < n_chunks; c++) {
+    _ITYPE_ width = 0;
+    for (int lane = 0; lane < chunk; lane++) {
+      const _ITYPE_ row = plan.rows[size_t(c) * chunk + lane];
+      if (row >= 0) width = std::max<_ITYPE_>(width, offsets[row + 1] - offsets[row]);
+    }
+    plan.chunk_widths[c] = width;
+    plan.chunk_offsets[c + 1] = plan.chunk_offsets[c] + size_t(width) * chunk;
+  }
+  return plan;
+}
+
+// CSR to SELL-C-sigma, rows sorted by column within a row as in the CSR
+template <typename _TYPE_, typename _ITYPE_>
+SolverMarketDeviceSELL<_TYPE_, _ITYPE_> SolverMarketToSELL(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A, int chunk = 0, _ITYPE_ sigma = 0) {
+  if (chunk <= 0) chunk = SolverMarketSELLDefaultChunk<_TYPE_>();
+  if (!SolverMarketSELLOnGPU) chunk = std::min(chunk, SolverMarketSELLMaxHostChunk);
+  if (sigma <= 0) sigma = _ITYPE_(32 * chunk);
+  auto host_offsets = Kokkos::create_mirror_view_and_copy(Host(), A.offsets);
+  const auto plan = SolverMarketPlanSELL(host_offsets.data(), A.n_rows, chunk, sigma);
+
+  SolverMarketDeviceSELL<_TYPE_, _ITYPE_> S;
+  S.n_rows = A.n_rows;
+  S.n_cols = A.n_cols;
+  S.chunk = chunk;
+  S.sigma = sigma;
+  S.n_chunks = _ITYPE_(plan.chunk_widths.size());
+  S.stored_nnz = A.nnz();
+  S.chunk_offsets = DeviceView<size_t>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::sell_chunk_offsets"), plan.chunk_offsets.size());
+  S.chunk_widths = DeviceView<_ITYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::sell_chunk_widths"), plan.chunk_widths.size());
+  S.rows = DeviceView<_ITYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::sell_rows"), plan.rows.size());
+  Kokkos::deep_copy(S.chunk_offsets, HostView<size_t>(const_cast<size_t*>(plan.chunk_offsets.data()), plan.chunk_offsets.size()));
+  Kokkos::deep_copy(S.chunk_widths, HostView<_ITYPE_>(const_cast<_ITYPE_*>(plan.chunk_widths.data()), plan.chunk_widths.size()));
+  Kokkos::deep_copy(S.rows, HostView<_ITYPE_>(const_cast<_ITYPE_*>(plan.rows.data()), plan.rows.size()));
+  S.columns = DeviceView<_ITYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::sell_columns"), plan.padded());
+  S.values = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::sell_values"), plan.padded());
+
+  auto a_offsets = A.offsets;
+  auto a_columns = A.columns;
+  auto a_values = A.values;
+  auto chunk_offsets = S.chunk_offsets;
+  auto chunk_widths = S.chunk_widths;
+  auto rows = S.rows;
+  auto columns = S.columns;
+  auto values = S.values;
+  // One slot (row of a chunk) per thread, writes of a chunk column are contiguous across slots
+  Kokkos::parallel_for("SolverMarket::sell_fill", Kokkos::RangePolicy<Device>(0, rows.extent(0)), KOKKOS_LAMBDA(const size_t slot) {
+    const size_t c = slot / chunk;
+    const size_t lane = slot % chunk;
+    const _ITYPE_ row = rows(slot);
+    const _ITYPE_ length = (row >= 0) ? a_offsets(row + 1) - a_offsets(row) : 0;
+    for (_ITYPE_ j = 0; j < chunk_widths(c); j++) {
+      const size_t position = chunk_offsets(c) + size_t(j) * chunk + lane;
+      if (j < length) {
+        columns(position) = a_columns(a_offsets(row) + j);
+        values(position) = a_values(a_offsets(row) + j);
+      } else {
+        columns(position) = 0;
+        values(position) = 0;
+      }
+    }
+  });
+  return S;
+}
+
+// y = alpha A x + beta y
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketSpMV(const SolverMarketDeviceSELL<_TYPE_, _ITYPE_>& A, const DeviceView<_TYPE_>& x,
+                      const DeviceView<_TYPE_>& y, const _TYPE_ alpha = 1, const _TYPE_ beta = 0) {
+  auto chunk_offsets = A.chunk_offsets;
+  auto chunk_widths = A.chunk_widths;
+  auto rows = A.rows;
+  auto columns = A.columns;
+  auto values = A.values;
+  const int chunk = A.chunk;
+#if defined(KOKKOS_ENABLE_CUDA) || defined(KOKKOS_ENABLE_HIP)
+  // The C lanes of a chunk are the vector lanes of a team member: coalesced loads of a chunk column
+  constexpr int chunks_per_team = 8;
+  const int league = int((A.n_chunks + chunks_per_team - 1) / chunks_per_team);
+  using Member = typename Kokkos::TeamPolicy<Device>::member_type;
+  Kokkos::parallel_for("SolverMarket::sell_spmv", Kokkos::TeamPolicy<Device>(league, chunks_per_team, chunk),
+      KOKKOS_LAMBDA(const Member& member) {
+    const _ITYPE_ c = _ITYPE_(member.league_rank()) * chunks_per_team + member.team_rank();
+    if (c >= _ITYPE_(chunk_widths.extent(0))) return;
+    const size_t offset = chunk_offsets(c);
+    const _ITYPE_ width = chunk_widths(c);
+    Kokkos::parallel_for(Kokkos::ThreadVectorRange(member, chunk), [&](const int lane) {
+      const _ITYPE_ row = rows(size_t(c) * chunk + lane);
+      if (row < 0) return;
+      _TYPE_ sum = 0;
+      for (_ITYPE_ j = 0; j < width; j++) sum += values(offset + size_t(j) * chunk + lane) * x(columns(offset + size_t(j) * chunk + lane));
+      y(row) = (beta == _TYPE_(0)) ? alpha * sum : alpha * sum + beta * y(row);
+    });
+  });
+#else
+  // One chunk per iteration, the inner loop over its C rows is unit stride and vectorizes (gather on x)
+  Kokkos::parallel_for("SolverMarket::sell_spmv", Kokkos::RangePolicy<Device>(0, A.n_chunks), KOKKOS_LAMBDA(const _ITYPE_ c) {
+    _TYPE_ sum[SolverMarketSELLMaxHostChunk];
+    for (int lane = 0; lane < chunk; lane++) sum[lane] = 0;
+    // Pointer arithmetic, not &values(offset): a zero-width chunk at the end starts one past the last slot
+    const _TYPE_* __restrict__ chunk_values = values.data() + chunk_offsets(c);
+    const _ITYPE_* __restrict__ chunk_columns = columns.data() + chunk_offsets(c);
+    const _ITYPE_ width = chunk_widths(c);
+    for (_ITYPE_ j = 0; j < width; j++) {
+      const _TYPE_* __restrict__ v = chunk_values + size_t(j) * chunk;
+      const _ITYPE_* __restrict__ col = chunk_columns + size_t(j) * chunk;
+      for (int lane = 0; lane < chunk; lane++) sum[lane] += v[lane] * x(col[lane]);
+    }
+    for (int lane = 0; lane < chunk; lane++) {
+      const _ITYPE_ row = rows(size_t(c) * chunk + lane);
+      if (row >= 0) y(row) = (beta == _TYPE_(0)) ? alpha * sum[lane] : alpha * sum[lane] + beta * y(row);
+    }
+  });
+#endif
+}
+
+// r = b - A x
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketResidual(const SolverMarketDeviceSELL<_TYPE_, _ITYPE_>& A, const DeviceView<_TYPE_>& x,
+                          const DeviceView<_TYPE_>& b, const DeviceView<_TYPE_>& r) {
+  Kokkos::deep_copy(r, b);
+  SolverMarketSpMV(A, x, r, _TYPE_(-1), _TYPE_(1));
+}
+
+enum SolverMarketSpMVFormat {
+  SolverMarketSpMVCSR,
+  SolverMarketSpMVSELL,
+  SolverMarketSpMVAuto  /* chosen by SolverMarketSelectFormat*/
+};
+
+inline int SolverMarketParseSpMVFormat(const std::string& text, SolverMarketSpMVFormat& format) {
+  if (text == "csr") format = SolverMarketSpMVCSR;
+  else if (text == "sell") format = SolverMarketSpMVSELL;
+  else if (text == "auto") format = SolverMarketSpMVAuto;
+  else return 1;
+  return 0;
+}
+
+inline const char* SolverMarketSpMVFormatName(const SolverMarketSpMVFormat format) {
+  return format == SolverMarketSpMVSELL ? "sell" : (format == SolverMarketSpMVAuto ? "auto" : "csr");
+}
+
+struct SolverMarketFormatReport {
+  /* row lengths*/
+  double row_mean = 0;
+  double row_stddev = 0;
+  size_t row_max = 0;
+  /* lane utilization (nonzeros / lane slots) of each kernel, from the row lengths*/
+  double csr_efficiency = 1;
+  double sell_efficiency = 1;
+  double padding_overhead = 0;  /* SELL padded / nnz - 1*/
+  int chunk = 1;
+  size_t sigma = 1;
+  SolverMarketSpMVFormat format = SolverMarketSpMVCSR;
+  std::string reason;
+  /* measured by SolverMarketMeasureFormat, -1 if not*/
+  double conversion_ms = -1;
+  double csr_spmv_ms = -1;
+  double sell_spmv_ms = -1;
+  double break_even_spmvs = -1;  /* SpMVs to pay the conversion back, -1: never*/
+
+  double row_cv() const { return row_mean > 0 ? row_stddev / row_mean : 0.0; }
+
+  std::string summary() const {
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(3) << "format=" << SolverMarketSpMVFormatName(format)
+      << " row_mean=" << row_mean << " row_cv=" << row_cv() << " row_max=" << row_max
+      << " C=" << chunk << " sigma=" << sigma << " padding=" << padding_overhead
+      << " csr_efficiency=" << csr_efficiency << " sell_efficiency=" << sell_efficiency;
+    if (conversion_ms >= 0) {
+      s << " conversion_ms=" << conversion_ms << " csr_spmv_ms=" << csr_spmv_ms << " sell_spmv_ms=" << sell_spmv_ms
+        << " break_even_spmvs=";
+      if (break_even_spmvs >= 0) s << std::setprecision(1) << break_even_spmvs;
+      else s << "never";
+    }
+    return s.str();
+  }
+
+  void print() const {
+    SolverMarketLog() << "[Info][SolverMarket][SELL] " << summary() << " (" << reason << ")\n";
+  }
+};
+
+/* CSR or SELL-C-sigma from the row lengths of A: SELL when its padding overhead is at most
+max_padding and its lane utilization beats the one of the CSR kernel by min_gain. */
+template <typename _TYPE_, typename _ITYPE_>
+SolverMarketFormatReport SolverMarketSelectFormat(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A, int chunk = 0, _ITYPE_ sigma = 0,
+                                                  const double max_padding = 0.25, const double min_gain = 0.1) {
+  SolverMarketFormatReport report;
+  if (chunk <= 0) chunk = SolverMarketSELLDefaultChunk<_TYPE_>();
+  if (!SolverMarketSELLOnGPU) chunk = std::min(chunk, SolverMarketSELLMaxHostChunk);
+  if (sigma <= 0) sigma = _ITYPE_(32 * chunk);
+  report.chunk = chunk;
+  report.sigma = size_t(sigma);
+
+  auto host_offsets = Kokkos::create_mirror_view_and_copy(Host(), A.offsets);
+  const _ITYPE_* offsets = host_offsets.data();
+  const _ITYPE_ n = A.n_rows;
+  const double nnz = double(A.nnz());
+  if (n == 0 || nnz == 0) {
+    report.reason = "empty matrix";
+    return report;
+  }
+
+  double sum_sq = 0, csr_slots = 0;
+  for (_ITYPE_ i = 0; i < n; i++) {
+    const size_t length = size_t(offsets[i + 1] - offsets[i]);
+    sum_sq += double(length) * double(length);
+    report.row_max = std::max(report.row_max, length);
+    // CPU: ceil(L / W) vector instructions per row
+    if (!SolverMarketSELLOnGPU) csr_slots += double((length + chunk - 1) / chunk) * chunk;
+  }
+  report.row_mean = nnz / double(n);
+  report.row_stddev = std::sqrt(std::max(0.0, sum_sq / double(n) - report.row_mean * report.row_mean));
+  // GPU: a warp of consecutive rows runs as long as its longest row, the padding of SELL-C-1
+  if (SolverMarketSELLOnGPU) csr_slots = double(SolverMarketPlanSELL(offsets, n, chunk, _ITYPE_(1)).padded());
+  report.csr_efficiency = csr_slots > 0 ? nnz / csr_slots : 1.0;
+
+  const double padded = double(SolverMarketPlanSELL(offsets, n, chunk, sigma).padded());
+  report.sell_efficiency = nnz / padded;
+  report.padding_overhead = padded / nnz - 1.0;
+
+  std::ostringstream reason;
+  reason << std::fixed << std::setprecision(2);
+  if (report.padding_overhead > max_padding) {
+    report.format = SolverMarketSpMVCSR;
+    reason << "padding " << report.padding_overhead << " > " << max_padding;
+  } else if (report.sell_efficiency < report.csr_efficiency * (1.0 + min_gain)) {
+    report.format = SolverMarketSpMVCSR;
+    reason << "lane utilization gain " << report.sell_efficiency / report.csr_efficiency << " < " << 1.0 + min_gain;
+  } else {
+    report.format = SolverMarketSpMVSELL;
+    reason << "lane utilization " << report.csr_efficiency << " -> " << report.sell_efficiency;
+  }
+  report.reason = reason.str();
+  return report;
+}
+
+/* Times the conversion and `spmvs` SpMVs in each format (after one warm-up), fills the measured
+fields of the report and returns the SELL matrix */
+template <typename _TYPE_, typename _ITYPE_>
+SolverMarketDeviceSELL<_TYPE_, _ITYPE_> SolverMarketMeasureFormat(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A,
+                                                                 SolverMarketFormatReport& report, const int spmvs = 20) {
+  auto elapsed_ms = [](std::chrono::high_resolution_clock::time_point start) {
+    Kokkos::fence();
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  };
+  Kokkos::fence();
+  auto start = std::chrono::high_resolution_clock::now();
+  auto S = SolverMarketToSELL(A, report.chunk, _ITYPE_(report.sigma));
+  report.conversion_ms = elapsed_ms(start);
+
+  DeviceView<_TYPE_> x("SolverMarket::sell_measure_x", A.n_cols), y("SolverMarket::sell_measure_y", A.n_rows);
+  Kokkos::deep_copy(x, _TYPE_(1));
+  SolverMarketSpMV(A, x, y);
+  start = std::chrono::high_resolution_clock::now();
+  for (int k = 0; k < spmvs; k++) SolverMarketSpMV(A, x, y);
+  report.csr_spmv_ms = elapsed_ms(start) / spmvs;
+  SolverMarketSpMV(S, x, y);
+  start = std::chrono::high_resolution_clock::now();
+  for (int k = 0; k < spmvs; k++) SolverMarketSpMV(S, x, y);
+  report.sell_spmv_ms = elapsed_ms(start) / spmvs;
+
+  const double saving = report.csr_spmv_ms - report.sell_spmv_ms;
+  report.break_even_spmvs = saving > 0 ? report.conversion_ms / saving : -1.0;
+  return S;
+}
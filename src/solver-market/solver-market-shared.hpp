@@ -0,0 +1,281 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#pragma once
+
+/* Binary CSR/vector segment, shared between processes (POSIX shared memory, memfd) or stored as
+a file. The arrays are 64 byte aligned inside the segment so the host Views of a matrix or vector
+can wrap them directly (unmanaged Views, no copy):
+
+  [SolverMarketSharedHeader][pad][offsets: index_bytes * (n+1)][pad][columns: index_bytes * nnz][pad][values: value_bytes * nnz]
+
+A vector segment only has values (n of them). Numbers are in host byte order. */
+
+constexpr char SolverMarketSharedMagic[8] = {'S', 'M', 'C', 'S', 'R', '0', '1', '\0'};
+constexpr size_t SolverMarketSharedAlignment = 64;
+
+enum SolverMarketSharedKind : uint32_t {
+    SolverMarketSharedMatrix = 1,
+    SolverMarketSharedVector = 2
+};
+
+enum SolverMarketSharedStatus {
+    SolverMarketSharedSuccess,
+    SolverMarketSharedErrorOpen,       /* shm_open/memfd_create/open failed*/
+    SolverMarketSharedErrorMap,        /* ftruncate/mmap failed*/
+    SolverMarketSharedErrorFormat,     /* bad magic, sizes or offsets outside the segment*/
+    SolverMarketSharedErrorKind,       /* matrix segment given to a vector or the other way round*/
+    SolverMarketSharedErrorType,       /* index/value size differs from the reader's types (no zero-copy), n/nnz
+                                          beyond the index type, or unknown matrix view/type*/
+    SolverMarketSharedErrorOffsets,    /* CSR offsets not monotone or not ending at nnz*/
+    SolverMarketSharedErrorColumns     /* CSR column index outside [0, n)*/
+};
+
+struct SolverMarketSharedHeader {
+    char magic[8];
+    uint32_t kind;
+    uint32_t index_bytes;
+    uint32_t value_bytes;
+    uint16_t matrix_view;     /* SolverMarketCSRMatrixView/Type of the stored CSR, 0: full general*/
+    uint16_t matrix_type;
+    uint64_t n;
+    uint64_t nnz;
+    uint64_t offsets_offset;  /* byte offsets from the start of the segment*/
+    uint64_t columns_offset;
+    uint64_t values_offset;
+    uint64_t total_bytes;
+};
+
+inline uint64_t SolverMarketSharedAlign(uint64_t bytes) {
+    return (bytes + SolverMarketSharedAlignment - 1) / SolverMarketSharedAlignment * SolverMarketSharedAlignment;
+}
+
+/* One mapping of a segment. Readers map privately (copy on write): the Views may be modified
+without touching the producer's data or the file. Matrices and vectors built on a segment keep
+a shared_ptr to it, so the mapping lives as long as any of them. */
+class SolverMarketSharedSegment {
+public:
+  SolverMarketSharedSegment() = default;
+  SolverMarketSharedSegment(const SolverMarketSharedSegment&) = delete;
+  SolverMarketSharedSegment& operator=(const SolverMarketSharedSegment&) = delete;
+
+  ~SolverMarketSharedSegment() { close(); }
+
+  // --- Producer side: size the segment for (n, nnz), map it writable and fill the header ---
+
+  int create_shared(const std::string& name, SolverMarketSharedKind kind, uint64_t n, uint64_t nnz,
+                    uint32_t index_bytes, uint32_t value_bytes) {
+    close();
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd < 0) return report("create_shared", name, SolverMarketSharedErrorOpen, errno);
+    shm_name_ = name;
+    return create(fd, name, kind, n, nnz, index_bytes, value_bytes);
+  }
+
+  // Anonymous segment, its fd() can be sent to another process (SolverMarketSendFd)
+  int create_memfd(const std::string& name, SolverMarketSharedKind kind, uint64_t n, uint64_t nnz,
+                   uint32_t index_bytes, uint32_t value_bytes) {
+    close();
+    int fd = ::memfd_create(name.c_str(), MFD_CLOEXEC);
+    if (fd < 0) return report("create_memfd", name, SolverMarketSharedErrorOpen, errno);
+    return create(fd, name, kind, n, nnz, index_bytes, value_bytes);
+  }
+
+  int create_file(const std::string& filename, SolverMarketSharedKind kind, uint64_t n, uint64_t nnz,
+                  uint32_t index_bytes, uint32_t value_bytes) {
+    close();
+    int fd = ::open(filename.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) return report("create_file", filename, SolverMarketSharedErrorOpen, errno);
+    return create(fd, filename, kind, n, nnz, index_bytes, value_bytes);
+  }
+
+  // --- Consumer side: map and validate the layout ---
+
+  int open_shared(const std::string& name) {
+    close();
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return report("open_shared", name, SolverMarketSharedErrorOpen, errno);
+    return open(fd, name);
+  }
+
+  int open_file(const std::string& filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return report("open_file", filename, SolverMarketSharedErrorOpen, errno);
+    return open(fd, filename);
+  }
+
+  // Takes ownership of fd (e.g. a memfd received with SolverMarketRecvFd)
+  int open_fd(int fd) {
+    close();
+    if (fd < 0) return report("open_fd", "fd", SolverMarketSharedErrorOpen);
+    return open(fd, "fd " + std::to_string(fd));
+  }
+
+  // Remove the shared memory name (the memory goes away with the last mapping)
+  void unlink() {
+    if (!shm_name_.empty()) ::shm_unlink(shm_name_.c_str());
+    shm_name_.clear();
+  }
+
+  void close() {
+    if (data_ != nullptr) ::munmap(data_, bytes_);
+    if (fd_ >= 0) ::close(fd_);
+    data_ = nullptr;
+    bytes_ = 0;
+    fd_ = -1;
+    shm_name_.clear();
+  }
+
+  bool is_open() const { return data_ != nullptr; }
+  int fd() const { return fd_; }
+  size_t bytes() const { return bytes_; }
+  const SolverMarketSharedHeader& header() const { return *static_cast<const SolverMarketSharedHeader*>(data_); }
+  SolverMarketSharedHeader& header() { return *static_cast<SolverMarketSharedHeader*>(data_); }
+
+  template <typename _ITYPE_> _ITYPE_* offsets() { return at<_ITYPE_>(header().offsets_offset); }
+  template <typename _ITYPE_> _ITYPE_* columns() { return at<_ITYPE_>(header().columns_offset); }
+  template <typename _TYPE_> _TYPE_* values() { return at<_TYPE_>(header().values_offset); }
+
+private:
+  void* data_ = nullptr;
+  size_t bytes_ = 0;
+  int fd_ = -1;
+  std::string shm_name_;   /* producer side of a POSIX segment, for unlink()*/
+
+  template <typename _T_> _T_* at(uint64_t offset) {
+    return reinterpret_cast<_T_*>(static_cast<char*>(data_) + offset);
+  }
+
+  // error: errno saved right after the failing call, 0 when no system call failed
+  static int report(const std::string& method, const std::string& name, int status, int error = 0) {
+    std::cerr << "[Error][SolverMarket][SharedSegment][" << method << "] " << name << ": status " << status;
+    if (error != 0) std::cerr << " (" << std::strerror(error) << ")";
+    std::cerr << std::endl;
+    return status;
+  }
+
+  int create(int fd, const std::string& name, SolverMarketSharedKind kind, uint64_t n, uint64_t nnz,
+             uint32_t index_bytes, uint32_t value_bytes) {
+    SolverMarketSharedHeader header{};
+    std::memcpy(header.magic, SolverMarketSharedMagic, sizeof(header.magic));
+    header.kind = kind;
+    header.index_bytes = index_bytes;
+    header.value_bytes = value_bytes;
+    header.n = n;
+    header.nnz = (kind == SolverMarketSharedVector) ? n : nnz;
+    uint64_t offset = SolverMarketSharedAlign(sizeof(SolverMarketSharedHeader));
+    if (kind == SolverMarketSharedMatrix) {
+      header.offsets_offset = offset;
+      offset = SolverMarketSharedAlign(offset + (n + 1) * index_bytes);
+      header.columns_offset = offset;
+      offset = SolverMarketSharedAlign(offset + nnz * index_bytes);
+    }
+    header.values_offset = offset;
+    header.total_bytes = offset + header.nnz * value_bytes;
+
+    fd_ = fd;
+    if (::ftruncate(fd_, off_t(header.total_bytes)) != 0) {
+      const int error = errno;
+      close();
+      return report("create", name, SolverMarketSharedErrorMap, error);
+    }
+    data_ = ::mmap(nullptr, header.total_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (data_ == MAP_FAILED) {
+      const int error = errno;
+      data_ = nullptr;
+      close();
+      return report("create", name, SolverMarketSharedErrorMap, error);
+    }
+    bytes_ = header.total_bytes;
+    std::memcpy(data_, &header, sizeof(header));
+    return SolverMarketSharedSuccess;
+  }
+
+  int open(int fd, const std::string& name) {
+    fd_ = fd;
+    struct stat info;
+    if (::fstat(fd_, &info) != 0) {
+      const int error = errno;
+      close();
+      return report("open", name, SolverMarketSharedErrorOpen, error);
+    }
+    if (size_t(info.st_size) < sizeof(SolverMarketSharedHeader)) {
+      close();
+      return report("open", name, SolverMarketSharedErrorFormat);
+    }
+    bytes_ = size_t(info.st_size);
+    // Private writable mapping: pages are shared with the producer until a View writes to them
+    data_ = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd_, 0);
+    if (data_ == MAP_FAILED) {
+      const int error = errno;
+      data_ = nullptr;
+      close();
+      return report("open", name, SolverMarketSharedErrorMap, error);
+    }
+
+    const auto& h = header();
+    const uint64_t arrays = (h.kind == SolverMarketSharedMatrix) ? h.nnz : h.n;
+    const bool valid = std::memcmp(h.magic, SolverMarketSharedMagic, sizeof(h.magic)) == 0
+        && h.n < bytes_ && h.nnz <= bytes_ && h.index_bytes <= 8 && h.value_bytes <= 64
+        && (h.kind == SolverMarketSharedMatrix || h.kind == SolverMarketSharedVector)
+        && h.index_bytes > 0 && h.value_bytes > 0 && h.total_bytes <= bytes_
+        && h.values_offset % SolverMarketSharedAlignment == 0
+        && h.values_offset + arrays * h.value_bytes <= h.total_bytes
+        && (h.kind == SolverMarketSharedVector ||
+            (h.offsets_offset % SolverMarketSharedAlignment == 0 && h.columns_offset % SolverMarketSharedAlignment == 0
+             && h.offsets_offset + (h.n + 1) * h.index_bytes <= h.columns_offset
+             && h.columns_offset + h.nnz * h.index_bytes <= h.values_offset));
+    if (!valid) {
+      close();
+      return report("open", name, SolverMarketSharedErrorFormat);
+    }
+    return SolverMarketSharedSuccess;
+  }
+};
+
+// --- Passing a segment fd (memfd) over a Unix domain socket ---
+
+inline bool SolverMarketSendFd(int socket_fd, int fd) {
+    char byte = 0;
+    iovec io{&byte, 1};
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    return ::sendmsg(socket_fd, &message, MSG_NOSIGNAL) == 1;
+}
+
+// -1 if no descriptor came with the message
+inline int SolverMarketRecvFd(int socket_fd) {
+    char byte;
+    iovec io{&byte, 1};
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (::recvmsg(socket_fd, &message, MSG_CMSG_CLOEXEC) != 1) return -1;
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) return -1;
+    int fd;
+    std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
@@ -0,0 +1,236 @@
+#include <cstdint>
+#include <string>
+
+#include "solver-market-header.hpp"
+
+#pragma once
+
+/* Device CSR and vector kernels used by the native solvers (AMG hierarchy, Krylov methods).
+
+SolverMarketDeviceCSR is a plain bundle of device Views, cheap to copy into kernels. It either owns
+its arrays (matrices built here: transposes, products) or wraps the device arrays of a
+SolverMarketCSRMatrix, which must then outlive it. Rows are sorted by column everywhere. */
+
+template <typename _TYPE_, typename _ITYPE_>
+struct SolverMarketDeviceCSR {
+  _ITYPE_ n_rows = 0;
+  _ITYPE_ n_cols = 0;
+  DeviceView<_ITYPE_> offsets;  /* n_rows + 1*/
+  DeviceView<_ITYPE_> columns;
+  DeviceView<_TYPE_> values;
+
+  size_t nnz() const { return columns.extent(0); }
+
+  // Wraps device arrays owned elsewhere (e.g. SolverMarketCSRMatrix::get_device_*_pointer)
+  static SolverMarketDeviceCSR wrap(_ITYPE_ n_rows, _ITYPE_ n_cols, size_t nnz,
+                                    _ITYPE_* offsets, _ITYPE_* columns, _TYPE_* values) {
+    SolverMarketDeviceCSR A;
+    A.n_rows = n_rows;
+    A.n_cols = n_cols;
+    A.offsets = DeviceView<_ITYPE_>(offsets, size_t(n_rows) + 1);
+    A.columns = DeviceView<_ITYPE_>(columns, nnz);
+    A.values = DeviceView<_TYPE_>(values, nnz);
+    return A;
+  }
+
+  // Square matrix of a SolverMarketCSRMatrix, sent to the device beforehand
+  template <typename _MATRIX_>
+  static SolverMarketDeviceCSR wrap(_MATRIX_& A) {
+    return wrap(A.get_n(), A.get_n(), size_t(A.get_nnz()), A.get_device_offsets_pointer(),
+                A.get_device_columns_pointer(), A.get_device_values_pointer());
+  }
+};
+
+// In place heap sort of (keys, values) by key, a short row handled by one thread
+template <typename _KEY_, typename _VALUE_>
+KOKKOS_INLINE_FUNCTION void SolverMarketSortPairs(_KEY_* keys, _VALUE_* values, const size_t length) {
+  if (length < 2) return;
+  auto sift_down = [&](size_t root, const size_t end) {
+    while (2 * root + 1 < end) {
+      size_t child = 2 * root + 1;
+      if (child + 1 < end && keys[child] < keys[child + 1]) child++;
+      if (!(keys[root] < keys[child])) return;
+      const _KEY_ k = keys[root]; keys[root] = keys[child]; keys[child] = k;
+      const _VALUE_ v = values[root]; values[root] = values[child]; values[child] = v;
+      root = child;
+    }
+  };
+  for (size_t start = length / 2; start-- > 0;) sift_down(start, length);
+  for (size_t end = length - 1; end > 0; end--) {
+    const _KEY_ k = keys[0]; keys[0] = keys[end]; keys[end] = k;
+    const _VALUE_ v = values[0]; values[0] = values[end]; values[end] = v;
+    sift_down(0, end);
+  }
+}
+
+// y = alpha A x + beta y
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketSpMV(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A, const DeviceView<_TYPE_>& x,
+                      const DeviceView<_TYPE_>& y, const _TYPE_ alpha = 1, const _TYPE_ beta = 0) {
+  auto offsets = A.offsets;
+  auto columns = A.columns;
+  auto values = A.values;
+  Kokkos::parallel_for("SolverMarket::spmv", Kokkos::RangePolicy<Device>(0, A.n_rows), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    _TYPE_ sum = 0;
+    for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) sum += values(k) * x(columns(k));
+    y(i) = (beta == _TYPE_(0)) ? alpha * sum : alpha * sum + beta * y(i);
+  });
+}
+
+// r = b - A x
+template <typename _TYPE_, typename _ITYPE_>
+void SolverMarketResidual(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A, const DeviceView<_TYPE_>& x,
+                          const DeviceView<_TYPE_>& b, const DeviceView<_TYPE_>& r) {
+  auto offsets = A.offsets;
+  auto columns = A.columns;
+  auto values = A.values;
+  Kokkos::parallel_for("SolverMarket::residual", Kokkos::RangePolicy<Device>(0, A.n_rows), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    _TYPE_ sum = 0;
+    for (_ITYPE_ k = offsets(i); k < offsets(i + 1); k++) sum += values(k) * x(columns(k));
+    r(i) = b(i) - sum;
+  });
+}
+
+template <typename _TYPE_>
+_TYPE_ SolverMarketDot(const DeviceView<_TYPE_>& x, const DeviceView<_TYPE_>& y) {
+  _TYPE_ result = 0;
+  Kokkos::parallel_reduce("SolverMarket::dot", Kokkos::RangePolicy<Device>(0, x.extent(0)), KOKKOS_LAMBDA(const size_t i, _TYPE_& sum) {
+    sum += x(i) * y(i);
+  }, result);
+  return result;
+}
+
+// y = a x + b y
+template <typename _TYPE_>
+void SolverMarketAxpby(const _TYPE_ a, const DeviceView<_TYPE_>& x, const _TYPE_ b, const DeviceView<_TYPE_>& y) {
+  Kokkos::parallel_for("SolverMarket::axpby", Kokkos::RangePolicy<Device>(0, x.extent(0)), KOKKOS_LAMBDA(const size_t i) {
+    y(i) = a * x(i) + b * y(i);
+  });
+}
+
+// Exclusive scan of counts(0..n-1) stored shifted by one (counts(i+1)), returns the total
+template <typename _ITYPE_>
+_ITYPE_ SolverMarketScanOffsets(const DeviceView<_ITYPE_>& offsets, const size_t n) {
+  _ITYPE_ total = 0;
+  Kokkos::parallel_scan("SolverMarket::scan_offsets", Kokkos::RangePolicy<Device>(0, n + 1),
+    KOKKOS_LAMBDA(const size_t i, _ITYPE_& update, const bool final) {
+      const _ITYPE_ count = offsets(i);
+      update += count;
+      if (final) offsets(i) = update;
+    }, total);
+  return total;
+}
+
+// A^T, rows sorted
+template <typename _TYPE_, typename _ITYPE_>
+SolverMarketDeviceCSR<_TYPE_, _ITYPE_> SolverMarketTranspose(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A) {
+  SolverMarketDeviceCSR<_TYPE_, _ITYPE_> T;
+  T.n_rows = A.n_cols;
+  T.n_cols = A.n_rows;
+  const size_t nnz = A.nnz();
+  T.offsets = DeviceView<_ITYPE_>("SolverMarket::transpose_offsets", size_t(T.n_rows) + 1);
+  T.columns = DeviceView<_ITYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::transpose_columns"), nnz);
+  T.values = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::transpose_values"), nnz);
+
+  auto a_offsets = A.offsets;
+  auto a_columns = A.columns;
+  auto a_values = A.values;
+  auto t_offsets = T.offsets;
+  auto t_columns = T.columns;
+  auto t_values = T.values;
+
+  Kokkos::parallel_for("SolverMarket::transpose_count", Kokkos::RangePolicy<Device>(0, A.n_rows), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    for (_ITYPE_ k = a_offsets(i); k < a_offsets(i + 1); k++) Kokkos::atomic_add(&t_offsets(a_columns(k) + 1), _ITYPE_(1));
+  });
+  SolverMarketScanOffsets(t_offsets, T.n_rows);
+
+  DeviceView<_ITYPE_> cursor(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::transpose_cursor"), T.n_rows);
+  Kokkos::deep_copy(cursor, Kokkos::subview(t_offsets, std::make_pair(size_t(0), size_t(T.n_rows))));
+  Kokkos::parallel_for("SolverMarket::transpose_fill", Kokkos::RangePolicy<Device>(0, A.n_rows), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    for (_ITYPE_ k = a_offsets(i); k < a_offsets(i + 1); k++) {
+      const _ITYPE_ position = Kokkos::atomic_fetch_add(&cursor(a_columns(k)), _ITYPE_(1));
+      t_columns(position) = i;
+      t_values(position) = a_values(k);
+    }
+  });
+  // Atomic fill order is arbitrary
+  Kokkos::parallel_for("SolverMarket::transpose_sort", Kokkos::RangePolicy<Device>(0, T.n_rows), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    const size_t length = size_t(t_offsets(i + 1) - t_offsets(i));
+    if (length > 1) SolverMarketSortPairs(&t_columns(t_offsets(i)), &t_values(t_offsets(i)), length);
+  });
+  return T;
+}
+
+/* C = A B, expand-sort-compress: every product a_ik b_kj of a row is written out, sorted by column
+and merged. One thread per row, the expanded row lives in a global scratch sized by the upper bound
+sum_k nnz(B_k), which stays moderate for the sparse products of an AMG setup (A P, R (A P)). */
+template <typename _TYPE_, typename _ITYPE_>
+SolverMarketDeviceCSR<_TYPE_, _ITYPE_> SolverMarketSpGEMM(const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& A,
+                                                          const SolverMarketDeviceCSR<_TYPE_, _ITYPE_>& B) {
+  const _ITYPE_ n = A.n_rows;
+  auto a_offsets = A.offsets;
+  auto a_columns = A.columns;
+  auto a_values = A.values;
+  auto b_offsets = B.offsets;
+  auto b_columns = B.columns;
+  auto b_values = B.values;
+
+  // 1. Upper bound of each row
+  DeviceView<size_t> expanded_offsets("SolverMarket::spgemm_bound", size_t(n) + 1);
+  Kokkos::parallel_for("SolverMarket::spgemm_bound", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    size_t bound = 0;
+    for (_ITYPE_ k = a_offsets(i); k < a_offsets(i + 1); k++) bound += b_offsets(a_columns(k) + 1) - b_offsets(a_columns(k));
+    expanded_offsets(i + 1) = bound;
+  });
+  const size_t expanded_nnz = SolverMarketScanOffsets(expanded_offsets, n);
+
+  // 2. Expand, 3. sort and merge in place, unique count per row
+  DeviceView<_ITYPE_> expanded_columns(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::spgemm_columns"), expanded_nnz);
+  DeviceView<_TYPE_> expanded_values(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::spgemm_values"), expanded_nnz);
+  SolverMarketDeviceCSR<_TYPE_, _ITYPE_> C;
+  C.n_rows = n;
+  C.n_cols = B.n_cols;
+  C.offsets = DeviceView<_ITYPE_>("SolverMarket::spgemm_offsets", size_t(n) + 1);
+  auto c_offsets = C.offsets;
+  Kokkos::parallel_for("SolverMarket::spgemm_expand", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    const size_t begin = expanded_offsets(i);
+    size_t p = begin;
+    for (_ITYPE_ k = a_offsets(i); k < a_offsets(i + 1); k++) {
+      const _ITYPE_ row = a_columns(k);
+      for (_ITYPE_ l = b_offsets(row); l < b_offsets(row + 1); l++) {
+        expanded_columns(p) = b_columns(l);
+        expanded_values(p) = a_values(k) * b_values(l);
+        p++;
+      }
+    }
+    const size_t length = p - begin;
+    if (length == 0) { c_offsets(i + 1) = 0; return; }
+    SolverMarketSortPairs(&expanded_columns(begin), &expanded_values(begin), length);
+    size_t unique = 0;
+    for (size_t q = 1; q < length; q++) {
+      if (expanded_columns(begin + q) == expanded_columns(begin + unique)) {
+        expanded_values(begin + unique) += expanded_values(begin + q);
+      } else {
+        unique++;
+        expanded_columns(begin + unique) = expanded_columns(begin + q);
+        expanded_values(begin + unique) = expanded_values(begin + q);
+      }
+    }
+    c_offsets(i + 1) = _ITYPE_(unique + 1);
+  });
+
+  // 4. Compress
+  const size_t nnz = SolverMarketScanOffsets(c_offsets, n);
+  C.columns = DeviceView<_ITYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::spgemm_c_columns"), nnz);
+  C.values = DeviceView<_TYPE_>(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::spgemm_c_values"), nnz);
+  auto c_columns = C.columns;
+  auto c_values = C.values;
+  Kokkos::parallel_for("SolverMarket::spgemm_compress", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const _ITYPE_ i) {
+    const size_t source = expanded_offsets(i);
+    for (_ITYPE_ k = c_offsets(i); k < c_offsets(i + 1); k++) {
+      c_columns(k) = expanded_columns(source + (k - c_offsets(i)));
+      c_values(k) = expanded_values(source + (k - c_offsets(i)));
+    }
+  });
+  return C;
+}
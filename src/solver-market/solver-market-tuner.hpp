@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "solver-market-matrix-features.hpp"
+
+#pragma once
+
+/* Solver configuration auto-tuning.
+
+The tuner is backend agnostic: a parameter space is a list of (key, values), where
+keys are whatever the backend understands (AMGX scoped parameters, paths in a
+Teuchos parameter list, ...). Each deck provides a trial function that runs a
+candidate for a given number of iterations and reports timings and residuals.
+
+Search is a successive halving: every candidate is probed for a few iterations,
+the convergence rate predicts its time to tolerance, the best 1/eta are kept and
+probed again with eta times more iterations, and the survivors are finally solved
+to tolerance. The winner is stored in a cache keyed by the matrix fingerprint. */
+
+// Ordered (key, value) assignments, one per parameter of the space
+using SolverMarketTuningCandidate = std::vector<std::pair<std::string, std::string>>;
+
+inline std::string SolverMarketCandidateToString(const SolverMarketTuningCandidate& candidate, const std::string& separator = ", ") {
+  std::string out;
+  for (size_t p = 0; p < candidate.size(); p++) {
+    if (p) out += separator;
+    out += candidate[p].first + "=" + candidate[p].second;
+  }
+  return out;
+}
+
+inline SolverMarketTuningCandidate SolverMarketCandidateFromString(const std::string& str, const char separator = ';') {
+  SolverMarketTuningCandidate candidate;
+  std::istringstream in(str);
+  std::string item;
+  while (std::getline(in, item, separator)) {
+    auto eq = item.find('=');
+    if (eq == std::string::npos) continue;
+    candidate.emplace_back(item.substr(0, eq), item.substr(eq + 1));
+  }
+  return candidate;
+}
+
+/* What a trial function reports back for one candidate */
+struct SolverMarketTuningTrial {
+  bool success = false;   /* false if the backend rejected the configuration*/
+  bool converged = false; /* tolerance reached within the allowed iterations*/
+  int iterations = 0;
+  double relative_residual = 1.0;     /* ||r_k|| / ||r_0||*/
+  std::vector<double> residual_history; /* optional, ||r_0|| ... ||r_k||*/
+  double setup_time = 0.0; /* seconds*/
+  double solve_time = 0.0; /* seconds*/
+};
+
+using SolverMarketTuningTrialFunction = std::function<SolverMarketTuningTrial(const SolverMarketTuningCandidate&, int max_iterations)>;
+
+class SolverMarketTuningSpace {
+public:
+
+  SolverMarketTuningSpace() = default;
+
+  void add(const std::string& key, const std::vector<std::string>& values) {
+    if (!values.empty()) parameters_.emplace_back(key, values);
+  }
+
+  /* One parameter per line: `key = value1 | value2 | ...`, '#' starts a comment */
+  int read_file(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+      std::cerr << "[Error][SolverMarket][TuningSpace][read_file] Could not open file " << filename << std::endl;
+      return 1;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+      line = line.substr(0, line.find('#'));
+      auto eq = line.find('=');
+      if (eq == std::string::npos) continue;
+      std::string key = trim(line.substr(0, eq));
+      std::vector<std::string> values;
+      std::istringstream list(line.substr(eq + 1));
+      std::string value;
+      while (std::getline(list, value, '|')) {
+        value = trim(value);
+        if (!value.empty()) values.push_back(value);
+      }
+      if (key.empty() || values.empty()) {
+        std::cerr << "[Error][SolverMarket][TuningSpace][read_file] Malformed line: " << line << std::endl;
+        return 1;
+      }
+      add(key, values);
+    }
+    std::cout << "[Info][SolverMarket][TuningSpace][read_file] " << parameters_.size() << " parameters, "
+              << size() << " candidates\n";
+    return 0;
+  }
+
+  size_t size() const {
+    if (parameters_.empty()) return 0;
+    size_t s = 1;
+    for (auto& p : parameters_) s *= p.second.size();
+    return s;
+  }
+
+  size_t num_parameters() const { return parameters_.size(); }
+
+  // Mixed radix decoding of the cartesian product, first parameter varies slowest
+  SolverMarketTuningCandidate candidate(size_t index) const {
+    SolverMarketTuningCandidate c(parameters_.size());
+    for (size_t p = parameters_.size(); p-- > 0;) {
+      const auto& values = parameters_[p].second;
+      c[p] = {parameters_[p].first, values[index % values.size()]};
+      index /= values.size();
+    }
+    return c;
+  }
+
+private:
+  std::vector<std::pair<std::string, std::vector<std::string>>> parameters_;
+
+  static std::string trim(const std::string& s) {
+    auto b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    auto e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+  }
+};
+
+/* Persistent store of tuned configurations.
+One tab separated line per entry: backend, fingerprint, similarity key, time (s), candidate.
+The last entry wins, so re-tuning a matrix simply appends. */
+class SolverMarketTuningCache {
+public:
+
+  explicit SolverMarketTuningCache(const std::string& filename = "solver_market_tuning.cache") : filename_(filename) {}
+
+  // Matrices in the same class (size and row length order of magnitude, symmetry) are "similar"
+  static std::string similarity_key(const SolverMarketMatrixFeatures& features) {
+    std::ostringstream key;
+    key << "n" << log2_bucket(features.n)
+        << "-r" << log2_bucket(uint64_t(std::lround(features.row_nnz_mean)))
+        << "-s" << (features.numerically_symmetric ? 1 : 0);
+    return key.str();
+  }
+
+  /* Returns 0 if found. `exact` tells whether the fingerprint matched, or only the similarity key*/
+  int lookup(const std::string& backend, const SolverMarketMatrixFeatures& features,
+             SolverMarketTuningCandidate& candidate, bool& exact) const {
+    std::ifstream file(filename_);
+    if (!file.is_open()) return 1;
+
+    const std::string fingerprint = features.fingerprint_string();
+    const std::string key = similarity_key(features);
+    std::string line, exact_match, similar_match;
+
+    while (std::getline(file, line)) {
+      std::vector<std::string> fields;
+      std::istringstream in(line);
+      std::string field;
+      while (std::getline(in, field, '\t')) fields.push_back(field);
+      if (fields.size() != 5 || fields[0] != backend) continue;
+      if (fields[1] == fingerprint) exact_match = fields[4];
+      else if (fields[2] == key) similar_match = fields[4];
+    }
+
+    exact = !exact_match.empty();
+    if (exact) candidate = SolverMarketCandidateFromString(exact_match);
+    else if (!similar_match.empty()) candidate = SolverMarketCandidateFromString(similar_match);
+    else return 1;
+
+    std::cout << "[Info][SolverMarket][TuningCache][lookup] Found " << (exact ? "tuned" : "similar matrix")
+              << " configuration for " << fingerprint << ": " << SolverMarketCandidateToString(candidate) << "\n";
+    return 0;
+  }
+
+  int store(const std::string& backend, const SolverMarketMatrixFeatures& features,
+            const SolverMarketTuningCandidate& candidate, double time) const {
+    std::ofstream file(filename_, std::ios::app);
+    if (!file.is_open()) {
+      std::cerr << "Error: Could not open " << filename_ << " for writing.\n";
+      return 1;
+    }
+    file << backend << "\t" << features.fingerprint_string() << "\t" << similarity_key(features) << "\t"
+         << std::setprecision(6) << time << "\t" << SolverMarketCandidateToString(candidate, ";") << "\n";
+    return 0;
+  }
+
+private:
+  std::string filename_;
+
+  static int log2_bucket(uint64_t x) {
+    int b = 0;
+    while (x > 1) { x >>= 1; b++; }
+    return b;
+  }
+};
+
+class SolverMarketTuner {
+public:
+
+  double time_budget = 300.0;   /* seconds, checked before every trial*/
+  double tolerance = 1e-8;      /* relative residual the configurations are ranked for*/
+  int probe_iterations = 4;     /* iterations of the first round*/
+  int max_iterations = 1000;    /* iterations of the final round*/
+  int reduction_factor = 3;     /* eta: keep 1/eta of the candidates, multiply iterations by eta*/
+
+  // Convergence factor per iteration, taken on the second half of the history when
+  // available so that the fast initial drop does not flatter a configuration
+  static double convergence_rate(const SolverMarketTuningTrial& trial) {
+    const auto& h = trial.residual_history;
+    const int k = int(h.size()) - 1;
+    if (k >= 2 && h[k / 2] > 0.0 && h[k] > 0.0) {
+      return std::pow(h[k] / h[k / 2], 1.0 / double(k - k / 2));
+    }
+    if (trial.iterations > 0 && trial.relative_residual > 0.0) {
+      return std::pow(trial.relative_residual, 1.0 / double(trial.iterations));
+    }
+    return 1.0;
+  }
+
+  // Predicted setup + solve time to reach `tolerance` (infinite if not converging)
+  double predicted_time(const SolverMarketTuningTrial& trial) const {
+    if (!trial.success) return HUGE_VAL;
+    if (trial.converged) return trial.setup_time + trial.solve_time;
+    const double rate = convergence_rate(trial);
+    if (!(rate < 1.0) || trial.iterations == 0) return HUGE_VAL;
+    const double remaining = std::log(tolerance / std::max(trial.relative_residual, 1e-300)) / std::log(rate);
+    const double per_iteration = trial.solve_time / double(trial.iterations);
+    return trial.setup_time + trial.solve_time + std::max(remaining, 0.0) * per_iteration;
+  }
+
+  /* Explore `space`. If `seed` is not empty it is tried first (e.g. the cached config of a
+  similar matrix). Returns 0 and fills `best` if at least one candidate converged. */
+  int run(const SolverMarketTuningSpace& space, const SolverMarketTuningTrialFunction& trial_function,
+          SolverMarketTuningCandidate& best, double& best_time,
+          const SolverMarketTuningCandidate& seed = SolverMarketTuningCandidate()) {
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto elapsed = [&]() {
+      return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+
+    std::vector<SolverMarketTuningCandidate> candidates;
+    if (!seed.empty()) candidates.push_back(seed);
+    for (size_t c = 0; c < space.size(); c++) {
+      auto candidate = space.candidate(c);
+      if (candidate != seed) candidates.push_back(candidate);
+    }
+
+    std::cout << "[Info][SolverMarket][Tuner][run] Tuning over " << candidates.size()
+              << " candidates with a budget of " << time_budget << " s\n";
+
+    int iterations = probe_iterations;
+    bool out_of_budget = false;
+    trials_ = 0;
+
+    // Successive halving on the predicted time to tolerance
+    while (candidates.size() > 1 && iterations < max_iterations && !out_of_budget) {
+      std::vector<std::pair<double, size_t>> scores;
+      for (size_t c = 0; c < candidates.size(); c++) {
+        if (elapsed() > time_budget) { out_of_budget = true; break; }
+        auto trial = trial_function(candidates[c], iterations);
+        trials_++;
+        const double score = predicted_time(trial);
+        report(candidates[c], iterations, trial, score);
+        if (std::isfinite(score)) scores.emplace_back(score, c);
+      }
+      if (scores.empty()) break;
+
+      std::sort(scores.begin(), scores.end());
+      size_t keep = (candidates.size() + reduction_factor - 1) / reduction_factor;
+      keep = std::max<size_t>(1, std::min(keep, scores.size()));
+
+      std::vector<SolverMarketTuningCandidate> survivors;
+      for (size_t s = 0; s < keep; s++) survivors.push_back(candidates[scores[s].second]);
+      candidates.swap(survivors);
+      iterations *= reduction_factor;
+    }
+
+    // Final round: real solves to tolerance, the measured time decides
+    best_time = HUGE_VAL;
+    for (auto& candidate : candidates) {
+      if (elapsed() > time_budget && best_time < HUGE_VAL) break;
+      auto trial = trial_function(candidate, max_iterations);
+      trials_++;
+      const double time = trial.setup_time + trial.solve_time;
+      report(candidate, max_iterations, trial, trial.converged ? time : HUGE_VAL);
+      if (trial.success && trial.converged && time < best_time) {
+        best_time = time;
+        best = candidate;
+      }
+    }
+
+    if (best_time == HUGE_VAL) {
+      std::cerr << "[Error][SolverMarket][Tuner][run] No candidate converged after " << trials_ << " trials\n";
+      return 1;
+    }
+
+    std::cout << "[Info][SolverMarket][Tuner][run] Best configuration after " << trials_ << " trials ("
+              << elapsed() << " s): " << SolverMarketCandidateToString(best) << " in " << best_time << " s\n";
+    return 0;
+  }
+
+  int get_num_trials() const { return trials_; }
+
+private:
+  int trials_ = 0;
+
+  void report(const SolverMarketTuningCandidate& candidate, int iterations, const SolverMarketTuningTrial& trial, double score) const {
+    std::cout << "[Info][SolverMarket][Tuner][trial] " << std::setw(5) << iterations << " it | "
+              << (trial.success ? (trial.converged ? "converged" : "running  ") : "failed   ")
+              << " | rate " << std::setprecision(3) << convergence_rate(trial)
+              << " | predicted " << score << " s | " << SolverMarketCandidateToString(candidate) << "\n";
+  }
+};
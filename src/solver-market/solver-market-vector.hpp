@@ -3,8 +3,15 @@
 #include <sstream>
 #include <string>
 #include <algorithm>
+#include <limits>
+#include <memory>
 
 #include "solver-market-header.hpp"
+#include "solver-market-writer.hpp"
+#include "solver-market-pool.hpp"
+#include "solver-market-numa.hpp"
+#include "solver-market-parse.hpp"
+#include "solver-market-shared.hpp"
 #pragma once
 
 
@@ -29,10 +36,31 @@ public:
       values_h_(i)=value;
     }
   }
+
+  SolverMarketVector(const SolverMarketVector&) = default;
+  SolverMarketVector(SolverMarketVector&&) = default;
+  SolverMarketVector& operator=(const SolverMarketVector&) = default;
+  SolverMarketVector& operator=(SolverMarketVector&&) = default;
+
+  // Storage goes back to the buffer pool (if no View still references it)
+  ~SolverMarketVector(){
+    release_buffers();
+  }
   
   int read_matrix_market_file(std::string filename);
 
+  // Write the host values, full round-trip precision
+  int write_matrix_market_file(std::string filename, SolverMarketFileFormat format = SolverMarketFileCoordinate);
+
+  // Values from a binary segment (solver-market-shared.hpp), wrapped without copy
+  int read_shared_memory(std::string name);
+  int read_binary_file(std::string filename);
+  int attach_shared_segment(std::shared_ptr<SolverMarketSharedSegment> segment);
+  int write_binary_file(std::string filename);
+
   int send_to_device();
+  // Device values back to the host (e.g. a solution computed on the device)
+  int send_to_host();
   _TYPE_* get_host_values_pointer(){return values_h_.data();}
   _TYPE_* get_device_values_pointer(){return values_d_.data();}
 
@@ -59,7 +87,15 @@ private:
   HostView<_TYPE_> values_h_;
   DeviceView<_TYPE_> values_d_;
 
+  /* Pooled buffers (capacity >= n), the views above are their leading subviews*/
+  HostView<_TYPE_> values_h_buffer_;
+  DeviceView<_TYPE_> values_d_buffer_;
+
+  /* Mapping values_h_ points into when built from a segment*/
+  std::shared_ptr<SolverMarketSharedSegment> segment_;
+
   int allocate(const _ITYPE_ n);
+  void release_buffers();
 
 };
 #include "solver-market-vector.tpp"
\ No newline at end of file
@@ -2,37 +2,145 @@ template<typename _TYPE_, typename _ITYPE_>
 int SolverMarketVector<_TYPE_, _ITYPE_>::send_to_device(){
 
     if (not(is_allocated_)){
-        std::cout<<"[Error][SolverMarket][CsrVector][send_to_device] You want to send to device a CSR vector that has not been allocated\n";
+        SolverMarketLog() << "[Error][SolverMarket][CsrVector][send_to_device] You want to send to device a CSR vector that has not been allocated\n";
         return 1;
     }
     Kokkos::deep_copy(values_d_, values_h_);
 
-    std::cout << "[Info][SolverMarket][CsrVector][send_to_device] Values successfuly sent to device\n";
+    SolverMarketLog() << "[Info][SolverMarket][CsrVector][send_to_device] Values successfuly sent to device\n";
+
+    return 0;
+  }
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketVector<_TYPE_, _ITYPE_>::send_to_host(){
+
+    if (not(is_allocated_)){
+        SolverMarketLog() << "[Error][SolverMarket][CsrVector][send_to_host] You want to copy to host a vector that has not been allocated\n";
+        return 1;
+    }
+    Kokkos::deep_copy(values_h_, values_d_);
 
     return 0;
   }
 
 template<typename _TYPE_, typename _ITYPE_>
 int SolverMarketVector<_TYPE_, _ITYPE_>::allocate(const _ITYPE_ n){
+    // Previous storage goes back to the pool first, so a reload can get it back
+    release_buffers();
+
     n_ = n;
-    values_h_ = HostView<_TYPE_>("values_h_", n);
-    values_d_ = DeviceView<_TYPE_>("values_d_", n);
-    std::cout << "[Info][SolverMarket][CsrVector][allocate] Successfuly allocated on host and device\n";
+    const auto range = std::make_pair(size_t(0), size_t(n));
+
+    // Zeroed: a sparse vector file only sets its stored entries. A new host buffer is zeroed
+    // by its NUMA placement instead (first touch, or interleaved: every thread reads x)
+    bool fresh = false;
+    values_h_buffer_ = SolverMarketViewPool<_TYPE_, Host>::instance().acquire("values_h_", range.second, false, &fresh);
+    values_d_buffer_ = SolverMarketViewPool<_TYPE_, Device>::instance().acquire("values_d_", range.second, true);
+    values_h_ = Kokkos::subview(values_h_buffer_, range);
+    values_d_ = Kokkos::subview(values_d_buffer_, range);
+    if (!(fresh && SolverMarketNumaPlace(values_h_buffer_, range.second, true))) {
+        Kokkos::deep_copy(values_h_, _TYPE_(0));
+    }
+    SolverMarketLog() << "[Info][SolverMarket][CsrVector][allocate] Successfuly allocated on host and device\n";
 
 
     is_allocated_ = true;
     return 0;
   }
 
+template<typename _TYPE_, typename _ITYPE_>
+void SolverMarketVector<_TYPE_, _ITYPE_>::release_buffers(){
+    // Drop the subviews first: the pool only takes back buffers nobody else references
+    values_h_ = HostView<_TYPE_>();
+    values_d_ = DeviceView<_TYPE_>();
+    SolverMarketViewPool<_TYPE_, Host>::instance().release(values_h_buffer_);
+    SolverMarketViewPool<_TYPE_, Device>::instance().release(values_d_buffer_);
+    segment_.reset();
+    is_allocated_ = false;
+  }
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketVector<_TYPE_, _ITYPE_>::read_shared_memory(std::string name)
+{
+    auto segment = std::make_shared<SolverMarketSharedSegment>();
+    const int status = segment->open_shared(name);
+    if (status != SolverMarketSharedSuccess) return status;
+    return attach_shared_segment(segment);
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketVector<_TYPE_, _ITYPE_>::read_binary_file(std::string filename)
+{
+    auto segment = std::make_shared<SolverMarketSharedSegment>();
+    const int status = segment->open_file(filename);
+    if (status != SolverMarketSharedSuccess) return status;
+    return attach_shared_segment(segment);
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketVector<_TYPE_, _ITYPE_>::attach_shared_segment(std::shared_ptr<SolverMarketSharedSegment> segment)
+{
+    if (segment == nullptr || !segment->is_open()) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][attach_shared] Segment is not mapped\n";
+        return SolverMarketSharedErrorOpen;
+    }
+    const auto& header = segment->header();
+    if (header.kind != SolverMarketSharedVector) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][attach_shared] Segment does not hold a vector\n";
+        return SolverMarketSharedErrorKind;
+    }
+    if (header.value_bytes != sizeof(_TYPE_)) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][attach_shared] Segment stores " << header.value_bytes
+                  << " byte values, the vector uses " << sizeof(_TYPE_) << "\n";
+        return SolverMarketSharedErrorType;
+    }
+    if (header.n > uint64_t(std::numeric_limits<_ITYPE_>::max())) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][attach_shared] n= " << header.n << " does not fit the "
+                  << sizeof(_ITYPE_) << " byte index type\n";
+        return SolverMarketSharedErrorType;
+    }
+
+    release_buffers();
+    n_ = header.n;
+    segment_ = segment;
+    values_h_ = HostView<_TYPE_>(segment->values<_TYPE_>(), size_t(n_));
+    values_d_buffer_ = SolverMarketViewPool<_TYPE_, Device>::instance().acquire("values_d_", size_t(n_));
+    values_d_ = Kokkos::subview(values_d_buffer_, std::make_pair(size_t(0), size_t(n_)));
+    is_allocated_ = true;
+
+    SolverMarketLog() << "[Info][SolverMarket][Vector][attach_shared] Mapped n= " << n_ << " (no copy)\n";
+    return SolverMarketSharedSuccess;
+}
+
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketVector<_TYPE_, _ITYPE_>::write_binary_file(std::string filename)
+{
+    if (not(is_allocated_)){
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][write_binary] You want to write a vector that has not been allocated\n";
+        return MtxWriterErrorNotAllocated;
+    }
+
+    SolverMarketSharedSegment segment;
+    if (segment.create_file(filename, SolverMarketSharedVector, n_, n_, sizeof(_ITYPE_), sizeof(_TYPE_)) != SolverMarketSharedSuccess) {
+        return MtxWriterErrorFileNotOpened;
+    }
+    std::memcpy(segment.values<_TYPE_>(), values_h_.data(), size_t(n_) * sizeof(_TYPE_));
+    segment.close();
+
+    SolverMarketLog() << "[Info][SolverMarket][Vector][write_binary] Wrote " << n_ << " entries to " << filename << "\n";
+    return MtxWriterSuccess;
+}
+
 template<typename _TYPE_, typename _ITYPE_>
 int SolverMarketVector<_TYPE_, _ITYPE_>::read_matrix_market_file(std::string filename)
 {
     std::ifstream file(filename);
     if (!file.is_open()) {
-        std::cerr << "[Error][SolverMarket][Vector][read_from_file] Could not open file: " << filename << "\n";
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] Could not open file: " << filename << "\n";
         return MtxReaderErrorFileNotFound;
     }else{
-        std::cout << "[Info][SolverMarket][CsrMatrix][read_from_file] Reading file "<< filename << std::endl;
+        SolverMarketLog() << "[Info][SolverMarket][CsrMatrix][read_from_file] Reading file "<< filename << std::endl;
     }
 
     std::string line;
@@ -42,8 +150,7 @@ int SolverMarketVector<_TYPE_, _ITYPE_>::read_matrix_market_file(std::string fil
     int declared_nnz = 0;
     int file_line_count = 0;
     int nrows = 0, ncols = 0;
-
-    std::vector<std::pair<_ITYPE_, _TYPE_>> entries;
+    SolverMarketField value_field = SolverMarketFieldReal;
 
     while (std::getline(file, line)) {
         if (line.empty()) continue;
@@ -61,14 +168,19 @@ int SolverMarketVector<_TYPE_, _ITYPE_>::read_matrix_market_file(std::string fil
                 header >> banner >> object >> format >> field >> symmetry;
 
                 if (object != "matrix" || format != "coordinate") {
-                    std::cerr << "[Error][SolverMarket][Vector][read_from_file] Only 'matrix coordinate' format supported.\n";
+                    SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] Only 'matrix coordinate' format supported.\n";
                     return MtxReaderUnsupportedObject;
                 }
 
+                if (SolverMarketParseFieldName(field, value_field) || !SolverMarketFieldFits<_TYPE_>(value_field)) {
+                    SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] Unsupported field '" << field << "' for this value type\n";
+                    return MtxReaderUnsupportedField;
+                }
+
                 if (symmetry == "general"){}
                 else if (symmetry == "symmetric"){}
                 else {
-                    std::cerr << "[Error][SolverMarket][Vector][read_from_file] Unsupported matrix type: " << symmetry << "\n";
+                    SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] Unsupported matrix type: " << symmetry << "\n";
                     return MtxReaderUnsupportedMatrixType;
                 }
 
@@ -83,57 +195,125 @@ int SolverMarketVector<_TYPE_, _ITYPE_>::read_matrix_market_file(std::string fil
             lineData >> nrows >> ncols >> declared_nnz;
 
             if (ncols != 1) {
-                std::cerr << "[Error][SolverMarket][Vector][read_from_file] Not a vector (ncols = " << ncols << ")\n";
+                SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] Not a vector (ncols = " << ncols << ")\n";
                 return MtxReaderNotAVector;
             }
 
             if (nrows != declared_nnz) {
-                std::cerr << "[Error][SolverMarket][Vector][read_from_file] Not a vector (nnz = " << nrows << " != nrows ="<< declared_nnz <<")\n";
+                SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] Not a vector (nnz = " << nrows << " != nrows ="<< declared_nnz <<")\n";
                 return MtxReaderNotAVector;
             }
 
             foundSize = true;
-        } else {
-            _ITYPE_ i;
-            _ITYPE_ j;
-            _TYPE_ val;
+            break; // the body is parsed below
+        }
+    }
+
+    if (!foundHeader || !foundSize) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] Invalid Matrix Market header or size line.\n";
+        return MtxReaderWrongHeaderOrNoHeader;
+    }
+
+    n_ = nrows;
+
+    if (allocate(nrows)) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] Memory allocation failed.\n";
+        return MtxReaderErrorFileMemAllocFailed;
+    }
 
-            lineData >> i >> j >> val;
+    // Body: parsed in parallel, each line goes straight to its entry
+    size_t stored = 0;
+    auto values = values_h_;
+    int parse_status = SolverMarketDispatchField(value_field, [&](auto field) {
+      using EntryValue = SolverMarketEntryValue<decltype(field)::value, _TYPE_>;
+      return SolverMarketParseBody(file,
+        [](const size_t, const size_t) {},
+        [&](const char* p, const char* end, const size_t) -> int {
+            if (SolverMarketIsEmptyLine(p, end)) return -1;
+            long long i, j;
+            _TYPE_ val;
+            if (!SolverMarketParseInteger(p, end, i) || !SolverMarketParseInteger(p, end, j) || !EntryValue::parse(p, end, val)) {
+                return MtxReaderErrorInvalidEntry;
+            }
             i -= 1; // 1-based to 0-based
             if (i < 0 || i >= nrows) {
-                std::cerr << "[Error][SolverMarket][Vector][read_from_file] Invalid row index " << i << "\n";
+                SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] Invalid row index " << i << "\n";
                 return MtxReaderErrorOutOfBoundRowIndex;
             }
 
             if (j != 1) {
-                std::cerr << "[Error][SolverMarket][Vector][read_from_file] Invalid col index != 1 " << j << "\n";
+                SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][read_from_file] Invalid col index != 1 " << j << "\n";
                 return MtxReaderErrorOutOfBoundColIndex;
             }
 
-            entries.emplace_back(i, val);
-            file_line_count++;
-        }
+            values(i) = val;
+            return 0;
+        },
+        [](const size_t, const size_t) {},
+        stored);
+    });
+    file.close();
+    if (parse_status) return parse_status;
+    file_line_count = stored;
+
+    SolverMarketLog() << "[Info][SolverMarket][Vector][read_from_file] Successfully read vector with " << nrows
+              << " entries, " << file_line_count << " non-zeros\n";
+    return MtxReaderSuccess;
+}
+template<typename _TYPE_, typename _ITYPE_>
+int SolverMarketVector<_TYPE_, _ITYPE_>::write_matrix_market_file(std::string filename, SolverMarketFileFormat format)
+{
+    if (not(is_allocated_)){
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][write_to_file] You want to write a vector that has not been allocated\n";
+        return MtxWriterErrorNotAllocated;
     }
 
-    file.close();
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][write_to_file] Could not open file " << filename << std::endl;
+        return MtxWriterErrorFileNotOpened;
+    }
 
-    if (!foundHeader || !foundSize) {
-        std::cerr << "[Error][SolverMarket][Vector][read_from_file] Invalid Matrix Market header or size line.\n";
-        return MtxReaderWrongHeaderOrNoHeader;
+    Kokkos::Timer timer;
+    const bool array = (format == SolverMarketFileArray);
+
+    // Same layout as the reader expects: n x 1, every entry stored (zeros included)
+    std::string header = std::string("%%MatrixMarket matrix ") + (array ? "array " : "coordinate ")
+                       + SolverMarketFieldName<_TYPE_>() + " general\n";
+    SolverMarketAppendNumber(header, n_);
+    header += array ? " 1\n" : " 1 ";
+    if (!array) {
+        SolverMarketAppendNumber(header, n_);
+        header += "\n";
     }
 
-    n_ = nrows;
+    int status = (std::fwrite(header.data(), 1, header.size(), file) == header.size()) ? MtxWriterSuccess : MtxWriterErrorWriteFailed;
 
-    if (allocate(nrows)) {
-        std::cerr << "[Error][SolverMarket][Vector][read_from_file] Memory allocation failed.\n";
-        return MtxReaderErrorFileMemAllocFailed;
+    auto values = values_h_;
+    if (status == MtxWriterSuccess) {
+        status = SolverMarketWriteBlocks(file, n_, size_t(1) << 18, [&](const size_t begin, const size_t end, std::string& buffer) {
+            buffer.reserve(32 * (end - begin));
+            for (size_t i = begin; i < end; i++) {
+                if (!array) {
+                    SolverMarketAppendNumber(buffer, i + 1);
+                    buffer += " 1 ";
+                }
+                SolverMarketAppendNumber(buffer, values(i));
+                buffer += '\n';
+            }
+        });
     }
 
-    for (auto& [i, val] : entries) {
-        values_h_(i) = val;
+    if (std::fclose(file) != 0 && status == MtxWriterSuccess) {
+        status = MtxWriterErrorWriteFailed;
     }
 
-    std::cout << "[Info][SolverMarket][Vector][read_from_file] Successfully read vector with " << nrows
-              << " entries, " << file_line_count << " non-zeros\n";
-    return MtxReaderSuccess;
-}
\ No newline at end of file
+    if (status != MtxWriterSuccess) {
+        SolverMarketLog(std::cerr) << "[Error][SolverMarket][Vector][write_to_file] Write failed for file " << filename << std::endl;
+        return status;
+    }
+
+    SolverMarketLog() << "[Info][SolverMarket][Vector][write_to_file] Wrote " << n_ << " entries to " << filename
+              << " in " << timer.seconds() * 1000 << " ms\n";
+    return MtxWriterSuccess;
+}
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "solver-market-header.hpp"
+#include "solver-market-parse.hpp"
+
+#pragma once
+
+/* Shared machinery of the Matrix Market writers.
+Items (rows, columns, vector entries) are cut in blocks, each block is formatted by
+one host thread into its own buffer with std::to_chars, and the blocks are appended
+to the file in order with one fwrite each. Blocks are processed in waves of a few
+per thread so that the text of a huge matrix is never held in memory at once. */
+
+// Shortest representation that reads back to the same value (integers and floating point)
+template <typename _T_>
+inline void SolverMarketAppendNumber(std::string& buffer, const _T_ value) {
+  char tmp[64];
+  auto result = std::to_chars(tmp, tmp + sizeof(tmp), value);
+  buffer.append(tmp, result.ptr);
+}
+
+// Complex entries are written as "real imag"
+template <typename _T_>
+inline void SolverMarketAppendNumber(std::string& buffer, const Kokkos::complex<_T_> value) {
+  SolverMarketAppendNumber(buffer, value.real());
+  buffer += ' ';
+  SolverMarketAppendNumber(buffer, value.imag());
+}
+
+template <typename _TYPE_>
+inline const char* SolverMarketFieldName() {
+  if (SolverMarketIsComplex<_TYPE_>::value) return "complex";
+  return std::is_integral<_TYPE_>::value ? "integer" : "real";
+}
+
+// format_block(begin, end, buffer) appends the text of items [begin, end) to buffer
+template <typename _FORMAT_>
+int SolverMarketWriteBlocks(std::FILE* file, const size_t nitems, const size_t block_size, const _FORMAT_& format_block) {
+  if (nitems == 0) return MtxWriterSuccess;
+
+  const size_t nblocks = (nitems + block_size - 1) / block_size;
+  const size_t wave_size = std::min<size_t>(nblocks, 2 * size_t(Host().concurrency()));
+  std::vector<std::string> buffers(wave_size);
+
+  for (size_t wave = 0; wave < nblocks; wave += wave_size) {
+    const size_t wave_end = std::min(nblocks, wave + wave_size);
+
+    // Host only lambda: the buffers are std::strings
+    Kokkos::parallel_for("SolverMarket::write_blocks", Kokkos::RangePolicy<Host>(wave, wave_end), [&](const size_t b) {
+      std::string& buffer = buffers[b - wave];
+      buffer.clear();
+      format_block(b * block_size, std::min(nitems, (b + 1) * block_size), buffer);
+    });
+
+    for (size_t b = wave; b < wave_end; b++) {
+      const std::string& buffer = buffers[b - wave];
+      if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+        return MtxWriterErrorWriteFailed;
+      }
+    }
+  }
+  return MtxWriterSuccess;
+}
@@ -0,0 +1,151 @@
+#include <chrono>
+#include <mutex>
+
+#include "solver-market-amgx-solver.hpp"
+
+namespace {
+  std::mutex runtime_mutex;
+  int runtime_count = 0;
+
+  double elapsed_ms(std::chrono::high_resolution_clock::time_point start){
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  }
+}
+
+bool SolverMarketAMGXSolver::initialize_runtime(){
+  std::lock_guard<std::mutex> lock(runtime_mutex);
+  if (runtime_count == 0 && !check(AMGX_initialize(), "initialize")) return false;
+  runtime_count++;
+  return true;
+}
+
+void SolverMarketAMGXSolver::finalize_runtime(){
+  std::lock_guard<std::mutex> lock(runtime_mutex);
+  if (runtime_count == 0) return;
+  if (--runtime_count == 0) AMGX_finalize();
+}
+
+bool SolverMarketAMGXSolver::check(AMGX_RC rc, const char* method){
+  if (rc == AMGX_RC_OK) return true;
+  char err_string[256];
+  AMGX_get_error_string(rc, err_string, sizeof(err_string));
+  std::cerr << "[Error][SolverMarket][Solver][amgx][" << method << "] " << err_string << std::endl;
+  return false;
+}
+
+SolverMarketAMGXSolver::SolverMarketAMGXSolver(){
+  stats_.backend = name();
+  runtime_ = initialize_runtime();
+}
+
+SolverMarketAMGXSolver::~SolverMarketAMGXSolver(){
+  release();
+  if (resources_) AMGX_resources_destroy(resources_);
+  if (config_) AMGX_config_destroy(config_);
+  if (runtime_) finalize_runtime();
+}
+
+void SolverMarketAMGXSolver::release(){
+  if (solver_) AMGX_solver_destroy(solver_);
+  if (x_) AMGX_vector_destroy(x_);
+  if (b_) AMGX_vector_destroy(b_);
+  if (A_) AMGX_matrix_destroy(A_);
+  solver_ = nullptr;
+  x_ = b_ = nullptr;
+  A_ = nullptr;
+}
+
+int SolverMarketAMGXSolver::configure(const std::string& config_file){
+  if (!runtime_) return SolverMarketSolverErrorUnavailable;
+  release();
+  if (resources_) AMGX_resources_destroy(resources_);
+  if (config_) AMGX_config_destroy(config_);
+  resources_ = nullptr;
+  config_ = nullptr;
+
+  if (!check(AMGX_config_create_from_file(&config_, config_file.c_str()), "configure")) {
+    config_ = nullptr;
+    return SolverMarketSolverErrorConfig;
+  }
+  if (!check(AMGX_resources_create_simple(&resources_, config_), "configure")) {
+    AMGX_config_destroy(config_);
+    resources_ = nullptr;
+    config_ = nullptr;
+    return SolverMarketSolverErrorConfig;
+  }
+  return SolverMarketSolverSuccess;
+}
+
+int SolverMarketAMGXSolver::setup(SolverMarketSolverMatrix& A){
+  if (!config_) return SolverMarketSolverErrorConfig;
+  release();
+
+  // A handle that failed to be created stays null, release() skips it
+  const auto mode = AMGX_mode_dDDI;
+  bool ok = check(AMGX_matrix_create(&A_, resources_, mode), "setup")
+         && check(AMGX_vector_create(&b_, resources_, mode), "setup")
+         && check(AMGX_vector_create(&x_, resources_, mode), "setup")
+         && check(AMGX_solver_create(&solver_, resources_, mode, config_), "setup");
+  if (!ok) {
+    release();
+    return SolverMarketSolverErrorSetup;
+  }
+
+  n_ = A.get_n();
+  nnz_ = A.get_nnz();
+  auto start = std::chrono::high_resolution_clock::now();
+  ok = check(AMGX_matrix_upload_all(A_, n_, nnz_, 1, 1, A.get_device_offsets_pointer(), A.get_device_columns_pointer(),
+                                    A.get_device_values_pointer(), 0), "setup")
+    && check(AMGX_solver_setup(solver_, A_), "setup");
+  stats_.setup_ms = elapsed_ms(start);
+  stats_.setups++;
+  if (!ok) {
+    release();
+    return SolverMarketSolverErrorSetup;
+  }
+  return SolverMarketSolverSuccess;
+}
+
+int SolverMarketAMGXSolver::resetup(SolverMarketSolverMatrix& A){
+  if (!solver_) return SolverMarketSolverErrorNotSetUp;
+  if (A.get_n() != n_ || A.get_nnz() != nnz_) return SolverMarketSolverErrorSize;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  bool ok = check(AMGX_matrix_replace_coefficients(A_, n_, nnz_, A.get_device_values_pointer(), 0), "resetup")
+         && check(AMGX_solver_resetup(solver_, A_), "resetup");
+  stats_.resetup_ms = elapsed_ms(start);
+  stats_.resetups++;
+  return ok ? SolverMarketSolverSuccess : SolverMarketSolverErrorSetup;
+}
+
+int SolverMarketAMGXSolver::solve(SolverMarketSolverVector& b, SolverMarketSolverVector& x){
+  if (!solver_) return SolverMarketSolverErrorNotSetUp;
+  if (b.get_n() != n_ || x.get_n() != n_) return SolverMarketSolverErrorSize;
+
+  if (!check(AMGX_vector_upload(b_, n_, 1, b.get_device_values_pointer()), "solve")
+      || !check(AMGX_vector_upload(x_, n_, 1, x.get_device_values_pointer()), "solve")) {
+    return SolverMarketSolverErrorSolve;
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  bool ok = check(AMGX_solver_solve(solver_, b_, x_), "solve");
+  stats_.solve_ms = elapsed_ms(start);
+  stats_.solves++;
+  if (!ok) return SolverMarketSolverErrorSolve;
+
+  AMGX_SOLVE_STATUS status = AMGX_SOLVE_FAILED;
+  if (!check(AMGX_solver_get_status(solver_, &status), "solve")) return SolverMarketSolverErrorSolve;
+  AMGX_solver_get_iterations_number(solver_, &stats_.iterations);
+  // Only available with monitor_residual=1 in the config
+  if (AMGX_solver_get_iteration_residual(solver_, stats_.iterations, 0, &stats_.residual) != AMGX_RC_OK) {
+    stats_.residual = -1;
+  }
+  stats_.converged = (status == AMGX_SOLVE_SUCCESS);
+
+  // x is left as it was if the solution cannot be downloaded, not reported as solved
+  if (!check(AMGX_vector_download(x_, x.get_device_values_pointer()), "solve")) return SolverMarketSolverErrorSolve;
+  x.send_to_host();
+
+  if (status == AMGX_SOLVE_FAILED) return SolverMarketSolverErrorSolve;
+  return stats_.converged ? SolverMarketSolverSuccess : SolverMarketSolverErrorNotConverged;
+}
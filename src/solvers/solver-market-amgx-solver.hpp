@@ -0,0 +1,37 @@
+#include <amgx_c.h>
+
+#include "solver-market-solver.hpp"
+
+#pragma once
+
+/* AMGX backend (mode dDDI). The matrix and vectors are uploaded from the device views of the
+SolverMarket objects, AMGX keeps its own copy of the matrix for setup/resetup. */
+class SolverMarketAMGXSolver : public SolverMarketSolver {
+public:
+  SolverMarketAMGXSolver();
+  ~SolverMarketAMGXSolver() override;
+
+  std::string name() const override { return "amgx"; }
+  int configure(const std::string& config_file) override;
+  int setup(SolverMarketSolverMatrix& A) override;
+  int resetup(SolverMarketSolverMatrix& A) override;
+  int solve(SolverMarketSolverVector& b, SolverMarketSolverVector& x) override;
+
+  // AMGX_initialize/AMGX_finalize, reference counted: solvers created without
+  // SolverMarketInitializeBackends start (and stop) the runtime themselves
+  static bool initialize_runtime();
+  static void finalize_runtime();
+
+private:
+  AMGX_config_handle config_ = nullptr;
+  AMGX_resources_handle resources_ = nullptr;
+  AMGX_matrix_handle A_ = nullptr;
+  AMGX_vector_handle b_ = nullptr;
+  AMGX_vector_handle x_ = nullptr;
+  AMGX_solver_handle solver_ = nullptr;
+  bool runtime_ = false;
+  int n_ = 0, nnz_ = 0;
+
+  void release();
+  static bool check(AMGX_RC rc, const char* method);
+};
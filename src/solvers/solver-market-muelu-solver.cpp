@@ -0,0 +1,190 @@
+#include <chrono>
+
+// Teuchos includes
+#include <Teuchos_DefaultComm.hpp>
+#include <Teuchos_GlobalMPISession.hpp>
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_XMLParameterListHelpers.hpp>
+#include <Teuchos_YamlParameterListHelpers.hpp>
+
+// Tpetra includes
+#include <Tpetra_CrsMatrix.hpp>
+#include <Tpetra_Vector.hpp>
+#include "solver-market-tpetra.hpp"
+
+// Thyra and Stratimikos includes
+#include <Thyra_TpetraThyraWrappers.hpp>
+#include <Thyra_LinearOpWithSolveBase.hpp>
+#include <Thyra_LinearOpWithSolveFactoryHelpers.hpp>
+#include <Thyra_PreconditionerFactoryHelpers.hpp>
+#include <Stratimikos_LinearSolverBuilder.hpp>
+#include <Stratimikos_MueLuHelpers.hpp>
+
+#include "solver-market-muelu-solver.hpp"
+
+namespace {
+  using Scalar = double;
+  using LocalOrdinal = int;
+  using GlobalOrdinal = Tpetra::Map<>::global_ordinal_type;
+  using Node = Tpetra::Map<>::node_type;
+  using map_type = Tpetra::Map<LocalOrdinal, GlobalOrdinal, Node>;
+  using crs_matrix_type = Tpetra::CrsMatrix<Scalar, LocalOrdinal, GlobalOrdinal, Node>;
+  using vector_type = Tpetra::Vector<Scalar, LocalOrdinal, GlobalOrdinal, Node>;
+  using operator_type = Tpetra::Operator<Scalar, LocalOrdinal, GlobalOrdinal, Node>;
+
+  std::unique_ptr<Teuchos::GlobalMPISession> mpi_session;
+
+  double elapsed_ms(std::chrono::high_resolution_clock::time_point start){
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  }
+}
+
+struct SolverMarketMueLuSolver::Data {
+  Teuchos::RCP<Teuchos::ParameterList> parameters;
+  Teuchos::RCP<Thyra::LinearOpWithSolveFactoryBase<Scalar> > factory;
+  Teuchos::RCP<const map_type> map;
+  Teuchos::RCP<crs_matrix_type> A;
+  Teuchos::RCP<const Thyra::LinearOpBase<Scalar> > thyraA;
+  Teuchos::RCP<Thyra::PreconditionerBase<Scalar> > prec;
+  Teuchos::RCP<Thyra::LinearOpWithSolveBase<Scalar> > inverseA;
+  Teuchos::RCP<vector_type> b, x;
+
+  // Stratimikos operator A^{-1}: preconditioner (if any) built here, this is the setup cost
+  void initialize_inverse(){
+    auto precFactory = factory->getPreconditionerFactory();
+    if (!precFactory.is_null()) {
+      if (prec.is_null()) prec = precFactory->createPrec();
+      Thyra::initializePrec<Scalar>(*precFactory, thyraA, prec.ptr());
+      if (inverseA.is_null()) inverseA = factory->createOp();
+      Thyra::initializePreconditionedOp<Scalar>(*factory, thyraA, prec, inverseA.ptr());
+    } else {
+      inverseA = Thyra::linearOpWithSolve(*factory, thyraA);
+    }
+  }
+};
+
+void SolverMarketMueLuSolver::initialize_runtime(int* argc, char*** argv){
+  if (!mpi_session) mpi_session = std::make_unique<Teuchos::GlobalMPISession>(argc, argv, nullptr);
+}
+
+void SolverMarketMueLuSolver::finalize_runtime(){
+  mpi_session.reset();
+}
+
+SolverMarketMueLuSolver::SolverMarketMueLuSolver() : data_(std::make_unique<Data>()) {
+  stats_.backend = name();
+}
+
+SolverMarketMueLuSolver::~SolverMarketMueLuSolver() = default;
+
+int SolverMarketMueLuSolver::configure(const std::string& config_file){
+  auto comm = Teuchos::DefaultComm<int>::getComm();
+  try {
+    auto parameters = Teuchos::rcp(new Teuchos::ParameterList("params"));
+    const bool yaml = config_file.size() > 5 && (config_file.substr(config_file.size() - 5) == ".yaml" ||
+                                                 config_file.substr(config_file.size() - 4) == ".yml");
+    if (yaml)
+      Teuchos::updateParametersFromYamlFileAndBroadcast(config_file, parameters.ptr(), *comm);
+    else
+      Teuchos::updateParametersFromXmlFileAndBroadcast(config_file, parameters.ptr(), *comm);
+
+    Stratimikos::LinearSolverBuilder<Scalar> builder;
+    Stratimikos::enableMueLu<Scalar, LocalOrdinal, GlobalOrdinal, Node>(builder);
+    builder.setParameterList(parameters);
+    data_ = std::make_unique<Data>();
+    data_->parameters = parameters;
+    data_->factory = Thyra::createLinearSolveStrategy(builder);
+  } catch (std::exception& e) {
+    std::cerr << "[Error][SolverMarket][Solver][muelu][configure] " << config_file << ": " << e.what() << std::endl;
+    data_ = std::make_unique<Data>();
+    return SolverMarketSolverErrorConfig;
+  }
+  return SolverMarketSolverSuccess;
+}
+
+int SolverMarketMueLuSolver::setup(SolverMarketSolverMatrix& A){
+  if (data_->factory.is_null()) return SolverMarketSolverErrorConfig;
+  auto comm = Teuchos::DefaultComm<int>::getComm();
+  if (comm->getSize() != 1) {
+    std::cerr << "[Error][SolverMarket][Solver][muelu][setup] Single rank only" << std::endl;
+    return SolverMarketSolverErrorSetup;
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  try {
+    // Local matrix built from the device CSR, same arrays as the other backends
+    data_->A = SolverMarketToTpetraCrsMatrix<crs_matrix_type>(A, comm);
+    data_->map = data_->A->getRowMap();
+
+    data_->thyraA = Thyra::createConstLinearOp(Teuchos::rcp_implicit_cast<const operator_type>(data_->A));
+    data_->prec = Teuchos::null;
+    data_->inverseA = Teuchos::null;
+    data_->initialize_inverse();
+    data_->b = Teuchos::rcp(new vector_type(data_->map));
+    data_->x = Teuchos::rcp(new vector_type(data_->map));
+  } catch (std::exception& e) {
+    std::cerr << "[Error][SolverMarket][Solver][muelu][setup] " << e.what() << std::endl;
+    data_->inverseA = Teuchos::null;
+    stats_.setups++;
+    return SolverMarketSolverErrorSetup;
+  }
+  stats_.setup_ms = elapsed_ms(start);
+  stats_.setups++;
+  return SolverMarketSolverSuccess;
+}
+
+int SolverMarketMueLuSolver::resetup(SolverMarketSolverMatrix& A){
+  if (data_->inverseA.is_null()) return SolverMarketSolverErrorNotSetUp;
+  if (GlobalOrdinal(A.get_n()) != GlobalOrdinal(data_->map->getGlobalNumElements()) ||
+      size_t(A.get_nnz()) != data_->A->getGlobalNumEntries()) return SolverMarketSolverErrorSize;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  try {
+    SolverMarketUpdateTpetraValues(A, *data_->A);
+    // MueLu's "reuse: type" parameter decides what of the hierarchy survives
+    data_->initialize_inverse();
+  } catch (std::exception& e) {
+    std::cerr << "[Error][SolverMarket][Solver][muelu][resetup] " << e.what() << std::endl;
+    return SolverMarketSolverErrorSetup;
+  }
+  stats_.resetup_ms = elapsed_ms(start);
+  stats_.resetups++;
+  return SolverMarketSolverSuccess;
+}
+
+int SolverMarketMueLuSolver::solve(SolverMarketSolverVector& b, SolverMarketSolverVector& x){
+  if (data_->inverseA.is_null()) return SolverMarketSolverErrorNotSetUp;
+  const size_t n = data_->map->getLocalNumElements();
+  if (size_t(b.get_n()) != n || size_t(x.get_n()) != n) return SolverMarketSolverErrorSize;
+
+  SolverMarketCopyToTpetra(b, *data_->b);
+  SolverMarketCopyToTpetra(x, *data_->x);
+
+  auto thyraB = Thyra::createConstVector(Teuchos::rcp_implicit_cast<const vector_type>(data_->b));
+  auto thyraX = Thyra::createVector(data_->x);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  Thyra::SolveStatus<Scalar> status;
+  try {
+    status = Thyra::solve<Scalar>(*data_->inverseA, Thyra::NOTRANS, *thyraB, thyraX.ptr());
+  } catch (std::exception& e) {
+    std::cerr << "[Error][SolverMarket][Solver][muelu][solve] " << e.what() << std::endl;
+    stats_.solves++;
+    return SolverMarketSolverErrorSolve;
+  }
+  stats_.solve_ms = elapsed_ms(start);
+  stats_.solves++;
+
+  stats_.converged = (status.solveStatus == Thyra::SOLVE_STATUS_CONVERGED);
+  stats_.iterations = 0;
+  if (!status.extraParameters.is_null() && status.extraParameters->isParameter("Belos/Iteration Count"))
+    stats_.iterations = status.extraParameters->get<int>("Belos/Iteration Count");
+  stats_.residual = (status.achievedTol >= 0) ? status.achievedTol : -1.0;
+
+  // thyraX writes through to data_->x
+  thyraX = Teuchos::null;
+  SolverMarketCopyFromTpetra(*data_->x, x);
+  x.send_to_host();
+
+  return stats_.converged ? SolverMarketSolverSuccess : SolverMarketSolverErrorNotConverged;
+}
@@ -0,0 +1,25 @@
+#include "solver-market-solver.hpp"
+
+#pragma once
+
+/* MueLu backend through Stratimikos (Belos + MueLu, same xml/yaml parameter lists as
+muelu_input_deck), single rank. Trilinos types stay in the .cpp. */
+class SolverMarketMueLuSolver : public SolverMarketSolver {
+public:
+  SolverMarketMueLuSolver();
+  ~SolverMarketMueLuSolver() override;
+
+  std::string name() const override { return "muelu"; }
+  int configure(const std::string& config_file) override;
+  int setup(SolverMarketSolverMatrix& A) override;
+  int resetup(SolverMarketSolverMatrix& A) override;
+  int solve(SolverMarketSolverVector& b, SolverMarketSolverVector& x) override;
+
+  // MPI through Teuchos::GlobalMPISession, kept until finalize_runtime
+  static void initialize_runtime(int* argc, char*** argv);
+  static void finalize_runtime();
+
+private:
+  struct Data;
+  std::unique_ptr<Data> data_;
+};
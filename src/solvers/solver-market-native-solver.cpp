@@ -0,0 +1,137 @@
+#include <chrono>
+#include <fstream>
+
+#include "solver-market-native-solver.hpp"
+
+namespace {
+  double elapsed_ms(std::chrono::high_resolution_clock::time_point start){
+    Kokkos::fence();
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  }
+
+  std::string trim(const std::string& s){
+    auto b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    auto e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+  }
+}
+
+int SolverMarketNativeSolver::configure(const std::string& config_file){
+  std::ifstream file(config_file);
+  if (!file.is_open()) {
+    std::cerr << "[Error][SolverMarket][Solver][native][configure] Could not open file " << config_file << std::endl;
+    return SolverMarketSolverErrorConfig;
+  }
+  SolverMarketAMGOptions options;
+  double tolerance = 1e-8;
+  int max_iterations = 500;
+  SolverMarketSpMVFormat format = SolverMarketSpMVCSR;
+  int sell_chunk = 0, sell_sigma = 0;
+  SolverMarketCGVariant variant = SolverMarketCGClassic;
+  int sstep = 4;
+  std::string line;
+  while (std::getline(file, line)) {
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty()) continue;
+    auto eq = line.find('=');
+    std::string key = (eq == std::string::npos) ? line : trim(line.substr(0, eq));
+    std::string value = (eq == std::string::npos) ? "" : trim(line.substr(eq + 1));
+    int bad = 0;
+    try {
+      if (key == "tolerance") tolerance = std::stod(value);
+      else if (key == "max_iterations") max_iterations = std::stoi(value);
+      else if (key == "krylov") bad = SolverMarketParseCGVariant(value, variant);
+      else if (key == "sstep") bad = (sstep = std::stoi(value)) < 1 || sstep > SolverMarketSStepMax;
+      else if (key == "spmv_format") bad = SolverMarketParseSpMVFormat(value, format);
+      else if (key == "sell_chunk") sell_chunk = std::stoi(value);
+      else if (key == "sell_sigma") sell_sigma = std::stoi(value);
+      else bad = options.set(key, value);
+    } catch (std::exception&) {
+      bad = 1;
+    }
+    if (bad) {
+      std::cerr << "[Error][SolverMarket][Solver][native][configure] Bad line: " << line << std::endl;
+      return SolverMarketSolverErrorConfig;
+    }
+  }
+  amg_.setOptions(options);
+  tolerance_ = tolerance;
+  max_iterations_ = max_iterations;
+  variant_ = variant;
+  sstep_ = sstep;
+  format_ = format;
+  sell_chunk_ = sell_chunk;
+  sell_sigma_ = sell_sigma;
+  configured_ = true;
+  set_up_ = false;
+  return SolverMarketSolverSuccess;
+}
+
+int SolverMarketNativeSolver::setup(SolverMarketSolverMatrix& A){
+  if (!configured_) return SolverMarketSolverErrorConfig;
+  A_ = SolverMarketDeviceCSR<double, int>::wrap(A);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  set_up_ = (amg_.setup(A_) == 0);
+  setup_format();
+  stats_.setup_ms = elapsed_ms(start);
+  stats_.setups++;
+  return set_up_ ? SolverMarketSolverSuccess : SolverMarketSolverErrorSetup;
+}
+
+void SolverMarketNativeSolver::setup_format(){
+  use_sell_ = false;
+  A_sell_ = SolverMarketDeviceSELL<double, int>();
+  if (format_ == SolverMarketSpMVCSR) return;
+  format_report_ = SolverMarketSelectFormat(A_, sell_chunk_, sell_sigma_);
+  if (format_ == SolverMarketSpMVSELL) {
+    format_report_.format = SolverMarketSpMVSELL;
+    format_report_.reason = "spmv_format = sell";
+  }
+  if (format_report_.format != SolverMarketSpMVSELL) return;
+  // The conversion is part of the setup, its cost and the break-even are reported
+  A_sell_ = SolverMarketMeasureFormat(A_, format_report_);
+  use_sell_ = true;
+}
+
+int SolverMarketNativeSolver::resetup(SolverMarketSolverMatrix& A){
+  if (!set_up_) return SolverMarketSolverErrorNotSetUp;
+  if (A.get_n() != A_.n_rows || size_t(A.get_nnz()) != A_.nnz()) return SolverMarketSolverErrorSize;
+  A_ = SolverMarketDeviceCSR<double, int>::wrap(A);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  set_up_ = (amg_.resetup(A_) == 0);
+  if (use_sell_) A_sell_ = SolverMarketToSELL(A_, format_report_.chunk, int(format_report_.sigma));
+  stats_.resetup_ms = elapsed_ms(start);
+  stats_.resetups++;
+  return set_up_ ? SolverMarketSolverSuccess : SolverMarketSolverErrorSetup;
+}
+
+int SolverMarketNativeSolver::solve(SolverMarketSolverVector& b, SolverMarketSolverVector& x){
+  if (!set_up_) return SolverMarketSolverErrorNotSetUp;
+  if (b.get_n() != A_.n_rows || x.get_n() != A_.n_rows) return SolverMarketSolverErrorSize;
+
+  DeviceView<double> b_view(b.get_device_values_pointer(), b.get_n());
+  DeviceView<double> x_view(x.get_device_values_pointer(), x.get_n());
+  auto start = std::chrono::high_resolution_clock::now();
+  SolverMarketKrylovResult result = use_sell_ ? SolverMarketSolveCG(variant_, A_sell_, b_view, x_view, amg_, tolerance_, max_iterations_, sstep_)
+                                              : SolverMarketSolveCG(variant_, A_, b_view, x_view, amg_, tolerance_, max_iterations_, sstep_);
+  stats_.solve_ms = elapsed_ms(start);
+  stats_.solves++;
+  stats_.iterations = result.iterations;
+  stats_.residual = result.residual;
+  stats_.converged = result.converged;
+  reductions_ = result.reductions;
+
+  x.send_to_host();
+  return result.converged ? SolverMarketSolverSuccess : SolverMarketSolverErrorNotConverged;
+}
+
+void SolverMarketNativeSolver::print_details() const {
+  amg_.print_hierarchy();
+  if (format_ != SolverMarketSpMVCSR) format_report_.print();
+  SolverMarketLog() << "[Info][SolverMarket][Solver][native] krylov " << SolverMarketCGVariantName(variant_)
+                    << (variant_ == SolverMarketCGSStep ? " (s = " + std::to_string(sstep_) + ")" : std::string())
+                    << ", " << reductions_ << " global reductions in the last solve\n";
+}
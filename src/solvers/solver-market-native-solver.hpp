@@ -0,0 +1,46 @@
+#include "solver-market-amg.hpp"
+#include "solver-market-krylov-ca.hpp"
+#include "solver-market-sell.hpp"
+#include "solver-market-solver.hpp"
+
+#pragma once
+
+/* Native backend: CG preconditioned by the Kokkos smoothed aggregation AMG of solver-market-amg.hpp.
+Needs nothing but Kokkos, so it is always compiled in. The config file holds key = value lines
+(# comments): tolerance, max_iterations, the CG variant (krylov = cg, pipelined_cg or sstep_cg, sstep,
+see solver-market-krylov-ca.hpp), the storage of the CG operator (spmv_format = csr, sell or auto,
+sell_chunk, sell_sigma, see solver-market-sell.hpp) and the fields of SolverMarketAMGOptions, e.g.
+src/solvers/params-files/native-sa-amg.txt. The AMG levels are CSR whatever the format. */
+class SolverMarketNativeSolver : public SolverMarketSolver {
+public:
+  SolverMarketNativeSolver() { stats_.backend = name(); }
+
+  std::string name() const override { return "native"; }
+  int configure(const std::string& config_file) override;
+  int setup(SolverMarketSolverMatrix& A) override;
+  int resetup(SolverMarketSolverMatrix& A) override;
+  int solve(SolverMarketSolverVector& b, SolverMarketSolverVector& x) override;
+
+  // Levels, operator complexity and per level setup/cycle timers, SpMV format, reductions of the last solve
+  void print_details() const override;
+
+private:
+  // CSR or SELL-C-sigma for the CG operator after a setup, per spmv_format
+  void setup_format();
+
+  SolverMarketAMG<double, int> amg_;
+  SolverMarketDeviceCSR<double, int> A_;
+  SolverMarketDeviceSELL<double, int> A_sell_;
+  SolverMarketSpMVFormat format_ = SolverMarketSpMVCSR;
+  int sell_chunk_ = 0;   /* 0: SIMD/warp width*/
+  int sell_sigma_ = 0;   /* 0: 32 chunks*/
+  SolverMarketFormatReport format_report_;
+  bool use_sell_ = false;
+  double tolerance_ = 1e-8;
+  int max_iterations_ = 500;
+  SolverMarketCGVariant variant_ = SolverMarketCGClassic;
+  int sstep_ = 4;
+  int reductions_ = 0;   /* last solve*/
+  bool configured_ = false;
+  bool set_up_ = false;
+};
@@ -0,0 +1,57 @@
+#include "solver-market-solver.hpp"
+#include "solver-market-native-solver.hpp"
+
+#ifdef SOLVER_MARKET_HAVE_AMGX
+#include "solver-market-amgx-solver.hpp"
+#endif
+
+#ifdef SOLVER_MARKET_HAVE_MUELU
+#include "solver-market-muelu-solver.hpp"
+#endif
+
+
+std::unique_ptr<SolverMarketSolver> SolverMarketCreateSolver(const std::string& backend){
+#ifdef SOLVER_MARKET_HAVE_AMGX
+  if (backend == "amgx") return std::make_unique<SolverMarketAMGXSolver>();
+#endif
+#ifdef SOLVER_MARKET_HAVE_MUELU
+  if (backend == "muelu") return std::make_unique<SolverMarketMueLuSolver>();
+#endif
+  if (backend == "native") return std::make_unique<SolverMarketNativeSolver>();
+  std::cerr << "[Error][SolverMarket][Solver][create] Backend " << backend << " is not available in this build" << std::endl;
+  return nullptr;
+}
+
+std::vector<std::string> SolverMarketAvailableBackends(){
+  std::vector<std::string> backends;
+#ifdef SOLVER_MARKET_HAVE_AMGX
+  backends.push_back("amgx");
+#endif
+#ifdef SOLVER_MARKET_HAVE_MUELU
+  backends.push_back("muelu");
+#endif
+  backends.push_back("native");
+  return backends;
+}
+
+void SolverMarketInitializeBackends(int* argc, char*** argv){
+  // Host storage is placed for pinned threads (solver-market-numa.hpp), report if they are not
+  SolverMarketCheckThreadBinding();
+#ifdef SOLVER_MARKET_HAVE_AMGX
+  SolverMarketAMGXSolver::initialize_runtime();
+#endif
+#ifdef SOLVER_MARKET_HAVE_MUELU
+  SolverMarketMueLuSolver::initialize_runtime(argc, argv);
+#endif
+  (void)argc;
+  (void)argv;
+}
+
+void SolverMarketFinalizeBackends(){
+#ifdef SOLVER_MARKET_HAVE_MUELU
+  SolverMarketMueLuSolver::finalize_runtime();
+#endif
+#ifdef SOLVER_MARKET_HAVE_AMGX
+  SolverMarketAMGXSolver::finalize_runtime();
+#endif
+}
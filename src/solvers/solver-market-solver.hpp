@@ -0,0 +1,90 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-vector.hpp"
+
+#pragma once
+
+/* libsolvermarket: one interface over every backend of the market, so a single process can load a
+matrix once (SolverMarketCSRMatrix, sent to the device) and hand the same data to each backend.
+
+  auto solver = SolverMarketCreateSolver("amgx");   // nullptr if the backend was compiled out
+  solver->configure("config.json");
+  solver->setup(A);                                  // preconditioner/hierarchy for A
+  solver->solve(b, x);                               // b read on the device, x returned on host and device
+  solver->resetup(A);                                // new values, same sparsity pattern
+  solver->stats().print();
+
+Backends work in double precision with 32 bit indices. "native" (CG + the Kokkos smoothed
+aggregation AMG) needs only Kokkos and is always available. The process wide runtimes (AMGX_initialize,
+MPI for Trilinos) are started once by SolverMarketInitializeBackends, after Kokkos::initialize. */
+
+using SolverMarketSolverMatrix = SolverMarketCSRMatrix<double, int>;
+using SolverMarketSolverVector = SolverMarketVector<double, int>;
+
+enum SolverMarketSolverStatus {
+    SolverMarketSolverSuccess,
+    SolverMarketSolverErrorUnavailable,   /* backend compiled out*/
+    SolverMarketSolverErrorConfig,        /* configure() failed or was not called*/
+    SolverMarketSolverErrorNotSetUp,      /* solve/resetup before setup*/
+    SolverMarketSolverErrorSetup,
+    SolverMarketSolverErrorSolve,
+    SolverMarketSolverErrorNotConverged,  /* solve ran, tolerance not reached*/
+    SolverMarketSolverErrorSize           /* vector sizes do not match the matrix*/
+};
+
+struct SolverMarketSolverStats {
+    std::string backend;
+    int setups = 0, resetups = 0, solves = 0;
+    double setup_ms = 0, resetup_ms = 0, solve_ms = 0;  /* last call of each*/
+    int iterations = 0;                                  /* last solve*/
+    double residual = -1;                                /* last solve, -1 if the backend does not report it*/
+    bool converged = false;
+
+    void print() const {
+        std::cout << "[Info][SolverMarket][Solver][" << backend << "] setups " << setups << " (" << setup_ms << " ms)"
+                  << ", resetups " << resetups << " (" << resetup_ms << " ms)"
+                  << ", solves " << solves << " (" << solve_ms << " ms, " << iterations << " iterations, residual "
+                  << residual << (converged ? ", converged" : ", not converged") << ")" << std::endl;
+    }
+};
+
+class SolverMarketSolver {
+public:
+  virtual ~SolverMarketSolver() = default;
+
+  virtual std::string name() const = 0;
+
+  // Backend configuration file (AMGX json, Stratimikos xml/yaml, native key = value)
+  virtual int configure(const std::string& config_file) = 0;
+
+  // Build the preconditioner for A (device views, A.send_to_device() done by the caller)
+  virtual int setup(SolverMarketSolverMatrix& A) = 0;
+
+  // Same sparsity pattern as the last setup, new values: reuse what the backend can
+  virtual int resetup(SolverMarketSolverMatrix& A) = 0;
+
+  // x is the initial guess (device values) and receives the solution on host and device
+  virtual int solve(SolverMarketSolverVector& b, SolverMarketSolverVector& x) = 0;
+
+  const SolverMarketSolverStats& stats() const { return stats_; }
+
+  // Backend specific report after the stats (e.g. the hierarchy of the native AMG), nothing by default
+  virtual void print_details() const {}
+
+protected:
+  SolverMarketSolverStats stats_;
+};
+
+// nullptr if `backend` is unknown or not compiled in
+std::unique_ptr<SolverMarketSolver> SolverMarketCreateSolver(const std::string& backend);
+
+// Backends compiled into this build of libsolvermarket
+std::vector<std::string> SolverMarketAvailableBackends();
+
+// Process wide backend runtimes, once per process, after Kokkos::initialize (argc/argv for MPI)
+void SolverMarketInitializeBackends(int* argc, char*** argv);
+void SolverMarketFinalizeBackends();
@@ -0,0 +1,101 @@
+#include <stdexcept>
+#include <type_traits>
+
+#include <Teuchos_Comm.hpp>
+#include <Teuchos_RCP.hpp>
+#include <Tpetra_CrsMatrix.hpp>
+#include <Tpetra_MultiVector.hpp>
+
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-vector.hpp"
+
+#pragma once
+
+/* Tpetra objects straight from the device Views of SolverMarketCSRMatrix/SolverMarketVector, for a
+single rank: the CSR arrays are copied device to device into a KokkosSparse local matrix handed to
+the local-matrix constructor of Tpetra::CrsMatrix, so nothing is re-parsed, re-sorted or staged on
+the host. The row map is the identity and the column map equals it (local = global indices).
+Used by muelu_input_deck (--solver-market-reader) and the MueLu adapter of libsolvermarket. */
+
+// dst(i) = src(i) in dst's space, src is any contiguous View of the same length
+template <typename _DST_, typename _SRC_>
+void SolverMarketTpetraCopy(const _DST_& dst, const _SRC_& src){
+  using dst_value = typename _DST_::non_const_value_type;
+  using src_value = typename _SRC_::non_const_value_type;
+  if constexpr (std::is_same<dst_value, src_value>::value) {
+    Kokkos::deep_copy(dst, src);
+  } else {
+    // Type change (e.g. int offsets to size_t row map): stage in dst's memory space, convert there
+    using execution_space = typename _DST_::execution_space;
+    Kokkos::View<src_value*, typename _DST_::memory_space> staged(
+        Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarketTpetraCopy"), src.extent(0));
+    Kokkos::deep_copy(staged, src);
+    Kokkos::parallel_for("SolverMarketTpetraCopy", Kokkos::RangePolicy<execution_space>(0, src.extent(0)),
+      KOKKOS_LAMBDA(const size_t i){
+        dst(i) = dst_value(staged(i));
+      });
+    execution_space().fence();
+  }
+}
+
+// Fill-complete Tpetra::CrsMatrix from the device CSR of A (A.send_to_device() done by the caller)
+template <typename _CRS_MATRIX_, typename _TYPE_, typename _ITYPE_>
+Teuchos::RCP<_CRS_MATRIX_> SolverMarketToTpetraCrsMatrix(SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& A,
+                                                        const Teuchos::RCP<const Teuchos::Comm<int> >& comm){
+  using map_type = typename _CRS_MATRIX_::map_type;
+  using local_matrix_type = typename _CRS_MATRIX_::local_matrix_device_type;
+  using row_map_type = typename local_matrix_type::row_map_type::non_const_type;
+  using index_type = typename local_matrix_type::index_type::non_const_type;
+  using values_type = typename local_matrix_type::values_type::non_const_type;
+  using unmanaged = Kokkos::MemoryTraits<Kokkos::Unmanaged>;
+
+  TEUCHOS_TEST_FOR_EXCEPTION(comm->getSize() != 1, std::runtime_error,
+                             "SolverMarketToTpetraCrsMatrix: the SolverMarket CSR is not distributed, run on a single rank");
+  const size_t n = A.get_n();
+  const size_t nnz = A.get_nnz();
+
+  Kokkos::View<const _ITYPE_*, Device, unmanaged> offsets(A.get_device_offsets_pointer(), n + 1);
+  Kokkos::View<const _ITYPE_*, Device, unmanaged> columns(A.get_device_columns_pointer(), nnz);
+  Kokkos::View<const _TYPE_*, Device, unmanaged> values(A.get_device_values_pointer(), nnz);
+
+  row_map_type row_map(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::row_map"), n + 1);
+  index_type entries(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::entries"), nnz);
+  values_type local_values(Kokkos::view_alloc(Kokkos::WithoutInitializing, "SolverMarket::values"), nnz);
+  SolverMarketTpetraCopy(row_map, offsets);
+  SolverMarketTpetraCopy(entries, columns);
+  SolverMarketTpetraCopy(local_values, values);
+
+  local_matrix_type local("SolverMarket", n, n, nnz, local_values, row_map, entries);
+  auto map = Teuchos::rcp(new map_type(Tpetra::global_size_t(n), 0, comm));
+  return Teuchos::rcp(new _CRS_MATRIX_(map, map, local));
+}
+
+// New values of the same pattern (a resetup): device copy into the local matrix, fill completed again
+template <typename _CRS_MATRIX_, typename _TYPE_, typename _ITYPE_>
+void SolverMarketUpdateTpetraValues(SolverMarketCSRMatrix<_TYPE_, _ITYPE_>& A, _CRS_MATRIX_& tpetra_matrix){
+  using unmanaged = Kokkos::MemoryTraits<Kokkos::Unmanaged>;
+  TEUCHOS_TEST_FOR_EXCEPTION(size_t(A.get_nnz()) != tpetra_matrix.getLocalNumEntries(), std::runtime_error,
+                             "SolverMarketUpdateTpetraValues: pattern differs from the Tpetra matrix");
+
+  Kokkos::View<const _TYPE_*, Device, unmanaged> values(A.get_device_values_pointer(), A.get_nnz());
+  tpetra_matrix.resumeFill();
+  SolverMarketTpetraCopy(tpetra_matrix.getLocalMatrixDevice().values, values);
+  tpetra_matrix.fillComplete();
+}
+
+// Column `column` of a Tpetra::MultiVector from / to the device values of a SolverMarketVector
+template <typename _MULTI_VECTOR_, typename _TYPE_, typename _ITYPE_>
+void SolverMarketCopyToTpetra(SolverMarketVector<_TYPE_, _ITYPE_>& v, _MULTI_VECTOR_& tpetra_vector, size_t column = 0){
+  using unmanaged = Kokkos::MemoryTraits<Kokkos::Unmanaged>;
+  Kokkos::View<const _TYPE_*, Device, unmanaged> values(v.get_device_values_pointer(), v.get_n());
+  auto local = tpetra_vector.getLocalViewDevice(Tpetra::Access::ReadWrite);
+  SolverMarketTpetraCopy(Kokkos::subview(local, Kokkos::ALL(), column), values);
+}
+
+template <typename _MULTI_VECTOR_, typename _TYPE_, typename _ITYPE_>
+void SolverMarketCopyFromTpetra(_MULTI_VECTOR_& tpetra_vector, SolverMarketVector<_TYPE_, _ITYPE_>& v, size_t column = 0){
+  using unmanaged = Kokkos::MemoryTraits<Kokkos::Unmanaged>;
+  Kokkos::View<_TYPE_*, Device, unmanaged> values(v.get_device_values_pointer(), v.get_n());
+  auto local = tpetra_vector.getLocalViewDevice(Tpetra::Access::ReadOnly);
+  SolverMarketTpetraCopy(values, Kokkos::subview(local, Kokkos::ALL(), column));
+}
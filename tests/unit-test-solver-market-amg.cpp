@@ -0,0 +1,265 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <set>
+#include <vector>
+
+#define GTEST_
+#include "solver-market-amg.hpp"
+#include "solver-market-krylov.hpp"
+
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+using DeviceCSR = SolverMarketDeviceCSR<double, int>;
+
+struct HostCSR {
+    int n_rows = 0, n_cols = 0;
+    std::vector<int> offsets, columns;
+    std::vector<double> values;
+};
+
+DeviceCSR to_device(const HostCSR& h) {
+    DeviceCSR A;
+    A.n_rows = h.n_rows;
+    A.n_cols = h.n_cols;
+    A.offsets = DeviceView<int>("offsets", h.offsets.size());
+    A.columns = DeviceView<int>("columns", h.columns.size());
+    A.values = DeviceView<double>("values", h.values.size());
+    Kokkos::deep_copy(A.offsets, HostView<int>(const_cast<int*>(h.offsets.data()), h.offsets.size()));
+    Kokkos::deep_copy(A.columns, HostView<int>(const_cast<int*>(h.columns.data()), h.columns.size()));
+    Kokkos::deep_copy(A.values, HostView<double>(const_cast<double*>(h.values.data()), h.values.size()));
+    return A;
+}
+
+HostCSR to_host(const DeviceCSR& A) {
+    HostCSR h;
+    h.n_rows = A.n_rows;
+    h.n_cols = A.n_cols;
+    h.offsets.resize(A.offsets.extent(0));
+    h.columns.resize(A.nnz());
+    h.values.resize(A.nnz());
+    Kokkos::deep_copy(HostView<int>(h.offsets.data(), h.offsets.size()), A.offsets);
+    Kokkos::deep_copy(HostView<int>(h.columns.data(), h.columns.size()), A.columns);
+    Kokkos::deep_copy(HostView<double>(h.values.data(), h.values.size()), A.values);
+    return h;
+}
+
+std::vector<double> to_dense(const HostCSR& h) {
+    std::vector<double> dense(size_t(h.n_rows) * h.n_cols, 0.0);
+    for (int i = 0; i < h.n_rows; i++)
+        for (int k = h.offsets[i]; k < h.offsets[i + 1]; k++) dense[size_t(i) * h.n_cols + h.columns[k]] += h.values[k];
+    return dense;
+}
+
+// 5 point Laplacian on an nx x nx grid, Dirichlet boundary
+HostCSR laplacian_2d(int nx) {
+    HostCSR h;
+    h.n_rows = h.n_cols = nx * nx;
+    h.offsets.push_back(0);
+    for (int y = 0; y < nx; y++) {
+        for (int x = 0; x < nx; x++) {
+            const int i = y * nx + x;
+            if (y > 0) { h.columns.push_back(i - nx); h.values.push_back(-1); }
+            if (x > 0) { h.columns.push_back(i - 1); h.values.push_back(-1); }
+            h.columns.push_back(i); h.values.push_back(4);
+            if (x < nx - 1) { h.columns.push_back(i + 1); h.values.push_back(-1); }
+            if (y < nx - 1) { h.columns.push_back(i + nx); h.values.push_back(-1); }
+            h.offsets.push_back(int(h.columns.size()));
+        }
+    }
+    return h;
+}
+
+bool rows_sorted(const HostCSR& h) {
+    for (int i = 0; i < h.n_rows; i++)
+        for (int k = h.offsets[i] + 1; k < h.offsets[i + 1]; k++)
+            if (h.columns[k - 1] >= h.columns[k]) return false;
+    return true;
+}
+
+TEST(SolverMarketSparse, SpGEMMAndTransposeMatchDense) {
+    // A 3x4, B 4x3, with an empty row in A and cancellation-free products
+    HostCSR a;
+    a.n_rows = 3; a.n_cols = 4;
+    a.offsets = {0, 3, 3, 5};
+    a.columns = {0, 2, 3, 1, 3};
+    a.values = {1, 2, 3, 4, 5};
+    HostCSR b;
+    b.n_rows = 4; b.n_cols = 3;
+    b.offsets = {0, 2, 3, 5, 6};
+    b.columns = {0, 2, 1, 0, 1, 2};
+    b.values = {1, -1, 2, 3, 0.5, 4};
+
+    HostCSR c = to_host(SolverMarketSpGEMM(to_device(a), to_device(b)));
+    ASSERT_EQ(c.n_rows, 3);
+    ASSERT_EQ(c.n_cols, 3);
+    EXPECT_TRUE(rows_sorted(c));
+    EXPECT_EQ(c.offsets[2] - c.offsets[1], 0);
+
+    const auto da = to_dense(a), db = to_dense(b), dc = to_dense(c);
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) {
+            double expected = 0;
+            for (int k = 0; k < 4; k++) expected += da[i * 4 + k] * db[k * 3 + j];
+            EXPECT_DOUBLE_EQ(dc[i * 3 + j], expected) << i << "," << j;
+        }
+
+    HostCSR t = to_host(SolverMarketTranspose(to_device(a)));
+    ASSERT_EQ(t.n_rows, 4);
+    ASSERT_EQ(t.n_cols, 3);
+    EXPECT_TRUE(rows_sorted(t));
+    const auto dt = to_dense(t);
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 4; j++) EXPECT_DOUBLE_EQ(dt[j * 3 + i], da[i * 4 + j]);
+}
+
+TEST(SolverMarketAMG, MIS2AndAggregates) {
+    const int nx = 20;
+    HostCSR h = laplacian_2d(nx);
+    DeviceCSR A = to_device(h);
+
+    std::vector<int> roots(h.n_rows);
+    Kokkos::deep_copy(HostView<int>(roots.data(), roots.size()), SolverMarketMIS2(A.offsets, A.columns, A.n_rows));
+
+    // Independent at distance 2, and maximal: every vertex is within distance 2 of a root
+    auto neighbours2 = [&](int i) {
+        std::set<int> result;
+        for (int k = h.offsets[i]; k < h.offsets[i + 1]; k++) {
+            const int j = h.columns[k];
+            result.insert(j);
+            for (int l = h.offsets[j]; l < h.offsets[j + 1]; l++) result.insert(h.columns[l]);
+        }
+        result.erase(i);
+        return result;
+    };
+    int num_roots = 0;
+    for (int i = 0; i < h.n_rows; i++) {
+        bool root_near = false;
+        for (int j : neighbours2(i)) {
+            if (roots[i]) {
+                EXPECT_FALSE(roots[j]) << "roots " << i << " and " << j << " too close";
+            }
+            root_near = root_near || roots[j];
+        }
+        EXPECT_TRUE(roots[i] || root_near) << i;
+        num_roots += roots[i];
+    }
+
+    DeviceView<int> aggregates;
+    const int num_aggregates = SolverMarketAMGAggregate(A.offsets, A.columns, A.n_rows, aggregates);
+    EXPECT_EQ(num_aggregates, num_roots);
+    std::vector<int> agg(h.n_rows);
+    Kokkos::deep_copy(HostView<int>(agg.data(), agg.size()), aggregates);
+    std::vector<int> sizes(num_aggregates, 0);
+    for (int i = 0; i < h.n_rows; i++) {
+        ASSERT_GE(agg[i], 0);
+        ASSERT_LT(agg[i], num_aggregates);
+        sizes[agg[i]]++;
+    }
+    for (int s : sizes) EXPECT_GT(s, 0);
+
+    // Tentative prolongator: orthonormal columns
+    HostCSR p = to_host(SolverMarketAMGTentativeProlongator<double, int>(aggregates, A.n_rows, num_aggregates));
+    std::vector<double> column_norm(num_aggregates, 0.0);
+    for (int i = 0; i < p.n_rows; i++) {
+        ASSERT_EQ(p.offsets[i + 1] - p.offsets[i], 1);
+        EXPECT_EQ(p.columns[p.offsets[i]], agg[i]);
+        column_norm[agg[i]] += p.values[p.offsets[i]] * p.values[p.offsets[i]];
+    }
+    for (double norm : column_norm) EXPECT_NEAR(norm, 1.0, 1e-12);
+}
+
+TEST(SolverMarketAMG, GalerkinOperatorMatchesDense) {
+    const int nx = 24;
+    HostCSR h = laplacian_2d(nx);
+    DeviceCSR A = to_device(h);
+
+    SolverMarketAMGOptions options;
+    options.coarse_size = 50;
+    options.max_levels = 2;
+    SolverMarketAMG<double> amg(options);
+    ASSERT_EQ(amg.setup(A), 0);
+    ASSERT_EQ(amg.num_levels(), 2);
+
+    HostCSR p = to_host(amg.level_prolongator(0));
+    HostCSR ac = to_host(amg.level_matrix(1));
+    ASSERT_EQ(p.n_cols, ac.n_rows);
+    EXPECT_TRUE(rows_sorted(ac));
+
+    const int n = h.n_rows, nc = p.n_cols;
+    const auto da = to_dense(h), dp = to_dense(p), dac = to_dense(ac);
+    std::vector<double> ap(size_t(n) * nc, 0.0);
+    for (int i = 0; i < n; i++)
+        for (int k = 0; k < n; k++)
+            if (da[size_t(i) * n + k] != 0)
+                for (int j = 0; j < nc; j++) ap[size_t(i) * nc + j] += da[size_t(i) * n + k] * dp[size_t(k) * nc + j];
+    for (int i = 0; i < nc; i++)
+        for (int j = 0; j < nc; j++) {
+            double expected = 0;
+            for (int k = 0; k < n; k++) expected += dp[size_t(k) * nc + i] * ap[size_t(k) * nc + j];
+            EXPECT_NEAR(dac[size_t(i) * nc + j], expected, 1e-10) << i << "," << j;
+        }
+
+    // lambda_max(D^-1 A) of the Laplacian is below 2 and close to it
+    EXPECT_GT(amg.level_lambda_max(0), 1.5);
+    EXPECT_LT(amg.level_lambda_max(0), 2.0 + 1e-12);
+}
+
+TEST(SolverMarketAMG, PreconditionedCGConverges) {
+    const int nx = 64;
+    HostCSR h = laplacian_2d(nx);
+    DeviceCSR A = to_device(h);
+
+    SolverMarketAMGOptions options;
+    options.coarse_size = 100;
+    SolverMarketAMG<double> amg(options);
+    ASSERT_EQ(amg.setup(A), 0);
+    EXPECT_GE(amg.num_levels(), 3);
+    EXPECT_GT(amg.operator_complexity(), 1.0);
+    EXPECT_LT(amg.operator_complexity(), 2.0);
+    EXPECT_LT(amg.grid_complexity(), amg.operator_complexity());
+
+    DeviceView<double> b("b", h.n_rows);
+    DeviceView<double> x("x", h.n_rows);
+    Kokkos::deep_copy(b, 1.0);
+
+    SolverMarketIdentityPreconditioner identity;
+    SolverMarketKrylovResult plain = SolverMarketPCG(A, b, x, identity, 1e-8, 1000);
+    ASSERT_TRUE(plain.converged);
+
+    Kokkos::deep_copy(x, 0.0);
+    SolverMarketKrylovResult result = SolverMarketPCG(A, b, x, amg, 1e-8, 100);
+    EXPECT_TRUE(result.converged);
+    EXPECT_LT(result.residual, 1e-8);
+    EXPECT_LT(result.iterations, 25);
+    EXPECT_LT(result.iterations, plain.iterations / 4);
+    EXPECT_EQ(amg.cycles(), result.iterations);  /* one cycle per iteration, none after convergence*/
+
+    // New values, same pattern: the hierarchy is rebuilt on the kept aggregates
+    const int levels = amg.num_levels();
+    Kokkos::parallel_for("scale", Kokkos::RangePolicy<Device>(0, A.nnz()), KOKKOS_LAMBDA(const size_t k) { A.values(k) *= 2.0; });
+    ASSERT_EQ(amg.resetup(A), 0);
+    EXPECT_EQ(amg.num_levels(), levels);
+    Kokkos::deep_copy(x, 0.0);
+    result = SolverMarketPCG(A, b, x, amg, 1e-8, 100);
+    EXPECT_TRUE(result.converged);
+    EXPECT_LT(result.iterations, 25);
+}
+
+TEST(SolverMarketAMGOptions, Set) {
+    SolverMarketAMGOptions options;
+    EXPECT_EQ(options.set("chebyshev_degree", "3"), 0);
+    EXPECT_EQ(options.chebyshev_degree, 3);
+    EXPECT_EQ(options.set("strength_threshold", "0.08"), 0);
+    EXPECT_DOUBLE_EQ(options.strength_threshold, 0.08);
+    EXPECT_NE(options.set("smoother", "jacobi"), 0);
+    EXPECT_NE(options.set("max_levels", "many"), 0);
+}
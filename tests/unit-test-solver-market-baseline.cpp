@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "solver-market-baseline.hpp"
+
+
+static SolverMarketBaselineEntry make_entry(const std::string& backend, const std::string& metric, const std::vector<double>& samples) {
+    SolverMarketBaselineEntry entry;
+    entry.key = {"00000000deadbeef", backend, "0123456789abcdef", "Test_CPU/8cpus/Cuda"};
+    entry.metric = metric;
+    entry.samples = samples;
+    entry.label = "matrices/a.mtx amgx.json";
+    return entry;
+}
+
+TEST(SolverMarketBaseline, EntryRoundTrip) {
+    const auto entry = make_entry("amgx", "setup_ms", {12.5, 13.25, 12.75});
+    SolverMarketBaselineEntry parsed;
+    ASSERT_EQ(parsed.from_line(entry.to_line()), 0);
+    EXPECT_EQ(parsed.key.fingerprint, entry.key.fingerprint);
+    EXPECT_EQ(parsed.key.backend, "amgx");
+    EXPECT_EQ(parsed.key.config_hash, entry.key.config_hash);
+    EXPECT_EQ(parsed.key.host, entry.key.host);
+    EXPECT_EQ(parsed.metric, "setup_ms");
+    EXPECT_EQ(parsed.samples, entry.samples);
+    EXPECT_EQ(parsed.label, entry.label);
+
+    EXPECT_NE(parsed.from_line("too\tfew\tfields"), 0);
+    EXPECT_NE(parsed.from_line("a\tb\tc\td\tsetup_ms\tnot-a-number\tlabel"), 0);
+}
+
+TEST(SolverMarketBaseline, MannWhitney) {
+    const std::vector<double> baseline = {10.0, 10.2, 9.9, 10.1, 10.05};
+    // Every current sample above every baseline sample: p = 1 / C(10, 5)
+    EXPECT_NEAR(SolverMarketMannWhitneyGreater(baseline, {11.0, 11.2, 10.9, 11.1, 11.05}), 1.0 / 252.0, 1e-12);
+    // The other way round: certainly not larger
+    EXPECT_NEAR(SolverMarketMannWhitneyGreater(baseline, {9.0, 9.2, 8.9, 9.1, 9.05}), 1.0, 1e-12);
+    // Interleaved samples: nothing to see
+    EXPECT_GT(SolverMarketMannWhitneyGreater(baseline, {10.01, 10.11, 9.95, 10.15, 9.8}), 0.3);
+    // Three against three can never reach 0.05
+    EXPECT_NEAR(SolverMarketMannWhitneyGreater({1, 2, 3}, {4, 5, 6}), 0.05, 1e-12);
+    // Ties: normal approximation, still clearly significant
+    EXPECT_LT(SolverMarketMannWhitneyGreater({10, 10, 10, 10, 10, 10}, {12, 12, 12, 12, 12, 10}), 0.01);
+    // Exact and approximate distributions agree on larger samples
+    std::vector<double> low, high;
+    for (int i = 0; i < 30; i++) {
+        low.push_back(100.0 + (i * 7) % 13);
+        high.push_back(104.0 + (i * 5) % 11 + 0.5);
+    }
+    EXPECT_LT(SolverMarketMannWhitneyGreater(low, high), 1e-3);
+    EXPECT_EQ(SolverMarketMannWhitneyGreater({}, high), 1.0);
+}
+
+TEST(SolverMarketBaseline, Verdicts) {
+    const auto baseline = make_entry("native", "solve_ms", {100, 101, 99, 100.5, 99.5});
+
+    // 15% slower on every repetition
+    auto comparison = SolverMarketCompareBaseline(make_entry("native", "solve_ms", {115, 116, 114, 115.5, 114.5}), &baseline);
+    EXPECT_EQ(comparison.verdict, SolverMarketBaselineRegression);
+    EXPECT_NEAR(comparison.change, 0.15, 1e-12);
+    EXPECT_LT(comparison.p_value, 0.05);
+
+    // 2% slower on every repetition: significant, below the threshold
+    comparison = SolverMarketCompareBaseline(make_entry("native", "solve_ms", {102, 103, 101, 102.5, 101.5}), &baseline);
+    EXPECT_EQ(comparison.verdict, SolverMarketBaselineUnchanged);
+    EXPECT_LT(comparison.p_value, 0.05);
+
+    // Median 20% slower but one outlier each way, only 3 samples: not significant
+    comparison = SolverMarketCompareBaseline(make_entry("native", "solve_ms", {120, 98, 121}), &baseline);
+    EXPECT_EQ(comparison.verdict, SolverMarketBaselineUnchanged);
+    EXPECT_GE(comparison.p_value, 0.05);
+
+    // 30% faster
+    comparison = SolverMarketCompareBaseline(make_entry("native", "solve_ms", {70, 71, 69, 70.5, 69.5}), &baseline);
+    EXPECT_EQ(comparison.verdict, SolverMarketBaselineImprovement);
+
+    comparison = SolverMarketCompareBaseline(make_entry("native", "solve_ms", {70}), nullptr);
+    EXPECT_EQ(comparison.verdict, SolverMarketBaselineNew);
+}
+
+TEST(SolverMarketBaseline, StoreLastEntryWins) {
+    const std::string filename = "test_baseline.tsv";
+    std::remove(filename.c_str());
+    SolverMarketBaselineStore store(filename);
+
+    SolverMarketBaselineEntry entry;
+    EXPECT_EQ(store.lookup(make_entry("amgx", "setup_ms", {}).key, "setup_ms", entry), SolverMarketBaselineNotFound);
+
+    ASSERT_EQ(store.store({make_entry("amgx", "setup_ms", {10, 11, 12, 10, 11}), make_entry("amgx", "solve_ms", {5, 5, 5, 5, 5})}),
+              SolverMarketBaselineSuccess);
+    ASSERT_EQ(store.store({make_entry("amgx", "setup_ms", {20, 21, 22, 20, 21})}), SolverMarketBaselineSuccess);
+
+    ASSERT_EQ(store.lookup(make_entry("amgx", "setup_ms", {}).key, "setup_ms", entry), SolverMarketBaselineSuccess);
+    EXPECT_EQ(entry.samples, std::vector<double>({20, 21, 22, 20, 21}));
+    ASSERT_EQ(store.lookup(make_entry("amgx", "solve_ms", {}).key, "solve_ms", entry), SolverMarketBaselineSuccess);
+    EXPECT_EQ(entry.samples.size(), 5u);
+
+    // Another host or config is another key
+    auto other_host = make_entry("amgx", "setup_ms", {25, 26, 27, 25, 26});
+    other_host.key.host = "Other_CPU/8cpus/Cuda";
+    const auto comparisons = store.compare({make_entry("amgx", "setup_ms", {25, 26, 27, 25, 26}), other_host}, 0.05, 0.05);
+    ASSERT_EQ(comparisons.size(), 2u);
+    EXPECT_EQ(comparisons[0].verdict, SolverMarketBaselineRegression);
+    EXPECT_EQ(comparisons[1].verdict, SolverMarketBaselineNew);
+
+    ::testing::internal::CaptureStdout();
+    SolverMarketPrintBaselineComparisons(std::cout, comparisons);
+    const std::string table = ::testing::internal::GetCapturedStdout();
+    EXPECT_NE(table.find("REGRESSION"), std::string::npos) << table;
+    EXPECT_NE(table.find("+23.8%"), std::string::npos) << table;
+    EXPECT_NE(table.find("matrices/a.mtx"), std::string::npos) << table;
+}
+
+TEST(SolverMarketBaseline, ConfigHashAndHost) {
+    std::ofstream("test_baseline_config.json") << "{\"solver\": \"PCG\"}\n";
+    const std::string hash = SolverMarketHashFile("test_baseline_config.json", "scaling=none");
+    EXPECT_EQ(hash.size(), 16u);
+    EXPECT_EQ(hash, SolverMarketHashFile("test_baseline_config.json", "scaling=none"));
+    EXPECT_NE(hash, SolverMarketHashFile("test_baseline_config.json", "scaling=ruiz"));
+    std::ofstream("test_baseline_config.json") << "{\"solver\": \"FGMRES\"}\n";
+    EXPECT_NE(hash, SolverMarketHashFile("test_baseline_config.json", "scaling=none"));
+    EXPECT_EQ(SolverMarketHashFile("test_baseline_missing.json"), "none");
+
+    const std::string host = SolverMarketHostSignature("Cuda");
+    EXPECT_EQ(host.find(' '), std::string::npos);
+    EXPECT_EQ(host.find('\t'), std::string::npos);
+    EXPECT_EQ(host.substr(host.size() - 5), "/Cuda");
+}
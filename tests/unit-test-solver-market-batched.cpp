@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+#define GTEST_
+#include "solver-market-batched.hpp"
+
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+using DeviceCSR = SolverMarketDeviceCSR<double, int>;
+using BatchedCSR = SolverMarketBatchedCSR<double, int>;
+
+// 5 point pattern on an nx x nx grid, rows sorted. kind(i, j) tells the neighbour: 0 diagonal,
+// 1 west, 2 east, 3 south, 4 north
+struct HostPattern {
+    int n = 0;
+    std::vector<int> offsets, columns, kinds;
+};
+
+HostPattern pattern_2d(int nx) {
+    HostPattern h;
+    h.n = nx * nx;
+    h.offsets.push_back(0);
+    for (int y = 0; y < nx; y++) {
+        for (int x = 0; x < nx; x++) {
+            const int i = y * nx + x;
+            if (y > 0) { h.columns.push_back(i - nx); h.kinds.push_back(3); }
+            if (x > 0) { h.columns.push_back(i - 1); h.kinds.push_back(1); }
+            h.columns.push_back(i); h.kinds.push_back(0);
+            if (x < nx - 1) { h.columns.push_back(i + 1); h.kinds.push_back(2); }
+            if (y < nx - 1) { h.columns.push_back(i + nx); h.kinds.push_back(4); }
+            h.offsets.push_back(int(h.columns.size()));
+        }
+    }
+    return h;
+}
+
+DeviceCSR pattern_to_device(const HostPattern& h, const std::vector<double>& values) {
+    DeviceCSR A;
+    A.n_rows = A.n_cols = h.n;
+    A.offsets = DeviceView<int>("offsets", h.offsets.size());
+    A.columns = DeviceView<int>("columns", h.columns.size());
+    A.values = DeviceView<double>("values", values.size());
+    Kokkos::deep_copy(A.offsets, HostView<int>(const_cast<int*>(h.offsets.data()), h.offsets.size()));
+    Kokkos::deep_copy(A.columns, HostView<int>(const_cast<int*>(h.columns.data()), h.columns.size()));
+    Kokkos::deep_copy(A.values, HostView<double>(const_cast<double*>(values.data()), values.size()));
+    return A;
+}
+
+// Values of system s: shifted and scaled Laplacian, with a convection term (nonsymmetric) if asked
+std::vector<double> system_values(const HostPattern& h, int s, bool convection) {
+    std::vector<double> values(h.columns.size());
+    const double c = convection ? 0.1 * (s % 8) : 0.0;
+    for (size_t k = 0; k < values.size(); k++) {
+        switch (h.kinds[k]) {
+            case 0: values[k] = 4.0 + 0.05 * s; break;
+            case 1: values[k] = -1.0 - c; break;
+            case 2: values[k] = -1.0 + c; break;
+            default: values[k] = -1.0 - 0.01 * s; break;
+        }
+    }
+    return values;
+}
+
+struct Batch {
+    BatchedCSR A;
+    DeviceBatchView<double> B, X;
+    std::vector<std::vector<double>> values, rhs;
+};
+
+Batch make_batch(const HostPattern& h, int n_systems, bool convection) {
+    Batch batch;
+    HostBatchView<double> values("values", n_systems, h.columns.size());
+    HostBatchView<double> B("B", n_systems, h.n);
+    for (int s = 0; s < n_systems; s++) {
+        batch.values.push_back(system_values(h, s, convection));
+        batch.rhs.emplace_back(h.n);
+        for (size_t k = 0; k < h.columns.size(); k++) values(s, k) = batch.values[s][k];
+        for (int i = 0; i < h.n; i++) B(s, i) = batch.rhs[s][i] = 1.0 + std::sin(0.1 * i + s);
+    }
+    DeviceBatchView<double> device_values("device_values", n_systems, h.columns.size());
+    batch.B = DeviceBatchView<double>("device_B", n_systems, h.n);
+    batch.X = DeviceBatchView<double>("device_X", n_systems, h.n);
+    Kokkos::deep_copy(device_values, values);
+    Kokkos::deep_copy(batch.B, B);
+    batch.A = BatchedCSR::wrap(pattern_to_device(h, batch.values[0]), device_values);
+    return batch;
+}
+
+// ||b - A x|| / ||b|| of system s, on the host
+double true_residual(const HostPattern& h, const Batch& batch, const HostBatchView<double>& X, int s) {
+    double rr = 0, bb = 0;
+    for (int i = 0; i < h.n; i++) {
+        double ax = 0;
+        for (int k = h.offsets[i]; k < h.offsets[i + 1]; k++) ax += batch.values[s][k] * X(s, h.columns[k]);
+        rr += (batch.rhs[s][i] - ax) * (batch.rhs[s][i] - ax);
+        bb += batch.rhs[s][i] * batch.rhs[s][i];
+    }
+    return std::sqrt(rr / bb);
+}
+
+TEST(SolverMarketBatched, CGMatchesSingleSolves) {
+    const HostPattern h = pattern_2d(8);
+    const int n_systems = 32;
+    Batch batch = make_batch(h, n_systems, false);
+
+    const auto results = SolverMarketBatchedSolve(batch.A, batch.B, batch.X, SolverMarketBatchedCG, 1e-10, 200);
+    ASSERT_EQ(results.size(), size_t(n_systems));
+    HostBatchView<double> X("X", n_systems, h.n);
+    Kokkos::deep_copy(X, batch.X);
+
+    for (int s = 0; s < n_systems; s++) {
+        EXPECT_TRUE(results[s].converged) << "system " << s;
+        EXPECT_LE(results[s].residual, 1e-10);
+        EXPECT_LE(true_residual(h, batch, X, s), 1e-9);
+
+        // Same iteration as one Jacobi preconditioned PCG on the system alone
+        DeviceCSR A = pattern_to_device(h, batch.values[s]);
+        DeviceView<double> b("b", h.n), x("x", h.n);
+        Kokkos::deep_copy(b, HostView<double>(batch.rhs[s].data(), h.n));
+        SolverMarketJacobiPreconditioner<double> M(A);
+        const auto single = SolverMarketPCG(A, b, x, M, 1e-10, 200);
+        EXPECT_NEAR(results[s].iterations, single.iterations, 1);
+        HostView<double> host_x("host_x", h.n);
+        Kokkos::deep_copy(host_x, x);
+        for (int i = 0; i < h.n; i++) EXPECT_NEAR(X(s, i), host_x(i), 1e-8);
+    }
+    // The diagonal shift makes the later systems better conditioned
+    EXPECT_LE(results[n_systems - 1].iterations, results[0].iterations);
+}
+
+TEST(SolverMarketBatched, BiCGStabNonsymmetric) {
+    // 576 rows: 8 work vectors no longer fit the level 0 scratch
+    const HostPattern h = pattern_2d(24);
+    ASSERT_GT(SolverMarketBatchedVectors(SolverMarketBatchedBiCGStab) * h.n * sizeof(double), SolverMarketBatchedLevel0Bytes);
+    const int n_systems = 16;
+    Batch batch = make_batch(h, n_systems, true);
+
+    const auto results = SolverMarketBatchedSolve(batch.A, batch.B, batch.X, SolverMarketBatchedBiCGStab, 1e-9, 500);
+    HostBatchView<double> X("X", n_systems, h.n);
+    Kokkos::deep_copy(X, batch.X);
+    for (int s = 0; s < n_systems; s++) {
+        EXPECT_TRUE(results[s].converged) << "system " << s;
+        EXPECT_GT(results[s].iterations, 0);
+        EXPECT_LE(true_residual(h, batch, X, s), 1e-8) << "system " << s;
+
+        DeviceCSR A = pattern_to_device(h, batch.values[s]);
+        DeviceView<double> b("b", h.n), x("x", h.n);
+        Kokkos::deep_copy(b, HostView<double>(batch.rhs[s].data(), h.n));
+        SolverMarketJacobiPreconditioner<double> M(A);
+        const auto single = SolverMarketBiCGStab(A, b, x, M, 1e-9, 500);
+        EXPECT_TRUE(single.converged);
+        EXPECT_NEAR(results[s].iterations, single.iterations, 2);
+    }
+}
+
+TEST(SolverMarketBatched, InitialGuessAndIterationLimit) {
+    const HostPattern h = pattern_2d(6);
+    const int n_systems = 3;
+    Batch batch = make_batch(h, n_systems, false);
+
+    // System 0: zero right-hand side, system 1: the exact solution as initial guess
+    auto first = SolverMarketBatchedSolve(batch.A, batch.B, batch.X, SolverMarketBatchedCG, 1e-12, 200);
+    ASSERT_TRUE(first[1].converged);
+    HostBatchView<double> B("B", n_systems, h.n);
+    HostBatchView<double> X("X", n_systems, h.n);
+    Kokkos::deep_copy(B, batch.B);
+    Kokkos::deep_copy(X, batch.X);
+    for (int i = 0; i < h.n; i++) {
+        B(0, i) = 0;
+        X(0, i) = 0;
+        X(2, i) = 0;
+    }
+    Kokkos::deep_copy(batch.B, B);
+    Kokkos::deep_copy(batch.X, X);
+
+    for (const auto method : {SolverMarketBatchedCG, SolverMarketBatchedBiCGStab}) {
+        Kokkos::deep_copy(batch.X, X);
+        const auto results = SolverMarketBatchedSolve(batch.A, batch.B, batch.X, method, 1e-10, 2);
+        EXPECT_TRUE(results[0].converged);
+        EXPECT_EQ(results[0].iterations, 0);
+        EXPECT_EQ(results[0].residual, 0.0);
+        EXPECT_TRUE(results[1].converged);
+        EXPECT_EQ(results[1].iterations, 0);
+        // Two iterations are not enough for the third
+        EXPECT_FALSE(results[2].converged);
+        EXPECT_EQ(results[2].iterations, 2);
+        EXPECT_GT(results[2].residual, 1e-10);
+    }
+}
+
+TEST(SolverMarketBatched, ParseMethod) {
+    SolverMarketBatchedMethod method = SolverMarketBatchedCG;
+    EXPECT_EQ(SolverMarketParseBatchedMethod("bicgstab", method), 0);
+    EXPECT_EQ(method, SolverMarketBatchedBiCGStab);
+    EXPECT_EQ(SolverMarketParseBatchedMethod("cg", method), 0);
+    EXPECT_EQ(method, SolverMarketBatchedCG);
+    EXPECT_NE(SolverMarketParseBatchedMethod("gmres", method), 0);
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+
+#define GTEST_
+#include "solver-market-csr-matrix.hpp"
+
+
+void write_temp_file(const std::string& filename, const std::string& content) {
+    std::ofstream out(filename);
+    out << content;
+    out.close();
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+TEST(SolverMarketCsrMatrixFeatures, BasicStatistics) {
+    std::string content =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "5 5 8\n"
+        "1 1 4.0\n"
+        "1 2 -1.0\n"
+        "2 1 -1.0\n"
+        "2 2 4.0\n"
+        "2 5 -1.0\n"
+        "4 4 0.5\n"
+        "4 1 -2.0\n"
+        "5 2 -1.0\n";
+
+    std::string filename = "test_features.mtx";
+    write_temp_file(filename, content);
+    auto matrix = SolverMarketCSRMatrix<double>(filename, SolverMarketCSRMatrixFull);
+
+    SolverMarketMatrixFeatures features;
+    ASSERT_EQ(matrix.compute_features(features), 0);
+
+    EXPECT_EQ(features.n, 5);
+    EXPECT_EQ(features.nnz, 8);
+    EXPECT_EQ(features.row_nnz_min, 0);
+    EXPECT_EQ(features.row_nnz_max, 3);
+    EXPECT_DOUBLE_EQ(features.row_nnz_mean, 8.0 / 5.0);
+    EXPECT_EQ(features.empty_rows, 1);
+    EXPECT_EQ(features.bandwidth, 3);
+    EXPECT_EQ(features.duplicates, 0);
+    EXPECT_EQ(features.missing_diagonal, 2); // rows 2 and 4 (0-based)
+
+    // row lengths 2, 3, 0, 2, 1: one empty row, one of length 1, three in [2,4)
+    EXPECT_EQ(features.row_nnz_histogram[0], 1);
+    EXPECT_EQ(features.row_nnz_histogram[1], 1);
+    EXPECT_EQ(features.row_nnz_histogram[2], 3);
+
+    // row 0: 4 >= 1, row 1: 4 >= 2, row 3: 0.5 < 2, row 4: 0 < 1
+    EXPECT_EQ(features.diagonally_dominant_rows, 2);
+    EXPECT_DOUBLE_EQ(features.diagonal_dominance_min, 0.0);
+
+    // (2,5) and (5,2) match, (4,1) has no transpose
+    EXPECT_FALSE(features.structurally_symmetric);
+    EXPECT_EQ(features.structural_asymmetric_entries, 1);
+}
+
+TEST(SolverMarketCsrMatrixFeatures, NumericSymmetry) {
+    std::string symmetric =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 3 5\n"
+        "1 1 2.0\n"
+        "1 3 -1.0\n"
+        "2 2 2.0\n"
+        "3 1 -1.0\n"
+        "3 3 2.0\n";
+    std::string unsymmetric =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 3 5\n"
+        "1 1 2.0\n"
+        "1 3 -1.0\n"
+        "2 2 2.0\n"
+        "3 1 -1.5\n"
+        "3 3 2.0\n";
+
+    write_temp_file("test_sym.mtx", symmetric);
+    write_temp_file("test_unsym.mtx", unsymmetric);
+    auto a = SolverMarketCSRMatrix<double>("test_sym.mtx", SolverMarketCSRMatrixFull);
+    auto b = SolverMarketCSRMatrix<double>("test_unsym.mtx", SolverMarketCSRMatrixFull);
+
+    SolverMarketMatrixFeatures fa, fb;
+    ASSERT_EQ(a.compute_features(fa), 0);
+    ASSERT_EQ(b.compute_features(fb), 0);
+
+    EXPECT_TRUE(fa.structurally_symmetric);
+    EXPECT_TRUE(fa.numerically_symmetric);
+    EXPECT_EQ(fa.diagonally_dominant_rows, 3);
+
+    EXPECT_TRUE(fb.structurally_symmetric);
+    EXPECT_FALSE(fb.numerically_symmetric);
+    EXPECT_EQ(fb.numerical_asymmetric_entries, 2);
+
+    // Same structure, different values: same fingerprint
+    EXPECT_EQ(fa.fingerprint, fb.fingerprint);
+}
+
+TEST(SolverMarketCsrMatrixFeatures, FingerprintDependsOnStructure) {
+    std::string content_a =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 3 3\n"
+        "1 1 1.0\n"
+        "2 2 1.0\n"
+        "3 3 1.0\n";
+    std::string content_b =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 3 3\n"
+        "1 1 1.0\n"
+        "2 3 1.0\n"
+        "3 3 1.0\n";
+
+    write_temp_file("test_fp_a.mtx", content_a);
+    write_temp_file("test_fp_b.mtx", content_b);
+    auto a = SolverMarketCSRMatrix<double>("test_fp_a.mtx", SolverMarketCSRMatrixFull);
+    auto b = SolverMarketCSRMatrix<float, int>("test_fp_b.mtx", SolverMarketCSRMatrixFull);
+    auto a_int = SolverMarketCSRMatrix<float, int>("test_fp_a.mtx", SolverMarketCSRMatrixFull);
+
+    SolverMarketMatrixFeatures fa, fb, fa_int;
+    a.compute_features(fa);
+    b.compute_features(fb);
+    a_int.compute_features(fa_int);
+
+    EXPECT_NE(fa.fingerprint, fb.fingerprint);
+    // Independent of the value and index types
+    EXPECT_EQ(fa.fingerprint, fa_int.fingerprint);
+    EXPECT_EQ(fa.fingerprint_string().size(), 16u);
+}
+
+TEST(SolverMarketCsrMatrixFeatures, NotAllocated) {
+    SolverMarketCSRMatrix<double> matrix;
+    SolverMarketMatrixFeatures features;
+    EXPECT_NE(matrix.compute_features(features), 0);
+}
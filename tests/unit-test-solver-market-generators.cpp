@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define GTEST_
+#include "solver-market-generators.hpp"
+
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+using Matrix = SolverMarketCSRMatrix<double, int>;
+
+// Entries of the host CSR, checking on the way that each row is sorted without duplicates
+std::map<std::pair<int, int>, double> entries_of(Matrix& A) {
+    std::map<std::pair<int, int>, double> entries;
+    auto offsets = A.get_host_offsets();
+    auto columns = A.get_host_columns();
+    auto values = A.get_host_values();
+    EXPECT_EQ(offsets(0), 0);
+    EXPECT_EQ(offsets(A.get_n()), A.get_nnz());
+    for (int i = 0; i < A.get_n(); i++) {
+        for (int k = offsets(i); k < offsets(i + 1); k++) {
+            if (k > offsets(i)) {
+                EXPECT_LT(columns(k - 1), columns(k)) << "row " << i;
+            }
+            entries[{i, columns(k)}] = values(k);
+        }
+    }
+    return entries;
+}
+
+// Symmetric, and positive definite: dense Cholesky (small matrices only)
+void expect_spd(Matrix& A) {
+    auto entries = entries_of(A);
+    const int n = A.get_n();
+    ASSERT_LE(n, 2000);
+    std::vector<double> dense(size_t(n) * n, 0.0);
+    for (const auto& [ij, value] : entries) {
+        auto transposed = entries.find({ij.second, ij.first});
+        ASSERT_NE(transposed, entries.end()) << ij.first << "," << ij.second;
+        EXPECT_DOUBLE_EQ(transposed->second, value);
+        dense[size_t(ij.first) * n + ij.second] = value;
+    }
+    for (int j = 0; j < n; j++) {
+        double pivot = dense[size_t(j) * n + j];
+        for (int k = 0; k < j; k++) pivot -= dense[size_t(j) * n + k] * dense[size_t(j) * n + k];
+        ASSERT_GT(pivot, 0.0) << "pivot " << j;
+        const double l = std::sqrt(pivot);
+        dense[size_t(j) * n + j] = l;
+        for (int i = j + 1; i < n; i++) {
+            double s = dense[size_t(i) * n + j];
+            for (int k = 0; k < j; k++) s -= dense[size_t(i) * n + k] * dense[size_t(j) * n + k];
+            dense[size_t(i) * n + j] = s / l;
+        }
+    }
+}
+
+// a_ii >= sum_j |a_ij| on every row
+void expect_diagonally_dominant(Matrix& A) {
+    auto entries = entries_of(A);
+    std::vector<double> diagonal(A.get_n(), 0.0), off(A.get_n(), 0.0);
+    for (const auto& [ij, value] : entries) {
+        if (ij.first == ij.second) diagonal[ij.first] = value;
+        else off[ij.first] += std::abs(value);
+    }
+    for (int i = 0; i < A.get_n(); i++) EXPECT_GE(diagonal[i] * (1 + 1e-12), off[i]) << "row " << i;
+}
+
+TEST(SolverMarketGenerators, ParsesSpecs) {
+    SolverMarketGeneratorSpec spec;
+    EXPECT_EQ(SolverMarketParseGeneratorSpec("laplace3d:n=16,nz=4", spec), SolverMarketGeneratorSuccess);
+    EXPECT_EQ(spec.name, "laplace3d");
+    double value = 0;
+    EXPECT_EQ(spec.get("n", 1, value), 0);
+    EXPECT_EQ(value, 16);
+    EXPECT_EQ(spec.get("missing", 7, value), 0);
+    EXPECT_EQ(value, 7);
+
+    EXPECT_EQ(SolverMarketParseGeneratorSpec("laplace2d", spec), SolverMarketGeneratorSuccess);
+    EXPECT_TRUE(spec.parameters.empty());
+    EXPECT_EQ(SolverMarketParseGeneratorSpec(":n=4", spec), SolverMarketGeneratorErrorSpec);
+    EXPECT_EQ(SolverMarketParseGeneratorSpec("laplace2d:n", spec), SolverMarketGeneratorErrorSpec);
+
+    Matrix A;
+    EXPECT_EQ(SolverMarketGenerate("poisson9d:n=4", A), SolverMarketGeneratorErrorUnknown);
+    EXPECT_EQ(SolverMarketGenerate("laplace2d:n=4,eps=2", A), SolverMarketGeneratorErrorParameter);
+    EXPECT_EQ(SolverMarketGenerate("laplace2d:n=four", A), SolverMarketGeneratorErrorParameter);
+    EXPECT_EQ(SolverMarketGenerate("elasticity2d:n=4,poisson=0.5", A), SolverMarketGeneratorErrorParameter);
+    EXPECT_EQ(SolverMarketGenerate("randomspd:n=100,skew=1", A), SolverMarketGeneratorErrorParameter);
+    // Not truncated to a smaller grid
+    EXPECT_EQ(SolverMarketGenerate("laplace2d:nx=4.5,ny=4", A), SolverMarketGeneratorErrorParameter);
+    EXPECT_EQ(SolverMarketGenerate("jump3d:n=4,blocks=1.5", A), SolverMarketGeneratorErrorParameter);
+    EXPECT_EQ(SolverMarketGenerate("randomspd:n=100.5", A), SolverMarketGeneratorErrorParameter);
+
+    // Skew close to 1: the heavy tail is clamped to n - 1 partners instead of overflowing
+    ASSERT_EQ(SolverMarketGenerate("randomspd:n=500,row_nnz=9,skew=0.9999999", A), SolverMarketGeneratorSuccess);
+    EXPECT_LE(size_t(A.get_nnz()), size_t(500) * 500);
+
+    // Refused by the size guard: 3 rows per node, 81 entries per row would exceed int nonzeros
+    EXPECT_EQ(SolverMarketGenerate("elasticity3d:n=210", A), SolverMarketGeneratorErrorParameter);
+    EXPECT_EQ(SolverMarketGenerate("laplace3d27:n=431", A), SolverMarketGeneratorErrorParameter);
+}
+
+TEST(SolverMarketGenerators, OffsetsBeyondTheIndexTypeFail) {
+    // 20000 rows of 2 entries: the 40000 nonzeros do not fit int16_t offsets
+    SolverMarketCSRMatrix<double, int16_t> small;
+    const int status = small.generate(int16_t(20000), [](const int16_t i, auto&& emit) {
+        emit(i, 2.0);
+        if (i > 0) emit(int16_t(i - 1), -1.0);
+    });
+    EXPECT_EQ(status, MtxReaderErrorWrongNnz);
+}
+
+TEST(SolverMarketGenerators, WrittenFileKeepsBothTriangles) {
+    Matrix A, B;
+    ASSERT_EQ(SolverMarketGenerate("laplace2d:n=6", A), 0);
+    ASSERT_EQ(A.write_matrix_market_file("generated_laplace2d.mtx"), MtxWriterSuccess);
+    ASSERT_EQ(B.read_matrix_market_file("generated_laplace2d.mtx", SolverMarketCSRMatrixFull), MtxReaderSuccess);
+    EXPECT_TRUE(B.isGeneral());
+    EXPECT_EQ(entries_of(B), entries_of(A));
+    std::remove("generated_laplace2d.mtx");
+}
+
+TEST(SolverMarketGenerators, LaplaciansHaveTheStencilCounts) {
+    Matrix A;
+    ASSERT_EQ(SolverMarketGenerate("laplace2d:nx=5,ny=4", A), 0);
+    EXPECT_EQ(A.get_n(), 20);
+    EXPECT_EQ(A.get_nnz(), 20 + 2 * (4 * 4 + 5 * 3));  // diagonal + both directions of each grid edge
+    EXPECT_TRUE(A.isFull() && A.isGeneral());  // both triangles stored
+    auto entries = entries_of(A);
+    EXPECT_EQ(entries[std::make_pair(0, 0)], 4.0);
+    EXPECT_EQ(entries[std::make_pair(0, 1)], -1.0);
+    EXPECT_EQ(entries[std::make_pair(0, 5)], -1.0);
+    expect_spd(A);
+    expect_diagonally_dominant(A);
+
+    // Explicit dimension wins over n=
+    ASSERT_EQ(SolverMarketGenerate("laplace3d:n=4,nz=3", A), 0);
+    EXPECT_EQ(A.get_n(), 48);
+    EXPECT_EQ(A.get_nnz(), 48 + 2 * (3 * 4 * 3 + 4 * 3 * 3 + 4 * 4 * 2));
+    expect_spd(A);
+    expect_diagonally_dominant(A);
+
+    ASSERT_EQ(SolverMarketGenerate("laplace3d27:n=5", A), 0);
+    auto offsets = A.get_host_offsets();
+    const int center = 2 + 5 * (2 + 5 * 2), corner = 0;
+    EXPECT_EQ(offsets(center + 1) - offsets(center), 27);
+    EXPECT_EQ(offsets(corner + 1) - offsets(corner), 8);
+    EXPECT_EQ(entries_of(A)[std::make_pair(center, center)], 26.0);
+    expect_spd(A);
+    expect_diagonally_dominant(A);
+}
+
+TEST(SolverMarketGenerators, CoefficientProblemsAreSymmetric) {
+    Matrix A;
+    ASSERT_EQ(SolverMarketGenerate("anisotropic2d:n=6,eps=0.01", A), 0);
+    auto entries = entries_of(A);
+    EXPECT_DOUBLE_EQ(entries[std::make_pair(7, 8)], -0.01);
+    EXPECT_DOUBLE_EQ(entries[std::make_pair(7, 13)], -1.0);
+    EXPECT_DOUBLE_EQ(entries[std::make_pair(7, 7)], 2.02);
+    expect_spd(A);
+    expect_diagonally_dominant(A);
+
+    // Face between a k = 1 box and a k = contrast box: harmonic mean
+    ASSERT_EQ(SolverMarketGenerate("jump3d:n=4,blocks=2,contrast=100", A), 0);
+    entries = entries_of(A);
+    EXPECT_NEAR(entries[std::make_pair(1, 2)], -2.0 * 100 / 101, 1e-12);
+    EXPECT_DOUBLE_EQ(entries[std::make_pair(0, 1)], -1.0);
+    expect_spd(A);
+    expect_diagonally_dominant(A);
+
+    for (const std::string spec : {"elasticity2d:n=5,poisson=0.3", "elasticity3d:n=3,poisson=0.2"}) {
+        ASSERT_EQ(SolverMarketGenerate(spec, A), 0) << spec;
+        expect_spd(A);
+    }
+    EXPECT_EQ(A.get_n(), 3 * 27);
+    // x component of the middle node: x-y/x-z couplings only along the diagonals that move in x
+    auto offsets = A.get_host_offsets();
+    const int center = 3 * 13;
+    EXPECT_EQ(offsets(center + 1) - offsets(center), 1 + 6 + (8 * 2 + 4) + 8 * 3);
+}
+
+TEST(SolverMarketGenerators, RandomSPDIsReproducibleAndSkewed) {
+    Matrix A, B, C;
+    ASSERT_EQ(SolverMarketGenerate("randomspd:n=600,row_nnz=9,seed=3", A), 0);
+    ASSERT_EQ(SolverMarketGenerate("randomspd:n=600,row_nnz=9,seed=3", B), 0);
+    EXPECT_EQ(entries_of(A), entries_of(B));
+    expect_spd(A);
+    expect_diagonally_dominant(A);
+    EXPECT_NEAR(double(A.get_nnz()) / A.get_n(), 9.0, 1.0);
+
+    // Same mean row length, much longer longest row
+    ASSERT_EQ(SolverMarketGenerate("randomspd:n=600,row_nnz=9,skew=0.8,seed=3", C), 0);
+    expect_diagonally_dominant(C);
+    auto longest = [](Matrix& M) {
+        int longest = 0;
+        for (int i = 0; i < M.get_n(); i++)
+            longest = std::max(longest, M.get_host_offsets()(i + 1) - M.get_host_offsets()(i));
+        return longest;
+    };
+    EXPECT_GT(longest(C), 4 * longest(A));
+    EXPECT_NEAR(double(C.get_nnz()) / C.get_n(), 9.0, 2.0);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+#define GTEST_
+#include "solver-market-amg.hpp"
+#include "solver-market-generators.hpp"
+#include "solver-market-krylov-ca.hpp"
+
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+using Matrix = SolverMarketCSRMatrix<double, int>;
+using DeviceCSR = SolverMarketDeviceCSR<double, int>;
+
+std::vector<double> to_host(const DeviceView<double>& v) {
+    std::vector<double> h(v.extent(0));
+    Kokkos::deep_copy(HostView<double>(h.data(), h.size()), v);
+    return h;
+}
+
+DeviceView<double> right_hand_side(const size_t n) {
+    DeviceView<double> b("b", n);
+    Kokkos::parallel_for("rhs", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const size_t i) {
+        b(i) = 1.0 + 0.5 * std::sin(0.01 * double(i));
+    });
+    return b;
+}
+
+// ||b - A x|| / ||b||
+double true_residual(const DeviceCSR& A, const DeviceView<double>& b, const DeviceView<double>& x) {
+    DeviceView<double> r("r", A.n_rows);
+    SolverMarketResidual(A, x, b, r);
+    return std::sqrt(SolverMarketDot(r, r) / SolverMarketDot(b, b));
+}
+
+struct Problem {
+    Matrix M;
+    DeviceCSR A;
+    DeviceView<double> b;
+
+    explicit Problem(const std::string& spec) {
+        EXPECT_EQ(SolverMarketGenerate(spec, M), SolverMarketGeneratorSuccess);
+        M.send_to_device();
+        A = DeviceCSR::wrap(M);
+        b = right_hand_side(A.n_rows);
+    }
+};
+
+TEST(SolverMarketKrylovCA, PipelinedMatchesCG) {
+    Problem problem("laplace2d:n=48");
+    SolverMarketJacobiPreconditioner<double> jacobi(problem.A);
+
+    DeviceView<double> x_cg("x_cg", problem.A.n_rows), x_pipelined("x_pipelined", problem.A.n_rows);
+    const auto cg = SolverMarketPCG(problem.A, problem.b, x_cg, jacobi, 1e-9, 1000);
+    const auto pipelined = SolverMarketPipelinedCG(problem.A, problem.b, x_pipelined, jacobi, 1e-9, 1000);
+    ASSERT_TRUE(cg.converged);
+    ASSERT_TRUE(pipelined.converged);
+    EXPECT_NEAR(pipelined.iterations, cg.iterations, 3);
+    EXPECT_LE(pipelined.residual, 1e-9);
+    EXPECT_LE(true_residual(problem.A, problem.b, x_pipelined), 1e-9);
+
+    // One reduction per iteration against three
+    EXPECT_LE(pipelined.reductions, pipelined.iterations + 4);
+    EXPECT_GE(cg.reductions, 3 * cg.iterations);
+
+    const auto h_cg = to_host(x_cg), h_pipelined = to_host(x_pipelined);
+    for (size_t i = 0; i < h_cg.size(); i++) ASSERT_NEAR(h_pipelined[i], h_cg[i], 1e-6 * std::abs(h_cg[i]) + 1e-8) << "row " << i;
+}
+
+TEST(SolverMarketKrylovCA, SStepMatchesCG) {
+    Problem problem("randomspd:n=3000,row_nnz=12,skew=0.5");
+    SolverMarketJacobiPreconditioner<double> jacobi(problem.A);
+
+    DeviceView<double> x_cg("x_cg", problem.A.n_rows);
+    const auto cg = SolverMarketPCG(problem.A, problem.b, x_cg, jacobi, 1e-10, 1000);
+    ASSERT_TRUE(cg.converged);
+    const auto h_cg = to_host(x_cg);
+
+    for (int s : {1, 2, 4, 8}) {
+        DeviceView<double> x("x", problem.A.n_rows);
+        const auto result = SolverMarketSStepCG(problem.A, problem.b, x, jacobi, 1e-10, 1000, s);
+        ASSERT_TRUE(result.converged) << "s=" << s << " residual " << result.residual;
+        EXPECT_EQ(result.iterations % s, 0);
+        // Same Krylov space every s iterations: at most one extra outer step (plus a replacement)
+        EXPECT_LE(result.iterations, cg.iterations + 2 * s) << "s=" << s;
+        EXPECT_LE(true_residual(problem.A, problem.b, x), 1e-10) << "s=" << s;
+        // One reduction per outer step and the final check, the norm of b, two replacements and the lambda_max estimate aside
+        EXPECT_LE(result.reductions, result.iterations / s + 4 + (s > 1 ? SolverMarketSStepPowerIterations + 1 : 0)) << "s=" << s;
+
+        const auto h = to_host(x);
+        for (size_t i = 0; i < h.size(); i++) ASSERT_NEAR(h[i], h_cg[i], 1e-7 * std::abs(h_cg[i]) + 1e-9) << "row " << i << " s=" << s;
+    }
+
+    // s is clamped
+    DeviceView<double> x("x", problem.A.n_rows);
+    EXPECT_TRUE(SolverMarketSStepCG(problem.A, problem.b, x, jacobi, 1e-8, 1000, 64).converged);
+}
+
+TEST(SolverMarketKrylovCA, WithAMG) {
+    Problem problem("laplace3d:n=24");
+    SolverMarketAMGOptions options;
+    options.coarse_size = 200;
+    SolverMarketAMG<double> amg(options);
+    ASSERT_EQ(amg.setup(problem.A), 0);
+
+    DeviceView<double> x_cg("x_cg", problem.A.n_rows), x_pipelined("x_pipelined", problem.A.n_rows), x_sstep("x_sstep", problem.A.n_rows);
+    const auto cg = SolverMarketPCG(problem.A, problem.b, x_cg, amg, 1e-8, 200);
+    const auto pipelined = SolverMarketPipelinedCG(problem.A, problem.b, x_pipelined, amg, 1e-8, 200);
+    const auto sstep = SolverMarketSStepCG(problem.A, problem.b, x_sstep, amg, 1e-8, 200, 4);
+    ASSERT_TRUE(cg.converged);
+    ASSERT_TRUE(pipelined.converged);
+    ASSERT_TRUE(sstep.converged);
+    EXPECT_LE(pipelined.iterations, cg.iterations + 2);
+    EXPECT_LE(sstep.iterations, cg.iterations + 8);
+    EXPECT_LE(true_residual(problem.A, problem.b, x_pipelined), 1e-8);
+    EXPECT_LE(true_residual(problem.A, problem.b, x_sstep), 1e-8);
+    EXPECT_LT(sstep.reductions, pipelined.reductions);
+    EXPECT_LT(pipelined.reductions, cg.reductions);
+}
+
+TEST(SolverMarketKrylovCA, StopsAtMaxIterations) {
+    Problem problem("laplace2d:n=64");
+    SolverMarketIdentityPreconditioner identity;
+    DeviceView<double> x("x", problem.A.n_rows);
+    auto result = SolverMarketPipelinedCG(problem.A, problem.b, x, identity, 1e-12, 10);
+    EXPECT_FALSE(result.converged);
+    EXPECT_EQ(result.iterations, 10);
+
+    Kokkos::deep_copy(x, 0.0);
+    result = SolverMarketSStepCG(problem.A, problem.b, x, identity, 1e-12, 10, 4);
+    EXPECT_FALSE(result.converged);
+    EXPECT_EQ(result.iterations, 12);
+
+    // Already solved: no iteration
+    Kokkos::deep_copy(x, 0.0);
+    DeviceView<double> zero("zero", problem.A.n_rows);
+    result = SolverMarketPipelinedCG(problem.A, zero, x, identity, 1e-8, 10);
+    EXPECT_TRUE(result.converged);
+    EXPECT_EQ(result.iterations, 0);
+}
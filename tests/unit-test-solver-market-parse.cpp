@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "solver-market-parse.hpp"
+
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+// The parsers may read SolverMarketParsePadding bytes past the end
+std::vector<char> padded(const std::string& text) {
+    std::vector<char> buffer(text.begin(), text.end());
+    buffer.resize(text.size() + SolverMarketParsePadding, '\0');
+    return buffer;
+}
+
+TEST(SolverMarketParse, Integers) {
+    const std::vector<std::string> fields = {"0", "7", "42", "12345678", "123456789", "  9876543210123",
+                                             "+15", "-12", "4294967296", "1000000000000000000"};
+    const std::vector<long long> expected = {0, 7, 42, 12345678, 123456789, 9876543210123LL,
+                                             15, -12, 4294967296LL, 1000000000000000000LL};
+    for (size_t f = 0; f < fields.size(); f++) {
+        auto buffer = padded(fields[f] + " 3\n");
+        const char* p = buffer.data();
+        const char* end = p + fields[f].size() + 3;
+        long long value = -1;
+        ASSERT_TRUE(SolverMarketParseInteger(p, end, value)) << fields[f];
+        EXPECT_EQ(value, expected[f]) << fields[f];
+        EXPECT_EQ(*p, ' ');
+
+        long long next = 0;
+        ASSERT_TRUE(SolverMarketParseInteger(p, end, next));
+        EXPECT_EQ(next, 3);
+    }
+
+    // Stops at the end of the field even when digits follow in memory
+    auto buffer = padded("1234567890");
+    const char* p = buffer.data();
+    int value;
+    ASSERT_TRUE(SolverMarketParseInteger(p, buffer.data() + 3, value));
+    EXPECT_EQ(value, 123);
+
+    // Not a number, unsigned negative
+    buffer = padded("abc -5");
+    p = buffer.data();
+    EXPECT_FALSE(SolverMarketParseInteger(p, buffer.data() + 6, value));
+    p = buffer.data() + 3;
+    size_t unsigned_value;
+    EXPECT_FALSE(SolverMarketParseInteger(p, buffer.data() + 6, unsigned_value));
+}
+
+TEST(SolverMarketParse, RealsAreCorrectlyRounded) {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> mantissa(-10.0, 10.0);
+    std::uniform_int_distribution<int> exponent(-300, 300);
+
+    for (int t = 0; t < 2000; t++) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "%.17g", mantissa(rng) * std::pow(10.0, exponent(rng)));
+        std::string field = std::string(" ") + text + "\n";
+        auto buffer = padded(field);
+        const char* p = buffer.data();
+        double value;
+        ASSERT_TRUE(SolverMarketParseValue(p, buffer.data() + field.size(), value)) << text;
+        EXPECT_EQ(value, std::strtod(text, nullptr)) << text;
+        EXPECT_EQ(*p, '\n');
+    }
+
+    const std::vector<std::string> fields = {"+1.5", "1e-400", "1e400", "-0.0", "3", "2.5E+3"};
+    const std::vector<double> expected = {1.5, 0.0, HUGE_VAL, -0.0, 3.0, 2500.0};
+    for (size_t f = 0; f < fields.size(); f++) {
+        auto buffer = padded(fields[f]);
+        const char* p = buffer.data();
+        double value;
+        ASSERT_TRUE(SolverMarketParseValue(p, buffer.data() + fields[f].size(), value)) << fields[f];
+        EXPECT_EQ(value, expected[f]) << fields[f];
+    }
+
+    auto buffer = padded("x");
+    const char* p = buffer.data();
+    double value;
+    EXPECT_FALSE(SolverMarketParseValue(p, buffer.data() + 1, value));
+}
+
+TEST(SolverMarketParse, NewlinesAllAlignments) {
+    std::mt19937 rng(7);
+    std::string text(1000, 'a');
+    for (auto& c : text) c = (rng() % 7 == 0) ? '\n' : char('0' + rng() % 10);
+    auto buffer = padded(text);
+
+    for (size_t begin = 0; begin < 40; begin++) {
+        for (size_t end = begin; end < text.size(); end += 37) {
+            const char* b = buffer.data() + begin;
+            const char* e = buffer.data() + end;
+            EXPECT_EQ(SolverMarketCountNewlines(b, e), SolverMarketCountNewlinesScalar(b, e));
+            EXPECT_EQ(SolverMarketFindNewline(b, e), SolverMarketFindNewlineScalar(b, e));
+        }
+    }
+}
+
+TEST(SolverMarketParse, BodyBlocksAndChunks) {
+    // Enough lines for several chunks, comments and blank lines inside, no final newline
+    std::string text;
+    const int nlines = 60000;
+    for (int l = 0; l < nlines; l++) {
+        text += std::to_string(l + 1) + " " + std::to_string(2 * l + 1) + " " + std::to_string(0.5 * l) + "\n";
+        if (l % 9999 == 0) text += "% comment\n\n";
+    }
+    text.pop_back();
+
+    for (size_t block_bytes : {size_t(100), size_t(1) << 16, size_t(64) << 20}) {
+        std::istringstream in(text);
+        std::vector<long long> rows, cols;
+        std::vector<double> vals;
+        size_t stored = 0;
+        int status = SolverMarketParseBody(in,
+            [&](const size_t first, const size_t nlines) {
+                rows.resize(first + nlines); cols.resize(first + nlines); vals.resize(first + nlines);
+            },
+            [&](const char* p, const char* end, const size_t slot) -> int {
+                if (SolverMarketIsEmptyLine(p, end)) return -1;
+                if (!SolverMarketParseInteger(p, end, rows[slot]) || !SolverMarketParseInteger(p, end, cols[slot])
+                    || !SolverMarketParseValue(p, end, vals[slot])) return 1;
+                return 0;
+            },
+            [&](const size_t from, const size_t to) {
+                rows[to] = rows[from]; cols[to] = cols[from]; vals[to] = vals[from];
+            },
+            stored, block_bytes);
+
+        ASSERT_EQ(status, 0) << "block " << block_bytes;
+        ASSERT_EQ(stored, size_t(nlines)) << "block " << block_bytes;
+        for (int l = 0; l < nlines; l++) {
+            ASSERT_EQ(rows[l], l + 1);
+            ASSERT_EQ(cols[l], 2 * l + 1);
+            ASSERT_EQ(vals[l], 0.5 * l);
+        }
+    }
+}
+
+TEST(SolverMarketParse, BodyReportsFirstError) {
+    std::string text;
+    for (int l = 0; l < 50000; l++) {
+        text += (l == 30000) ? "1 x 1.0\n" : (l == 40000) ? "oops\n" : "1 1 1.0\n";
+    }
+    std::istringstream in(text);
+    size_t stored;
+    int status = SolverMarketParseBody(in,
+        [](const size_t, const size_t) {},
+        [&](const char* p, const char* end, const size_t) -> int {
+            long long i, j;
+            if (!SolverMarketParseInteger(p, end, i)) return 3;
+            if (!SolverMarketParseInteger(p, end, j)) return 2;
+            return 0;
+        },
+        [](const size_t, const size_t) {},
+        stored);
+    EXPECT_EQ(status, 2);
+}
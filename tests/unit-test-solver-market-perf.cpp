@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#define GTEST_
+#include "solver-market-perf.hpp"
+
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+// Some work the compiler cannot drop
+static double busy(const int n) {
+    volatile double sum = 0;
+    for (int i = 0; i < n; i++) sum = sum + 0.5 * i;
+    return sum;
+}
+
+TEST(SolverMarketPerf, DerivedMetrics) {
+    SolverMarketPerfSample sample;
+    EXPECT_EQ(sample.ipc(), 0.0);
+    EXPECT_EQ(sample.summary("solve"), "solve:s=0");
+
+    sample.seconds = 2.0;
+    for (int e = 0; e < SolverMarketPerfEventCount; e++) sample.counted[e] = true;
+    sample.counts[SolverMarketPerfCycles] = 1000;
+    sample.counts[SolverMarketPerfInstructions] = 1500;
+    sample.counts[SolverMarketPerfCacheReferences] = 400;
+    sample.counts[SolverMarketPerfCacheMisses] = 100;
+    sample.counts[SolverMarketPerfBranches] = 200;
+    sample.counts[SolverMarketPerfBranchMisses] = 2;
+    sample.flops = 3200;
+    EXPECT_DOUBLE_EQ(sample.ipc(), 1.5);
+    EXPECT_DOUBLE_EQ(sample.llc_miss_ratio(), 0.25);
+    EXPECT_DOUBLE_EQ(sample.branch_miss_ratio(), 0.01);
+    EXPECT_DOUBLE_EQ(sample.dram_bytes(), 6400);
+    EXPECT_DOUBLE_EQ(sample.dram_gbs(), 3.2e-6);
+    EXPECT_DOUBLE_EQ(sample.flop_per_byte(), 0.5);
+    EXPECT_EQ(sample.summary("solve"), "solve:s=2,ipc=1.5,llc_miss=0.25,gbs=3.2e-06,branch_miss=0.01,flop_per_byte=0.5");
+
+    SolverMarketPerfSample twice = sample;
+    twice += sample;
+    EXPECT_DOUBLE_EQ(twice.seconds, 4.0);
+    EXPECT_DOUBLE_EQ(twice.ipc(), 1.5);
+}
+
+TEST(SolverMarketPerf, DisabledRegionsRecordNothing) {
+    auto& perf = SolverMarketPerf::instance();
+    perf.set_enabled(false);
+    perf.clear();
+    {
+        SolverMarketPerfRegion region("setup");
+        busy(1000);
+    }
+    SolverMarketPerfSample sample;
+    EXPECT_FALSE(perf.sample("setup", sample));
+    EXPECT_EQ(perf.summary(), "");
+}
+
+TEST(SolverMarketPerf, NestedRegionsWithOrWithoutCounters) {
+    auto& perf = SolverMarketPerf::instance();
+    perf.set_enabled(true);
+    perf.clear();
+    {
+        SolverMarketPerfRegion outer("read");
+        for (int repeat = 0; repeat < 2; repeat++) {
+            SolverMarketPerfRegion inner("read:parse");
+            busy(200000);
+        }
+        busy(100000);
+    }
+    SolverMarketPerfSample outer, inner;
+    ASSERT_TRUE(perf.sample("read", outer));
+    ASSERT_TRUE(perf.sample("read:parse", inner));
+    EXPECT_GT(inner.seconds, 0.0);
+    EXPECT_GE(outer.seconds, inner.seconds);
+
+    // Machines without a PMU (VMs, containers) only time the phases
+    const bool available = perf.counters()->available();
+    if (available && perf.counters()->counted(SolverMarketPerfInstructions)) {
+        EXPECT_GT(inner.counts[SolverMarketPerfInstructions], 0.0);
+        EXPECT_GE(outer.counts[SolverMarketPerfInstructions], inner.counts[SolverMarketPerfInstructions]);
+    } else {
+        EXPECT_FALSE(inner.has(SolverMarketPerfInstructions));
+    }
+
+    // Phases are listed in the order they first end
+    const std::string summary = perf.summary();
+    EXPECT_EQ(summary.rfind(available ? "perf[read:parse:s=" : "perf=unavailable[read:parse:s=", 0), 0u) << summary;
+    EXPECT_NE(summary.find(";read:s="), std::string::npos) << summary;
+    perf.set_enabled(false);
+}
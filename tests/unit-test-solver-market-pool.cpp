@@ -0,0 +1,283 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define GTEST_
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-vector.hpp"
+
+
+void write_temp_file(const std::string& filename, const std::string& content) {
+    std::ofstream out(filename);
+    out << content;
+    out.close();
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+class SolverMarketBufferPoolTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        SolverMarketBufferPool::instance().set_enabled(true);
+        SolverMarketBufferPool::instance().clear();
+        SolverMarketBufferPool::instance().reset_statistics();
+
+        write_temp_file("test_pool_a.mtx",
+            "%%MatrixMarket matrix coordinate real general\n"
+            "3 3 4\n"
+            "1 1 1.0\n"
+            "2 2 2.0\n"
+            "3 1 3.0\n"
+            "3 3 4.0\n");
+        write_temp_file("test_pool_b.mtx",
+            "%%MatrixMarket matrix coordinate real general\n"
+            "3 3 3\n"
+            "1 2 5.0\n"
+            "2 2 6.0\n"
+            "3 3 7.0\n");
+    }
+};
+
+TEST(SolverMarketBufferPool, RoundCapacity) {
+    EXPECT_EQ(SolverMarketBufferPool::round_capacity(1), 64u);
+    EXPECT_EQ(SolverMarketBufferPool::round_capacity(64), 64u);
+    EXPECT_EQ(SolverMarketBufferPool::round_capacity(65), 80u);
+    EXPECT_EQ(SolverMarketBufferPool::round_capacity(1000), 1024u);
+    EXPECT_EQ(SolverMarketBufferPool::round_capacity(1025), 1280u);
+    for (size_t n : {100u, 4097u, 123457u}) {
+        EXPECT_GE(SolverMarketBufferPool::round_capacity(n), n);
+        EXPECT_LE(SolverMarketBufferPool::round_capacity(n), n + n / 4);
+    }
+}
+
+TEST_F(SolverMarketBufferPoolTest, ReloadReusesBuffers) {
+    SolverMarketCSRMatrix<double> matrix;
+    ASSERT_EQ(matrix.read_matrix_market_file("test_pool_a.mtx", SolverMarketCSRMatrixFull), 0);
+    auto first = SolverMarketBufferPool::instance().statistics();
+    EXPECT_EQ(first.hits, 0u);
+    EXPECT_GT(first.misses, 0u);
+
+    // Same object, smaller matrix: every buffer comes back from the pool
+    ASSERT_EQ(matrix.read_matrix_market_file("test_pool_b.mtx", SolverMarketCSRMatrixFull), 0);
+    auto second = SolverMarketBufferPool::instance().statistics();
+    EXPECT_EQ(second.misses, first.misses);
+    EXPECT_GE(second.hits, 6u);
+    EXPECT_EQ(second.bytes_reserved, first.bytes_reserved);
+
+    // Content is the new matrix, sized exactly
+    EXPECT_EQ(matrix.get_nnz(), 3u);
+    auto offsets = matrix.get_host_offsets();
+    auto cols = matrix.get_host_columns();
+    auto values = matrix.get_host_values();
+    ASSERT_EQ(offsets.extent(0), 4u);
+    ASSERT_EQ(values.extent(0), 3u);
+    EXPECT_EQ(offsets(3), 3u);
+    EXPECT_EQ(cols(0), 1u);
+    EXPECT_DOUBLE_EQ(values(0), 5.0);
+    EXPECT_DOUBLE_EQ(values(2), 7.0);
+}
+
+TEST_F(SolverMarketBufferPoolTest, DestroyedObjectFeedsTheNextOne) {
+    {
+        SolverMarketCSRMatrix<double> matrix("test_pool_a.mtx", SolverMarketCSRMatrixFull);
+    }
+    auto stats = SolverMarketBufferPool::instance().statistics();
+    EXPECT_GT(stats.bytes_idle, 0u);
+    EXPECT_EQ(stats.bytes_idle, stats.bytes_reserved);
+
+    SolverMarketCSRMatrix<double> other("test_pool_b.mtx", SolverMarketCSRMatrixFull);
+    auto after = SolverMarketBufferPool::instance().statistics();
+    EXPECT_EQ(after.misses, stats.misses);
+    EXPECT_LT(after.bytes_idle, stats.bytes_idle);
+}
+
+TEST_F(SolverMarketBufferPoolTest, ReferencedBuffersAreNotReused) {
+    HostView<double> kept;
+    {
+        SolverMarketCSRMatrix<double> matrix("test_pool_a.mtx", SolverMarketCSRMatrixFull);
+        kept = matrix.get_host_values();
+    }
+    // Still readable, and not handed out to the next matrix
+    EXPECT_DOUBLE_EQ(kept(3), 4.0);
+    SolverMarketCSRMatrix<double> other("test_pool_b.mtx", SolverMarketCSRMatrixFull);
+    EXPECT_NE(other.get_host_values().data(), kept.data());
+    EXPECT_DOUBLE_EQ(kept(3), 4.0);
+}
+
+TEST_F(SolverMarketBufferPoolTest, CopiesShareStorageSafely) {
+    SolverMarketCSRMatrix<double> matrix("test_pool_a.mtx", SolverMarketCSRMatrixFull);
+    auto before = SolverMarketBufferPool::instance().statistics();
+    {
+        SolverMarketCSRMatrix<double> copy = matrix;
+        EXPECT_EQ(copy.get_host_values().data(), matrix.get_host_values().data());
+    }
+    // The copy went away while the original still owns the storage
+    EXPECT_EQ(SolverMarketBufferPool::instance().statistics().bytes_idle, before.bytes_idle);
+    EXPECT_DOUBLE_EQ(matrix.get_host_values()(2), 3.0);
+}
+
+TEST_F(SolverMarketBufferPoolTest, ReusedVectorIsZeroed) {
+    {
+        SolverMarketVector<double> vec(10, 7.0);
+    }
+    SolverMarketVector<double> vec(8);
+    auto values = vec.get_host_values();
+    ASSERT_EQ(values.extent(0), 8u);
+    for (size_t i = 0; i < 8; i++) {
+        EXPECT_EQ(values(i), 0.0);
+    }
+    EXPECT_GT(SolverMarketBufferPool::instance().statistics().hits, 0u);
+}
+
+TEST_F(SolverMarketBufferPoolTest, ParserScratchIsReused) {
+    SolverMarketCSRMatrix<double> a("test_pool_a.mtx", SolverMarketCSRMatrixFull);
+    auto first = SolverMarketBufferPool::instance().statistics();
+    SolverMarketCSRMatrix<double> b("test_pool_b.mtx", SolverMarketCSRMatrixFull);
+    auto second = SolverMarketBufferPool::instance().statistics();
+
+    // b gets new CSR buffers (a still owns its own) but reuses the COO and row scratch
+    EXPECT_GE(second.hits - first.hits, 2u);
+}
+
+TEST_F(SolverMarketBufferPoolTest, DisabledPoolAndIdleLimit) {
+    SolverMarketBufferPool::instance().set_enabled(false);
+    {
+        SolverMarketCSRMatrix<double> matrix("test_pool_a.mtx", SolverMarketCSRMatrixFull);
+    }
+    auto stats = SolverMarketBufferPool::instance().statistics();
+    EXPECT_EQ(stats.hits, 0u);
+    EXPECT_EQ(stats.misses, 0u);
+    EXPECT_EQ(stats.bytes_idle, 0u);
+
+    SolverMarketBufferPool::instance().set_enabled(true);
+    const uint64_t max_idle_bytes = SolverMarketBufferPool::instance().get_max_idle_bytes();
+    EXPECT_LT(max_idle_bytes, ~uint64_t(0));
+    SolverMarketBufferPool::instance().set_max_idle_bytes(0);
+    {
+        SolverMarketCSRMatrix<double> matrix("test_pool_a.mtx", SolverMarketCSRMatrixFull);
+    }
+    stats = SolverMarketBufferPool::instance().statistics();
+    EXPECT_EQ(stats.bytes_idle, 0u);
+    EXPECT_EQ(stats.bytes_reserved, 0u);
+    SolverMarketBufferPool::instance().set_max_idle_bytes(max_idle_bytes);
+}
+
+TEST_F(SolverMarketBufferPoolTest, FreshBuffersArePlacedOnce) {
+    auto& pool = SolverMarketViewPool<double, Host>::instance();
+    bool fresh = false;
+    auto view = pool.acquire("numa", 1000, false, &fresh);
+    EXPECT_TRUE(fresh);
+    pool.release(view);
+    view = pool.acquire("numa", 1000, false, &fresh);
+    EXPECT_FALSE(fresh);
+    pool.release(view);
+
+    // Every placement leaves a zeroed vector, fresh or reused
+    for (auto placement : {SolverMarketNumaNone, SolverMarketNumaFirstTouch, SolverMarketNumaInterleave}) {
+        SolverMarketNumaPolicy() = placement;
+        SolverMarketBufferPool::instance().clear();
+        for (int reuse = 0; reuse < 2; reuse++) {
+            SolverMarketVector<double> vec(5000);
+            auto values = vec.get_host_values();
+            for (size_t i = 0; i < 5000; i++) ASSERT_EQ(values(i), 0.0) << SolverMarketNumaPlacementName(placement);
+            values(17) = 3.0;
+        }
+    }
+    SolverMarketNumaPolicy() = SolverMarketNumaFirstTouch;
+}
+
+TEST(SolverMarketNuma, NodesAndPolicy) {
+    write_temp_file("test_numa_online", "0-1,4\n");
+    EXPECT_EQ(SolverMarketNumaNodes("test_numa_online"), (std::vector<int>{0, 1, 4}));
+    EXPECT_EQ(SolverMarketNumaNodes("missing_numa_online"), std::vector<int>{0});
+
+    SolverMarketNumaPlacement placement = SolverMarketNumaNone;
+    EXPECT_EQ(SolverMarketParseNumaPlacement("interleave", placement), 0);
+    EXPECT_EQ(placement, SolverMarketNumaInterleave);
+    EXPECT_EQ(SolverMarketParseNumaPlacement("spread", placement), 1);
+
+    auto binding = SolverMarketCheckThreadBinding(false);
+    EXPECT_GE(binding.nodes, 1);
+    EXPECT_EQ(binding.threads, Host().concurrency());
+}
+
+TEST(SolverMarketNuma, EntriesAreTouchedByRows) {
+    // Skewed rows: one long row then short ones, the touch covers exactly the entries of the rows
+    HostView<int> offsets("offsets", 5);
+    const int ends[5] = {0, 40, 41, 43, 44};
+    for (int i = 0; i < 5; i++) offsets(i) = ends[i];
+    HostView<double> values("values", 48);
+    Kokkos::deep_copy(values, 7.0);
+    SolverMarketFirstTouchRows(values, offsets, 4);
+    for (size_t k = 0; k < 48; k++) EXPECT_EQ(values(k), k < 44 ? 0.0 : 7.0) << k;
+
+    // Fresh entries of a read matrix are placed once its offsets are known, under every policy
+    write_temp_file("test_numa_rows.mtx",
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 3 5\n"
+        "1 1 1.0\n1 2 2.0\n1 3 3.0\n"
+        "3 3 4.0\n2 2 5.0\n");
+    for (auto placement : {SolverMarketNumaNone, SolverMarketNumaFirstTouch}) {
+        SolverMarketNumaPolicy() = placement;
+        SolverMarketBufferPool::instance().clear();
+        SolverMarketCSRMatrix<double, int> matrix("test_numa_rows.mtx", SolverMarketCSRMatrixFull);
+        auto values_h = matrix.get_host_values();
+        const double expected[5] = {1.0, 2.0, 3.0, 5.0, 4.0};
+        for (int k = 0; k < 5; k++) EXPECT_EQ(values_h(k), expected[k]) << SolverMarketNumaPlacementName(placement);
+    }
+    SolverMarketNumaPolicy() = SolverMarketNumaFirstTouch;
+}
+
+TEST_F(SolverMarketBufferPoolTest, ScratchAboveTheIdleLimitIsFreed) {
+    auto& registry = SolverMarketBufferPool::instance();
+    const uint64_t max_idle_bytes = registry.get_max_idle_bytes();
+    registry.set_max_idle_bytes(1024);
+    {
+        SolverMarketPooledScratch<double> large(1000);
+        large.get().resize(1000);
+        SolverMarketPooledScratch<double> small(16);
+    }
+    auto stats = registry.statistics();
+    EXPECT_EQ(stats.bytes_idle, 16 * sizeof(double));
+    registry.set_max_idle_bytes(max_idle_bytes);
+}
+
+TEST_F(SolverMarketBufferPoolTest, ToggledWhileLoading) {
+    auto& registry = SolverMarketBufferPool::instance();
+    const uint64_t max_idle_bytes = registry.get_max_idle_bytes();
+    std::atomic<bool> done(false);
+    std::thread toggler([&]() {
+        for (int k = 0; !done; k++) {
+            registry.set_enabled(k % 2 == 0);
+            registry.set_max_idle_bytes(k % 3 == 0 ? 0 : max_idle_bytes);
+        }
+    });
+    std::vector<std::thread> loaders;
+    for (int t = 0; t < 4; t++) {
+        loaders.emplace_back([]() {
+            for (int k = 0; k < 200; k++) {
+                SolverMarketPooledScratch<double> scratch(100 + k);
+                scratch.get().resize(100 + k, 1.0);
+            }
+        });
+    }
+    for (auto& loader : loaders) loader.join();
+    done = true;
+    toggler.join();
+
+    registry.set_max_idle_bytes(max_idle_bytes);
+    registry.set_enabled(true);
+    registry.clear();
+    EXPECT_EQ(registry.statistics().bytes_idle, 0u);
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "solver-market-protocol.hpp"
+
+
+// Connected pair of Unix sockets, closed by the destructor
+struct SocketPair {
+    int fd[2] = {-1, -1};
+    SocketPair() { ::socketpair(AF_UNIX, SOCK_STREAM, 0, fd); }
+    ~SocketPair() { ::close(fd[0]); ::close(fd[1]); }
+};
+
+TEST(SolverMarketProtocol, JobRoundTrip) {
+    SolverMarketJob job;
+    job.matrix = "matrices/poisson 2d.mtx";
+    job.config = "params-files/PCG_CLASSICAL_V_JACOBI.json";
+    job.matrix_key = "poisson=2d";
+    job.use_cache = false;
+    job.return_solution = true;
+    job.has_matrix_payload = true;
+    job.matrix_payload.n = 3;
+    job.matrix_payload.nnz = 4;
+    job.matrix_payload.offsets = {0, 1, 2, 4};
+    job.matrix_payload.columns = {0, 1, 0, 2};
+    job.matrix_payload.values = {1.0, 2.0, -0.1, 1e-300};
+    job.has_rhs_payload = true;
+    job.rhs_payload = {1.0, 0.5, 0.25};
+
+    SocketPair sockets;
+    // Large enough payloads block the writer: send from a second thread
+    std::thread sender([&] { EXPECT_TRUE(SolverMarketSendJob(sockets.fd[0], job)); });
+    SolverMarketJob received;
+    ASSERT_TRUE(SolverMarketRecvJob(sockets.fd[1], received));
+    sender.join();
+
+    EXPECT_EQ(received.command, "solve");
+    EXPECT_EQ(received.backend, "amgx");
+    EXPECT_EQ(received.matrix, job.matrix);
+    EXPECT_EQ(received.config, job.config);
+    EXPECT_EQ(received.matrix_key, job.matrix_key);
+    EXPECT_TRUE(received.rhs.empty());
+    EXPECT_FALSE(received.use_cache);
+    EXPECT_TRUE(received.return_solution);
+    ASSERT_TRUE(received.has_matrix_payload);
+    EXPECT_EQ(received.matrix_payload.n, 3u);
+    EXPECT_EQ(received.matrix_payload.nnz, 4u);
+    EXPECT_EQ(received.matrix_payload.offsets, job.matrix_payload.offsets);
+    EXPECT_EQ(received.matrix_payload.columns, job.matrix_payload.columns);
+    EXPECT_EQ(received.matrix_payload.values, job.matrix_payload.values);
+    ASSERT_TRUE(received.has_rhs_payload);
+    EXPECT_EQ(received.rhs_payload, job.rhs_payload);
+}
+
+TEST(SolverMarketProtocol, LargePayloadAndResult) {
+    SolverMarketJob job;
+    job.has_matrix_payload = true;
+    auto& csr = job.matrix_payload;
+    csr.n = 100000;
+    csr.nnz = csr.n;
+    for (int i = 0; i <= int(csr.n); i++) csr.offsets.push_back(i);
+    for (int i = 0; i < int(csr.n); i++) { csr.columns.push_back(i); csr.values.push_back(i + 0.5); }
+
+    SocketPair sockets;
+    std::thread sender([&] { EXPECT_TRUE(SolverMarketSendJob(sockets.fd[0], job)); });
+    SolverMarketJob received;
+    ASSERT_TRUE(SolverMarketRecvJob(sockets.fd[1], received));
+    sender.join();
+    EXPECT_EQ(received.matrix_payload.values, csr.values);
+
+    SolverMarketJobResult result;
+    result.status = SolverMarketServerErrorSolve;
+    result.message = "solve did not converge";
+    result.load_ms = 12.25;
+    result.setup_ms = 0.1;
+    result.solve_ms = 3.0 / 7.0;
+    result.iterations = 42;
+    result.residual = 1.234567890123e-9;
+    result.matrix_cached = true;
+    result.solution = csr.values;
+
+    std::thread responder([&] { EXPECT_TRUE(SolverMarketSendResult(sockets.fd[1], result)); });
+    SolverMarketJobResult answer;
+    ASSERT_TRUE(SolverMarketRecvResult(sockets.fd[0], answer));
+    responder.join();
+
+    EXPECT_EQ(answer.status, SolverMarketServerErrorSolve);
+    EXPECT_EQ(answer.message, result.message);
+    EXPECT_EQ(answer.load_ms, result.load_ms);
+    EXPECT_EQ(answer.solve_ms, result.solve_ms);
+    EXPECT_EQ(answer.iterations, 42);
+    EXPECT_EQ(answer.residual, result.residual);
+    EXPECT_TRUE(answer.matrix_cached);
+    EXPECT_FALSE(answer.solver_cached);
+    EXPECT_EQ(answer.solution, result.solution);
+}
+
+TEST(SolverMarketProtocol, TruncatedOrMalformedMessages) {
+    {
+        // Peer goes away in the middle of the header
+        SocketPair sockets;
+        const uint64_t length = 100;
+        ASSERT_TRUE(SolverMarketSendAll(sockets.fd[0], &length, sizeof(length)));
+        ASSERT_TRUE(SolverMarketSendAll(sockets.fd[0], "command=solve\n", 14));
+        ::shutdown(sockets.fd[0], SHUT_WR);
+        SolverMarketJob job;
+        EXPECT_FALSE(SolverMarketRecvJob(sockets.fd[1], job));
+    }
+    {
+        // Payload announced in the header but shorter than the CSR it claims to hold
+        SocketPair sockets;
+        std::string payload;
+        const uint64_t n = 1000, nnz = 1000;
+        SolverMarketAppendBytes(payload, &n, sizeof(n));
+        SolverMarketAppendBytes(payload, &nnz, sizeof(nnz));
+        payload.append(64, '\0');
+        ASSERT_TRUE(SolverMarketSendMessage(sockets.fd[0], {{"command", "solve"}, {"matrix_payload", "1"}}, payload));
+        SolverMarketJob job;
+        EXPECT_FALSE(SolverMarketRecvJob(sockets.fd[1], job));
+    }
+    {
+        // Header line without '='
+        SocketPair sockets;
+        const std::string header = "command solve\n";
+        const uint64_t length = header.size();
+        ASSERT_TRUE(SolverMarketSendAll(sockets.fd[0], &length, sizeof(length)));
+        ASSERT_TRUE(SolverMarketSendAll(sockets.fd[0], header.data(), header.size()));
+        SolverMarketJob job;
+        EXPECT_FALSE(SolverMarketRecvJob(sockets.fd[1], job));
+    }
+    {
+        // Payload size that is not a number, or above the receiver's cap: refused before any allocation
+        for (const std::string size : {"abc", "-1", "99999999999999999999", "1048577"}) {
+            SocketPair sockets;
+            const std::string header = "command=solve\npayload_bytes=" + size + "\n";
+            const uint64_t length = header.size();
+            ASSERT_TRUE(SolverMarketSendAll(sockets.fd[0], &length, sizeof(length)));
+            ASSERT_TRUE(SolverMarketSendAll(sockets.fd[0], header.data(), header.size()));
+            SolverMarketJob job;
+            EXPECT_FALSE(SolverMarketRecvJob(sockets.fd[1], job, uint64_t(1) << 20)) << size;
+        }
+    }
+}
+
+TEST(SolverMarketProtocol, InvalidCSRPayload) {
+    SolverMarketCSRPayload valid;
+    valid.n = 3;
+    valid.nnz = 4;
+    valid.offsets = {0, 1, 2, 4};
+    valid.columns = {0, 1, 0, 2};
+    valid.values = {1.0, 2.0, -0.1, 3.0};
+    EXPECT_TRUE(SolverMarketCheckCSR(valid));
+
+    auto column_out_of_range = valid;
+    column_out_of_range.columns[3] = 3;
+    auto negative_column = valid;
+    negative_column.columns[0] = -1;
+    auto decreasing_offsets = valid;
+    decreasing_offsets.offsets = {0, 2, 1, 4};
+    auto wrong_last_offset = valid;
+    wrong_last_offset.offsets = {0, 1, 2, 3};
+    auto nonzero_first_offset = valid;
+    nonzero_first_offset.offsets = {1, 1, 2, 4};
+
+    for (const auto& csr : {column_out_of_range, negative_column, decreasing_offsets, wrong_last_offset, nonzero_first_offset}) {
+        EXPECT_FALSE(SolverMarketCheckCSR(csr));
+
+        // Same refusal when it comes through the socket
+        SolverMarketJob job;
+        job.has_matrix_payload = true;
+        job.matrix_payload = csr;
+        SocketPair sockets;
+        std::thread sender([&] { SolverMarketSendJob(sockets.fd[0], job); });
+        SolverMarketJob received;
+        EXPECT_FALSE(SolverMarketRecvJob(sockets.fd[1], received));
+        sender.join();
+    }
+}
+
+TEST(SolverMarketProtocol, NoServerListening) {
+    EXPECT_LT(SolverMarketConnect("/tmp/solver_market_no_such_socket.sock"), 0);
+}
@@ -0,0 +1,142 @@
+import os
+import tempfile
+import threading
+import unittest
+
+import numpy as np
+import scipy.io
+import scipy.sparse
+
+import solvermarket
+
+MATRICES_DIR = os.environ.get("SOLVER_MARKET_MATRICES_DIR", os.path.join(os.path.dirname(__file__), "..", "matrices"))
+
+
+def random_matrix(n, density, seed, dtype=np.float64):
+    rng = np.random.default_rng(seed)
+    A = scipy.sparse.random(n, n, density=density, format="csr", random_state=rng, dtype=np.float64)
+    if dtype == np.complex128:
+        A = A + 1j * scipy.sparse.random(n, n, density=density, format="csr", random_state=rng)
+        A.sum_duplicates()
+    return (A + scipy.sparse.eye(n, dtype=dtype, format="csr")).tocsr()
+
+
+class SolverMarketPythonTest(unittest.TestCase):
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def path(self, name):
+        return os.path.join(self.dir.name, name)
+
+    def test_matrix_round_trip_against_scipy(self):
+        reference = random_matrix(300, 0.02, 1)
+        solvermarket.write_matrix(self.path("A.mtx"), reference)
+
+        A = solvermarket.read_matrix(self.path("A.mtx"))
+        self.assertEqual(A.shape, (300, 300))
+        self.assertEqual(A.nnz, reference.nnz)
+        self.assertEqual(A.symmetry, "general")
+        self.assertEqual(A.indices.dtype, np.int32)
+
+        loaded = A.to_scipy()
+        self.assertEqual(abs(loaded - reference).max(), 0.0)
+        self.assertEqual(abs(loaded - scipy.io.mmread(self.path("A.mtx")).tocsr()).max(), 0.0)
+
+    def test_arrays_share_memory(self):
+        solvermarket.write_matrix(self.path("A.mtx"), random_matrix(100, 0.05, 2))
+        A = solvermarket.read_matrix(self.path("A.mtx"))
+        data = A.data
+        csr = A.to_scipy()
+        self.assertTrue(np.shares_memory(csr.data, data))
+        self.assertTrue(np.shares_memory(csr.indices, A.indices))
+        self.assertTrue(np.shares_memory(csr.indptr, A.indptr))
+
+        # The arrays keep the matrix alive
+        del A
+        data[0] = 42.0
+        self.assertEqual(csr.data[0], 42.0)
+
+        x = solvermarket.load_vector(os.path.join(MATRICES_DIR, "rhs_51840_coordinate.mtx"))
+        self.assertEqual(x.shape, (51840,))
+        self.assertIsNotNone(x.base)
+
+    def test_symmetric_keeps_the_stored_triangle(self):
+        full = random_matrix(120, 0.05, 3)
+        full = full + full.T
+        lower = scipy.sparse.tril(full).tocsr()
+        solvermarket.write_matrix(self.path("S.mtx"), lower, symmetry="symmetric")
+
+        A = solvermarket.read_matrix(self.path("S.mtx"))
+        self.assertEqual(A.symmetry, "symmetric")
+        self.assertEqual(A.nnz, lower.nnz)
+        self.assertEqual(abs(A.to_scipy() - lower).max(), 0.0)
+        self.assertEqual(abs(scipy.io.mmread(self.path("S.mtx")) - full).max(), 0.0)
+
+    def test_complex(self):
+        reference = random_matrix(80, 0.05, 4, dtype=np.complex128)
+        solvermarket.write_matrix(self.path("C.mtx"), reference)
+        A = solvermarket.read_matrix(self.path("C.mtx"), dtype="complex128")
+        self.assertEqual(A.field, "complex")
+        self.assertEqual(A.data.dtype, np.complex128)
+        self.assertEqual(abs(A.to_scipy() - reference).max(), 0.0)
+
+        with self.assertRaises(RuntimeError):
+            solvermarket.read_matrix(self.path("C.mtx"))
+
+    def test_binary(self):
+        reference = random_matrix(200, 0.03, 5)
+        solvermarket.write_matrix(self.path("A.mtx"), reference)
+        solvermarket.read_matrix(self.path("A.mtx")).write_binary(self.path("A.bin"))
+
+        A = solvermarket.read_binary_matrix(self.path("A.bin"))
+        self.assertTrue(A.shared)
+        self.assertEqual(abs(A.to_scipy() - reference).max(), 0.0)
+
+        values = np.linspace(0.0, 1.0, 17)
+        solvermarket.write_vector(self.path("v.mtx"), values)
+        solvermarket.read_vector(self.path("v.mtx")).write_binary(self.path("v.bin"))
+        self.assertTrue(np.array_equal(solvermarket.read_binary_vector(self.path("v.bin")).values, values))
+
+        # A vector segment is not a matrix
+        with self.assertRaises(RuntimeError):
+            solvermarket.read_binary_matrix(self.path("v.bin"))
+
+    def test_vector_formats(self):
+        values = np.random.default_rng(6).standard_normal(500)
+        for file_format in ("coordinate", "array"):
+            solvermarket.write_vector(self.path("v.mtx"), values, format=file_format)
+            read = scipy.io.mmread(self.path("v.mtx"))
+            dense = read.toarray() if scipy.sparse.issparse(read) else read
+            self.assertTrue(np.array_equal(dense.ravel(), values))
+        solvermarket.write_vector(self.path("v.mtx"), values)
+        self.assertTrue(np.array_equal(solvermarket.load_vector(self.path("v.mtx")), values))
+
+        with self.assertRaises(ValueError):
+            solvermarket.write_vector(self.path("v.mtx"), values, format="dense")
+        with self.assertRaises(RuntimeError):
+            solvermarket.read_vector(self.path("missing.mtx"))
+
+    def test_concurrent_loads(self):
+        references = [random_matrix(400, 0.02, 10 + k) for k in range(4)]
+        for k, reference in enumerate(references):
+            solvermarket.write_matrix(self.path(f"A{k}.mtx"), reference)
+
+        loaded = [None] * len(references)
+
+        def load(k):
+            loaded[k] = solvermarket.load_matrix(self.path(f"A{k}.mtx"))
+
+        threads = [threading.Thread(target=load, args=(k,)) for k in range(len(references))]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        for reference, A in zip(references, loaded):
+            self.assertEqual(abs(A - reference).max(), 0.0)
+
+
+if __name__ == "__main__":
+    unittest.main()
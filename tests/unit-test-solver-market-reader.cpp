@@ -468,6 +468,416 @@ TEST(MatrixReaderTest, UnsortedColumnsWithEmptyRows) {
     ASSERT_EQ(cols(4), 1);
 } 
 
+// n x n matrix, row i holds (i * 7) % 41 entries in scrambled column order (rows > 32 entries included)
+std::string scrambled_matrix(const int n, int& nnz) {
+    std::string body;
+    nnz = 0;
+    for (int i = 0; i < n; i++) {
+        const int len = (i * 7) % 41;
+        for (int k = 0; k < len; k++) {
+            const int j = (k * 37 + i) % n;
+            body += std::to_string(i + 1) + " " + std::to_string(j + 1) + " " + std::to_string(i + 0.001 * j) + "\n";
+            nnz++;
+        }
+    }
+    return "%%MatrixMarket matrix coordinate real general\n% comment\n"
+         + std::to_string(n) + " " + std::to_string(n) + " " + std::to_string(nnz) + "\n" + body;
+}
+
+TEST(SolverMarketCsrMatrixTwoPassReader, MatchesInMemoryReader) {
+    int nnz;
+    write_temp_file("test_two_pass.mtx", scrambled_matrix(97, nnz));
+
+    SolverMarketCSRMatrix<double> reference;
+    reference.setReadMode(SolverMarketReadInMemory);
+    ASSERT_EQ(reference.read_matrix_market_file("test_two_pass.mtx", SolverMarketCSRMatrixFull), 0);
+
+    SolverMarketCSRMatrix<double> matrix;
+    matrix.setReadMode(SolverMarketReadTwoPass);
+    ASSERT_EQ(matrix.read_matrix_market_file("test_two_pass.mtx", SolverMarketCSRMatrixFull), 0);
+
+    ASSERT_EQ(matrix.get_n(), 97u);
+    ASSERT_EQ(matrix.get_nnz(), size_t(nnz));
+    auto offsets = matrix.get_host_offsets(), offsets_ref = reference.get_host_offsets();
+    auto cols = matrix.get_host_columns(), cols_ref = reference.get_host_columns();
+    auto values = matrix.get_host_values(), values_ref = reference.get_host_values();
+    for (size_t i = 0; i < 98; i++) {
+        EXPECT_EQ(offsets(i), offsets_ref(i)) << "Mismatch at offsets[" << i << "]";
+    }
+    for (int k = 0; k < nnz; k++) {
+        EXPECT_EQ(cols(k), cols_ref(k)) << "Mismatch at col[" << k << "]";
+        EXPECT_EQ(values(k), values_ref(k)) << "Mismatch at val[" << k << "]";
+    }
+}
+
+TEST(SolverMarketCsrMatrixTwoPassReader, AutoModeFollowsBudget) {
+    int nnz;
+    write_temp_file("test_two_pass_auto.mtx", scrambled_matrix(50, nnz));
+
+    // Budget between the CSR size and the in memory peak: two pass, same result
+    SolverMarketCSRMatrix<double, int> matrix;
+    matrix.setHostMemoryBudget(50 * 4 + nnz * 12 + 100);
+    ASSERT_EQ(matrix.read_matrix_market_file("test_two_pass_auto.mtx", SolverMarketCSRMatrixFull), 0);
+    EXPECT_EQ(matrix.get_nnz(), nnz);
+
+    auto offsets = matrix.get_host_offsets();
+    auto cols = matrix.get_host_columns();
+    for (int i = 0; i < 50; i++) {
+        for (int k = offsets(i) + 1; k < offsets(i + 1); k++) {
+            EXPECT_LT(cols(k - 1), cols(k)) << "Row " << i << " not sorted";
+        }
+    }
+}
+
+TEST(SolverMarketCsrMatrixTwoPassReader, Errors) {
+    SolverMarketCSRMatrix<double> matrix;
+    matrix.setReadMode(SolverMarketReadTwoPass);
+
+    write_temp_file("test_two_pass_nnz.mtx",
+        "%%MatrixMarket matrix coordinate real general\n"
+        "2 2 3\n"
+        "1 1 1.0\n"
+        "2 2 1.0\n");
+    EXPECT_EQ(matrix.read_matrix_market_file("test_two_pass_nnz.mtx", SolverMarketCSRMatrixFull), MtxReaderErrorWrongNnz);
+
+    write_temp_file("test_two_pass_row.mtx",
+        "%%MatrixMarket matrix coordinate real general\n"
+        "2 2 2\n"
+        "1 1 1.0\n"
+        "3 2 1.0\n");
+    EXPECT_EQ(matrix.read_matrix_market_file("test_two_pass_row.mtx", SolverMarketCSRMatrixFull), MtxReaderErrorOutOfBoundRowIndex);
+
+    write_temp_file("test_two_pass_lower.mtx",
+        "%%MatrixMarket matrix coordinate real general\n"
+        "2 2 2\n"
+        "1 1 1.0\n"
+        "1 2 1.0\n");
+    EXPECT_EQ(matrix.read_matrix_market_file("test_two_pass_lower.mtx", SolverMarketCSRMatrixLower), MtxReaderErrorLowerViewButUpperFound);
+
+    // A header announcing ~24 GB of entries fails on the count, before columns and values exist
+    write_temp_file("test_two_pass_huge.mtx",
+        "%%MatrixMarket matrix coordinate real general\n"
+        "2 2 2000000000\n"
+        "1 1 1.0\n");
+    EXPECT_EQ(matrix.read_matrix_market_file("test_two_pass_huge.mtx", SolverMarketCSRMatrixFull), MtxReaderErrorWrongNnz);
+}
+
+TEST(SolverMarketCsrMatrixReader, InvalidSizeLine) {
+    const std::vector<std::string> size_lines = {
+        "2 3 2",           // not square
+        "2 2",             // no nnz
+        "two 2 2",         // not a number
+        "2 2 3000000000",  // nnz beyond the int index type
+        "-2 -2 1",
+    };
+    for (auto mode : {SolverMarketReadInMemory, SolverMarketReadTwoPass}) {
+        for (const auto& size_line : size_lines) {
+            write_temp_file("test_size_line.mtx",
+                "%%MatrixMarket matrix coordinate real general\n" + size_line + "\n1 1 1.0\n");
+            SolverMarketCSRMatrix<double, int> matrix;
+            matrix.setReadMode(mode);
+            EXPECT_EQ(matrix.read_matrix_market_file("test_size_line.mtx", SolverMarketCSRMatrixFull), MtxReaderErrorInvalidSize)
+                << size_line;
+        }
+    }
+
+    // Within int but not within a 16-bit index type
+    write_temp_file("test_size_line.mtx", "%%MatrixMarket matrix coordinate real general\n40000 40000 1\n1 1 1.0\n");
+    SolverMarketCSRMatrix<double, int16_t> small;
+    EXPECT_EQ(small.read_matrix_market_file("test_size_line.mtx", SolverMarketCSRMatrixFull), MtxReaderErrorInvalidSize);
+}
+
+TEST(SolverMarketCsrMatrixAssembly, SumDuplicatesAndPruneZeros) {
+    std::string content =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 3 9\n"
+        "1 1 1.0\n"
+        "1 3 0.0\n"   // explicit zero
+        "2 2 0.0\n"   // zero diagonal: kept
+        "1 1 2.0\n"   // duplicate of (1,1)
+        "3 1 1e-20\n" // below the tolerance
+        "3 3 5.0\n"
+        "2 1 -1.0\n"
+        "2 1 1.0\n"   // cancels (2,1): pruned after the sum
+        "1 1 0.5\n";
+    write_temp_file("test_assembly.mtx", content);
+
+    SolverMarketAssemblyOptions options;
+    options.sum_duplicates = true;
+    options.drop_tolerance = 1e-14;
+
+    for (auto mode : {SolverMarketReadInMemory, SolverMarketReadTwoPass}) {
+        SolverMarketCSRMatrix<double> matrix;
+        matrix.setReadMode(mode);
+        matrix.setAssemblyOptions(options);
+        ASSERT_EQ(matrix.read_matrix_market_file("test_assembly.mtx", SolverMarketCSRMatrixFull), 0);
+
+        EXPECT_EQ(matrix.get_nnz(), 3u);
+        EXPECT_EQ(matrix.getNumMergedEntries(), 3u);
+        EXPECT_EQ(matrix.getNumPrunedEntries(), 3u);
+
+        auto offsets = matrix.get_host_offsets();
+        auto cols = matrix.get_host_columns();
+        auto values = matrix.get_host_values();
+        ASSERT_EQ(values.extent(0), 3u);
+        const std::vector<size_t> expected_offsets = {0, 1, 2, 3};
+        for (size_t i = 0; i < 4; i++) EXPECT_EQ(offsets(i), expected_offsets[i]);
+        EXPECT_EQ(cols(0), 0u);
+        EXPECT_DOUBLE_EQ(values(0), 3.5);
+        EXPECT_EQ(cols(1), 1u);
+        EXPECT_DOUBLE_EQ(values(1), 0.0);
+        EXPECT_EQ(cols(2), 2u);
+        EXPECT_DOUBLE_EQ(values(2), 5.0);
+    }
+}
+
+TEST(SolverMarketCsrMatrixAssembly, DefaultKeepsEveryEntry) {
+    std::string content =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "2 2 4\n"
+        "1 1 1.0\n"
+        "1 1 2.0\n"
+        "2 2 0.0\n"
+        "1 2 0.0\n";
+    write_temp_file("test_assembly_default.mtx", content);
+
+    SolverMarketCSRMatrix<double> matrix("test_assembly_default.mtx", SolverMarketCSRMatrixFull);
+    EXPECT_EQ(matrix.get_nnz(), 4u);
+    EXPECT_EQ(matrix.getNumMergedEntries(), 0u);
+
+    // Pruning only, diagonal not protected: duplicates stay separate
+    SolverMarketAssemblyOptions options;
+    options.drop_tolerance = 0.0;
+    options.keep_diagonal = false;
+    matrix.setAssemblyOptions(options);
+    ASSERT_EQ(matrix.read_matrix_market_file("test_assembly_default.mtx", SolverMarketCSRMatrixFull), 0);
+    EXPECT_EQ(matrix.get_nnz(), 2u);
+    EXPECT_EQ(matrix.getNumPrunedEntries(), 2u);
+    auto offsets = matrix.get_host_offsets();
+    EXPECT_EQ(offsets(1), 2u);
+    EXPECT_EQ(offsets(2), 2u);
+}
+
+TEST(SolverMarketCsrMatrixAssembly, BuildFromCOOMatchesReader) {
+    std::string content =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "4 4 6\n"
+        "3 2 3.2\n"
+        "1 1 1.0\n"
+        "2 4 2.5\n"
+        "4 4 5.5\n"
+        "2 1 -1.0\n"
+        "3 2 0.5\n";
+    write_temp_file("test_coo.mtx", content);
+
+    SolverMarketAssemblyOptions options;
+    options.sum_duplicates = true;
+    SolverMarketCSRMatrix<double, int> read;
+    read.setAssemblyOptions(options);
+    ASSERT_EQ(read.read_matrix_market_file("test_coo.mtx", SolverMarketCSRMatrixFull), 0);
+
+    std::vector<std::tuple<int, int, double>> entries = {
+        {2, 1, 3.2}, {0, 0, 1.0}, {1, 3, 2.5}, {3, 3, 5.5}, {1, 0, -1.0}, {2, 1, 0.5}};
+    SolverMarketCSRMatrix<double, int> built;
+    built.setAssemblyOptions(options);
+    ASSERT_EQ(built.build_from_coo(4, entries), 0);
+    EXPECT_TRUE(built.isGeneral());
+
+    ASSERT_EQ(built.get_n(), read.get_n());
+    ASSERT_EQ(built.get_nnz(), 5);
+    ASSERT_EQ(built.get_nnz(), read.get_nnz());
+    EXPECT_EQ(built.getNumMergedEntries(), 1u);
+    for (int i = 0; i <= 4; i++) EXPECT_EQ(built.get_host_offsets()(i), read.get_host_offsets()(i));
+    for (int k = 0; k < 5; k++) {
+        EXPECT_EQ(built.get_host_columns()(k), read.get_host_columns()(k));
+        EXPECT_DOUBLE_EQ(built.get_host_values()(k), read.get_host_values()(k));
+    }
+
+    entries.emplace_back(4, 0, 1.0);
+    EXPECT_EQ(built.build_from_coo(4, entries), MtxReaderErrorOutOfBoundRowIndex);
+}
+
+TEST(SolverMarketCsrMatrixFields, PatternAndInteger) {
+    // Pattern: no value column, every entry is 1. Same in both readers
+    write_temp_file("test_pattern.mtx",
+        "%%MatrixMarket matrix coordinate pattern general\n"
+        "3 3 4\n"
+        "3 1\n"
+        "1 1\n"
+        "2 3\n"
+        "1 2\n");
+    for (auto mode : {SolverMarketReadInMemory, SolverMarketReadTwoPass}) {
+        SolverMarketCSRMatrix<double> matrix;
+        matrix.setReadMode(mode);
+        ASSERT_EQ(matrix.read_matrix_market_file("test_pattern.mtx", SolverMarketCSRMatrixFull), 0);
+        EXPECT_EQ(matrix.getField(), SolverMarketFieldPattern);
+        ASSERT_EQ(matrix.get_nnz(), 4);
+        for (int k = 0; k < 4; k++) EXPECT_EQ(matrix.get_host_values()(k), 1.0);
+        EXPECT_EQ(matrix.get_host_columns()(1), 1);
+    }
+
+    write_temp_file("test_integer.mtx",
+        "%%MatrixMarket matrix coordinate integer general\n"
+        "2 2 2\n"
+        "1 1 -7\n"
+        "2 2 12\n");
+    SolverMarketCSRMatrix<int> integers;
+    ASSERT_EQ(integers.read_matrix_market_file("test_integer.mtx", SolverMarketCSRMatrixFull), 0);
+    EXPECT_EQ(integers.get_host_values()(0), -7);
+    EXPECT_EQ(integers.get_host_values()(1), 12);
+
+    // A fraction is not an integer
+    write_temp_file("test_integer_fraction.mtx",
+        "%%MatrixMarket matrix coordinate integer general\n"
+        "2 2 2\n"
+        "1 1 -7\n"
+        "2 2 1.5\n");
+    SolverMarketCSRMatrix<double> fraction;
+    EXPECT_EQ(fraction.read_matrix_market_file("test_integer_fraction.mtx", SolverMarketCSRMatrixFull), MtxReaderErrorInvalidEntry);
+
+    write_temp_file("test_unknown_field.mtx",
+        "%%MatrixMarket matrix coordinate quaternion general\n"
+        "1 1 1\n"
+        "1 1 1\n");
+    EXPECT_EQ(fraction.read_matrix_market_file("test_unknown_field.mtx", SolverMarketCSRMatrixFull), MtxReaderUnsupportedField);
+}
+
+TEST(SolverMarketCsrMatrixFields, ComplexAndHermitian) {
+    const std::string content =
+        "%%MatrixMarket matrix coordinate complex hermitian\n"
+        "2 2 3\n"
+        "1 1 2.0 0.0\n"
+        "2 1 0.5 -1.5\n"
+        "2 2 3.0 0\n";
+    write_temp_file("test_complex.mtx", content);
+
+    // Real storage cannot hold it
+    SolverMarketCSRMatrix<double> real;
+    EXPECT_EQ(real.read_matrix_market_file("test_complex.mtx", SolverMarketCSRMatrixLower), MtxReaderUnsupportedField);
+
+    using Complex = Kokkos::complex<double>;
+    for (auto mode : {SolverMarketReadInMemory, SolverMarketReadTwoPass}) {
+        SolverMarketCSRMatrix<Complex> matrix;
+        matrix.setReadMode(mode);
+        ASSERT_EQ(matrix.read_matrix_market_file("test_complex.mtx", SolverMarketCSRMatrixLower), 0);
+        EXPECT_TRUE(matrix.isHermitian());
+        EXPECT_EQ(matrix.getField(), SolverMarketFieldComplex);
+        ASSERT_EQ(matrix.get_nnz(), 3);
+        EXPECT_EQ(matrix.get_host_values()(1), Complex(0.5, -1.5));
+        EXPECT_EQ(matrix.get_host_values()(2), Complex(3.0, 0.0));
+    }
+
+    // Written back with the same banner and values
+    SolverMarketCSRMatrix<Complex> matrix;
+    ASSERT_EQ(matrix.read_matrix_market_file("test_complex.mtx", SolverMarketCSRMatrixLower), 0);
+    ASSERT_EQ(matrix.write_matrix_market_file("test_complex_out.mtx"), 0);
+    std::ifstream written("test_complex_out.mtx");
+    std::string banner, size, entry;
+    std::getline(written, banner);
+    std::getline(written, size);
+    std::getline(written, entry);
+    std::getline(written, entry);
+    EXPECT_EQ(banner, "%%MatrixMarket matrix coordinate complex hermitian");
+    EXPECT_EQ(entry, "2 1 0.5 -1.5");
+
+    // A real file goes into complex storage with a zero imaginary part
+    SolverMarketCSRMatrix<Complex> promoted;
+    write_temp_file("test_real_to_complex.mtx",
+        "%%MatrixMarket matrix coordinate real general\n"
+        "1 1 1\n"
+        "1 1 4.5\n");
+    ASSERT_EQ(promoted.read_matrix_market_file("test_real_to_complex.mtx", SolverMarketCSRMatrixFull), 0);
+    EXPECT_EQ(promoted.get_host_values()(0), Complex(4.5, 0.0));
+}
+
+TEST(SolverMarketCsrMatrixFields, SkewSymmetric) {
+    write_temp_file("test_skew.mtx",
+        "%%MatrixMarket matrix coordinate real skew-symmetric\n"
+        "3 3 2\n"
+        "2 1 1.5\n"
+        "3 2 -4\n");
+    SolverMarketCSRMatrix<double> matrix;
+    ASSERT_EQ(matrix.read_matrix_market_file("test_skew.mtx", SolverMarketCSRMatrixLower), 0);
+    EXPECT_TRUE(matrix.isSkewSymmetric());
+    EXPECT_FALSE(matrix.isSymmetric());
+
+    // Array format: strictly lower triangle, column by column
+    ASSERT_EQ(matrix.write_matrix_market_file("test_skew_array.mtx", SolverMarketFileArray), 0);
+    std::ifstream written("test_skew_array.mtx");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(written, line)) lines.push_back(line);
+    ASSERT_EQ(lines.size(), 5u);
+    EXPECT_EQ(lines[0], "%%MatrixMarket matrix array real skew-symmetric");
+    EXPECT_EQ(lines[2], "1.5");
+    EXPECT_EQ(lines[3], "0");
+    EXPECT_EQ(lines[4], "-4");
+}
+
+TEST(SolverMarketMemory, PeakRSS) {
+    EXPECT_GT(SolverMarketCurrentRSS(), 0u);
+    EXPECT_GE(SolverMarketPeakRSS(), SolverMarketCurrentRSS());
+}
+
+TEST(SolverMarketMemory, NestedRegions) {
+    auto& memory = SolverMarketMemory::instance();
+    memory.set_enabled(true);
+    memory.clear();
+    {
+        SolverMarketMemoryRegion outer("outer");
+        HostView<double> kept("memory_test_kept", 1 << 20);
+        {
+            SolverMarketMemoryRegion inner("inner");
+            HostView<double> scratch("memory_test_scratch", 1 << 18);
+        }
+    }
+    SolverMarketMemorySample outer, inner;
+    ASSERT_TRUE(memory.sample("outer", outer));
+    ASSERT_TRUE(memory.sample("inner", inner));
+    EXPECT_GE(inner.host_allocated, sizeof(double) << 18);
+    EXPECT_GE(outer.host_allocated, (sizeof(double) << 20) + (sizeof(double) << 18));
+    // kept is live while scratch is allocated
+    EXPECT_GE(inner.host_peak, (sizeof(double) << 20) + (sizeof(double) << 18));
+    EXPECT_GE(outer.host_peak, inner.host_peak);
+    EXPECT_GT(outer.rss_peak, 0u);
+
+    const std::string summary = memory.summary();
+    EXPECT_NE(summary.find("inner:rss_peak_mb="), std::string::npos) << summary;
+    EXPECT_NE(summary.find(";outer:rss_peak_mb="), std::string::npos) << summary;
+    memory.erase("inner");
+    EXPECT_FALSE(memory.sample("inner", inner));
+    EXPECT_TRUE(memory.sample("outer", outer));
+
+    memory.set_enabled(false);
+    EXPECT_EQ(memory.summary(), "");
+}
+
+TEST(SolverMarketMemory, PhasesOfARead) {
+    // Empty pool: the read allocates its buffers
+    SolverMarketBufferPool::instance().clear();
+    std::string content = "%%MatrixMarket matrix coordinate real general\n37 37 37\n";
+    for (int i = 1; i <= 37; i++) content += std::to_string(i) + " " + std::to_string(i) + " 2.0\n";
+    write_temp_file("test_memory.mtx", content);
+
+    auto& memory = SolverMarketMemory::instance();
+    memory.set_enabled(true);
+    memory.clear();
+    SolverMarketCSRMatrix<double> matrix;
+    ASSERT_EQ(matrix.read_matrix_market_file("test_memory.mtx", SolverMarketCSRMatrixFull), 0);
+    matrix.send_to_device();
+    memory.set_enabled(false);
+
+    SolverMarketMemorySample read, assemble, upload;
+    ASSERT_TRUE(memory.sample("read", read));
+    ASSERT_TRUE(memory.sample("assemble", assemble));
+    ASSERT_TRUE(memory.sample("upload", upload));
+    const size_t csr_bytes = 38 * sizeof(int) + 37 * (sizeof(int) + sizeof(double));
+    EXPECT_GE(read.host_allocated, csr_bytes);
+    EXPECT_GE(read.host_peak, csr_bytes);
+    EXPECT_GE(read.host_allocated, assemble.host_allocated);
+    EXPECT_GE(upload.host_peak, csr_bytes);
+}
+
 TEST(SolverMarketVectorReader, BasicVectorRead) {
     std::string content =
         "%%MatrixMarket matrix coordinate real general\n"
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#define GTEST_
+#include "solver-market-scaling.hpp"
+#include "solver-market-generators.hpp"
+#include "solver-market-krylov.hpp"
+
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+using Matrix = SolverMarketCSRMatrix<double, int>;
+using Vector = SolverMarketVector<double, int>;
+using Scaling = SolverMarketScaling<double, int>;
+
+// Row (or column) max |a_ij| of the host CSR
+std::vector<double> max_norms(Matrix& A, const bool by_column) {
+    std::vector<double> norms(A.get_n(), 0.0);
+    auto offsets = A.get_host_offsets();
+    auto columns = A.get_host_columns();
+    auto values = A.get_host_values();
+    for (int i = 0; i < A.get_n(); i++)
+        for (int k = offsets(i); k < offsets(i + 1); k++) {
+            double& norm = norms[by_column ? columns(k) : i];
+            norm = std::max(norm, std::abs(values(k)));
+        }
+    return norms;
+}
+
+// CG without preconditioner on the host CSR, x from 0
+SolverMarketKrylovResult solve(Matrix& A, Vector& b, Vector& x) {
+    A.send_to_device();
+    b.send_to_device();
+    x = Vector(A.get_n(), 0.0);
+    x.send_to_device();
+    DeviceView<double> b_view(b.get_device_values_pointer(), b.get_n());
+    DeviceView<double> x_view(x.get_device_values_pointer(), x.get_n());
+    SolverMarketIdentityPreconditioner identity;
+    auto result = SolverMarketPCG(SolverMarketDeviceCSR<double, int>::wrap(A), b_view, x_view, identity, 1e-10, 5000);
+    x.send_to_host();
+    return result;
+}
+
+TEST(SolverMarketScaling, ParsesMethods) {
+    SolverMarketScalingMethod method = SolverMarketScalingNone;
+    EXPECT_EQ(SolverMarketParseScaling("ruiz", method), 0);
+    EXPECT_EQ(method, SolverMarketScalingRuiz);
+    EXPECT_EQ(SolverMarketParseScaling("jacobi", method), 0);
+    EXPECT_STREQ(SolverMarketScalingName(method), "jacobi");
+    EXPECT_EQ(SolverMarketParseScaling("row", method), 1);
+}
+
+TEST(SolverMarketScaling, JacobiGivesAUnitDiagonal) {
+    Matrix A;
+    ASSERT_EQ(SolverMarketGenerate("jump3d:n=8,blocks=2,contrast=1e8", A), 0);
+    Scaling scaling(SolverMarketScalingJacobi);
+    ASSERT_EQ(scaling.apply(A), 0);
+    EXPECT_EQ(scaling.row_scale(), scaling.col_scale());
+
+    auto offsets = A.get_host_offsets();
+    auto columns = A.get_host_columns();
+    auto values = A.get_host_values();
+    for (int i = 0; i < A.get_n(); i++)
+        for (int k = offsets(i); k < offsets(i + 1); k++) {
+            if (columns(k) != i) continue;
+            EXPECT_NEAR(values(k), 1.0, 1e-12) << "row " << i;
+        }
+}
+
+TEST(SolverMarketScaling, RuizEquilibratesRowsAndColumns) {
+    // Rows and columns scaled by 10^(+-4): a general, badly scaled matrix
+    Matrix A;
+    ASSERT_EQ(SolverMarketGenerate("laplace2d:n=10", A), 0);
+    auto offsets = A.get_host_offsets();
+    auto columns = A.get_host_columns();
+    auto values = A.get_host_values();
+    for (int i = 0; i < A.get_n(); i++)
+        for (int k = offsets(i); k < offsets(i + 1); k++) values(k) *= std::pow(10.0, i % 9 - 4) * std::pow(10.0, 4 - columns(k) % 7);
+
+    Scaling scaling(SolverMarketScalingRuiz, 50, 1e-3);
+    ASSERT_EQ(scaling.apply(A), 0);
+    EXPECT_LE(scaling.deviation(), 1e-3);
+    EXPECT_LT(scaling.iterations(), 50);
+    for (const bool by_column : {false, true}) {
+        auto norms = max_norms(A, by_column);
+        for (int i = 0; i < A.get_n(); i++) EXPECT_NEAR(norms[i], 1.0, 2e-3) << (by_column ? "column " : "row ") << i;
+    }
+
+    // Symmetric input: one scale for rows and columns, the result stays symmetric
+    Matrix S;
+    ASSERT_EQ(SolverMarketGenerate("jump3d:n=6,blocks=2,contrast=1e6", S), 0);
+    Scaling symmetric(SolverMarketScalingRuiz);
+    ASSERT_EQ(symmetric.apply(S), 0);
+    EXPECT_EQ(symmetric.row_scale(), symmetric.col_scale());
+}
+
+TEST(SolverMarketScaling, SolutionOfTheScaledSystemSolvesTheOriginalOne) {
+    const char* spec = "jump3d:n=10,blocks=2,contrast=1e8";
+    Matrix A, A_scaled;
+    ASSERT_EQ(SolverMarketGenerate(spec, A), 0);
+    ASSERT_EQ(SolverMarketGenerate(spec, A_scaled), 0);
+
+    Vector b(A.get_n(), 1.0), x;
+    auto plain = solve(A, b, x);
+
+    for (auto method : {SolverMarketScalingJacobi, SolverMarketScalingRuiz}) {
+        ASSERT_EQ(SolverMarketGenerate(spec, A_scaled), 0);
+        Scaling scaling(method);
+        ASSERT_EQ(scaling.apply(A_scaled), 0);
+        Vector b_scaled(A.get_n(), 1.0), y;
+        ASSERT_EQ(scaling.scale_rhs(b_scaled), 0);
+        auto scaled = solve(A_scaled, b_scaled, y);
+        ASSERT_TRUE(scaled.converged);
+        EXPECT_LT(scaled.iterations, plain.iterations) << SolverMarketScalingName(method);
+        ASSERT_EQ(scaling.unscale_solution(y), 0);
+
+        // ||b - A x|| / ||b|| on the original system (scaled tolerance 1e-10, jumps 1e8)
+        auto offsets = A.get_host_offsets();
+        auto columns = A.get_host_columns();
+        auto values = A.get_host_values();
+        double residual = 0;
+        for (int i = 0; i < A.get_n(); i++) {
+            double r = 1.0;
+            for (int k = offsets(i); k < offsets(i + 1); k++) r -= values(k) * y.get_host_values_pointer()[columns(k)];
+            residual += r * r;
+        }
+        EXPECT_LT(std::sqrt(residual / A.get_n()), 1e-4) << SolverMarketScalingName(method);
+    }
+
+    Vector wrong(3, 1.0);
+    Scaling scaling(SolverMarketScalingJacobi);
+    ASSERT_EQ(scaling.apply(A), 0);
+    EXPECT_EQ(scaling.scale_rhs(wrong), 1);
+}
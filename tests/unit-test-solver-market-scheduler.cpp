@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "solver-market-scheduler.hpp"
+
+
+static std::string read_file(const std::string& filename) {
+    std::ifstream in(filename);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+TEST(SolverMarketScheduler, CpuListsAndPartition) {
+    const std::vector<int> cpus = SolverMarketParseCpuList("0-3,8,10-11");
+    EXPECT_EQ(cpus, std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(SolverMarketCpuListString(cpus), "0-3,8,10-11");
+
+    // 7 cpus in 3 blocks: 3 + 2 + 2, contiguous and disjoint
+    const auto blocks = SolverMarketPartitionCpus(cpus, 3);
+    ASSERT_EQ(blocks.size(), 3u);
+    EXPECT_EQ(blocks[0], std::vector<int>({0, 1, 2}));
+    EXPECT_EQ(blocks[1], std::vector<int>({3, 8}));
+    EXPECT_EQ(blocks[2], std::vector<int>({10, 11}));
+    // Never more blocks than cpus
+    EXPECT_EQ(SolverMarketPartitionCpus(cpus, 16).size(), cpus.size());
+    EXPECT_TRUE(SolverMarketPartitionCpus(std::vector<int>(), 2).empty());
+}
+
+TEST(SolverMarketScheduler, SiblingsStayTogether) {
+    // Two sockets of two cores with SMT: cpu n and n + 4 share a core
+    const std::string sysfs = "test_scheduler_sysfs";
+    ::mkdir(sysfs.c_str(), 0755);
+    for (int cpu = 0; cpu < 8; cpu++) {
+        const std::string dir = sysfs + "/cpu" + std::to_string(cpu);
+        ::mkdir(dir.c_str(), 0755);
+        ::mkdir((dir + "/topology").c_str(), 0755);
+        std::ofstream(dir + "/topology/physical_package_id") << (cpu % 4) / 2 << "\n";
+        std::ofstream(dir + "/topology/core_id") << cpu % 2 << "\n";
+    }
+    const auto ordered = SolverMarketOrderCpus(SolverMarketParseCpuList("0-7"), sysfs);
+    EXPECT_EQ(ordered, std::vector<int>({0, 4, 1, 5, 2, 6, 3, 7}));
+    // Two jobs: one socket each
+    const auto blocks = SolverMarketPartitionCpus(ordered, 2);
+    EXPECT_EQ(blocks[0], std::vector<int>({0, 4, 1, 5}));
+    EXPECT_EQ(blocks[1], std::vector<int>({2, 6, 3, 7}));
+}
+
+TEST(SolverMarketScheduler, BestConcurrency) {
+    // Jobs per second: 1/10, 2/6, 4/8, 8/17: 4 at a time is best
+    EXPECT_EQ(SolverMarketBestConcurrency({{1, 10.0}, {2, 6.0}, {4, 8.0}, {8, 17.0}}), 4);
+    // 8 at a time is within 5% of 4 at a time: the lower one is kept
+    EXPECT_EQ(SolverMarketBestConcurrency({{1, 10.0}, {4, 8.0}, {8, 16.4}}), 4);
+    // No gain from running together (bandwidth bound)
+    EXPECT_EQ(SolverMarketBestConcurrency({{1, 1.0}, {2, 2.0}, {4, 4.0}}), 1);
+    EXPECT_EQ(SolverMarketBestConcurrency({}), 1);
+}
+
+TEST(SolverMarketScheduler, ReadJobFile) {
+    std::ofstream("test_jobs.txt") << "# matrix  rhs  backend\n"
+                                   << "--matrix=a.mtx --backends=native --native-config=p.txt\n"
+                                   << "\n"
+                                   << "AMGX_input_deck --matrix=b.mtx --config=c.json  # full command\n";
+    std::vector<SolverMarketBatchJob> jobs;
+    ASSERT_EQ(SolverMarketReadBatchJobs("test_jobs.txt", "./solver_market_driver", jobs), SolverMarketSchedulerSuccess);
+    ASSERT_EQ(jobs.size(), 2u);
+    EXPECT_EQ(jobs[0].name, "job-2");
+    EXPECT_EQ(jobs[0].args, std::vector<std::string>({"./solver_market_driver", "--matrix=a.mtx", "--backends=native", "--native-config=p.txt"}));
+    EXPECT_EQ(jobs[1].name, "job-4");
+    EXPECT_EQ(jobs[1].args, std::vector<std::string>({"AMGX_input_deck", "--matrix=b.mtx", "--config=c.json"}));
+
+    std::ofstream("test_jobs_empty.txt") << "# nothing\n";
+    jobs.clear();
+    EXPECT_EQ(SolverMarketReadBatchJobs("test_jobs_empty.txt", "driver", jobs), SolverMarketSchedulerErrorJobFile);
+    EXPECT_EQ(SolverMarketReadBatchJobs("test_jobs_missing.txt", "driver", jobs), SolverMarketSchedulerErrorJobFile);
+}
+
+TEST(SolverMarketScheduler, JobsArePinnedToTheirBlock) {
+    const std::vector<int> cpus = SolverMarketAvailableCpus();
+    ASSERT_FALSE(cpus.empty());
+    const int concurrency = std::min<int>(2, int(cpus.size()));
+
+    std::vector<SolverMarketBatchJob> jobs;
+    for (int i = 0; i < 4; i++) {
+        jobs.push_back({"pinned-" + std::to_string(i),
+                        {"sh", "-c", "grep Cpus_allowed_list /proc/self/status; echo threads=$OMP_NUM_THREADS bind=$OMP_PROC_BIND"}});
+    }
+    jobs.push_back({"failing", {"sh", "-c", "exit 3"}});
+    jobs.push_back({"missing", {"./no-such-executable"}});
+
+    SolverMarketScheduler scheduler(cpus, "test-batch-logs");
+    std::vector<SolverMarketBatchResult> results;
+    scheduler.run(jobs, concurrency, results, false);
+    ASSERT_EQ(results.size(), jobs.size());
+
+    const auto blocks = SolverMarketPartitionCpus(cpus, concurrency);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(results[i].exit_code, 0);
+        EXPECT_TRUE(results[i].cpus == blocks[0] || results[i].cpus == blocks[1 % blocks.size()]);
+        const std::string log = read_file(results[i].log_file);
+        std::vector<int> sorted = results[i].cpus;
+        std::sort(sorted.begin(), sorted.end());
+        EXPECT_NE(log.find(SolverMarketCpuListString(sorted)), std::string::npos) << log;
+        EXPECT_NE(log.find("threads=" + std::to_string(results[i].cpus.size()) + " bind=close"), std::string::npos) << log;
+    }
+    EXPECT_EQ(results[4].exit_code, 3);
+    EXPECT_EQ(results[5].exit_code, 127);
+}
+
+TEST(SolverMarketScheduler, JobsRunSideBySide) {
+    // Two slots (on the same cpu if there is only one): 4 jobs of 0.3 s take ~0.6 s, not 1.2 s
+    std::vector<int> cpus = SolverMarketAvailableCpus();
+    ASSERT_FALSE(cpus.empty());
+    if (cpus.size() == 1) cpus.push_back(cpus[0]);
+
+    std::vector<SolverMarketBatchJob> jobs(4, SolverMarketBatchJob{"", {"sleep", "0.3"}});
+    for (int i = 0; i < 4; i++) jobs[i].name = "sleep-" + std::to_string(i);
+    SolverMarketScheduler scheduler(cpus, "test-batch-logs");
+    std::vector<SolverMarketBatchResult> results;
+    const double seconds = scheduler.run(jobs, 2, results, false);
+    EXPECT_GE(seconds, 0.55);
+    EXPECT_LT(seconds, 1.0);
+
+    const auto makespans = scheduler.calibrate(jobs[0], 2);
+    ASSERT_EQ(makespans.size(), 2u);
+    EXPECT_EQ(SolverMarketBestConcurrency(makespans), 2);
+}
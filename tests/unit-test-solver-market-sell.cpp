@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#define GTEST_
+#include "solver-market-generators.hpp"
+#include "solver-market-krylov.hpp"
+#include "solver-market-sell.hpp"
+
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+using Matrix = SolverMarketCSRMatrix<double, int>;
+using DeviceCSR = SolverMarketDeviceCSR<double, int>;
+
+std::vector<double> to_host(const DeviceView<double>& v) {
+    std::vector<double> h(v.extent(0));
+    Kokkos::deep_copy(HostView<double>(h.data(), h.size()), v);
+    return h;
+}
+
+DeviceView<double> ramp(const size_t n) {
+    DeviceView<double> x("x", n);
+    Kokkos::parallel_for("ramp", Kokkos::RangePolicy<Device>(0, n), KOKKOS_LAMBDA(const size_t i) {
+        x(i) = 1.0 + 0.001 * double(i % 997);
+    });
+    return x;
+}
+
+TEST(SolverMarketSELL, SpMVMatchesCSR) {
+    Matrix M;
+    ASSERT_EQ(SolverMarketGenerate("randomspd:n=1001,row_nnz=12,skew=0.7", M), SolverMarketGeneratorSuccess);
+    M.send_to_device();
+    const auto A = DeviceCSR::wrap(M);
+    const auto x = ramp(A.n_cols);
+
+    DeviceView<double> y_csr("y_csr", A.n_rows);
+    SolverMarketSpMV(A, x, y_csr);
+    const auto expected = to_host(y_csr);
+
+    // Partial last chunk, no sorting, sorting within windows, global sorting
+    for (int chunk : {1, 4, 8, 7}) {
+        for (int sigma : {1, 64, 1001}) {
+            const auto S = SolverMarketToSELL(A, chunk, sigma);
+            EXPECT_EQ(S.nnz(), A.nnz());
+            EXPECT_GE(S.padded(), A.nnz());
+            DeviceView<double> y("y", A.n_rows);
+            Kokkos::deep_copy(y, 2.0);
+            SolverMarketSpMV(S, x, y, 2.0, 0.5);
+            const auto got = to_host(y);
+            for (int i = 0; i < A.n_rows; i++) {
+                ASSERT_NEAR(got[i], 2.0 * expected[i] + 1.0, 1e-10 * std::abs(expected[i]) + 1e-12)
+                    << "row " << i << " C=" << chunk << " sigma=" << sigma;
+            }
+        }
+    }
+}
+
+TEST(SolverMarketSELL, TrailingEmptyRows) {
+    // Sorted by length, the empty rows form zero-width chunks at the end of the slots
+    const int n = 20;
+    std::vector<std::tuple<int, int, double>> entries;
+    for (int i = 0; i < 10; i++) {
+        entries.emplace_back(i, i, 2.0 + i);
+        if (i % 3 == 0) entries.emplace_back(i, (i + 7) % n, -1.0);
+    }
+    Matrix M;
+    ASSERT_EQ(M.build_from_coo(n, entries), 0);
+    M.send_to_device();
+    const auto A = DeviceCSR::wrap(M);
+    const auto x = ramp(n);
+
+    DeviceView<double> y_csr("y_csr", n);
+    SolverMarketSpMV(A, x, y_csr);
+    const auto expected = to_host(y_csr);
+    for (int chunk : {1, 4, 8}) {
+        const auto S = SolverMarketToSELL(A, chunk, n);
+        EXPECT_EQ(S.nnz(), A.nnz());
+        DeviceView<double> y("y", n);
+        Kokkos::deep_copy(y, 3.0);
+        SolverMarketSpMV(S, x, y);
+        const auto got = to_host(y);
+        for (int i = 0; i < n; i++) ASSERT_DOUBLE_EQ(got[i], expected[i]) << "row " << i << " C=" << chunk;
+    }
+}
+
+TEST(SolverMarketSELL, SortingReducesPadding) {
+    Matrix M;
+    ASSERT_EQ(SolverMarketGenerate("randomspd:n=4096,row_nnz=16,skew=0.6", M), SolverMarketGeneratorSuccess);
+    M.send_to_device();
+    const auto A = DeviceCSR::wrap(M);
+
+    const auto unsorted = SolverMarketToSELL(A, 8, 1);
+    const auto windowed = SolverMarketToSELL(A, 8, 256);
+    const auto global = SolverMarketToSELL(A, 8, 4096);
+    EXPECT_LT(windowed.padding_overhead(), unsorted.padding_overhead());
+    EXPECT_LE(global.padding_overhead(), windowed.padding_overhead());
+
+    // Regular rows: no padding but at the boundary rows
+    Matrix L;
+    ASSERT_EQ(SolverMarketGenerate("laplace2d:n=64", L), SolverMarketGeneratorSuccess);
+    L.send_to_device();
+    EXPECT_LT(SolverMarketToSELL(DeviceCSR::wrap(L), 8, 64 * 64).padding_overhead(), 0.01);
+}
+
+TEST(SolverMarketSELL, Selector) {
+    // Uniform short rows that fill the SIMD lanes badly in CSR: SELL
+    Matrix L;
+    ASSERT_EQ(SolverMarketGenerate("laplace3d:n=16", L), SolverMarketGeneratorSuccess);
+    L.send_to_device();
+    auto report = SolverMarketSelectFormat(DeviceCSR::wrap(L), 8, 0);
+    EXPECT_EQ(report.format, SolverMarketSpMVSELL) << report.summary() << " " << report.reason;
+    EXPECT_NEAR(report.row_mean, double(L.get_nnz()) / L.get_n(), 1e-12);
+    EXPECT_LT(report.padding_overhead, 0.05);
+
+    // Asking for a gain SELL cannot reach: CSR
+    report = SolverMarketSelectFormat(DeviceCSR::wrap(L), 8, 0, 0.25, 10.0);
+    EXPECT_EQ(report.format, SolverMarketSpMVCSR);
+
+    // Heavy tail: the padding of the long rows is not worth it
+    Matrix R;
+    ASSERT_EQ(SolverMarketGenerate("randomspd:n=4096,row_nnz=16,skew=0.9", R), SolverMarketGeneratorSuccess);
+    R.send_to_device();
+    report = SolverMarketSelectFormat(DeviceCSR::wrap(R), 8, 8);
+    EXPECT_GT(report.row_cv(), 1.0);
+    EXPECT_GT(report.padding_overhead, 0.25);
+    EXPECT_EQ(report.format, SolverMarketSpMVCSR) << report.summary();
+
+    // Measured conversion and SpMV times
+    const auto S = SolverMarketMeasureFormat(DeviceCSR::wrap(L), report, 5);
+    EXPECT_EQ(S.nnz(), size_t(L.get_nnz()));
+    EXPECT_GE(report.conversion_ms, 0.0);
+    EXPECT_GT(report.csr_spmv_ms, 0.0);
+    EXPECT_GT(report.sell_spmv_ms, 0.0);
+    EXPECT_NE(report.summary().find("break_even_spmvs="), std::string::npos);
+}
+
+TEST(SolverMarketSELL, ConjugateGradient) {
+    Matrix M;
+    ASSERT_EQ(SolverMarketGenerate("randomspd:n=2000,row_nnz=10,skew=0.5", M), SolverMarketGeneratorSuccess);
+    M.send_to_device();
+    const auto A = DeviceCSR::wrap(M);
+    const auto S = SolverMarketToSELL(A);
+    SolverMarketJacobiPreconditioner<double> jacobi(A);
+    const auto b = ramp(A.n_rows);
+
+    DeviceView<double> x_csr("x_csr", A.n_rows), x_sell("x_sell", A.n_rows);
+    const auto csr = SolverMarketPCG(A, b, x_csr, jacobi, 1e-10, 500);
+    const auto sell = SolverMarketPCG(S, b, x_sell, jacobi, 1e-10, 500);
+    ASSERT_TRUE(csr.converged);
+    ASSERT_TRUE(sell.converged);
+    EXPECT_NEAR(sell.iterations, csr.iterations, 1);
+
+    const auto h_csr = to_host(x_csr), h_sell = to_host(x_sell);
+    for (size_t i = 0; i < h_csr.size(); i++) ASSERT_NEAR(h_sell[i], h_csr[i], 1e-8) << "row " << i;
+}
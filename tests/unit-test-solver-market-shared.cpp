@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define GTEST_
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-vector.hpp"
+#include "solver-market-shared.hpp"
+
+
+void write_temp_file(const std::string& filename, const std::string& content) {
+    std::ofstream out(filename);
+    out << content;
+    out.close();
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+// 3x3 CSR {{1,0,2},{0,3,0},{4,0,5}} written by a "producer" into a segment
+void fill_matrix(SolverMarketSharedSegment& segment) {
+    const std::vector<int> offsets = {0, 2, 3, 5};
+    const std::vector<int> columns = {0, 2, 1, 0, 2};
+    const std::vector<double> values = {1.0, 2.0, 3.0, 4.0, 5.0};
+    std::copy(offsets.begin(), offsets.end(), segment.offsets<int>());
+    std::copy(columns.begin(), columns.end(), segment.columns<int>());
+    std::copy(values.begin(), values.end(), segment.values<double>());
+}
+
+void expect_matrix(SolverMarketCSRMatrix<double, int>& matrix) {
+    ASSERT_EQ(matrix.get_n(), 3);
+    ASSERT_EQ(matrix.get_nnz(), 5);
+    auto offsets = matrix.get_host_offsets();
+    auto columns = matrix.get_host_columns();
+    auto values = matrix.get_host_values();
+    EXPECT_EQ(offsets(3), 5);
+    EXPECT_EQ(columns(1), 2);
+    EXPECT_DOUBLE_EQ(values(4), 5.0);
+
+    // The upload is the one copy
+    ASSERT_EQ(matrix.send_to_device(), 0);
+    auto device_values = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), matrix.get_device_values());
+    EXPECT_DOUBLE_EQ(device_values(3), 4.0);
+}
+
+TEST(SolverMarketShared, PosixSegmentIsWrappedWithoutCopy) {
+    const std::string name = "/solver_market_test_" + std::to_string(::getpid());
+    SolverMarketSharedSegment producer;
+    ASSERT_EQ(producer.create_shared(name, SolverMarketSharedMatrix, 3, 5, sizeof(int), sizeof(double)), SolverMarketSharedSuccess);
+    fill_matrix(producer);
+
+    SolverMarketCSRMatrix<double, int> matrix;
+    ASSERT_EQ(matrix.read_shared_memory(name), SolverMarketSharedSuccess);
+    producer.unlink();
+    EXPECT_TRUE(matrix.isShared());
+    EXPECT_TRUE(matrix.isFull());
+    EXPECT_TRUE(matrix.isGeneral());
+    expect_matrix(matrix);
+
+    // Arrays are aligned for the Views
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(matrix.get_host_values_pointer()) % SolverMarketSharedAlignment, 0u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(matrix.get_host_columns_pointer()) % SolverMarketSharedAlignment, 0u);
+
+    // Private mapping: the consumer writing to its Views leaves the producer's data alone
+    matrix.get_host_values()(0) = -1.0;
+    EXPECT_DOUBLE_EQ(producer.values<double>()[0], 1.0);
+}
+
+TEST(SolverMarketShared, MemfdPassedOverSocketAndKeptAlive) {
+    int sockets[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+
+    SolverMarketSharedSegment producer;
+    ASSERT_EQ(producer.create_memfd("matrix", SolverMarketSharedMatrix, 3, 5, sizeof(int), sizeof(double)), SolverMarketSharedSuccess);
+    fill_matrix(producer);
+    ASSERT_TRUE(SolverMarketSendFd(sockets[0], producer.fd()));
+    producer.close();
+
+    SolverMarketCSRMatrix<double, int> copy;
+    {
+        auto segment = std::make_shared<SolverMarketSharedSegment>();
+        ASSERT_EQ(segment->open_fd(SolverMarketRecvFd(sockets[1])), SolverMarketSharedSuccess);
+        SolverMarketCSRMatrix<double, int> matrix;
+        ASSERT_EQ(matrix.attach_shared_segment(segment), SolverMarketSharedSuccess);
+        copy = matrix;
+    }
+    // Segment and first matrix are gone, the copy still holds the mapping
+    expect_matrix(copy);
+    ::close(sockets[0]);
+    ::close(sockets[1]);
+}
+
+TEST(SolverMarketShared, BinaryFileRoundTrip) {
+    write_temp_file("test_shared.mtx",
+        "%%MatrixMarket matrix coordinate real symmetric\n"
+        "3 3 4\n"
+        "1 1 2.0\n"
+        "2 1 -1.0\n"
+        "2 2 2.0\n"
+        "3 3 0.5\n");
+    SolverMarketCSRMatrix<double, int> text("test_shared.mtx", SolverMarketCSRMatrixLower);
+    ASSERT_EQ(text.write_binary_file("test_shared.csr"), MtxWriterSuccess);
+
+    SolverMarketCSRMatrix<double, int> binary;
+    ASSERT_EQ(binary.read_binary_file("test_shared.csr"), SolverMarketSharedSuccess);
+    EXPECT_EQ(binary.getView(), text.getView());
+    EXPECT_EQ(binary.getType(), text.getType());
+    ASSERT_EQ(binary.get_nnz(), text.get_nnz());
+    for (int k = 0; k < text.get_nnz(); k++) {
+        EXPECT_EQ(binary.get_host_columns()(k), text.get_host_columns()(k));
+        EXPECT_EQ(binary.get_host_values()(k), text.get_host_values()(k));
+    }
+
+    // Reading a text file into the same object drops the mapping
+    ASSERT_EQ(binary.read_matrix_market_file("test_shared.mtx", SolverMarketCSRMatrixLower), 0);
+    EXPECT_FALSE(binary.isShared());
+
+    SolverMarketVector<double, int> vector(4, 0.25);
+    ASSERT_EQ(vector.write_binary_file("test_shared_vector.bin"), MtxWriterSuccess);
+    SolverMarketVector<double, int> mapped;
+    ASSERT_EQ(mapped.read_binary_file("test_shared_vector.bin"), SolverMarketSharedSuccess);
+    ASSERT_EQ(mapped.get_n(), 4);
+    EXPECT_DOUBLE_EQ(mapped.get_host_values()(3), 0.25);
+    ASSERT_EQ(mapped.send_to_device(), 0);
+}
+
+TEST(SolverMarketShared, Errors) {
+    SolverMarketCSRMatrix<double, int> matrix;
+    EXPECT_EQ(matrix.read_shared_memory("/solver_market_no_such_segment"), SolverMarketSharedErrorOpen);
+    EXPECT_EQ(matrix.read_binary_file("no_such_file.csr"), SolverMarketSharedErrorOpen);
+
+    write_temp_file("test_shared_garbage.csr", std::string(256, 'x'));
+    EXPECT_EQ(matrix.read_binary_file("test_shared_garbage.csr"), SolverMarketSharedErrorFormat);
+
+    // Vector segment given to a matrix, and the other way round
+    SolverMarketVector<double, int>(4, 1.0).write_binary_file("test_shared_vector.bin");
+    EXPECT_EQ(matrix.read_binary_file("test_shared_vector.bin"), SolverMarketSharedErrorKind);
+
+    auto segment = std::make_shared<SolverMarketSharedSegment>();
+    ASSERT_EQ(segment->create_memfd("bad", SolverMarketSharedMatrix, 3, 5, sizeof(int), sizeof(double)), SolverMarketSharedSuccess);
+    fill_matrix(*segment);
+    SolverMarketVector<double, int> vector;
+    EXPECT_EQ(vector.attach_shared_segment(segment), SolverMarketSharedErrorKind);
+
+    // size_t indices cannot wrap 32 bit ones without a copy
+    SolverMarketCSRMatrix<double> wide;
+    EXPECT_EQ(wide.attach_shared_segment(segment), SolverMarketSharedErrorType);
+
+    // Offsets that would send a reader out of the arrays
+    segment->offsets<int>()[2] = 1;
+    EXPECT_EQ(matrix.attach_shared_segment(segment), SolverMarketSharedErrorOffsets);
+    segment->offsets<int>()[2] = 3;
+    segment->offsets<int>()[3] = 6;
+    EXPECT_EQ(matrix.attach_shared_segment(segment), SolverMarketSharedErrorOffsets);
+    EXPECT_FALSE(matrix.isShared());
+
+    // Columns that would send SpMV (or the device upload) out of the vectors
+    fill_matrix(*segment);
+    segment->columns<int>()[4] = 3;
+    EXPECT_EQ(matrix.attach_shared_segment(segment), SolverMarketSharedErrorColumns);
+    segment->columns<int>()[4] = -1;
+    EXPECT_EQ(matrix.attach_shared_segment(segment), SolverMarketSharedErrorColumns);
+    EXPECT_FALSE(matrix.isShared());
+    fill_matrix(*segment);
+    EXPECT_EQ(matrix.attach_shared_segment(segment), SolverMarketSharedSuccess);
+
+    // Tags that are not values of SolverMarketCSRMatrixView/Type
+    segment->header().matrix_type = 9;
+    EXPECT_EQ(matrix.attach_shared_segment(segment), SolverMarketSharedErrorType);
+    segment->header().matrix_type = 0;
+    segment->header().matrix_view = 4;
+    EXPECT_EQ(matrix.attach_shared_segment(segment), SolverMarketSharedErrorType);
+
+    // More rows than a 16 bit index can address
+    auto tall = std::make_shared<SolverMarketSharedSegment>();
+    ASSERT_EQ(tall->create_memfd("tall", SolverMarketSharedMatrix, 40000, 0, sizeof(int16_t), sizeof(double)), SolverMarketSharedSuccess);
+    SolverMarketCSRMatrix<double, int16_t> small;
+    EXPECT_EQ(small.attach_shared_segment(tall), SolverMarketSharedErrorType);
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "solver-market-tuner.hpp"
+
+
+void write_temp_file(const std::string& filename, const std::string& content) {
+    std::ofstream out(filename);
+    out << content;
+    out.close();
+}
+
+TEST(SolverMarketTuningSpace, ReadFileAndEnumerate) {
+    std::string content =
+        "# comment\n"
+        "smoother = JACOBI | GS\n"
+        "\n"
+        "sweeps = 1 | 2 | 3   # trailing comment\n";
+
+    write_temp_file("test_space.txt", content);
+    SolverMarketTuningSpace space;
+    ASSERT_EQ(space.read_file("test_space.txt"), 0);
+
+    ASSERT_EQ(space.num_parameters(), 2u);
+    ASSERT_EQ(space.size(), 6u);
+
+    auto first = space.candidate(0);
+    auto last = space.candidate(5);
+    EXPECT_EQ(SolverMarketCandidateToString(first), "smoother=JACOBI, sweeps=1");
+    EXPECT_EQ(SolverMarketCandidateToString(last), "smoother=GS, sweeps=3");
+
+    // Round trip through the cache format
+    EXPECT_EQ(SolverMarketCandidateFromString(SolverMarketCandidateToString(last, ";")), last);
+}
+
+TEST(SolverMarketTuningSpace, MalformedLine) {
+    write_temp_file("test_space_bad.txt", "smoother JACOBI\nsweeps = \n");
+    SolverMarketTuningSpace space;
+    EXPECT_NE(space.read_file("test_space_bad.txt"), 0);
+    EXPECT_NE(space.read_file("idontexist.txt"), 0);
+}
+
+TEST(SolverMarketTuningCache, ExactAndSimilarLookup) {
+    std::string filename = "test_tuning.cache";
+    std::remove(filename.c_str());
+    SolverMarketTuningCache cache(filename);
+
+    SolverMarketMatrixFeatures features;
+    features.fingerprint = 0x1234;
+    features.n = 50000;
+    features.row_nnz_mean = 7.0;
+    features.numerically_symmetric = true;
+
+    SolverMarketTuningCandidate candidate = {{"cycle", "W"}, {"sweeps", "2"}};
+    ASSERT_EQ(cache.store("amgx", features, candidate, 1.5), 0);
+
+    SolverMarketTuningCandidate found;
+    bool exact = false;
+    ASSERT_EQ(cache.lookup("amgx", features, found, exact), 0);
+    EXPECT_TRUE(exact);
+    EXPECT_EQ(found, candidate);
+
+    // Different structure, same class: found, but not exact
+    SolverMarketMatrixFeatures similar = features;
+    similar.fingerprint = 0x5678;
+    similar.n = 60000;
+    found.clear();
+    ASSERT_EQ(cache.lookup("amgx", similar, found, exact), 0);
+    EXPECT_FALSE(exact);
+    EXPECT_EQ(found, candidate);
+
+    // Other backend or other class: nothing
+    EXPECT_NE(cache.lookup("muelu", features, found, exact), 0);
+    SolverMarketMatrixFeatures other = similar;
+    other.n = 5000000;
+    EXPECT_NE(cache.lookup("amgx", other, found, exact), 0);
+}
+
+TEST(SolverMarketTuner, PicksFastestAndPrunes) {
+    SolverMarketTuningSpace space;
+    space.add("smoother", {"A", "B", "C"});
+    space.add("sweeps", {"1", "2", "3"});
+
+    // Synthetic backend: convergence factor and time per iteration per candidate
+    auto model = [](const SolverMarketTuningCandidate& c, double& rate, double& cost) {
+        const std::map<std::string, double> rates = {{"A", 0.9}, {"B", 0.3}, {"C", 1.2}};
+        const int sweeps = std::stoi(c[1].second);
+        rate = std::pow(rates.at(c[0].second), sweeps);
+        cost = 0.01 * sweeps;
+    };
+
+    std::map<std::string, int> calls;
+    auto trial = [&](const SolverMarketTuningCandidate& c, int max_iterations) {
+        double rate, cost;
+        model(c, rate, cost);
+        calls[SolverMarketCandidateToString(c)]++;
+
+        SolverMarketTuningTrial t;
+        t.success = true;
+        t.setup_time = 0.05;
+        t.residual_history.push_back(1.0);
+        for (int it = 1; it <= max_iterations; it++) {
+            t.residual_history.push_back(t.residual_history.back() * rate);
+            t.iterations = it;
+            if (t.residual_history.back() < 1e-8) { t.converged = true; break; }
+            if (t.residual_history.back() > 1e10) break;
+        }
+        t.relative_residual = t.residual_history.back();
+        t.solve_time = cost * t.iterations;
+        return t;
+    };
+
+    SolverMarketTuner tuner;
+    tuner.max_iterations = 200;
+    SolverMarketTuningCandidate best;
+    double best_time;
+    ASSERT_EQ(tuner.run(space, trial, best, best_time), 0);
+
+    // B with 1 sweep: 16 iterations at 0.01 s, better than more sweeps of B
+    EXPECT_EQ(SolverMarketCandidateToString(best), "smoother=B, sweeps=1");
+    EXPECT_NEAR(best_time, 0.05 + 0.16, 1e-12);
+
+    // Diverging candidates are probed once and dropped
+    EXPECT_EQ(calls["smoother=C, sweeps=3"], 1);
+    EXPECT_LT(tuner.get_num_trials(), 9 * 2);
+}
+
+TEST(SolverMarketTuner, SeedIsTriedFirstAndNoConvergence) {
+    SolverMarketTuningSpace space;
+    space.add("p", {"x", "y"});
+
+    std::vector<std::string> order;
+    auto never = [&](const SolverMarketTuningCandidate& c, int) {
+        order.push_back(c[0].second);
+        SolverMarketTuningTrial t;
+        t.success = false;
+        return t;
+    };
+
+    SolverMarketTuner tuner;
+    SolverMarketTuningCandidate best;
+    double best_time;
+    EXPECT_NE(tuner.run(space, never, best, best_time, {{"p", "y"}}), 0);
+    ASSERT_FALSE(order.empty());
+    EXPECT_EQ(order.front(), "y");
+}
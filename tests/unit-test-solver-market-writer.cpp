@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define GTEST_
+#include "solver-market-csr-matrix.hpp"
+#include "solver-market-vector.hpp"
+
+
+void write_temp_file(const std::string& filename, const std::string& content) {
+    std::ofstream out(filename);
+    out << content;
+    out.close();
+}
+
+std::string read_temp_file(const std::string& filename) {
+    std::ifstream in(filename);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Kokkos::initialize(argc, argv); {
+    int result = RUN_ALL_TESTS();
+    Kokkos::finalize();
+    return result;
+  }
+}
+
+TEST(SolverMarketCsrMatrixWriter, CoordinateRoundTrip) {
+    std::string content =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "4 4 6\n"
+        "1 1 0.1\n"
+        "1 4 0.3333333333333333\n"
+        "2 2 -2.5e10\n"
+        "3 1 1e-300\n"
+        "4 3 123456789.125\n"
+        "4 4 -0.0\n";
+
+    write_temp_file("test_write_in.mtx", content);
+    auto matrix = SolverMarketCSRMatrix<double>("test_write_in.mtx", SolverMarketCSRMatrixFull);
+    ASSERT_EQ(matrix.write_matrix_market_file("test_write_out.mtx"), MtxWriterSuccess);
+
+    auto copy = SolverMarketCSRMatrix<double>("test_write_out.mtx", SolverMarketCSRMatrixFull);
+    ASSERT_EQ(copy.get_n(), matrix.get_n());
+    ASSERT_EQ(copy.get_nnz(), matrix.get_nnz());
+
+    auto offsets = matrix.get_host_offsets(), offsets_copy = copy.get_host_offsets();
+    auto cols = matrix.get_host_columns(), cols_copy = copy.get_host_columns();
+    auto values = matrix.get_host_values(), values_copy = copy.get_host_values();
+
+    for (size_t i = 0; i < matrix.get_n() + 1; i++) {
+        EXPECT_EQ(offsets(i), offsets_copy(i));
+    }
+    for (size_t k = 0; k < matrix.get_nnz(); k++) {
+        EXPECT_EQ(cols(k), cols_copy(k));
+        // Bitwise identical: shortest round-trip representation
+        EXPECT_EQ(values(k), values_copy(k)) << "Mismatch at val[" << k << "]";
+    }
+}
+
+TEST(SolverMarketCsrMatrixWriter, FloatShortestRepresentation) {
+    std::string content =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "2 2 2\n"
+        "1 1 0.1\n"
+        "2 2 3.0\n";
+
+    write_temp_file("test_write_float_in.mtx", content);
+    auto matrix = SolverMarketCSRMatrix<float, int>("test_write_float_in.mtx", SolverMarketCSRMatrixFull);
+    ASSERT_EQ(matrix.write_matrix_market_file("test_write_float_out.mtx"), MtxWriterSuccess);
+
+    EXPECT_EQ(read_temp_file("test_write_float_out.mtx"),
+              "%%MatrixMarket matrix coordinate real general\n"
+              "2 2 2\n"
+              "1 1 0.1\n"
+              "2 2 3\n");
+}
+
+TEST(SolverMarketCsrMatrixWriter, SymmetricArray) {
+    std::string content =
+        "%%MatrixMarket matrix coordinate real symmetric\n"
+        "3 3 4\n"
+        "1 1 4.0\n"
+        "2 1 -1.0\n"
+        "2 2 4.0\n"
+        "3 3 2.5\n";
+
+    write_temp_file("test_write_sym.mtx", content);
+    auto matrix = SolverMarketCSRMatrix<double>("test_write_sym.mtx", SolverMarketCSRMatrixLower);
+    ASSERT_EQ(matrix.write_matrix_market_file("test_write_sym_array.mtx", SolverMarketFileArray), MtxWriterSuccess);
+
+    // Lower triangle, column major
+    EXPECT_EQ(read_temp_file("test_write_sym_array.mtx"),
+              "%%MatrixMarket matrix array real symmetric\n"
+              "3 3\n"
+              "4\n-1\n0\n"
+              "4\n0\n"
+              "2.5\n");
+
+    ASSERT_EQ(matrix.write_matrix_market_file("test_write_sym_coord.mtx"), MtxWriterSuccess);
+    auto copy = SolverMarketCSRMatrix<double>("test_write_sym_coord.mtx", SolverMarketCSRMatrixLower);
+    EXPECT_TRUE(copy.isSymmetric());
+    EXPECT_EQ(copy.get_nnz(), 4);
+}
+
+TEST(SolverMarketCsrMatrixWriter, SymmetricUpperIsWrittenAsLower) {
+    std::string content =
+        "%%MatrixMarket matrix coordinate real symmetric\n"
+        "3 3 4\n"
+        "1 1 4.0\n"
+        "1 2 -1.0\n"
+        "2 3 0.5\n"
+        "3 3 2.5\n";
+
+    write_temp_file("test_write_upper.mtx", content);
+    auto matrix = SolverMarketCSRMatrix<double>("test_write_upper.mtx", SolverMarketCSRMatrixUpper);
+    ASSERT_EQ(matrix.write_matrix_market_file("test_write_upper_coord.mtx"), MtxWriterSuccess);
+    EXPECT_EQ(read_temp_file("test_write_upper_coord.mtx"),
+              "%%MatrixMarket matrix coordinate real symmetric\n"
+              "3 3 4\n"
+              "1 1 4\n"
+              "2 1 -1\n"
+              "3 2 0.5\n"
+              "3 3 2.5\n");
+
+    // Skew-symmetric: the swapped entry changes sign
+    write_temp_file("test_write_upper_skew.mtx",
+        "%%MatrixMarket matrix coordinate real skew-symmetric\n"
+        "2 2 1\n"
+        "1 2 3.0\n");
+    auto skew = SolverMarketCSRMatrix<double>("test_write_upper_skew.mtx", SolverMarketCSRMatrixUpper);
+    ASSERT_EQ(skew.write_matrix_market_file("test_write_upper_skew_coord.mtx"), MtxWriterSuccess);
+    EXPECT_EQ(read_temp_file("test_write_upper_skew_coord.mtx"),
+              "%%MatrixMarket matrix coordinate real skew-symmetric\n"
+              "2 2 1\n"
+              "2 1 -3\n");
+}
+
+TEST(SolverMarketCsrMatrixWriter, GeneralArray) {
+    std::string content =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "2 2 3\n"
+        "1 2 2.0\n"
+        "2 1 3.0\n"
+        "2 2 4.0\n";
+
+    write_temp_file("test_write_gen.mtx", content);
+    auto matrix = SolverMarketCSRMatrix<double>("test_write_gen.mtx", SolverMarketCSRMatrixFull);
+    ASSERT_EQ(matrix.write_matrix_market_file("test_write_gen_array.mtx", SolverMarketFileArray), MtxWriterSuccess);
+
+    EXPECT_EQ(read_temp_file("test_write_gen_array.mtx"),
+              "%%MatrixMarket matrix array real general\n"
+              "2 2\n"
+              "0\n3\n"
+              "2\n4\n");
+}
+
+TEST(SolverMarketCsrMatrixWriter, Errors) {
+    SolverMarketCSRMatrix<double> empty;
+    EXPECT_EQ(empty.write_matrix_market_file("test_never_written.mtx"), MtxWriterErrorNotAllocated);
+
+    std::string content =
+        "%%MatrixMarket matrix coordinate real general\n"
+        "1 1 1\n"
+        "1 1 1.0\n";
+    write_temp_file("test_write_err.mtx", content);
+    auto matrix = SolverMarketCSRMatrix<double>("test_write_err.mtx", SolverMarketCSRMatrixFull);
+    EXPECT_EQ(matrix.write_matrix_market_file("idontexist/out.mtx"), MtxWriterErrorFileNotOpened);
+}
+
+TEST(SolverMarketVectorWriter, CoordinateRoundTripAndArray) {
+    SolverMarketVector<double> vec(5, 0.0);
+    auto values = vec.get_host_values();
+    values(0) = 0.1;
+    values(1) = -1.0 / 3.0;
+    values(3) = 6.02214076e23;
+    values(4) = 5e-324;
+
+    ASSERT_EQ(vec.write_matrix_market_file("test_write_vec.mtx"), MtxWriterSuccess);
+    SolverMarketVector<double> copy("test_write_vec.mtx");
+    ASSERT_EQ(copy.get_n(), 5);
+    auto values_copy = copy.get_host_values();
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(values(i), values_copy(i)) << "Mismatch at val[" << i << "]";
+    }
+
+    ASSERT_EQ(vec.write_matrix_market_file("test_write_vec_array.mtx", SolverMarketFileArray), MtxWriterSuccess);
+    EXPECT_EQ(read_temp_file("test_write_vec_array.mtx"),
+              "%%MatrixMarket matrix array real general\n"
+              "5 1\n"
+              "0.1\n-0.3333333333333333\n0\n6.02214076e+23\n5e-324\n");
+}